@@ -80,7 +80,222 @@ struct fdAT {
 
 APNGWriter::APNGWriter()
 {
+    m_file = 0;
+    m_textPos = -1;
+    m_actlPos = -1;
+    m_numFrames = 0;
+    m_sequenceNumber = 0;
+}
+
+APNGWriter::~APNGWriter()
+{
+    if (m_file) Close();
+}
+
+// encode an RGB buffer as a PNG file in memory
+// this only uses reentrant Qt classes so it is safe to call from a worker thread
+QByteArray APNGWriter::EncodePNG(quint32 width, quint32 height, const unsigned char *rgb)
+{
+    QImage image(rgb, width, height, width * 3, QImage::Format_RGB888);
+    QByteArray ba;
+    QBuffer buffer(&ba);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG"); // this saves the PNG file data to a QByteArray
+    return ba;
+}
+
+// open an APNG file for appending
+// if the file already exists then the new frames are added after the existing ones
+// nothing is written to a new file until the first frame arrives because the IHDR comes from that frame
+int APNGWriter::Open(const char *pathname)
+{
+    if (m_file) Close();
+    m_pathname = pathname;
+    m_signature.clear();
+    m_ihdr.clear();
+    m_textPos = -1;
+    m_actlPos = -1;
+    m_numFrames = 0;
+    m_sequenceNumber = 0;
+
+    if (QFileInfo(pathname).exists() == false)
+    {
+        m_file = new QFile(pathname);
+        if (m_file->open(QIODevice::WriteOnly) == false) { delete m_file; m_file = 0; return __LINE__; }
+        return 0;
+    }
+
+    m_file = new QFile(pathname);
+    if (m_file->open(QIODevice::ReadWrite) == false) { delete m_file; m_file = 0; return __LINE__; }
+
+    m_signature = m_file->read(sizeof(PNGSignature));
+    m_ihdr = m_file->read(sizeof(IHDR));
+    tEXt text;
+    m_textPos = m_file->pos();
+    m_file->read(reinterpret_cast<char *>(&text), sizeof(text));
+    acTL actl;
+    m_actlPos = m_file->pos();
+    m_file->read(reinterpret_cast<char *>(&actl), sizeof(actl));
+    if (m_signature.size() != sizeof(PNGSignature) || m_ihdr.size() != sizeof(IHDR) ||
+            memcmp(text.chunkType, "tEXt", sizeof(text.chunkType)) || memcmp(text.keyword, "last_seq", sizeof(text.keyword)) ||
+            memcmp(actl.chunkType, "acTL", sizeof(actl.chunkType)))
+    {
+        qDebug() << "APNGWriter::Open: " << pathname << " is not an APNG file created by GaitSym";
+        m_file->close(); delete m_file; m_file = 0;
+        return __LINE__;
+    }
+    bool ok;
+    m_sequenceNumber = QString(QByteArray((const char *)text.text, sizeof(text.text))).toUInt(&ok, 16);
+    m_numFrames = qFromBigEndian<quint32>(actl.numFrames);
+
+    // the IEND is rewritten by Close()
+    m_file->seek(m_file->size() - sizeof(IEND));
+    return 0;
+}
+
+// append a single frame that has already been encoded as a PNG (e.g. by EncodePNG)
+int APNGWriter::AppendPNG(const QByteArray &png)
+{
+    if (m_file == 0) return __LINE__;
+
+    PNGSignature signature;
+    IHDR ihdr;
+    std::vector<IDAT> idatVector;
+    IEND iend;
+    int err = DecodePNG(reinterpret_cast<const quint8 *>(png.constData()), png.size(), &signature, &ihdr, &idatVector, &iend);
+    if (err) return err;
+
+    if (m_textPos < 0)
+    {
+        // first frame in a new file so write the headers with placeholder counts
+        m_signature = QByteArray(reinterpret_cast<const char *>(&signature), sizeof(signature));
+        m_ihdr = QByteArray(reinterpret_cast<const char *>(&ihdr), sizeof(ihdr));
+        m_file->write(m_signature);
+        m_file->write(m_ihdr);
+
+        tEXt text = {
+            /*chunkLength*/ qToBigEndian(quint32(sizeof(text) - 12)),
+            /*chunkType*/ {'t','E','X','t'},
+            /*keyword*/ {'l','a','s','t','_','s','e','q'},
+            /*nullSeparator*/ 0,
+            /*text*/ {'0','0','0','0','0','0','0','0'},
+            /*crc*/ 0
+        };
+        m_textPos = m_file->pos();
+        m_file->write(reinterpret_cast<const char *>(&text), sizeof(text));
+
+        acTL actl = {
+            /*chunkLength*/ qToBigEndian(quint32(sizeof(actl) - 12)),
+            /*chunkType*/ {'a','c','T','L'},
+            /*numFrames*/ qToBigEndian(0u),
+            /*numPlays*/ qToBigEndian(0u),
+            /*crc*/ 0
+        };
+        m_actlPos = m_file->pos();
+        m_file->write(reinterpret_cast<const char *>(&actl), sizeof(actl));
+    }
+    else
+    {
+        if (memcmp(m_signature.constData(), &signature, sizeof(signature)) || memcmp(m_ihdr.constData(), &ihdr, sizeof(ihdr)))
+        {
+            qDebug() << "APNGWriter::AppendPNG: frame does not match the existing frames in " << m_pathname;
+            return __LINE__;
+        }
+    }
 
+    // fcTL
+    fcTL fctl = {
+        /*fctl.chunkLength*/ qToBigEndian(quint32(sizeof(fctl) - 12)),
+        /*fctl.chunkType*/ {'f','c','T','L'},
+        /*fctl.sequenceNumber*/ qToBigEndian(m_sequenceNumber++),
+        /*fctl.width*/ ihdr.width, // already big endian
+        /*fctl.height*/ ihdr.height,
+        /*fctl.xOffset*/ qToBigEndian(0u),
+        /*fctl.yOffset*/ qToBigEndian(0u),
+        /*fctl.delayNumerator*/ qToBigEndian(quint16(40)),
+        /*fctl.delayDenominator*/ qToBigEndian(quint16(1000)), // 1000 makes the numerator work in ms
+        /*fctl.disposeOp*/ 0,
+        /*fctl.blendOp*/ 0,
+        /*fctl.crc*/ 0
+    };
+    fctl.crc = qToBigEndian(PNGCRC32(reinterpret_cast<const quint8 *>(&fctl) + 4, sizeof(fctl) - 8));
+    m_file->write(reinterpret_cast<const char *>(&fctl), sizeof(fctl));
+
+    if (m_numFrames == 0)
+    {
+        // the first frame uses the IDAT chunks unchanged
+        for (unsigned int i = 0; i < idatVector.size(); i++)
+        {
+            const IDAT &idat = idatVector[i];
+            m_file->write(reinterpret_cast<const char *>(&idat), sizeof(idat.chunkLength) + sizeof(idat.chunkType));
+            m_file->write(reinterpret_cast<const char *>(idat.chunkData), qFromBigEndian<quint32>(idat.chunkLength));
+            m_file->write(reinterpret_cast<const char *>(&idat.crc), sizeof(idat.crc));
+        }
+    }
+    else
+    {
+        // subsequent frames need to convert IDAT to fdAT
+        QByteArray fdatData;
+        for (unsigned int i = 0; i < idatVector.size(); i++)
+        {
+            const IDAT &idat = idatVector[i];
+            int fdatSize = qFromBigEndian<quint32>(idat.chunkLength) + 16;
+            fdatData.resize(fdatSize);
+            quint8 *fdat = reinterpret_cast<quint8 *>(fdatData.data());
+            quint32 value = qToBigEndian(qFromBigEndian<quint32>(idat.chunkLength) + 4);
+            memcpy(&fdat[0], &value, 4);
+            memcpy(&fdat[4], "fdAT", 4);
+            value = qToBigEndian(m_sequenceNumber++);
+            memcpy(&fdat[8], &value, 4);
+            memcpy(&fdat[12], idat.chunkData, qFromBigEndian<quint32>(idat.chunkLength));
+            quint32 crc = qToBigEndian(PNGCRC32(fdat + 4, fdatSize - 8));
+            memcpy(&fdat[fdatSize - 4], &crc, 4);
+            m_file->write(fdatData);
+        }
+    }
+    m_numFrames++;
+    return 0;
+}
+
+// finish off the file by adding the IEND and patching the frame count and sequence number
+int APNGWriter::Close()
+{
+    if (m_file == 0) return __LINE__;
+    if (m_textPos >= 0)
+    {
+        IEND iend = {/*chunkLength*/ qToBigEndian(0u), /*chunkType*/ {'I','E','N','D'}, /*crc*/ 0};
+        iend.crc = qToBigEndian(PNGCRC32(reinterpret_cast<const quint8 *>(&iend) + 4, sizeof(iend) - 8));
+        m_file->write(reinterpret_cast<const char *>(&iend), sizeof(iend));
+
+        tEXt text = {
+            /*chunkLength*/ qToBigEndian(quint32(sizeof(text) - 12)),
+            /*chunkType*/ {'t','E','X','t'},
+            /*keyword*/ {'l','a','s','t','_','s','e','q'},
+            /*nullSeparator*/ 0,
+            /*text*/ {'0','0','0','0','0','0','0','0'},
+            /*crc*/ 0
+        };
+        memcpy(&text.text, QString("%1").arg(m_sequenceNumber, 8, 16, QLatin1Char( '0' )).toUtf8().constData(), sizeof(text.text));
+        text.crc = qToBigEndian(PNGCRC32(reinterpret_cast<const quint8 *>(&text) + 4, sizeof(text) - 8));
+        m_file->seek(m_textPos);
+        m_file->write(reinterpret_cast<const char *>(&text), sizeof(text));
+
+        acTL actl = {
+            /*chunkLength*/ qToBigEndian(quint32(sizeof(actl) - 12)),
+            /*chunkType*/ {'a','c','T','L'},
+            /*numFrames*/ qToBigEndian(m_numFrames),
+            /*numPlays*/ qToBigEndian(0u),
+            /*crc*/ 0
+        };
+        actl.crc = qToBigEndian(PNGCRC32(reinterpret_cast<const quint8 *>(&actl) + 4, sizeof(actl) - 8));
+        m_file->seek(m_actlPos);
+        m_file->write(reinterpret_cast<const char *>(&actl), sizeof(actl));
+    }
+    m_file->close();
+    if (m_textPos < 0) m_file->remove(); // no frames were ever written
+    delete m_file;
+    m_file = 0;
+    return 0;
 }
 
 
@@ -99,11 +314,7 @@ void APNGWriter::WriteAPNG(const char *pathname, quint32 width, quint32 height,
         }
     }
 
-    QImage image(rgb, width, height, width * 3, QImage::Format_RGB888);
-    QByteArray ba;
-    QBuffer buffer(&ba);
-    buffer.open(QIODevice::WriteOnly);
-    image.save(&buffer, "PNG"); // this saves the PNG file data to a QByteArray
+    QByteArray ba = EncodePNG(width, height, rgb);
 
     PNGSignature signature;
     IHDR ihdr;
@@ -2,6 +2,7 @@
 #define APNGWRITER_H
 
 #include <qglobal.h>
+#include <QByteArray>
 #include <vector>
 
 struct PNGSignature;
@@ -9,14 +10,36 @@ struct IHDR;
 struct IEND;
 struct IDAT;
 
+class QFile;
+
 class APNGWriter
 {
 public:
     APNGWriter();
+    ~APNGWriter();
 
     static void WriteAPNG(const char *pathname, quint32 width, quint32 height, const unsigned char *rgb, bool deleteExisting);
     static int DecodePNG(const quint8 *data, quint32 length, PNGSignature *signature, IHDR *ihdr, std::vector<IDAT> *idatVector, IEND *iend);
     static quint32 PNGCRC32(const quint8 *data, size_t length);
+    static QByteArray EncodePNG(quint32 width, quint32 height, const unsigned char *rgb);
+
+    // appender interface - keeps the file open between frames and only patches the headers in Close()
+    int Open(const char *pathname);
+    int AppendPNG(const QByteArray &png);
+    int Close();
+
+    bool isOpen() const { return m_file != 0; }
+    const QByteArray &pathname() const { return m_pathname; }
+
+private:
+    QFile *m_file;
+    QByteArray m_pathname;
+    QByteArray m_signature;
+    QByteArray m_ihdr;
+    qint64 m_textPos;
+    qint64 m_actlPos;
+    quint32 m_numFrames;
+    quint32 m_sequenceNumber;
 };
 
 #endif // APNGWRITER_H
@@ -296,7 +296,6 @@ void DialogInterface::colourStrap()
             for (muscleIter = muscleList->begin(); muscleIter != muscleList->end(); muscleIter++)
             {
                 muscleIter->second->GetStrap()->SetColour(m_StrapColour.redF(), m_StrapColour.greenF(), m_StrapColour.blueF(), m_StrapColour.alphaF());
-                muscleIter->second->GetStrap()->SetLastDrawTime(-1);
             }
             m_simulation->GetInterface()->StrapColour.SetColour(m_StrapColour.redF(), m_StrapColour.greenF(), m_StrapColour.blueF(), m_StrapColour.alphaF());
             emit EmitRedrawRequired();
@@ -324,7 +323,6 @@ void DialogInterface::colourStrapForce()
             for (muscleIter = muscleList->begin(); muscleIter != muscleList->end(); muscleIter++)
             {
                 muscleIter->second->GetStrap()->SetForceColour(m_simulation->GetInterface()->StrapForceColour);
-                muscleIter->second->GetStrap()->SetLastDrawTime(-1);
             }
             emit EmitRedrawRequired();
         }
@@ -352,18 +350,12 @@ void DialogInterface::colourStrapCylinder()
             {
                 CylinderWrapStrap *cylinderWrapStrap = dynamic_cast<CylinderWrapStrap *>(muscleIter->second->GetStrap());
                 if (cylinderWrapStrap)
-                {
                     cylinderWrapStrap->SetCylinderColour(m_simulation->GetInterface()->StrapCylinderColour);
-                    cylinderWrapStrap->SetLastDrawTime(-1);
-                }
                 else
                 {
                     TwoCylinderWrapStrap *twoCylinderWrapStrap = dynamic_cast<TwoCylinderWrapStrap *>(muscleIter->second->GetStrap());
                     if (twoCylinderWrapStrap)
-                    {
                         twoCylinderWrapStrap->SetCylinderColour(m_simulation->GetInterface()->StrapCylinderColour);
-                        twoCylinderWrapStrap->SetLastDrawTime(-1);
-                    }
                 }
             }
             emit EmitRedrawRequired();
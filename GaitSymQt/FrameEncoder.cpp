@@ -0,0 +1,198 @@
+#include "FrameEncoder.h"
+#include "TIFFWrite.h"
+
+#include <QDebug>
+
+#include <stdio.h>
+
+FrameEncoder::FrameEncoder(int numThreads, int maxBuffers)
+{
+    if (numThreads <= 0)
+    {
+        numThreads = std::thread::hardware_concurrency() - 1; // leave a core for the simulation
+        if (numThreads < 1) numThreads = 1;
+    }
+    m_maxBuffers = maxBuffers;
+    if (m_maxBuffers <= 0) m_maxBuffers = 2 * numThreads + 1;
+    m_activeJobs = 0;
+    m_quit = false;
+    m_nextAPNGSequence = 0;
+    m_nextAPNGSubmit = 0;
+    for (int i = 0; i < numThreads; i++) m_threads.push_back(std::thread(&FrameEncoder::WorkerLoop, this));
+}
+
+FrameEncoder::~FrameEncoder()
+{
+    Flush();
+    {
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        m_quit = true;
+    }
+    m_jobAvailable.notify_all();
+    for (unsigned int i = 0; i < m_threads.size(); i++) m_threads[i].join();
+    for (std::map<unsigned char *, size_t>::iterator it = m_bufferSizes.begin(); it != m_bufferSizes.end(); it++) delete [] it->first;
+}
+
+unsigned char *FrameEncoder::AcquireBuffer(size_t size)
+{
+    std::unique_lock<std::mutex> lock(m_bufferMutex);
+    while (true)
+    {
+        for (unsigned int i = 0; i < m_freeBuffers.size(); i++)
+        {
+            unsigned char *rgb = m_freeBuffers[i];
+            if (m_bufferSizes[rgb] >= size)
+            {
+                m_freeBuffers.erase(m_freeBuffers.begin() + i);
+                return rgb;
+            }
+        }
+        if (m_freeBuffers.size())
+        {
+            // the frame size has changed so replace a buffer that is too small
+            unsigned char *rgb = m_freeBuffers.back();
+            m_freeBuffers.pop_back();
+            m_bufferSizes.erase(rgb);
+            delete [] rgb;
+        }
+        if (int(m_bufferSizes.size()) < m_maxBuffers)
+        {
+            unsigned char *rgb = new unsigned char[size];
+            m_bufferSizes[rgb] = size;
+            return rgb;
+        }
+        // all the buffers are queued so wait for the encoders to catch up
+        m_bufferAvailable.wait(lock);
+    }
+}
+
+void FrameEncoder::ReleaseBuffer(unsigned char *rgb)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_bufferMutex);
+        m_freeBuffers.push_back(rgb);
+    }
+    m_bufferAvailable.notify_one();
+}
+
+void FrameEncoder::Submit(Format format, const QString &pathname, int width, int height, unsigned char *rgb)
+{
+    Job job;
+    job.format = format;
+    job.pathname = pathname.toUtf8();
+    job.width = width;
+    job.height = height;
+    job.rgb = rgb;
+    job.apngSequence = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        if (format == APNG) job.apngSequence = m_nextAPNGSubmit++;
+        m_jobs.push_back(job);
+    }
+    m_jobAvailable.notify_one();
+}
+
+void FrameEncoder::Flush()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_jobMutex);
+        while (m_jobs.size() || m_activeJobs) m_jobsDone.wait(lock);
+    }
+    std::lock_guard<std::mutex> lock(m_apngMutex);
+    if (m_apngWriter.isOpen()) m_apngWriter.Close();
+}
+
+void FrameEncoder::WorkerLoop()
+{
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_jobMutex);
+            while (m_jobs.empty() && m_quit == false) m_jobAvailable.wait(lock);
+            if (m_jobs.empty()) return;
+            job = m_jobs.front();
+            m_jobs.pop_front();
+            m_activeJobs++;
+        }
+
+        switch (job.format)
+        {
+        case TIFF:
+            WriteTIFF(job.pathname.constData(), job.width, job.height, job.rgb);
+            ReleaseBuffer(job.rgb);
+            break;
+
+        case PPM:
+            WritePPM(job.pathname.constData(), job.width, job.height, job.rgb);
+            ReleaseBuffer(job.rgb);
+            break;
+
+        case APNG:
+            if (1)
+            {
+                QByteArray png = APNGWriter::EncodePNG(job.width, job.height, job.rgb);
+                ReleaseBuffer(job.rgb); // release before appending so capture can carry on
+                AppendAPNG(job, png);
+            }
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_jobMutex);
+            m_activeJobs--;
+        }
+        m_jobsDone.notify_all();
+    }
+}
+
+// frames can finish encoding in any order so they are held until all the earlier frames have been written
+void FrameEncoder::AppendAPNG(const Job &job, const QByteArray &png)
+{
+    std::lock_guard<std::mutex> lock(m_apngMutex);
+    m_pendingPNG[job.apngSequence] = std::make_pair(job.pathname, png);
+    std::map<quint64, std::pair<QByteArray, QByteArray> >::iterator it;
+    while ((it = m_pendingPNG.begin()) != m_pendingPNG.end() && it->first == m_nextAPNGSequence)
+    {
+        const QByteArray &pathname = it->second.first;
+        if (m_apngWriter.isOpen() == false || m_apngWriter.pathname() != pathname)
+        {
+            if (m_apngWriter.isOpen()) m_apngWriter.Close();
+            if (m_apngWriter.Open(pathname.constData())) qDebug() << "FrameEncoder: unable to open " << pathname;
+        }
+        if (m_apngWriter.isOpen() && it->second.second.size())
+        {
+            if (m_apngWriter.AppendPNG(it->second.second)) qDebug() << "FrameEncoder: unable to append frame to " << pathname;
+        }
+        m_pendingPNG.erase(it);
+        m_nextAPNGSequence++;
+    }
+}
+
+// write a PPM file (the screenshot rows are already top to bottom so this matches the Irrlicht PPM writer)
+void FrameEncoder::WritePPM(const char *pathname, int width, int height, const unsigned char *rgb)
+{
+    FILE *out;
+
+    out = fopen(pathname, "wb");
+    if (out == 0) return;
+
+    fprintf(out, "P6\n%d %d\n255\n", width, height);
+    fwrite(rgb, width * 3, height, out);
+
+    fclose(out);
+}
+
+// write a TIFF file
+void FrameEncoder::WriteTIFF(const char *pathname, int width, int height, const unsigned char *rgb)
+{
+    TIFFWrite tiff;
+    int i;
+
+    tiff.initialiseImage(width, height, 72, 72, 3);
+    // need to invert write order
+    for (i = 0; i < height; i ++)
+        tiff.copyRow(height - i - 1, const_cast<unsigned char *>(rgb + (i * width * 3)));
+
+    tiff.writeToFile(const_cast<char *>(pathname));
+}
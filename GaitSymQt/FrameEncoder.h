@@ -0,0 +1,77 @@
+#ifndef FRAMEENCODER_H
+#define FRAMEENCODER_H
+
+#include "APNGWriter.h"
+
+#include <QByteArray>
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// FrameEncoder takes RGB frames captured on the GUI thread and encodes them
+// to disk on a pool of worker threads. The RGB buffers are recycled so that
+// once the pool has warmed up recording a frame is just a copy from the
+// framebuffer. APNG frames are compressed in parallel but are appended to the
+// file in the order they were submitted.
+
+class FrameEncoder
+{
+public:
+    enum Format {TIFF, PPM, APNG};
+
+    FrameEncoder(int numThreads = 0, int maxBuffers = 0);
+    ~FrameEncoder();
+
+    // get a buffer of at least size bytes, blocking if all the buffers are in use
+    unsigned char *AcquireBuffer(size_t size);
+    // return a buffer to the pool without encoding it
+    void ReleaseBuffer(unsigned char *rgb);
+    // hand a filled buffer over to the encoder threads - the encoder owns the buffer from now on
+    void Submit(Format format, const QString &pathname, int width, int height, unsigned char *rgb);
+    // wait for all the queued frames to be written and close any open APNG
+    void Flush();
+
+    static void WritePPM(const char *pathname, int width, int height, const unsigned char *rgb);
+    static void WriteTIFF(const char *pathname, int width, int height, const unsigned char *rgb);
+
+private:
+    struct Job
+    {
+        Format format;
+        QByteArray pathname;
+        int width;
+        int height;
+        unsigned char *rgb;
+        quint64 apngSequence;
+    };
+
+    void WorkerLoop();
+    void AppendAPNG(const Job &job, const QByteArray &png);
+
+    std::vector<std::thread> m_threads;
+    std::deque<Job> m_jobs;
+    std::mutex m_jobMutex;
+    std::condition_variable m_jobAvailable;
+    std::condition_variable m_jobsDone;
+    int m_activeJobs;
+    bool m_quit;
+
+    std::vector<unsigned char *> m_freeBuffers;
+    std::map<unsigned char *, size_t> m_bufferSizes; // all the allocated buffers and their capacity
+    int m_maxBuffers;
+    std::mutex m_bufferMutex;
+    std::condition_variable m_bufferAvailable;
+
+    // APNG frames are reordered here before being appended
+    APNGWriter m_apngWriter;
+    std::map<quint64, std::pair<QByteArray, QByteArray> > m_pendingPNG; // sequence -> (pathname, png)
+    quint64 m_nextAPNGSequence;
+    quint64 m_nextAPNGSubmit;
+    std::mutex m_apngMutex;
+};
+
+#endif // FRAMEENCODER_H
@@ -499,13 +499,16 @@ SOURCES += \
     ../ode-0.15/OPCODE/StdAfx.cpp \
     ../src/AMotorJoint.cpp \
     ../src/BallJoint.cpp \
+    ../src/BinaryMesh.cpp \
     ../src/Body.cpp \
     ../src/BoxCarDriver.cpp \
     ../src/BoxGeom.cpp \
     ../src/ButterworthFilter.cpp \
+    ../src/BVHTriangleSelector.cpp \
     ../src/CappedCylinderGeom.cpp \
     ../src/Contact.cpp \
     ../src/Controller.cpp \
+    ../src/CurveTable.cpp \
     ../src/CyclicDriver.cpp \
     ../src/CylinderWrapStrap.cpp \
     ../src/DampedSpringMuscle.cpp \
@@ -516,9 +519,12 @@ SOURCES += \
     ../src/DataTargetVector.cpp \
     ../src/Drivable.cpp \
     ../src/Driver.cpp \
+    ../src/DriverEngine.cpp \
+    ../src/EnergyAccounts.cpp \
     ../src/Environment.cpp \
     ../src/ErrorHandler.cpp \
     ../src/Face.cpp \
+    ../src/FacetedBatch.cpp \
     ../src/FacetedBox.cpp \
     ../src/FacetedCappedCylinder.cpp \
     ../src/FacetedConicSegment.cpp \
@@ -531,12 +537,16 @@ SOURCES += \
     ../src/FloatingHingeJoint.cpp \
     ../src/Geom.cpp \
     ../src/GLUtils.cpp \
+    ../src/HeadlessRenderer.cpp \
+    ../src/HeightfieldGeom.cpp \
     ../src/HingeJoint.cpp \
     ../src/Joint.cpp \
     ../src/MAMuscle.cpp \
     ../src/MAMuscleComplete.cpp \
     ../src/MAMuscleExtended.cpp \
     ../src/Marker.cpp \
+    ../src/MeshBVH.cpp \
+    ../src/MeshCache.cpp \
     ../src/MovingAverage.cpp \
     ../src/Muscle.cpp \
     ../src/NamedObject.cpp \
@@ -561,6 +571,7 @@ SOURCES += \
     ../src/ThreePointStrap.cpp \
     ../src/TIFFWrite.cpp \
     ../src/TorqueReporter.cpp \
+    ../src/Trace.cpp \
     ../src/TrimeshGeom.cpp \
     ../src/TwoCylinderWrapStrap.cpp \
     ../src/TwoPointStrap.cpp \
@@ -587,7 +598,9 @@ SOURCES += \
     TrackBall.cpp \
     ViewControlWidget.cpp \
     ../src/Filter.cpp \
-    APNGWriter.cpp
+    ../src/FilterBank.cpp \
+    APNGWriter.cpp \
+    FrameEncoder.cpp
 HEADERS += \
     ../ann_1.1.2/include/ANN/ANN.h \
     ../ann_1.1.2/include/ANN/ANNperf.h \
@@ -1171,13 +1184,16 @@ HEADERS += \
     ../rapidxml-1.13/rapidxml.hpp \
     ../src/AMotorJoint.h \
     ../src/BallJoint.h \
+    ../src/BinaryMesh.h \
     ../src/Body.h \
     ../src/BoxCarDriver.h \
     ../src/BoxGeom.h \
     ../src/ButterworthFilter.h \
+    ../src/BVHTriangleSelector.h \
     ../src/CappedCylinderGeom.h \
     ../src/Contact.h \
     ../src/Controller.h \
+    ../src/CurveTable.h \
     ../src/CyclicDriver.h \
     ../src/CylinderWrapStrap.h \
     ../src/DampedSpringMuscle.h \
@@ -1189,9 +1205,12 @@ HEADERS += \
     ../src/DebugControl.h \
     ../src/Drivable.h \
     ../src/Driver.h \
+    ../src/DriverEngine.h \
+    ../src/EnergyAccounts.h \
     ../src/Environment.h \
     ../src/ErrorHandler.h \
     ../src/Face.h \
+    ../src/FacetedBatch.h \
     ../src/FacetedBox.h \
     ../src/FacetedCappedCylinder.h \
     ../src/FacetedConicSegment.h \
@@ -1204,12 +1223,16 @@ HEADERS += \
     ../src/FloatingHingeJoint.h \
     ../src/Geom.h \
     ../src/GLUtils.h \
+    ../src/HeadlessRenderer.h \
+    ../src/HeightfieldGeom.h \
     ../src/HingeJoint.h \
     ../src/Joint.h \
     ../src/MAMuscle.h \
     ../src/MAMuscleComplete.h \
     ../src/MAMuscleExtended.h \
     ../src/Marker.h \
+    ../src/MeshBVH.h \
+    ../src/MeshCache.h \
     ../src/MovingAverage.h \
     ../src/MPIStuff.h \
     ../src/Muscle.h \
@@ -1238,6 +1261,7 @@ HEADERS += \
     ../src/ThreePointStrap.h \
     ../src/TIFFWrite.h \
     ../src/TorqueReporter.h \
+    ../src/Trace.h \
     ../src/TrimeshGeom.h \
     ../src/TwoCylinderWrapStrap.h \
     ../src/TwoPointStrap.h \
@@ -1264,7 +1288,9 @@ HEADERS += \
     TrackBall.h \
     ViewControlWidget.h \
     ../src/Filter.h \
-    APNGWriter.h
+    ../src/FilterBank.h \
+    APNGWriter.h \
+    FrameEncoder.h
 FORMS += \
     AboutDialog.ui \
     DialogInterface.ui \
@@ -410,6 +410,7 @@ void MainWindow::menuRecordMovie()
     {
         m_movieFlag = false;
         if (m_simulationWindow->getMovieFormat() == SimulationWindow::Quicktime) menuStopQuicktimeSave();
+        m_simulationWindow->FlushFrames();
         ui->radioButtonOBJ->setEnabled(true);
         ui->radioButtonAPNG->setEnabled(true);
         ui->radioButtonPPM->setEnabled(true);
@@ -530,6 +531,7 @@ void MainWindow::snapshot()
         if (m_simulationWindow->getMovieFormat() == SimulationWindow::OBJNOBODIES) m_simulationWindow->setMovieFormat(SimulationWindow::OBJ); // this is kludge for now
         m_simulationWindow->WriteFrame(QString("%1/%2").arg(configFile.absolutePath()).arg(filename));
     }
+    if (m_movieFlag == false) m_simulationWindow->FlushFrames();
     statusBar()->showMessage(tr("Snapshot taken"));
 }
 
@@ -763,10 +765,8 @@ void MainWindow::checkboxMuscleForce(int v)
         for (std::map<std::string, Muscle *>::const_iterator muscleIter = muscleList->begin(); muscleIter != muscleList->end(); muscleIter++)
         {
             muscleIter->second->setDrawMuscleForces(m_preferences->DisplayMuscleForces);
-            muscleIter->second->GetStrap()->SetLastDrawTime(-1);
-            muscleIter->second->Draw(m_simulationWindow);
-
         }
+        m_simulation->Draw(m_simulationWindow);
     }
     m_simulationWindow->updateCamera();
     m_simulationWindow->renderLater();
@@ -784,7 +784,6 @@ void MainWindow::checkboxActivationColours(int v)
             muscleIter->second->setActivationDisplay(static_cast<bool>(v));
             muscleIter->second->GetStrap()->SetColour(m_simulation->GetInterface()->StrapColour);
             muscleIter->second->GetStrap()->SetForceColour(m_simulation->GetInterface()->StrapForceColour);
-            muscleIter->second->GetStrap()->SetLastDrawTime(-1);
         }
     }
     m_simulationWindow->updateCamera();
@@ -868,8 +867,7 @@ void MainWindow::listMuscleChecked(QListWidgetItem* item)
     bool visible = true;
     if (item->checkState() == Qt::Unchecked) visible = false;
     (*m_simulation->GetMuscleList())[std::string(item->text().toUtf8())]->SetAllVisible(visible);
-    (*m_simulation->GetMuscleList())[std::string(item->text().toUtf8())]->GetStrap()->SetLastDrawTime(-1);
-    (*m_simulation->GetMuscleList())[std::string(item->text().toUtf8())]->Draw(m_simulationWindow);
+    m_simulation->Draw(m_simulationWindow);
     m_simulationWindow->updateCamera();
     m_simulationWindow->renderLater();
 }
@@ -1123,9 +1121,8 @@ void MainWindow::menuRequestMuscle(QPoint p)
             item = ui->listWidgetMuscle->item(i);
             item->setCheckState(state);
             (*m_simulation->GetMuscleList())[std::string(item->text().toUtf8())]->SetAllVisible(visible);
-            (*m_simulation->GetMuscleList())[std::string(item->text().toUtf8())]->GetStrap()->SetLastDrawTime(-1);
-            (*m_simulation->GetMuscleList())[std::string(item->text().toUtf8())]->Draw(m_simulationWindow);
         }
+        m_simulation->Draw(m_simulationWindow);
         m_simulationWindow->updateCamera();
         m_simulationWindow->renderLater();
     }
@@ -2,8 +2,10 @@
 #include "Simulation.h"
 #include "Body.h"
 #include "FacetedObject.h"
+#include "FacetedBatch.h"
+#include "BVHTriangleSelector.h"
 #include "trackball.h"
-#include "TIFFWrite.H"
+#include "FrameEncoder.h"
 #include "CCameraSceneNode.h"
 
 #include <QApplication>
@@ -16,6 +18,8 @@
 #include <QDebug>
 #include <QBuffer>
 
+#include <cfloat>
+
 #define CLAMP(x, low, high)  (((x) > (high)) ? (high) : (((x) < (low)) ? (low) : (x)))
 
 SimulationWindow::SimulationWindow(QWindow *parent)
@@ -49,10 +53,15 @@ SimulationWindow::SimulationWindow(QWindow *parent)
     m_highlightedNode = 0;
     m_movieFormat = TIFF;
     m_qtMovie = 0;
+    m_frameEncoder = new FrameEncoder();
+    m_strapBatch = new FacetedBatch();
+    m_strapBatch->setSimulationWindow(this);
 }
 
 SimulationWindow::~SimulationWindow()
 {
+    delete m_strapBatch;
+    delete m_frameEncoder;
 }
 
 void SimulationWindow::initialiseScene()
@@ -443,43 +452,68 @@ irr::scene::ISceneNode* SimulationWindow::getSceneNodeAndCollisionPointFromRawSc
     m_projectPanMatrix.getInverse(m_unprojectPanMatrix); // we need the unproject matrix
     m_unprojectPanMatrix.transformVect(startPoint, startPointScreen); // this is now in world coordinates
     m_unprojectPanMatrix.transformVect(endPoint, endPointScreen);
-    irr::scene::ISceneCollisionManager* collMan = sceneManager()->getSceneCollisionManager();
     irr::core::line3d<irr::f32> ray(startPoint[0]/startPoint[3], startPoint[1]/startPoint[3], startPoint[2]/startPoint[3],
             endPoint[0]/endPoint[3], endPoint[1]/endPoint[3], endPoint[2]/endPoint[3]);
     //qDebug("ray=%f,%f,%f to %f,%f,%f", ray.start.X, ray.start.Y, ray.start.Z, ray.end.X, ray.end.Y, ray.end.Z);
-    irr::scene::ISceneNode* node = collMan->getSceneNodeAndCollisionPointFromRay(ray, outCollisionPoint, outTriangle, idBitMask);
+    irr::scene::ISceneNode* node = 0;
+    irr::f32 bestDistanceSquared = FLT_MAX;
+    PickSceneNode(sceneManager()->getRootSceneNode(), ray, idBitMask, &bestDistanceSquared, &node, outCollisionPoint, outTriangle);
     return node;
 }
 
+// this replaces ISceneCollisionManager::getSceneNodeAndCollisionPointFromRay because that gathers and transforms
+// every triangle near the ray whereas the BVHTriangleSelector only tests a few nodes of its tree in local coordinates
+void SimulationWindow::PickSceneNode(irr::scene::ISceneNode *sceneNode, const irr::core::line3df &ray, irr::s32 idBitMask, irr::f32 *bestDistanceSquared,
+                                     irr::scene::ISceneNode **bestNode, irr::core::vector3df &outCollisionPoint, irr::core::triangle3df &outTriangle)
+{
+    const irr::scene::ISceneNodeList &children = sceneNode->getChildren();
+    for (irr::scene::ISceneNodeList::ConstIterator it = children.begin(); it != children.end(); it++)
+    {
+        irr::scene::ISceneNode *current = *it;
+        irr::scene::ITriangleSelector *selector = current->getTriangleSelector();
+        if (selector && current->isVisible() && (idBitMask == 0 || (current->getID() & idBitMask)))
+        {
+            irr::core::vector3df collisionPoint;
+            irr::core::triangle3df triangle;
+            irr::scene::ISceneNode *hitNode = 0;
+            bool hit;
+            BVHTriangleSelector *bvhSelector = dynamic_cast<BVHTriangleSelector *>(selector);
+            if (bvhSelector) hit = bvhSelector->IntersectRay(ray, collisionPoint, triangle);
+            else hit = sceneManager()->getSceneCollisionManager()->getCollisionPoint(ray, selector, collisionPoint, triangle, hitNode);
+            if (hit)
+            {
+                irr::f32 distanceSquared = (collisionPoint - ray.start).getLengthSQ();
+                if (distanceSquared < *bestDistanceSquared)
+                {
+                    *bestDistanceSquared = distanceSquared;
+                    *bestNode = current;
+                    outCollisionPoint = collisionPoint;
+                    outTriangle = triangle;
+                }
+            }
+        }
+        PickSceneNode(current, ray, idBitMask, bestDistanceSquared, bestNode, outCollisionPoint, outTriangle);
+    }
+}
+
 // write the current frame out to a file
+// the image formats are only grabbed here and the encoding happens on the FrameEncoder threads
 int SimulationWindow::WriteFrame(const QString &filename)
 {
+    int width, height;
+    unsigned char *rgb;
+
     switch(m_movieFormat)
     {
     case Quicktime:
         if (m_qtMovie)
         {
             // get image from the last rendered frame
-            irr::video::IImage* const image = videoDriver()->createScreenShot();
-            if (image) //should always be true, but you never know. ;)
+            rgb = GrabFrame(&width, &height);
+            if (rgb) //should always be true, but you never know. ;)
             {
-                irr::core::dimension2d<irr::u32>size =  image->getDimension();
-                unsigned char *rgb = new unsigned char[size.Width * size.Height * 3];
-                unsigned char *ptr = rgb;
-                irr::video::SColor c;
-                for (unsigned int iy = 0; iy < size.Height; iy++)
-                {
-                    for (unsigned int ix = 0; ix < size.Width; ix++)
-                    {
-                        c = image->getPixel(ix, iy);
-                        *ptr++ = c.getRed();
-                        *ptr++ = c.getGreen();
-                        *ptr++ = c.getBlue();
-                    }
-                }
-                image->drop();
-                addImageToMovie(m_qtMovie, size.Width, size.Height, rgb);
-                delete [] rgb;
+                addImageToMovie(m_qtMovie, width, height, rgb);
+                m_frameEncoder->ReleaseBuffer(rgb);
             }
             return 0;
         }
@@ -487,50 +521,14 @@ int SimulationWindow::WriteFrame(const QString &filename)
 
 
     case PPM:
-        if (1)
-        {
-            // get image from the last rendered frame
-            irr::video::IImage* const image = videoDriver()->createScreenShot();
-            if (image) //should always be true, but you never know. ;)
-            {
-                // write screenshot to file
-                QString filenameWithExtension = filename + ".ppm";
-                if (!videoDriver()->writeImageToFile(image, filenameWithExtension.toUtf8().data()))
-                    irrlichtDevice()->getLogger()->log(L"Failed to take screenshot.", irr::ELL_WARNING);
-                image->drop();
-            }
-        }
-        break;
+        rgb = GrabFrame(&width, &height);
+        if (rgb) m_frameEncoder->Submit(FrameEncoder::PPM, filename + ".ppm", width, height, rgb);
+        return 0;
 
     case TIFF:
-        if (1)
-        {
-            // get image from the last rendered frame
-            irr::video::IImage* const image = videoDriver()->createScreenShot();
-            if (image) //should always be true, but you never know. ;)
-            {
-                irr::core::dimension2d<irr::u32>size =  image->getDimension();
-                unsigned char *rgb = new unsigned char[size.Width * size.Height * 3];
-                unsigned char *ptr = rgb;
-                irr::video::SColor c;
-                for (unsigned int iy = 0; iy < size.Height; iy++)
-                {
-                    for (unsigned int ix = 0; ix < size.Width; ix++)
-                    {
-                        c = image->getPixel(ix, iy);
-                        *ptr++ = c.getRed();
-                        *ptr++ = c.getGreen();
-                        *ptr++ = c.getBlue();
-                    }
-                }
-                image->drop();
-                QString filenameWithExtension = filename + ".tif";
-                WriteTIFF(filenameWithExtension.toUtf8(), size.Width, size.Height, (unsigned char *)rgb);
-                delete [] rgb;
-            }
-            return 0;
-        }
-        break;
+        rgb = GrabFrame(&width, &height);
+        if (rgb) m_frameEncoder->Submit(FrameEncoder::TIFF, filename + ".tif", width, height, rgb);
+        return 0;
 
     case OBJ:
     case OBJNOBODIES:
@@ -541,76 +539,35 @@ int SimulationWindow::WriteFrame(const QString &filename)
         break;
 
     case APNG:
-        if (1)
-        {
-            // get image from the last rendered frame
-            irr::video::IImage* const image = videoDriver()->createScreenShot();
-            if (image) //should always be true, but you never know. ;)
-            {
-                irr::core::dimension2d<irr::u32>size =  image->getDimension();
-                unsigned char *rgb = new unsigned char[size.Width * size.Height * 3];
-                unsigned char *ptr = rgb;
-                irr::video::SColor c;
-                for (unsigned int iy = 0; iy < size.Height; iy++)
-                {
-                    for (unsigned int ix = 0; ix < size.Width; ix++)
-                    {
-                        c = image->getPixel(ix, iy);
-                        *ptr++ = c.getRed();
-                        *ptr++ = c.getGreen();
-                        *ptr++ = c.getBlue();
-                    }
-                }
-                image->drop();
-                QString filenameWithExtension = filename + ".png";
-                WriteAPNG(filenameWithExtension.toUtf8(), size.Width, size.Height, (unsigned char *)rgb, false);
-                delete [] rgb;
-            }
-            return 0;
-        }
-        break;
+        rgb = GrabFrame(&width, &height);
+        if (rgb) m_frameEncoder->Submit(FrameEncoder::APNG, filename + ".png", width, height, rgb);
+        return 0;
     }
 
     return 0;
 }
 
-// write a PPM file (need to invert the y axis)
-void SimulationWindow::WritePPM(const char *pathname, int width, int height, unsigned char *rgb)
-{
-    FILE *out;
-    int i;
-
-    out = fopen(pathname, "wb");
-
-    // need to invert write order
-    fprintf(out, "P6\n%d %d\n255\n", width, height);
-    for (i = height - 1; i >= 0; i--)
-        fwrite(rgb + (i * width * 3), width * 3, 1, out);
-
-    fclose(out);
-}
-
-// write a TIFF file
-void SimulationWindow::WriteTIFF(const char *pathname, int width, int height, unsigned char *rgb)
+// wait for any queued frames to be written and close the movie file
+void SimulationWindow::FlushFrames()
 {
-    TIFFWrite tiff;
-    int i;
-
-    tiff.initialiseImage(width, height, 72, 72, 3);
-    // need to invert write order
-    for (i = 0; i < height; i ++)
-        tiff.copyRow(height - i - 1, rgb + (i * width * 3));
-
-    tiff.writeToFile((char *)pathname);
+    m_frameEncoder->Flush();
 }
 
-// write an APNG file
-void SimulationWindow::WriteAPNG(const char *pathname, int width, int height, unsigned char *rgb, bool deleteExisting)
+// copy the last rendered frame into a pooled RGB buffer
+// asking for ECF_R8G8B8 means the copy is a straight memcpy rather than a getPixel per pixel
+unsigned char *SimulationWindow::GrabFrame(int *width, int *height)
 {
-    APNGWriter::WriteAPNG(pathname, static_cast<quint32>(width), static_cast<quint32>(height), rgb, deleteExisting);
+    irr::video::IImage* const image = videoDriver()->createScreenShot(irr::video::ECF_R8G8B8);
+    if (image == 0) return 0;
+    irr::core::dimension2d<irr::u32>size =  image->getDimension();
+    unsigned char *rgb = m_frameEncoder->AcquireBuffer(size.Width * size.Height * 3);
+    image->copyToScaling(rgb, size.Width, size.Height, irr::video::ECF_R8G8B8, size.Width * 3);
+    image->drop();
+    *width = size.Width;
+    *height = size.Height;
+    return rgb;
 }
 
-
 // write the scene as a series of OBJ files in a folder
 void SimulationWindow::WriteOBJ(const char *pathname)
 {
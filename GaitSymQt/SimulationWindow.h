@@ -8,6 +8,8 @@
 class Simulation;
 class FacetedObject;
 class Trackball;
+class FrameEncoder;
+class FacetedBatch;
 
 class SimulationWindow : public IrrlichtWindow
 {
@@ -92,11 +94,11 @@ public:
 
     enum MovieFormat {TIFF, PPM, OBJ, Quicktime, OBJNOBODIES, APNG};
     int WriteFrame(const QString &filename);
-    void WritePPM(const char *pathname, int width, int height, unsigned char *rgb);
-    void WriteTIFF(const char *pathname, int width, int height, unsigned char *rgb);
-    void WriteAPNG(const char *pathname, int width, int height, unsigned char *rgb, bool deleteExisting);
+    void FlushFrames();
     void WriteOBJ(const char *pathname);
     void GetAllChildren(irr::scene::ISceneNode *sceneNode, irr::core::list<irr::scene::ISceneNode *> *sceneNodeList);
+    void PickSceneNode(irr::scene::ISceneNode *sceneNode, const irr::core::line3df &ray, irr::s32 idBitMask, irr::f32 *bestDistanceSquared,
+                       irr::scene::ISceneNode **bestNode, irr::core::vector3df &outCollisionPoint, irr::core::triangle3df &outTriangle);
 
     MovieFormat getMovieFormat() const;
     void setMovieFormat(const MovieFormat &movieFormat);
@@ -107,6 +109,9 @@ public:
     // utilities
     void SetMeshColour(irr::scene::IMesh *mesh, const irr::video::SColor &colour);
 
+    // all the strap, wrapping cylinder and force arrow geometry is drawn through this
+    FacetedBatch *strapBatch() const { return m_strapBatch; }
+
 public slots:
     void SetCameraVec(double x, double y, double z);
 
@@ -116,6 +121,8 @@ signals:
     void EmitFoV(double v);
 
 protected:
+    unsigned char *GrabFrame(int *width, int *height);
+
     void mousePressEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
     void mouseMoveEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
     void mouseReleaseEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
@@ -168,6 +175,8 @@ private:
 
     MovieFormat m_movieFormat;
     MyMovieHandle m_qtMovie;
+    FrameEncoder *m_frameEncoder;
+    FacetedBatch *m_strapBatch;
 };
 
 #endif // SIMULATIONWINDOW_H
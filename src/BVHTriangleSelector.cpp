@@ -0,0 +1,151 @@
+/*
+ *  BVHTriangleSelector.cpp
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+#ifdef USE_QT
+
+#include <vector>
+
+#include "BVHTriangleSelector.h"
+
+BVHTriangleSelector::BVHTriangleSelector(const irr::scene::IMesh *mesh, irr::scene::ISceneNode *node)
+{
+    m_sceneNode = node;
+
+    std::vector<float> vertices;
+    for (irr::u32 b = 0; b < mesh->getMeshBufferCount(); b++)
+    {
+        const irr::scene::IMeshBuffer *meshBuffer = mesh->getMeshBuffer(b);
+        irr::u32 indexCount = meshBuffer->getIndexCount();
+        const irr::u16 *indices16 = meshBuffer->getIndices();
+        const irr::u32 *indices32 = reinterpret_cast<const irr::u32 *>(indices16);
+        bool use32 = (meshBuffer->getIndexType() == irr::video::EIT_32BIT);
+        vertices.reserve(vertices.size() + 3 * indexCount);
+        for (irr::u32 i = 0; i < indexCount; i++)
+        {
+            const irr::core::vector3df &p = meshBuffer->getPosition(use32 ? indices32[i] : indices16[i]);
+            vertices.push_back(p.X);
+            vertices.push_back(p.Y);
+            vertices.push_back(p.Z);
+        }
+    }
+    m_BVH.Build(vertices.size() ? &vertices[0] : 0, int(vertices.size() / 9));
+}
+
+bool BVHTriangleSelector::IntersectRay(const irr::core::line3df &ray, irr::core::vector3df &outCollisionPoint, irr::core::triangle3df &outTriangle) const
+{
+    irr::core::matrix4 toWorld;
+    if (m_sceneNode) toWorld = m_sceneNode->getAbsoluteTransformation();
+    irr::core::matrix4 toLocal;
+    if (toWorld.getInverse(toLocal) == false) return false;
+
+    // the ray is parameterised 0 to 1 along the line so t maps straight back to world coordinates
+    irr::core::vector3df start = ray.start, end = ray.end;
+    toLocal.transformVect(start);
+    toLocal.transformVect(end);
+    float origin[3] = {start.X, start.Y, start.Z};
+    float direction[3] = {end.X - start.X, end.Y - start.Y, end.Z - start.Z};
+    float t;
+    int triangleIndex;
+    if (m_BVH.IntersectRay(origin, direction, 1, &t, &triangleIndex) == false) return false;
+
+    outCollisionPoint = ray.start + (ray.end - ray.start) * t;
+    GetTriangle(triangleIndex, toWorld, &outTriangle);
+    return true;
+}
+
+irr::s32 BVHTriangleSelector::getTriangleCount() const
+{
+    return m_BVH.GetNumTriangles();
+}
+
+void BVHTriangleSelector::getTriangles(irr::core::triangle3df *triangles, irr::s32 arraySize, irr::s32 &outTriangleCount,
+                                       const irr::core::matrix4 *transform) const
+{
+    irr::core::matrix4 matrix;
+    if (transform) matrix = *transform;
+    if (m_sceneNode) matrix *= m_sceneNode->getAbsoluteTransformation();
+
+    irr::s32 count = irr::core::min_(arraySize, m_BVH.GetNumTriangles());
+    for (irr::s32 i = 0; i < count; i++) GetTriangle(i, matrix, &triangles[i]);
+    outTriangleCount = count;
+}
+
+void BVHTriangleSelector::getTriangles(irr::core::triangle3df *triangles, irr::s32 arraySize, irr::s32 &outTriangleCount,
+                                       const irr::core::aabbox3d<irr::f32> &box, const irr::core::matrix4 *transform) const
+{
+    irr::core::aabbox3df localBox(box);
+    irr::core::matrix4 matrix;
+    if (m_sceneNode)
+    {
+        irr::core::matrix4 toLocal;
+        m_sceneNode->getAbsoluteTransformation().getInverse(toLocal);
+        toLocal.transformBoxEx(localBox);
+    }
+    if (transform) matrix = *transform;
+    if (m_sceneNode) matrix *= m_sceneNode->getAbsoluteTransformation();
+
+    float boxMin[3] = {localBox.MinEdge.X, localBox.MinEdge.Y, localBox.MinEdge.Z};
+    float boxMax[3] = {localBox.MaxEdge.X, localBox.MaxEdge.Y, localBox.MaxEdge.Z};
+    std::vector<int> triangleList;
+    m_BVH.GetTrianglesInBox(boxMin, boxMax, &triangleList);
+
+    irr::s32 count = irr::core::min_(arraySize, irr::s32(triangleList.size()));
+    for (irr::s32 i = 0; i < count; i++) GetTriangle(triangleList[i], matrix, &triangles[i]);
+    outTriangleCount = count;
+}
+
+// only the nearest triangle can matter for a line query so that is all that is returned
+void BVHTriangleSelector::getTriangles(irr::core::triangle3df *triangles, irr::s32 arraySize, irr::s32 &outTriangleCount,
+                                       const irr::core::line3d<irr::f32> &line, const irr::core::matrix4 *transform) const
+{
+    outTriangleCount = 0;
+    if (arraySize < 1) return;
+    irr::core::vector3df collisionPoint;
+    if (IntersectRay(line, collisionPoint, triangles[0]) == false) return;
+    if (transform)
+    {
+        transform->transformVect(triangles[0].pointA);
+        transform->transformVect(triangles[0].pointB);
+        transform->transformVect(triangles[0].pointC);
+    }
+    outTriangleCount = 1;
+}
+
+irr::scene::ISceneNode *BVHTriangleSelector::getSceneNodeForTriangle(irr::u32 /* triangleIndex */) const
+{
+    return m_sceneNode;
+}
+
+irr::u32 BVHTriangleSelector::getSelectorCount() const
+{
+    return 1;
+}
+
+irr::scene::ITriangleSelector *BVHTriangleSelector::getSelector(irr::u32 index)
+{
+    if (index) return 0;
+    return this;
+}
+
+const irr::scene::ITriangleSelector *BVHTriangleSelector::getSelector(irr::u32 index) const
+{
+    if (index) return 0;
+    return this;
+}
+
+void BVHTriangleSelector::GetTriangle(int i, const irr::core::matrix4 &matrix, irr::core::triangle3df *triangle) const
+{
+    const float *t = m_BVH.GetTriangle(i);
+    triangle->set(irr::core::vector3df(t[0], t[1], t[2]), irr::core::vector3df(t[3], t[4], t[5]), irr::core::vector3df(t[6], t[7], t[8]));
+    matrix.transformVect(triangle->pointA);
+    matrix.transformVect(triangle->pointB);
+    matrix.transformVect(triangle->pointC);
+}
+
+#endif
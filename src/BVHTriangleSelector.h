@@ -0,0 +1,55 @@
+/*
+ *  BVHTriangleSelector.h
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+// BVHTriangleSelector is an Irrlicht triangle selector backed by a MeshBVH
+// built in the node's local coordinates. It can be used anywhere an octree
+// selector would be but SimulationWindow picking calls IntersectRay directly
+// so that only the nearest triangle is ever transformed or tested.
+
+#ifndef BVHTriangleSelector_h
+#define BVHTriangleSelector_h
+
+#ifdef USE_QT
+
+#include "MeshBVH.h"
+
+#include <irrlicht.h>
+
+class BVHTriangleSelector: public irr::scene::ITriangleSelector
+{
+public:
+    BVHTriangleSelector(const irr::scene::IMesh *mesh, irr::scene::ISceneNode *node);
+
+    // ray in world coordinates, returns true and the world collision point if the node is hit
+    bool IntersectRay(const irr::core::line3df &ray, irr::core::vector3df &outCollisionPoint, irr::core::triangle3df &outTriangle) const;
+
+    const MeshBVH *GetBVH() const { return &m_BVH; }
+
+    virtual irr::s32 getTriangleCount() const;
+    virtual void getTriangles(irr::core::triangle3df *triangles, irr::s32 arraySize, irr::s32 &outTriangleCount,
+                              const irr::core::matrix4 *transform = 0) const;
+    virtual void getTriangles(irr::core::triangle3df *triangles, irr::s32 arraySize, irr::s32 &outTriangleCount,
+                              const irr::core::aabbox3d<irr::f32> &box, const irr::core::matrix4 *transform = 0) const;
+    virtual void getTriangles(irr::core::triangle3df *triangles, irr::s32 arraySize, irr::s32 &outTriangleCount,
+                              const irr::core::line3d<irr::f32> &line, const irr::core::matrix4 *transform = 0) const;
+    virtual irr::scene::ISceneNode *getSceneNodeForTriangle(irr::u32 triangleIndex) const;
+    virtual irr::u32 getSelectorCount() const;
+    virtual irr::scene::ITriangleSelector *getSelector(irr::u32 index);
+    virtual const irr::scene::ITriangleSelector *getSelector(irr::u32 index) const;
+
+private:
+    void GetTriangle(int i, const irr::core::matrix4 &matrix, irr::core::triangle3df *triangle) const;
+
+    MeshBVH m_BVH;
+    irr::scene::ISceneNode *m_sceneNode; // not grabbed because the node owns the selector
+};
+
+#endif
+
+#endif
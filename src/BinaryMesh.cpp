@@ -0,0 +1,243 @@
+/*
+ *  BinaryMesh.cpp
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <cfloat>
+#include <iostream>
+#include <vector>
+
+#if defined(_WIN32) || defined(WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "BinaryMesh.h"
+#include "DebugControl.h"
+
+static const char kMagic[8] = {'G', 'S', 'M', 'E', 'S', 'H', '0', '1'};
+static const uint32_t kVersion = 1;
+static const uint32_t kByteOrder = 0x01020304;
+
+#define _I(i,j) I[(i)*4+(j)]
+
+// shared mesh that points into a memory mapped file
+// single precision vertices are converted when the file is read
+struct MappedMesh : public FacetedObject::SharedMesh
+{
+    MappedMesh() { mapping = 0; mappingSize = 0; }
+    ~MappedMesh()
+    {
+#if defined(_WIN32) || defined(WIN32)
+        if (mapping) UnmapViewOfFile(mapping);
+#else
+        if (mapping) munmap(mapping, mappingSize);
+#endif
+    }
+
+    void *mapping;
+    size_t mappingSize;
+    std::vector<double> vertexStorage;
+};
+
+// map the whole file read only
+// returns 0 on error
+static void *MapFile(const char *filename, size_t *size)
+{
+#if defined(_WIN32) || defined(WIN32)
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) == 0 || fileSize.QuadPart == 0) { CloseHandle(file); return 0; }
+    HANDLE fileMapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+    CloseHandle(file);
+    if (fileMapping == 0) return 0;
+    void *mapping = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(fileMapping); // the view keeps the mapping open
+    *size = size_t(fileSize.QuadPart);
+    return mapping;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) || fileStat.st_size == 0) { close(fd); return 0; }
+    void *mapping = mmap(0, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (mapping == MAP_FAILED) return 0;
+    *size = size_t(fileStat.st_size);
+    return mapping;
+#endif
+}
+
+bool BinaryMesh::IsBinaryMesh(const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+    if (file == 0) return false;
+    char magic[sizeof(kMagic)];
+    size_t n = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+    return (n == sizeof(magic) && memcmp(magic, kMagic, sizeof(kMagic)) == 0);
+}
+
+std::shared_ptr<const FacetedObject::SharedMesh> BinaryMesh::Read(const char *filename)
+{
+    std::shared_ptr<MappedMesh> mesh(new MappedMesh());
+    mesh->mapping = MapFile(filename, &mesh->mappingSize);
+    if (mesh->mapping == 0)
+    {
+        std::cerr << "Error: BinaryMesh::Read(" << filename << ") - Cannot map file\n";
+        return std::shared_ptr<const FacetedObject::SharedMesh>();
+    }
+
+    const Header *header = static_cast<const Header *>(mesh->mapping);
+    if (mesh->mappingSize < sizeof(Header) || memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+            header->version != kVersion || header->byteOrder != kByteOrder)
+    {
+        std::cerr << "Error: BinaryMesh::Read(" << filename << ") - Unrecognised header\n";
+        return std::shared_ptr<const FacetedObject::SharedMesh>();
+    }
+    bool singlePrecision = (header->flags & SinglePrecisionVertices) != 0;
+    size_t normalsSize = sizeof(double) * 3 * size_t(header->numTriangles);
+    size_t verticesSize = (singlePrecision ? sizeof(float) : sizeof(double)) * 3 * size_t(header->numVertices);
+    size_t indicesSize = sizeof(int32_t) * 3 * size_t(header->numTriangles);
+    if (mesh->mappingSize < sizeof(Header) + normalsSize + verticesSize + indicesSize || header->numVertices > INT32_MAX || header->numTriangles > INT32_MAX / 3)
+    {
+        std::cerr << "Error: BinaryMesh::Read(" << filename << ") - File too short\n";
+        return std::shared_ptr<const FacetedObject::SharedMesh>();
+    }
+
+    const char *data = static_cast<const char *>(mesh->mapping) + sizeof(Header);
+    mesh->numVertices = int(header->numVertices);
+    mesh->numTriangles = int(header->numTriangles);
+    mesh->normals = reinterpret_cast<const double *>(data);
+    if (singlePrecision)
+    {
+        const float *vertices = reinterpret_cast<const float *>(data + normalsSize);
+        mesh->vertexStorage.assign(vertices, vertices + 3 * size_t(header->numVertices));
+        mesh->vertices = mesh->vertexStorage.data();
+    }
+    else
+    {
+        mesh->vertices = reinterpret_cast<const double *>(data + normalsSize);
+    }
+    mesh->indices = reinterpret_cast<const int *>(data + normalsSize + verticesSize);
+
+    // a bad index would crash much later so check them all now
+    for (size_t i = 0; i < 3 * size_t(header->numTriangles); i++)
+    {
+        if (mesh->indices[i] < 0 || mesh->indices[i] >= mesh->numVertices)
+        {
+            std::cerr << "Error: BinaryMesh::Read(" << filename << ") - Index out of range\n";
+            return std::shared_ptr<const FacetedObject::SharedMesh>();
+        }
+    }
+
+    dMassSetZero(&mesh->unitMass);
+    mesh->unitMass.mass = header->mass;
+    for (int i = 0; i < 3; i++)
+    {
+        mesh->unitMass.c[i] = header->centre[i];
+        for (int j = 0; j < 3; j++) mesh->unitMass._I(i,j) = header->inertia[i * 3 + j];
+    }
+    mesh->hasMassProperties = true;
+
+    if (gDebug == FacetedObjectDebug)
+        std::cerr << "BinaryMesh::Read\t" << filename << "\tvertices\t" << mesh->numVertices << "\ttriangles\t" << mesh->numTriangles << "\n";
+
+    return mesh;
+}
+
+// shared mesh used to describe the vertices that a single precision file will load as
+struct RoundedMesh : public FacetedObject::SharedMesh
+{
+    std::vector<double> vertexStorage;
+};
+
+bool BinaryMesh::Write(const char *filename, FacetedObject *facetedObject, bool singlePrecision)
+{
+    int numVertices = facetedObject->GetNumVertices();
+    int numTriangles = facetedObject->GetNumTriangles();
+    int i, j;
+
+    // the header has to describe the mesh that will be read back so with single precision
+    // the bounds and mass properties are calculated from the rounded vertices
+    FacetedObject roundedObject;
+    FacetedObject *headerObject = facetedObject;
+    std::vector<float> singleVertices;
+    if (singlePrecision)
+    {
+        singleVertices.assign(facetedObject->GetVertexList(), facetedObject->GetVertexList() + numVertices * 3);
+        std::shared_ptr<RoundedMesh> roundedMesh(new RoundedMesh());
+        roundedMesh->vertexStorage.assign(singleVertices.begin(), singleVertices.end());
+        roundedMesh->numVertices = numVertices;
+        roundedMesh->numTriangles = numTriangles;
+        roundedMesh->vertices = roundedMesh->vertexStorage.data();
+        roundedMesh->normals = facetedObject->GetNormalList();
+        roundedMesh->indices = facetedObject->GetIndexList();
+        roundedObject.SetSharedMesh(roundedMesh);
+        headerObject = &roundedObject;
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrder;
+    header.flags = singlePrecision ? SinglePrecisionVertices : 0;
+    header.numVertices = numVertices;
+    header.numTriangles = numTriangles;
+    for (j = 0; j < 3; j++)
+    {
+        header.boundsMin[j] = numVertices ? DBL_MAX : 0;
+        header.boundsMax[j] = numVertices ? -DBL_MAX : 0;
+    }
+    for (i = 0; i < numVertices; i++)
+    {
+        const double *v = headerObject->GetVertex(i);
+        for (j = 0; j < 3; j++)
+        {
+            if (v[j] < header.boundsMin[j]) header.boundsMin[j] = v[j];
+            if (v[j] > header.boundsMax[j]) header.boundsMax[j] = v[j];
+        }
+    }
+    dMass mass;
+    headerObject->CalculateMassProperties(&mass, 1.0, false);
+    header.mass = mass.mass;
+    for (i = 0; i < 3; i++)
+    {
+        header.centre[i] = mass.c[i];
+        for (j = 0; j < 3; j++) header.inertia[i * 3 + j] = mass._I(i,j);
+    }
+
+    FILE *file = fopen(filename, "wb");
+    if (file == 0)
+    {
+        std::cerr << "Error: BinaryMesh::Write(" << filename << ") - Cannot open file\n";
+        return true;
+    }
+    bool error = false;
+    error |= fwrite(&header, sizeof(header), 1, file) != 1;
+    error |= fwrite(facetedObject->GetNormalList(), sizeof(double) * 3, numTriangles, file) != size_t(numTriangles);
+    if (singlePrecision)
+    {
+        error |= fwrite(singleVertices.data(), sizeof(float) * 3, numVertices, file) != size_t(numVertices);
+    }
+    else
+    {
+        error |= fwrite(facetedObject->GetVertexList(), sizeof(double) * 3, numVertices, file) != size_t(numVertices);
+    }
+    error |= fwrite(facetedObject->GetIndexList(), sizeof(int32_t) * 3, numTriangles, file) != size_t(numTriangles);
+    error |= fclose(file) != 0;
+    if (error) std::cerr << "Error: BinaryMesh::Write(" << filename << ") - Cannot write file\n";
+    return error;
+}
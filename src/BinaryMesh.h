@@ -0,0 +1,58 @@
+/*
+ *  BinaryMesh.h
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+// BinaryMesh reads and writes a pre-processed version of a mesh so that large
+// meshes can be loaded without parsing. The file is a fixed size header
+// followed by the face normals (double), the vertices (double or float) and
+// the triangle indices (32 bit) so the double precision version can be memory
+// mapped and used directly as FacetedObject storage. The header holds the
+// bounding box and the mass properties at unit density. The byte order is the
+// native order of the machine that wrote the file and files with the wrong
+// byte order are rejected.
+
+#ifndef BinaryMesh_h
+#define BinaryMesh_h
+
+#include "FacetedObject.h"
+
+#include <stdint.h>
+#include <memory>
+
+class BinaryMesh
+{
+public:
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t flags;
+        uint32_t numVertices;
+        uint32_t numTriangles;
+        uint32_t reserved;
+        double boundsMin[3];
+        double boundsMax[3];
+        double mass; // unit density and anticlockwise winding
+        double centre[3];
+        double inertia[9];
+    };
+
+    enum Flags { SinglePrecisionVertices = 1 };
+
+    // returns true if the file starts with the binary mesh identifier
+    static bool IsBinaryMesh(const char *filename);
+
+    // returns a null pointer on error
+    static std::shared_ptr<const FacetedObject::SharedMesh> Read(const char *filename);
+
+    // returns true on error
+    static bool Write(const char *filename, FacetedObject *facetedObject, bool singlePrecision);
+};
+
+#endif
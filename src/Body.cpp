@@ -538,7 +538,7 @@ void Body::GetRelativeLinearVelocity(Body *rel, pgd::Vector *vel)
         pgd::Vector worldV(v[0], v[1], v[2]);
         pgd::Vector relV(vR[0], vR[1], vR[2]);
         pgd::Quaternion qRelBody(qR[0], qR[1], qR[2], qR[3]);
-        *vel = QVRotate(~qRelBody, worldV - relV);
+        *vel = pgd::QVRotator(~qRelBody).Rotate(worldV - relV);
     }
     else
     {
@@ -556,7 +556,7 @@ void Body::GetRelativeAngularVelocity(Body *rel, pgd::Vector *rVel)
         pgd::Vector worldVR(vR[0], vR[1], vR[2]);
         pgd::Vector relVR(vRR[0], vRR[1], vRR[2]);
         pgd::Quaternion qRelBody(qR[0], qR[1], qR[2], qR[3]);
-        *rVel = QVRotate(~qRelBody, worldVR - relVR);
+        *rVel = pgd::QVRotator(~qRelBody).Rotate(worldVR - relVR);
     }
     else
     {
@@ -564,6 +564,27 @@ void Body::GetRelativeAngularVelocity(Body *rel, pgd::Vector *rVel)
     }
 }
 
+void Body::GetRelativeVelocities(Body *rel, pgd::Vector *vel, pgd::Vector *rVel)
+{
+    const double *v = GetLinearVelocity();
+    const double *vR = GetAngularVelocity();
+    if (rel)
+    {
+        const double *qR = rel->GetQuaternion();
+        const double *relV = rel->GetLinearVelocity();
+        const double *relVR = rel->GetAngularVelocity();
+        pgd::Quaternion qRelBody(qR[0], qR[1], qR[2], qR[3]);
+        pgd::QVRotator relRotator(~qRelBody);
+        *vel = relRotator.Rotate(pgd::Vector(v[0], v[1], v[2]) - pgd::Vector(relV[0], relV[1], relV[2]));
+        *rVel = relRotator.Rotate(pgd::Vector(vR[0], vR[1], vR[2]) - pgd::Vector(relVR[0], relVR[1], relVR[2]));
+    }
+    else
+    {
+        *vel = pgd::Vector(v[0], v[1], v[2]);
+        *rVel = pgd::Vector(vR[0], vR[1], vR[2]);
+    }
+}
+
 double Body::GetMass()
 {
     dMass mass;
@@ -572,9 +593,22 @@ double Body::GetMass()
 }
 
 
+// this is called every step so the usual case is a single pass over the body state with one branch
+// and the individual tests are only done to find out what went wrong
 LimitTestResult Body::TestLimits()
 {
     const double *p = dBodyGetPosition(m_BodyID);
+    const double *v = dBodyGetLinearVel(m_BodyID);
+    bool ok = true;
+    for (int i = 0; i < 3; i++)
+    {
+        // x - x is only zero if x is finite and the range tests are false for NaN
+        ok &= (p[i] - p[i] == 0) & (v[i] - v[i] == 0);
+        ok &= (p[i] >= m_PositionLowBound[i]) & (p[i] <= m_PositionHighBound[i]);
+        ok &= (v[i] >= m_LinearVelocityLowBound[i]) & (v[i] <= m_LinearVelocityHighBound[i]);
+    }
+    if (ok) return WithinLimits;
+
     if (!std::isfinite(p[0])) return NumericalError;
     if (!std::isfinite(p[1])) return NumericalError;
     if (!std::isfinite(p[2])) return NumericalError;
@@ -582,7 +616,6 @@ LimitTestResult Body::TestLimits()
     if (OUTSIDERANGE(p[1], m_PositionLowBound[1], m_PositionHighBound[1])) return YPosError;
     if (OUTSIDERANGE(p[2], m_PositionLowBound[2], m_PositionHighBound[2])) return ZPosError;
 
-    const double *v = dBodyGetLinearVel(m_BodyID);
     if (!std::isfinite(v[0])) return NumericalError;
     if (!std::isfinite(v[1])) return NumericalError;
     if (!std::isfinite(v[2])) return NumericalError;
@@ -84,6 +84,7 @@ public:
     void GetRelativeRotation(Body *rel, pgd::Matrix3x3 *rot);
     void GetRelativeLinearVelocity(Body *rel, pgd::Vector *vel);
     void GetRelativeAngularVelocity(Body *rel, pgd::Vector *rVel);
+    void GetRelativeVelocities(Body *rel, pgd::Vector *vel, pgd::Vector *rVel); // both velocities with one rotation setup
     double GetMass();
     double GetLinearKineticEnergy();
     void GetLinearKineticEnergy(dVector3 ke);
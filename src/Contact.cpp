@@ -12,12 +12,12 @@
 
 #include "Contact.h"
 #include "PGDMath.h"
-#include "FacetedPolyline.h"
 #include "Simulation.h"
 
 #ifdef USE_QT
 #include "GLUtils.h"
 #include "SimulationWindow.h"
+#include "FacetedBatch.h"
 #endif
 
 // length of vector a
@@ -32,35 +32,19 @@ Contact::Contact()
 {
 #ifdef USE_QT
     m_drawContactForces = false;
-    m_LastDrawTime = -1;
 #endif
 }
 
 #ifdef USE_QT
 void Contact::Draw(SimulationWindow *window)
 {
-    const int kSides = 128;
-
     if (m_drawContactForces)
     {
-        if (m_simulation->GetTime() != m_LastDrawTime)
-        {
-            m_LastDrawTime = m_simulation->GetTime();
-            std::vector<FacetedObject *>::const_iterator iterFO;
-            //        GLUtils::DrawAxes(m_AxisSize[0], m_AxisSize[1], m_AxisSize[2],
-            //                m_ContactPosition[0], m_ContactPosition[1], m_ContactPosition[2]);
-
-            std::vector<pgd::Vector> polyline;
-            pgd::Vector startPos(m_ContactPosition[0], m_ContactPosition[1], m_ContactPosition[2]);
-            pgd::Vector length(m_ContactJointFeedback.f1[0] * m_ForceScale, m_ContactJointFeedback.f1[1] * m_ForceScale, m_ContactJointFeedback.f1[2] * m_ForceScale);
-            polyline.push_back(startPos);
-            polyline.push_back(startPos + length);
-            if (m_physRep) delete m_physRep;
-            m_physRep = new FacetedPolyline(&polyline, m_ForceRadius, kSides);
-            m_physRep->SetColour(m_Colour);
-            m_physRep->setSimulationWindow(window);
-            m_physRep->Draw();
-        }
+        //        GLUtils::DrawAxes(m_AxisSize[0], m_AxisSize[1], m_AxisSize[2],
+        //                m_ContactPosition[0], m_ContactPosition[1], m_ContactPosition[2]);
+        pgd::Vector startPos(m_ContactPosition[0], m_ContactPosition[1], m_ContactPosition[2]);
+        pgd::Vector length(m_ContactJointFeedback.f1[0] * m_ForceScale, m_ContactJointFeedback.f1[1] * m_ForceScale, m_ContactJointFeedback.f1[2] * m_ForceScale);
+        window->strapBatch()->AddCylinder(startPos, startPos + length, m_ForceRadius, m_Colour);
     }
 }
 #endif
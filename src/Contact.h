@@ -42,7 +42,6 @@ protected:
     float m_ForceRadius;
     float m_ForceScale;
     bool m_drawContactForces;
-    double m_LastDrawTime;
 #endif
 };
 
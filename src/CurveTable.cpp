@@ -0,0 +1,132 @@
+/*
+ *  CurveTable.cpp
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+#include <cfloat>
+
+#include "CurveTable.h"
+#include "Util.h"
+
+CurveTable::CurveTable()
+{
+    m_gridType = UniformGrid;
+    m_minX = 0;
+    m_maxX = -1; // empty range so Evaluate always uses the function
+    m_pointsPerRange = 0;
+    m_inverseSpacing = 0;
+    m_minExponent = 0;
+    m_lastIndex = 0;
+    m_achievedRelativeError = 0;
+}
+
+bool CurveTable::Build(std::function<double(double)> function, double minX, double maxX, GridType gridType, double maxRelativeError, int maxPointsPerRange)
+{
+    m_function = function;
+    m_gridType = gridType;
+    m_values.clear();
+    m_minX = 0;
+    m_maxX = -1;
+    if (maxX <= minX) return true;
+    if (gridType == OctaveGrid && minX <= 0) return true;
+
+    for (int pointsPerRange = 16; pointsPerRange <= maxPointsPerRange; pointsPerRange *= 2)
+    {
+        m_minX = minX;
+        m_maxX = maxX;
+        Fill(pointsPerRange);
+        m_achievedRelativeError = MeasureRelativeError();
+        if (m_achievedRelativeError <= maxRelativeError) return false;
+    }
+
+    m_values.clear();
+    m_minX = 0;
+    m_maxX = -1;
+    return true;
+}
+
+void CurveTable::Fill(int pointsPerRange)
+{
+    m_pointsPerRange = pointsPerRange;
+    int numPoints;
+    if (m_gridType == UniformGrid)
+    {
+        m_inverseSpacing = pointsPerRange / (m_maxX - m_minX);
+        numPoints = pointsPerRange + 1;
+    }
+    else
+    {
+        int maxExponent;
+        frexp(m_minX, &m_minExponent);
+        frexp(m_maxX, &maxExponent);
+        numPoints = (maxExponent - m_minExponent + 1) * pointsPerRange + 1;
+    }
+    m_values.resize(numPoints);
+    for (int i = 0; i < numPoints; i++) m_values[i] = m_function(Abscissa(i));
+    m_lastIndex = numPoints - 1;
+}
+
+double CurveTable::Abscissa(int index) const
+{
+    if (m_gridType == UniformGrid)
+        return m_minX + index * ((m_maxX - m_minX) / m_pointsPerRange);
+    return ldexp(0.5 + (0.5 * (index % m_pointsPerRange)) / m_pointsPerRange, m_minExponent + index / m_pointsPerRange);
+}
+
+// checks the quarter points of every interval since linear interpolation error peaks between the points
+double CurveTable::MeasureRelativeError() const
+{
+    double maxError = 0;
+    for (int i = 0; i < m_lastIndex; i++)
+    {
+        double x0 = Abscissa(i);
+        double x1 = Abscissa(i + 1);
+        for (int j = 1; j < 4; j++)
+        {
+            double x = x0 + (x1 - x0) * j * 0.25;
+            if (x < m_minX || x > m_maxX) continue;
+            double exact = m_function(x);
+            double error = fabs(Evaluate(x) - exact);
+            if (exact != 0) error /= fabs(exact);
+            if (error > maxError) maxError = error;
+        }
+    }
+    return maxError;
+}
+
+double CurveTable::Benchmark(int numSamples) const
+{
+    if (IsValid() == false || numSamples <= 0) return 0;
+
+    // fixed pseudo-random samples so that the branch pattern is not trivially predictable
+    std::vector<double> samples(numSamples);
+    unsigned int seed = 12345;
+    for (int i = 0; i < numSamples; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        samples[i] = m_minX + (m_maxX - m_minX) * (double(seed) / 4294967296.0);
+    }
+
+    const int repeats = 10;
+    volatile double sink = 0;
+    double sum = 0;
+    double startTime = Util::GetTime();
+    for (int r = 0; r < repeats; r++)
+        for (int i = 0; i < numSamples; i++) sum += m_function(samples[i]);
+    double exactTime = Util::GetTime() - startTime;
+    sink = sum;
+
+    sum = 0;
+    startTime = Util::GetTime();
+    for (int r = 0; r < repeats; r++)
+        for (int i = 0; i < numSamples; i++) sum += Evaluate(samples[i]);
+    double tableTime = Util::GetTime() - startTime;
+    sink = sink + sum;
+
+    if (tableTime <= 0) return DBL_MAX;
+    return exactTime / tableTime;
+}
@@ -0,0 +1,82 @@
+/*
+ *  CurveTable.h
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+// CurveTable replaces a smooth function of one variable with a lookup table
+// and linear interpolation. The table is made denser until the relative error
+// measured between the table points is below the requested limit. Values
+// outside the tabulated range are calculated with the original function.
+// UniformGrid spaces the points evenly. OctaveGrid spaces them evenly within
+// each power of 2, which suits power laws near zero, and needs minX > 0.
+
+#ifndef CurveTable_h
+#define CurveTable_h
+
+#include <cmath>
+#include <functional>
+#include <vector>
+
+class CurveTable
+{
+public:
+    CurveTable();
+
+    enum GridType { UniformGrid, OctaveGrid };
+
+    // returns true on error (the limit could not be reached within maxPointsPerRange)
+    bool Build(std::function<double(double)> function, double minX, double maxX, GridType gridType, double maxRelativeError, int maxPointsPerRange = 65536);
+
+    double Evaluate(double x) const
+    {
+        if (x >= m_minX && x <= m_maxX)
+        {
+            double position;
+            if (m_gridType == UniformGrid)
+            {
+                position = (x - m_minX) * m_inverseSpacing;
+            }
+            else
+            {
+                int exponent;
+                double mantissa = frexp(x, &exponent); // 0.5 <= mantissa < 1
+                position = (exponent - m_minExponent) * m_pointsPerRange + (mantissa - 0.5) * 2 * m_pointsPerRange;
+            }
+            int index = int(position);
+            if (index >= m_lastIndex) index = m_lastIndex - 1;
+            double fraction = position - index;
+            const double *y = m_values.data() + index;
+            return y[0] + fraction * (y[1] - y[0]);
+        }
+        return m_function(x);
+    }
+
+    bool IsValid() const { return m_values.size() != 0; }
+    int GetNumPoints() const { return int(m_values.size()); }
+    double GetMaxRelativeError() const { return m_achievedRelativeError; }
+
+    // times the exact function and the table over the tabulated range and returns the speed up
+    double Benchmark(int numSamples) const;
+
+protected:
+    void Fill(int pointsPerRange);
+    double Abscissa(int index) const;
+    double MeasureRelativeError() const;
+
+    std::function<double(double)> m_function;
+    GridType m_gridType;
+    double m_minX;
+    double m_maxX;
+    int m_pointsPerRange;
+    double m_inverseSpacing;
+    int m_minExponent;
+    int m_lastIndex;
+    double m_achievedRelativeError;
+    std::vector<double> m_values;
+};
+
+#endif // CurveTable_h
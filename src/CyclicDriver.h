@@ -24,6 +24,10 @@ public:
     void SetPhaseDelay(double phaseDelay) { m_PhaseDelay = phaseDelay; }; // 0 to 1
     double GetValue(double time);
     double GetCycleTime();
+    double GetPhaseDelay() { return m_PhaseDelay; }
+    int GetListLength() { return m_ListLength; }
+    const double *GetValueList() { return m_ValueList; }
+    const double *GetDurationList() { return m_DurationList; }
     
 protected:
         
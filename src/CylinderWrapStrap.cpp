@@ -23,31 +23,24 @@
 #include "Util.h"
 
 #include "DebugControl.h"
+#include "Trace.h"
 
 #ifdef USE_QT
-#include "FacetedPolyline.h"
+#include "FacetedBatch.h"
+#include "SimulationWindow.h"
 #endif
 
 
 CylinderWrapStrap::CylinderWrapStrap()
 {
-    PointForce *origin = new PointForce();
-    PointForce *insertion = new PointForce();
-    PointForce *cylinder = new PointForce();
-    m_PointForceList.push_back(origin);
-    m_PointForceList.push_back(insertion);
-    m_PointForceList.push_back(cylinder);
+    m_PointForceList.resize(3); // origin, insertion, cylinder
 
     m_CylinderRadius = 1;
     m_WrapStatus = -1;
     m_NumWrapSegments = 16;
     m_NumPathCoordinates = 0;
-
-#ifdef USE_QT
-    m_PathCoordinates = new pgd::Vector[m_NumWrapSegments + 2];
-#else
     m_PathCoordinates = 0;
-#endif
+    m_PathCoordinatesValid = false;
 }
 
 CylinderWrapStrap::~CylinderWrapStrap()
@@ -58,7 +51,7 @@ CylinderWrapStrap::~CylinderWrapStrap()
 void CylinderWrapStrap::SetOrigin(Body *body, dVector3 point)
 {
     m_OriginBody = body;
-    m_PointForceList[0]->body = m_OriginBody;
+    m_PointForceList[0].body = m_OriginBody;
     m_OriginPosition.x = point[0];
     m_OriginPosition.y = point[1];
     m_OriginPosition.z = point[2];
@@ -122,7 +115,7 @@ void CylinderWrapStrap::SetOrigin(Body *body, const char *buf)
 void CylinderWrapStrap::SetInsertion(Body *body, dVector3 point)
 {
     m_InsertionBody = body;
-    m_PointForceList[1]->body = m_InsertionBody;
+    m_PointForceList[1].body = m_InsertionBody;
     m_InsertionPosition.x = point[0];
     m_InsertionPosition.y = point[1];
     m_InsertionPosition.z = point[2];
@@ -185,7 +178,7 @@ void CylinderWrapStrap::SetInsertion(Body *body, const char *buf)
 void CylinderWrapStrap::SetCylinderBody(Body *body)
 {
     m_CylinderBody = body;
-    m_PointForceList[2]->body = m_CylinderBody;
+    m_PointForceList[2].body = m_CylinderBody;
 }
 
 void CylinderWrapStrap::SetCylinderPosition(double x, double y, double z)
@@ -432,7 +425,6 @@ void CylinderWrapStrap::SetCylinderQuaternion(const char *buf)
 
 void CylinderWrapStrap::Calculate(double deltaT)
 {
-    int i;
     // get the necessary body orientations and positions
     const double *q;
     q = dBodyGetQuaternion(m_OriginBody->GetBodyID());
@@ -448,9 +440,9 @@ void CylinderWrapStrap::Calculate(double deltaT)
     q = dBodyGetPosition(m_CylinderBody->GetBodyID());
     pgd::Vector vCylinderBody(q[0], q[1], q[2]);
 
-    // calculate some inverses
-    pgd::Quaternion qCylinderBodyInv = ~qCylinderBody;
-    pgd::Quaternion qCylinderQuaternionInv = ~m_CylinderQuaternion;
+    // calculate some inverses (as rotators since each is used more than once)
+    pgd::QVRotator cylinderBodyInvRotator(~qCylinderBody);
+    pgd::QVRotator cylinderQuaternionInvRotator(~m_CylinderQuaternion);
 
     // get the world coordinates of the origin and insertion
     pgd::Vector worldOriginPosition = QVRotate(qOriginBody, m_OriginPosition) + vOriginBody;
@@ -459,12 +451,12 @@ void CylinderWrapStrap::Calculate(double deltaT)
     // now calculate as cylinder coordinates
     pgd::Vector v;
     if (m_OriginBody->GetBodyID() == m_CylinderBody->GetBodyID()) v = m_OriginPosition;
-    else v = QVRotate(qCylinderBodyInv, worldOriginPosition - vCylinderBody);
-    pgd::Vector cylinderOriginPosition = QVRotate(qCylinderQuaternionInv, v - m_CylinderPosition);
+    else v = cylinderBodyInvRotator.Rotate(worldOriginPosition - vCylinderBody);
+    pgd::Vector cylinderOriginPosition = cylinderQuaternionInvRotator.Rotate(v - m_CylinderPosition);
 
     if (m_InsertionBody->GetBodyID() == m_CylinderBody->GetBodyID()) v = m_InsertionPosition;
-    else v = QVRotate(qCylinderBodyInv, worldInsertionPosition - vCylinderBody);
-    pgd::Vector cylinderInsertionPosition = QVRotate(qCylinderQuaternionInv, v - m_CylinderPosition);
+    else v = cylinderBodyInvRotator.Rotate(worldInsertionPosition - vCylinderBody);
+    pgd::Vector cylinderInsertionPosition = cylinderQuaternionInvRotator.Rotate(v - m_CylinderPosition);
 
     // std::cerr << "cylinderOriginPosition " << cylinderOriginPosition.x << " " << cylinderOriginPosition.y << " " << cylinderOriginPosition.z << " ";
     // std::cerr << "cylinderInsertionPosition " << cylinderInsertionPosition.x << " " << cylinderInsertionPosition.y << " " << cylinderInsertionPosition.z << "\n";
@@ -475,64 +467,86 @@ void CylinderWrapStrap::Calculate(double deltaT)
     pgd::Vector theCylinderForcePosition;
     m_LastLength = m_Length;
 
+    int numPathCoordinates;
     m_WrapStatus = CylinderWrap(cylinderOriginPosition, cylinderInsertionPosition, m_CylinderRadius, m_NumWrapSegments, M_PI,
                                 theOriginForce, theInsertionForce, theCylinderForce, theCylinderForcePosition,
-                                &m_Length, m_PathCoordinates, &m_NumPathCoordinates);
+                                &m_Length, 0, &numPathCoordinates);
 
-    // calculate the length and velocity
-    if (deltaT != 0.0) m_Velocity = (m_Length - m_LastLength) / deltaT;
-    else m_Velocity = 0;
+    m_CylinderOriginPosition = cylinderOriginPosition;
+    m_CylinderInsertionPosition = cylinderInsertionPosition;
+    m_CylinderBodyQuaternion = qCylinderBody;
+    m_CylinderBodyPosition = vCylinderBody;
+    m_PathCoordinatesValid = false;
 
-    if (gDebug == CylinderWrapStrapDebug)
-    {
-        *gDebugStream << "CylinderWrapStrap::Calculate m_Name " << m_Name << " "
-                "cylinderOriginPosition " << cylinderOriginPosition.x << " " << cylinderOriginPosition.y << " " << cylinderOriginPosition.z << " " <<
-                "cylinderInsertionPosition " << cylinderInsertionPosition.x << " " << cylinderInsertionPosition.y << " " << cylinderInsertionPosition.z << "  " <<
-                "theOriginForce " << theOriginForce.x << " " << theOriginForce.y << " " << theOriginForce.z << " " <<
-                "theInsertionForce " << theInsertionForce.x << " " << theInsertionForce.y << " " << theInsertionForce.z << "  " <<
-                "theCylinderForcePosition " << theCylinderForcePosition.x << " " << theCylinderForcePosition.y << " " << theCylinderForcePosition.z << "  " <<
-                "theCylinderForce " << theCylinderForce.x << " " << theCylinderForce.y << " " << theCylinderForce.z << "  " <<
-                "m_Length " << m_Length << " m_Velocity " << m_Velocity << " m_WrapStatus " << m_WrapStatus << "\n";
-    }
     // now rotate back to world reference frame
 
-    theOriginForce = QVRotate(qCylinderBody, QVRotate(m_CylinderQuaternion, theOriginForce));
-    theInsertionForce = QVRotate(qCylinderBody, QVRotate(m_CylinderQuaternion, theInsertionForce));
-    theCylinderForce = QVRotate(qCylinderBody, QVRotate(m_CylinderQuaternion, theCylinderForce));
-    theCylinderForcePosition = QVRotate(m_CylinderQuaternion, theCylinderForcePosition) + m_CylinderPosition;
-    theCylinderForcePosition = QVRotate(qCylinderBody, theCylinderForcePosition) + vCylinderBody;
+    pgd::QVRotator cylinderQuaternionRotator(m_CylinderQuaternion);
+    pgd::QVRotator cylinderBodyRotator(qCylinderBody);
+    pgd::Vector worldOriginForce = cylinderBodyRotator.Rotate(cylinderQuaternionRotator.Rotate(theOriginForce));
+    pgd::Vector worldInsertionForce = cylinderBodyRotator.Rotate(cylinderQuaternionRotator.Rotate(theInsertionForce));
+    pgd::Vector worldCylinderForce = cylinderBodyRotator.Rotate(cylinderQuaternionRotator.Rotate(theCylinderForce));
+    pgd::Vector worldCylinderForcePosition = cylinderQuaternionRotator.Rotate(theCylinderForcePosition) + m_CylinderPosition;
+    worldCylinderForcePosition = cylinderBodyRotator.Rotate(worldCylinderForcePosition) + vCylinderBody;
 
 
-    PointForce *theOrigin = m_PointForceList[0];
-    PointForce *theInsertion = m_PointForceList[1];
-    PointForce *theCylinder = m_PointForceList[2];
-    theOrigin->vector[0] = theOriginForce.x; theOrigin->vector[1] = theOriginForce.y; theOrigin->vector[2] = theOriginForce.z;
+    PointForce *theOrigin = &m_PointForceList[0];
+    PointForce *theInsertion = &m_PointForceList[1];
+    PointForce *theCylinder = &m_PointForceList[2];
+    theOrigin->vector[0] = worldOriginForce.x; theOrigin->vector[1] = worldOriginForce.y; theOrigin->vector[2] = worldOriginForce.z;
     theOrigin->point[0] = worldOriginPosition.x; theOrigin->point[1] = worldOriginPosition.y; theOrigin->point[2] = worldOriginPosition.z;
-    theInsertion->vector[0] = theInsertionForce.x; theInsertion->vector[1] = theInsertionForce.y; theInsertion->vector[2] = theInsertionForce.z;
+    theInsertion->vector[0] = worldInsertionForce.x; theInsertion->vector[1] = worldInsertionForce.y; theInsertion->vector[2] = worldInsertionForce.z;
     theInsertion->point[0] = worldInsertionPosition.x; theInsertion->point[1] = worldInsertionPosition.y; theInsertion->point[2] = worldInsertionPosition.z;
-    theCylinder->vector[0] = theCylinderForce.x; theCylinder->vector[1] = theCylinderForce.y; theCylinder->vector[2] = theCylinderForce.z;
-    theCylinder->point[0] = theCylinderForcePosition.x; theCylinder->point[1] = theCylinderForcePosition.y; theCylinder->point[2] = theCylinderForcePosition.z;
+    theCylinder->vector[0] = worldCylinderForce.x; theCylinder->vector[1] = worldCylinderForce.y; theCylinder->vector[2] = worldCylinderForce.z;
+    theCylinder->point[0] = worldCylinderForcePosition.x; theCylinder->point[1] = worldCylinderForcePosition.y; theCylinder->point[2] = worldCylinderForcePosition.z;
+
+    CalculateVelocity(deltaT);
 
-    // and handle the path coordinates
-    for (i = 0; i < m_NumPathCoordinates; i++)
+    // the wrap values are reported in the cylinder frame
+    if (TRACE_ON(CylinderWrapStrapDebug))
     {
-        m_PathCoordinates[i] = QVRotate(m_CylinderQuaternion, m_PathCoordinates[i]) + m_CylinderPosition;
-        m_PathCoordinates[i] = QVRotate(qCylinderBody, m_PathCoordinates[i]) + vCylinderBody;
+        Trace::Record(CylinderWrapStrapEvent, m_Name,
+                      {cylinderOriginPosition.x, cylinderOriginPosition.y, cylinderOriginPosition.z,
+                       cylinderInsertionPosition.x, cylinderInsertionPosition.y, cylinderInsertionPosition.z,
+                       theOriginForce.x, theOriginForce.y, theOriginForce.z,
+                       theInsertionForce.x, theInsertionForce.y, theInsertionForce.z,
+                       theCylinderForcePosition.x, theCylinderForcePosition.y, theCylinderForcePosition.z,
+                       theCylinderForce.x, theCylinderForce.y, theCylinderForce.z,
+                       m_Length, m_Velocity, double(m_WrapStatus)});
     }
 
-    if (gDebug == StrapDebug)
+    if (TRACE_ON(StrapDebug))
     {
         pgd::Vector totalF(0, 0, 0);
-        for (i = 0; i < (int)m_PointForceList.size(); i++)
+        for (int i = 0; i < (int)m_PointForceList.size(); i++)
         {
-            *gDebugStream << "CylinderWrapStrap::Calculate " <<
-                    *m_PointForceList[i]->body->GetName() << " " <<
-                    m_PointForceList[i]->point[0] << " " << m_PointForceList[i]->point[1] << " " << m_PointForceList[i]->point[2] << " " <<
-                    m_PointForceList[i]->vector[0] << " " << m_PointForceList[i]->vector[1] << " " << m_PointForceList[i]->vector[2] << "\n";
-            totalF.x += m_PointForceList[i]->vector[0]; totalF.y += m_PointForceList[i]->vector[1]; totalF.z += m_PointForceList[i]->vector[2];
+            Trace::Record(StrapPointForceEvent, *m_PointForceList[i].body->GetName(),
+                          {m_PointForceList[i].point[0], m_PointForceList[i].point[1], m_PointForceList[i].point[2],
+                           m_PointForceList[i].vector[0], m_PointForceList[i].vector[1], m_PointForceList[i].vector[2]});
+            totalF.x += m_PointForceList[i].vector[0]; totalF.y += m_PointForceList[i].vector[1]; totalF.z += m_PointForceList[i].vector[2];
         }
-        *gDebugStream << "Total F " << totalF.x << " " << totalF.y << " " << totalF.z << "\n";
+        Trace::Record(StrapTotalForceEvent, m_Name, {totalF.x, totalF.y, totalF.z});
+    }
+}
+
+// repeats the wrap from the stored cylinder frame positions with the path generation switched on
+// and then rotates the path back into the world frame used by the last Calculate
+const pgd::Vector *CylinderWrapStrap::GetPathCoordinates(int *numPathCoordinates)
+{
+    if (m_PathCoordinatesValid == false)
+    {
+        if (m_PathCoordinates == 0) m_PathCoordinates = new pgd::Vector[m_NumWrapSegments + 2];
+        pgd::Vector originForce, insertionForce, cylinderForce, cylinderForcePosition;
+        double pathLength;
+        m_NumPathCoordinates = 0;
+        CylinderWrap(m_CylinderOriginPosition, m_CylinderInsertionPosition, m_CylinderRadius, m_NumWrapSegments, M_PI,
+                     originForce, insertionForce, cylinderForce, cylinderForcePosition,
+                     &pathLength, m_PathCoordinates, &m_NumPathCoordinates);
+        pgd::QVRotator(m_CylinderQuaternion).Transform(m_CylinderPosition, m_PathCoordinates, m_PathCoordinates, m_NumPathCoordinates);
+        pgd::QVRotator(m_CylinderBodyQuaternion).Transform(m_CylinderBodyPosition, m_PathCoordinates, m_PathCoordinates, m_NumPathCoordinates);
+        m_PathCoordinatesValid = true;
     }
+    *numPathCoordinates = m_NumPathCoordinates;
+    return m_PathCoordinates;
 }
 
 // function to wrap a line around a cylinder
@@ -795,28 +809,13 @@ int CylinderWrapStrap::SanityCheck(Strap *otherStrap, AxisType axis, const std::
 #ifdef USE_QT
 void CylinderWrapStrap::Draw(SimulationWindow *window)
 {
-    const int kSides = 128;
-    FacetedPolyline *facetedPolyline;
-    unsigned int i;
+    FacetedBatch *batch = window->strapBatch();
 
-    if (m_simulation->GetTime() != m_LastDrawTime)
+    if (m_Visible)
     {
-        m_LastDrawTime = m_simulation->GetTime();
-        std::vector<FacetedObject *>::const_iterator iterFO;
-        for (iterFO = m_DrawList.begin(); iterFO != m_DrawList.end(); iterFO++)
-            delete *iterFO;
-        m_DrawList.clear();
-
-        std::vector<pgd::Vector> polyline;
-        for (i = 0; i < (unsigned int)m_NumPathCoordinates; i++)
-        {
-            polyline.push_back(m_PathCoordinates[i]);
-        }
-        facetedPolyline = new FacetedPolyline(&polyline, m_Radius, kSides);
-        facetedPolyline->SetColour(m_Colour);
-        facetedPolyline->setSimulationWindow(window);
-        facetedPolyline->SetVisible(m_Visible);
-        m_DrawList.push_back(facetedPolyline);
+        int numPathCoordinates;
+        const pgd::Vector *pathCoordinates = GetPathCoordinates(&numPathCoordinates);
+        batch->AddPolyline(pathCoordinates, numPathCoordinates, m_Radius, m_Colour);
 
         // calculate the quaternion that rotates from cylinder coordinates to world coordinates
         const double *q = dBodyGetQuaternion(m_CylinderBody->GetBodyID());
@@ -827,33 +826,10 @@ void CylinderWrapStrap::Draw(SimulationWindow *window)
         dVector3 position;
         dBodyGetRelPointPos(m_CylinderBody->GetBodyID(), m_CylinderPosition.x, m_CylinderPosition.y, m_CylinderPosition.z, position);
         // and draw it
-        polyline.clear();
-        polyline.push_back(pgd::Vector(position[0] - cylinderVecWorld.x, position[1] - cylinderVecWorld.y, position[2] - cylinderVecWorld.z));
-        polyline.push_back(pgd::Vector(position[0] + cylinderVecWorld.x, position[1] + cylinderVecWorld.y, position[2] + cylinderVecWorld.z));
-        facetedPolyline = new FacetedPolyline(&polyline, m_CylinderRadius, kSides);
-        facetedPolyline->SetColour(m_CylinderColour);
-        facetedPolyline->setSimulationWindow(window);
-        facetedPolyline->SetVisible(m_Visible);
-        m_DrawList.push_back(facetedPolyline);
-
-        if (m_drawMuscleForces)
-        {
-            for (i = 0; i < m_PointForceList.size(); i++)
-            {
-                polyline.clear();
-                pgd::Vector f = pgd::Vector(m_PointForceList[i]->vector[0], m_PointForceList[i]->vector[1], m_PointForceList[i]->vector[2]) * m_Tension * m_ForceScale;
-                polyline.push_back(pgd::Vector(m_PointForceList[i]->point[0], m_PointForceList[i]->point[1], m_PointForceList[i]->point[2]));
-                polyline.push_back(pgd::Vector(m_PointForceList[i]->point[0], m_PointForceList[i]->point[1], m_PointForceList[i]->point[2]) + f);
-                facetedPolyline = new FacetedPolyline(&polyline, m_ForceRadius, kSides);
-                facetedPolyline->SetColour(m_Colour);
-                facetedPolyline->setSimulationWindow(window);
-                facetedPolyline->SetVisible(m_drawMuscleForces);
-                m_DrawList.push_back(facetedPolyline);
-            }
-        }
+        pgd::Vector cylinderCentre(position[0], position[1], position[2]);
+        batch->AddCylinder(cylinderCentre - cylinderVecWorld, cylinderCentre + cylinderVecWorld, m_CylinderRadius, m_CylinderColour);
     }
 
-    for (i = 0; i < m_DrawList.size(); i++)
-        m_DrawList[i]->Draw();
+    DrawPointForces(batch);
 }
 #endif
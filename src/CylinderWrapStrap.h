@@ -33,7 +33,7 @@ public:
     void SetCylinderPosition(const char *buf);
     void SetCylinderQuaternion(const char *buf);
     void SetCylinderAxis(const char *buf);
-    void SetNumWrapSegments(int num) { m_NumWrapSegments = num; };
+    void SetNumWrapSegments(int num) { m_NumWrapSegments = num; delete [] m_PathCoordinates; m_PathCoordinates = 0; m_PathCoordinatesValid = false; };
 
     virtual void Calculate(double deltaT);
 
@@ -41,6 +41,9 @@ public:
     void GetInsertion(Body **body, dVector3 pos) { *body = m_InsertionBody; pos[0] = m_InsertionPosition.x; pos[1] = m_InsertionPosition.y; pos[2] = m_InsertionPosition.z; };
     void GetCylinder(Body **body, dVector3 pos, double *radius, dQuaternion q);
 
+    // the path is only needed for drawing so it is generated on request from the last Calculate
+    const pgd::Vector *GetPathCoordinates(int *numPathCoordinates);
+
     virtual int SanityCheck(Strap *otherStrap, AxisType axis, const std::string &sanityCheckLeft, const std::string &sanityCheckRight);
 
 #ifdef USE_QT
@@ -68,8 +71,15 @@ protected:
 
     int m_WrapStatus;
 
+    // the cylinder frame state from the last Calculate which is all the path needs
+    pgd::Vector m_CylinderOriginPosition;
+    pgd::Vector m_CylinderInsertionPosition;
+    pgd::Quaternion m_CylinderBodyQuaternion;
+    pgd::Vector m_CylinderBodyPosition;
+
     pgd::Vector *m_PathCoordinates;
     int m_NumPathCoordinates;
+    bool m_PathCoordinatesValid;
 
 #ifdef USE_QT
     Colour m_CylinderColour;
@@ -14,6 +14,7 @@
 #include "Strap.h"
 #include "DampedSpringMuscle.h"
 #include "DebugControl.h"
+#include "Trace.h"
 #include "Simulation.h"
 
 // constructor
@@ -77,10 +78,9 @@ void DampedSpringMuscle::SetActivation(double activation, double /* duration */)
     }
     m_Strap->SetTension(tension);
 
-    if (gDebug == DampedSpringDebug)
-        *gDebugStream << "DampedSpringMuscle::UpdateTension m_Name " << m_Name << " m_Strap->GetLength() " << m_Strap->GetLength() << " m_UnloadedLength " << m_UnloadedLength
-            << " m_SpringConstant " << m_SpringConstant << " m_Strap->GetVelocity() " << m_Strap->GetVelocity()
-            << " m_Damping " << m_Damping << " tension " << tension << "\n";
+    if (TRACE_ON(DampedSpringDebug))
+        Trace::Record(DampedSpringTensionEvent, m_Name,
+                      {m_Strap->GetLength(), m_UnloadedLength, m_SpringConstant, m_Strap->GetVelocity(), m_Damping, tension});
 }
 
 void DampedSpringMuscle::Dump()
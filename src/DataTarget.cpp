@@ -27,7 +27,6 @@ DataTarget::DataTarget()
     m_MatchType = linear;
     m_AbortThreshold = -DBL_MAX;
     m_Target = 0;
-    m_LastMatchIndex = -1;
 }
 
 DataTarget::~DataTarget()
@@ -76,31 +75,13 @@ void DataTarget::SetTargetValues(int size, double *values)
 }
 
 
-// returns the index if a target match time is triggered
-// the tolerance needs to be lower than the distance between target times
-// returns -1 if no target is found within the tolerance
-int DataTarget::TargetMatch(double time, double tolerance)
+// returns the highest score that a single match could give which is the intercept
+// since the error term can only reduce the score
+// returns DBL_MAX if there is no upper bound
+double DataTarget::GetMaximumMatchValue()
 {
-    m_LastMatchIndex = ProtectedTargetMatch(time, tolerance);
-    return m_LastMatchIndex;
-}
-
-int DataTarget::ProtectedTargetMatch(double time, double tolerance)
-{
-    int index = Util::BinarySearchRange(m_TargetTimeList, m_TargetTimeListLength, time);
-    if (index < 0)
-    {
-        if (fabs(m_TargetTimeList[0] - time) <= tolerance) return 0;
-        return -1;
-    }
-    if (index >= m_TargetTimeListLength - 1)
-    {
-        if (fabs(m_TargetTimeList[m_TargetTimeListLength - 1] - time) <= tolerance) return m_TargetTimeListLength - 1;
-        return -1;
-    }
-    if (fabs(m_TargetTimeList[index] - time) <= tolerance) return index;
-    if (fabs(m_TargetTimeList[index + 1] - time) <= tolerance) return index + 1;
-    return -1;
+    if (m_Slope < 0) return DBL_MAX;
+    return m_Intercept;
 }
 
 double DataTarget::PositiveFunction(double v)
@@ -28,8 +28,9 @@ public:
 
     void SetTargetTimes(int size, double *targetTimes);
     virtual void SetTargetValues(int size, double *values);
-    int TargetMatch(double time, double tolerance);
-    int GetLastMatchIndex() { return m_LastMatchIndex; }
+    int GetTargetTimeListLength() { return m_TargetTimeListLength; }
+    double GetTargetTime(int index) { return m_TargetTimeList[index]; }
+    double GetMaximumMatchValue();
 
     void SetIntercept(double intercept) { m_Intercept = intercept; }
     void SetSlope(double slope) { m_Slope = slope; }
@@ -48,8 +49,6 @@ public:
 
 protected:
 
-    int ProtectedTargetMatch(double time, double tolerance);
-
     NamedObject *m_Target;
 
     double m_Intercept;
@@ -61,8 +60,6 @@ protected:
     int m_TargetTimeListLength;
     double *m_ValueList;
     int m_ValueListLength;
-
-    int m_LastMatchIndex;
 };
 
 #endif
@@ -25,6 +25,7 @@ public:
     double GetCurrentDriverSum() { return m_currentDriverSum; }
     void SetCurrentDriverSum(double currentDriverSum) { m_currentDriverSum = currentDriverSum; }
     double SumDrivers(double time);
+    const std::vector<Driver *> *GetDriverList() { return &m_driverList; }
 
 protected:
     std::vector<Driver *> m_driverList;
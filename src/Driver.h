@@ -25,6 +25,9 @@ public:
     Drivable *GetTarget() { return m_Target; }
     void SetMinMax(double minV, double maxV) { m_MinValue = minV; m_MaxValue = maxV; }
     void SetInterp(bool interp) { m_Interp = interp; }
+    double GetMinValue() { return m_MinValue; }
+    double GetMaxValue() { return m_MaxValue; }
+    bool GetInterp() { return m_Interp; }
 
     virtual double GetValue(double time) = 0;
 
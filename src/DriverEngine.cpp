@@ -0,0 +1,350 @@
+/*
+ *  DriverEngine.cpp
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+#include <iostream>
+#include <cmath>
+
+#include "DriverEngine.h"
+#include "Driver.h"
+#include "Drivable.h"
+#include "BoxCarDriver.h"
+#include "StackedBoxCarDriver.h"
+#include "CyclicDriver.h"
+#include "StepDriver.h"
+#include "FixedDriver.h"
+
+DriverEngine::DriverEngine()
+{
+    m_updateInterval = 1;
+    m_stepSize = 0;
+    m_interpolation = HoldValue;
+    m_stepsSinceUpdate = 0;
+}
+
+void DriverEngine::Build(const std::map<std::string, Driver *> &driverList)
+{
+    m_values.clear();
+    m_boxCarCycleTimes.clear();
+    m_boxCarDelays.clear();
+    m_boxCarOffTimes.clear();
+    m_boxCarHeights.clear();
+    m_boxCarCycleCounts.clear();
+    m_boxCarEntrySlots.clear();
+    m_boxCarSlots.clear();
+    m_boxCarMinValues.clear();
+    m_boxCarMaxValues.clear();
+    m_cyclics.clear();
+    m_steps.clear();
+    m_fixedDrivers.clear();
+    m_fixedSlots.clear();
+    m_otherDrivers.clear();
+    m_otherSlots.clear();
+    m_targets.clear();
+    m_targetStarts.clear();
+    m_targetSlots.clear();
+    m_startSums.clear();
+    m_endSums.clear();
+    m_stepsSinceUpdate = 0;
+
+    std::map<Driver *, int> slotMap;
+    std::map<Drivable *, int> targetMap;
+    int slot = 0;
+    for (std::map<std::string, Driver *>::const_iterator iter = driverList.begin(); iter != driverList.end(); iter++, slot++)
+    {
+        Driver *driver = iter->second;
+        slotMap[driver] = slot;
+        if (driver->GetTarget() && targetMap.find(driver->GetTarget()) == targetMap.end())
+        {
+            targetMap[driver->GetTarget()] = int(m_targets.size());
+            m_targets.push_back(driver->GetTarget());
+        }
+
+        BoxCarDriver *boxCarDriver = dynamic_cast<BoxCarDriver *>(driver);
+        if (boxCarDriver)
+        {
+            m_boxCarCycleTimes.push_back(boxCarDriver->GetCycleTime());
+            m_boxCarDelays.push_back(boxCarDriver->GetDelay());
+            m_boxCarOffTimes.push_back(boxCarDriver->GetDelay() + boxCarDriver->GetWidth());
+            m_boxCarHeights.push_back(boxCarDriver->GetHeight());
+            m_boxCarCycleCounts.push_back(0);
+            m_boxCarEntrySlots.push_back(slot);
+            m_boxCarSlots.push_back(slot);
+            m_boxCarMinValues.push_back(driver->GetMinValue());
+            m_boxCarMaxValues.push_back(driver->GetMaxValue());
+            continue;
+        }
+
+        StackedBoxCarDriver *stackedBoxCarDriver = dynamic_cast<StackedBoxCarDriver *>(driver);
+        if (stackedBoxCarDriver)
+        {
+            std::vector<double> *cycleTimes = stackedBoxCarDriver->GetCycleTimes();
+            std::vector<double> *delays = stackedBoxCarDriver->GetDelays();
+            std::vector<double> *widths = stackedBoxCarDriver->GetWidths();
+            std::vector<double> *heights = stackedBoxCarDriver->GetHeights();
+            for (size_t i = 0; i < cycleTimes->size(); i++)
+            {
+                m_boxCarCycleTimes.push_back((*cycleTimes)[i]);
+                m_boxCarDelays.push_back((*delays)[i]);
+                m_boxCarOffTimes.push_back((*delays)[i] + (*widths)[i]);
+                m_boxCarHeights.push_back((*heights)[i]);
+                m_boxCarCycleCounts.push_back(0);
+                m_boxCarEntrySlots.push_back(slot);
+            }
+            m_boxCarSlots.push_back(slot);
+            m_boxCarMinValues.push_back(driver->GetMinValue());
+            m_boxCarMaxValues.push_back(driver->GetMaxValue());
+            continue;
+        }
+
+        CyclicDriver *cyclicDriver = dynamic_cast<CyclicDriver *>(driver);
+        if (cyclicDriver)
+        {
+            CyclicState state;
+            state.valueList = cyclicDriver->GetValueList();
+            state.durationList = cyclicDriver->GetDurationList();
+            state.listLength = cyclicDriver->GetListLength();
+            state.cycleTime = state.durationList[state.listLength];
+            state.timeOffset = state.cycleTime - state.cycleTime * cyclicDriver->GetPhaseDelay();
+            state.index = 0;
+            state.interp = driver->GetInterp();
+            state.minValue = driver->GetMinValue();
+            state.maxValue = driver->GetMaxValue();
+            state.slot = slot;
+            m_cyclics.push_back(state);
+            continue;
+        }
+
+        StepDriver *stepDriver = dynamic_cast<StepDriver *>(driver);
+        if (stepDriver)
+        {
+            StepState state;
+            state.valueList = stepDriver->GetValueList();
+            state.durationList = stepDriver->GetDurationList();
+            state.listLength = stepDriver->GetListLength();
+            state.index = 0;
+            state.lastTime = -1;
+            state.lastValue = -1;
+            state.interp = driver->GetInterp();
+            state.minValue = driver->GetMinValue();
+            state.maxValue = driver->GetMaxValue();
+            state.slot = slot;
+            m_steps.push_back(state);
+            continue;
+        }
+
+        FixedDriver *fixedDriver = dynamic_cast<FixedDriver *>(driver);
+        if (fixedDriver)
+        {
+            m_fixedDrivers.push_back(fixedDriver);
+            m_fixedSlots.push_back(slot);
+            continue;
+        }
+
+        m_otherDrivers.push_back(driver);
+        m_otherSlots.push_back(slot);
+    }
+    m_values.resize(slot, 0);
+
+    for (size_t i = 0; i < m_targets.size(); i++)
+    {
+        m_targetStarts.push_back(int(m_targetSlots.size()));
+        const std::vector<Driver *> *targetDriverList = m_targets[i]->GetDriverList();
+        for (size_t j = 0; j < targetDriverList->size(); j++)
+        {
+            std::map<Driver *, int>::const_iterator found = slotMap.find((*targetDriverList)[j]);
+            if (found == slotMap.end())
+            {
+                std::cerr << "DriverEngine::Build error: driver not found for target " << *m_targets[i]->GetName() << "\n";
+                continue;
+            }
+            m_targetSlots.push_back(found->second);
+        }
+    }
+    m_targetStarts.push_back(int(m_targetSlots.size()));
+}
+
+void DriverEngine::SumDrivers(double time)
+{
+    CalculateSums(time, &m_startSums);
+    for (size_t i = 0; i < m_targets.size(); i++) m_targets[i]->SetCurrentDriverSum(m_startSums[i]);
+}
+
+void DriverEngine::SetUpdateInterval(int updateInterval, double stepSize, InterpolationType interpolation)
+{
+    m_updateInterval = updateInterval;
+    m_stepSize = stepSize;
+    m_interpolation = interpolation;
+    m_stepsSinceUpdate = 0;
+    m_endSums.clear();
+}
+
+void DriverEngine::Update(double time)
+{
+    if (m_updateInterval <= 1)
+    {
+        SumDrivers(time);
+        return;
+    }
+
+    size_t i;
+    if (m_stepsSinceUpdate == 0)
+    {
+        if (m_interpolation == HoldValue)
+        {
+            SumDrivers(time);
+        }
+        else
+        {
+            // the end of the last interval is the start of this one so the drivers are only asked for times in order
+            if (m_endSums.size() == m_targets.size()) m_startSums.swap(m_endSums);
+            else CalculateSums(time, &m_startSums);
+            CalculateSums(time + m_updateInterval * m_stepSize, &m_endSums);
+        }
+    }
+
+    if (m_interpolation == LinearInterpolation)
+    {
+        double fraction = double(m_stepsSinceUpdate) / m_updateInterval;
+        for (i = 0; i < m_targets.size(); i++)
+            m_targets[i]->SetCurrentDriverSum(m_startSums[i] + fraction * (m_endSums[i] - m_startSums[i]));
+    }
+
+    m_stepsSinceUpdate++;
+    if (m_stepsSinceUpdate >= m_updateInterval) m_stepsSinceUpdate = 0;
+}
+
+void DriverEngine::CalculateSums(double time, std::vector<double> *sums)
+{
+    size_t i;
+    int j;
+    double *values = m_values.data();
+
+    EvaluateBoxCars(time);
+    EvaluateCyclics(time);
+    EvaluateSteps(time);
+    for (i = 0; i < m_fixedDrivers.size(); i++) values[m_fixedSlots[i]] = m_fixedDrivers[i]->FixedDriver::GetValue(time);
+    for (i = 0; i < m_otherDrivers.size(); i++) values[m_otherSlots[i]] = m_otherDrivers[i]->GetValue(time);
+
+    sums->resize(m_targets.size());
+    const int *targetSlots = m_targetSlots.data();
+    for (i = 0; i < m_targets.size(); i++)
+    {
+        double sum = 0;
+        for (j = m_targetStarts[i]; j < m_targetStarts[i + 1]; j++) sum += values[targetSlots[j]];
+        (*sums)[i] = sum;
+    }
+}
+
+// same shape as BoxCarDriver::GetValue but floor(time / cycleTime) is kept as a running cycle count
+// which only needs to be incremented at the end of each cycle
+void DriverEngine::EvaluateBoxCars(double time)
+{
+    size_t i;
+    double *values = m_values.data();
+    for (i = 0; i < m_boxCarSlots.size(); i++) values[m_boxCarSlots[i]] = 0;
+
+    const double *cycleTimes = m_boxCarCycleTimes.data();
+    const double *delays = m_boxCarDelays.data();
+    const double *offTimes = m_boxCarOffTimes.data();
+    const double *heights = m_boxCarHeights.data();
+    double *cycleCounts = m_boxCarCycleCounts.data();
+    const int *entrySlots = m_boxCarEntrySlots.data();
+    size_t numEntries = m_boxCarCycleTimes.size();
+    double cycles, normalisedCycleTime;
+    bool active;
+    for (i = 0; i < numEntries; i++)
+    {
+        cycles = time / cycleTimes[i];
+        if (cycles >= cycleCounts[i] + 1)
+        {
+            cycleCounts[i] += 1;
+            if (cycles >= cycleCounts[i] + 1) cycleCounts[i] = floor(cycles); // more than one cycle since the last call
+        }
+        else if (cycles < cycleCounts[i]) cycleCounts[i] = floor(cycles); // time has gone backwards
+        normalisedCycleTime = cycles - cycleCounts[i];
+
+        if (offTimes[i] < 1) active = (normalisedCycleTime > delays[i] && normalisedCycleTime < offTimes[i]); // no wrap case
+        else active = (normalisedCycleTime < offTimes[i] - 1 || normalisedCycleTime > delays[i]); // wrap case
+        if (active) values[entrySlots[i]] += heights[i];
+    }
+
+    for (i = 0; i < m_boxCarSlots.size(); i++)
+    {
+        double *v = values + m_boxCarSlots[i];
+        if (*v < m_boxCarMinValues[i]) *v = m_boxCarMinValues[i];
+        if (*v > m_boxCarMaxValues[i]) *v = m_boxCarMaxValues[i];
+    }
+}
+
+// same as CyclicDriver::GetValue except that a miss on the current interval moves forward
+// through the list (wrapping at the end of the cycle) rather than doing a binary search
+void DriverEngine::EvaluateCyclics(double time)
+{
+    double *values = m_values.data();
+    for (size_t i = 0; i < m_cyclics.size(); i++)
+    {
+        CyclicState *state = &m_cyclics[i];
+        const double *durationList = state->durationList;
+        const double *valueList = state->valueList;
+        double rem = fmod(time + state->timeOffset, state->cycleTime);
+
+        int index = state->index;
+        if (durationList[index] > rem) index = 0; // wrapped into the next cycle
+        while (index < state->listLength - 1 && durationList[index + 1] <= rem) index++;
+        if (durationList[index] > rem || durationList[index + 1] <= rem) index = 0; // fixup for not found errors
+        state->index = index;
+
+        double v;
+        if (state->interp == false) v = valueList[index];
+        else v = ((rem - durationList[index]) / (durationList[index + 1] - durationList[index])) *
+                (valueList[index + 1] - valueList[index]) + valueList[index];
+
+        if (v < state->minValue) v = state->minValue;
+        if (v > state->maxValue) v = state->maxValue;
+        values[state->slot] = v;
+    }
+}
+
+// same as StepDriver::GetValue but with the cursor held in the engine
+void DriverEngine::EvaluateSteps(double time)
+{
+    double *values = m_values.data();
+    for (size_t i = 0; i < m_steps.size(); i++)
+    {
+        StepState *state = &m_steps[i];
+        if (time < state->lastTime)
+        {
+            std::cerr << "DriverEngine::EvaluateSteps Error: cannot request value in the past. lastTime = " << state->lastTime << " time = " << time << "\n";
+            values[state->slot] = 0;
+            continue;
+        }
+        if (time == state->lastTime)
+        {
+            values[state->slot] = state->lastValue;
+            continue;
+        }
+        state->lastTime = time;
+
+        const double *durationList = state->durationList;
+        const double *valueList = state->valueList;
+        int lastEntry = state->listLength - 1;
+        while (state->index < lastEntry && time >= durationList[state->index + 1]) state->index++;
+
+        double v;
+        if (state->index >= lastEntry) v = valueList[lastEntry];
+        else if (state->interp == false) v = valueList[state->index];
+        else v = ((time - durationList[state->index]) / (durationList[state->index + 1] - durationList[state->index])) *
+                (valueList[state->index + 1] - valueList[state->index]) + valueList[state->index];
+
+        if (v < state->minValue) v = state->minValue;
+        if (v > state->maxValue) v = state->maxValue;
+        state->lastValue = v;
+        values[state->slot] = v;
+    }
+}
@@ -0,0 +1,119 @@
+/*
+ *  DriverEngine.h
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+// DriverEngine evaluates every driver in the simulation once per step and
+// writes the driver sums into the targets. The drivers are grouped by their
+// concrete type when the model is loaded so that each group is evaluated in
+// its own loop over flat arrays rather than through a virtual call per driver.
+// Box car phases and the step and cyclic list positions are tracked with
+// cursors that only move forward because simulation time only increases, and
+// the arithmetic matches the GetValue functions of the individual drivers.
+// The sums can be recalculated every few steps rather than every step, in
+// which case they are either held or interpolated linearly towards the sums
+// at the next update time.
+
+#ifndef DriverEngine_h
+#define DriverEngine_h
+
+#include <map>
+#include <string>
+#include <vector>
+
+class Driver;
+class Drivable;
+class FixedDriver;
+
+class DriverEngine
+{
+public:
+    DriverEngine();
+
+    enum InterpolationType { HoldValue, LinearInterpolation };
+
+    void Build(const std::map<std::string, Driver *> &driverList);
+    void SumDrivers(double time);
+
+    // Update is called every step and recalculates the sums every updateInterval steps
+    void SetUpdateInterval(int updateInterval, double stepSize, InterpolationType interpolation);
+    void Update(double time);
+
+    size_t GetNumDrivers() { return m_values.size(); }
+
+protected:
+    void CalculateSums(double time, std::vector<double> *sums);
+    void EvaluateBoxCars(double time);
+    void EvaluateCyclics(double time);
+    void EvaluateSteps(double time);
+
+    struct CyclicState
+    {
+        const double *valueList;
+        const double *durationList;
+        int listLength;
+        double timeOffset;
+        double cycleTime;
+        int index;
+        bool interp;
+        double minValue;
+        double maxValue;
+        int slot;
+    };
+
+    struct StepState
+    {
+        const double *valueList;
+        const double *durationList;
+        int listLength;
+        int index;
+        double lastTime;
+        double lastValue;
+        bool interp;
+        double minValue;
+        double maxValue;
+        int slot;
+    };
+
+    std::vector<double> m_values; // current value of every driver indexed by slot
+
+    // box car and stacked box car entries as parallel arrays (a BoxCarDriver is a stack of 1)
+    std::vector<double> m_boxCarCycleTimes;
+    std::vector<double> m_boxCarDelays;
+    std::vector<double> m_boxCarOffTimes;
+    std::vector<double> m_boxCarHeights;
+    std::vector<double> m_boxCarCycleCounts; // floor(time / cycleTime) at the last evaluation
+    std::vector<int> m_boxCarEntrySlots;
+    std::vector<int> m_boxCarSlots; // one per box car driver
+    std::vector<double> m_boxCarMinValues;
+    std::vector<double> m_boxCarMaxValues;
+
+    std::vector<CyclicState> m_cyclics;
+    std::vector<StepState> m_steps;
+
+    std::vector<FixedDriver *> m_fixedDrivers;
+    std::vector<int> m_fixedSlots;
+
+    // anything not listed above falls back to the virtual GetValue
+    std::vector<Driver *> m_otherDrivers;
+    std::vector<int> m_otherSlots;
+
+    // the slots for each target are stored in the same order as the target's own driver list
+    // so that the sums are accumulated in the same order as Drivable::SumDrivers
+    std::vector<Drivable *> m_targets;
+    std::vector<int> m_targetStarts;
+    std::vector<int> m_targetSlots;
+
+    int m_updateInterval;
+    double m_stepSize;
+    InterpolationType m_interpolation;
+    int m_stepsSinceUpdate;
+    std::vector<double> m_startSums; // sums at the last update
+    std::vector<double> m_endSums; // sums at the next update when interpolating
+};
+
+#endif // DriverEngine_h
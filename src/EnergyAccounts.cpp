@@ -0,0 +1,70 @@
+/*
+ *  EnergyAccounts.cpp
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+#include "EnergyAccounts.h"
+
+EnergyAccounts::EnergyAccounts()
+{
+    m_numMuscles = 0;
+    m_recordElasticEnergy = false;
+    m_mechanicalEnergy = 0;
+    m_metabolicEnergy = 0;
+}
+
+void EnergyAccounts::SetNumMuscles(int numMuscles)
+{
+    m_numMuscles = numMuscles;
+    m_positiveMechanicalWork.assign(numMuscles, 0);
+    m_negativeMechanicalWork.assign(numMuscles, 0);
+    m_positiveContractileWork.assign(numMuscles, 0);
+    m_negativeContractileWork.assign(numMuscles, 0);
+    m_positiveSerialElasticWork.assign(numMuscles, 0);
+    m_negativeSerialElasticWork.assign(numMuscles, 0);
+    m_positiveParallelElasticWork.assign(numMuscles, 0);
+    m_negativeParallelElasticWork.assign(numMuscles, 0);
+    m_muscleMetabolicEnergy.assign(numMuscles, 0);
+    m_mechanicalPower.assign(numMuscles, 0);
+    m_contractilePower.assign(numMuscles, 0);
+    m_serialElasticPower.assign(numMuscles, 0);
+    m_parallelElasticPower.assign(numMuscles, 0);
+    m_elasticEnergy.assign(numMuscles, 0);
+    m_serialElasticEnergy.assign(numMuscles, 0);
+    m_parallelElasticEnergy.assign(numMuscles, 0);
+    m_hasElements.assign(numMuscles, 0);
+    m_hasElasticEnergy.assign(numMuscles, 0);
+}
+
+void EnergyAccounts::AddElementWork(int muscle,
+                                    double contractileVelocity, double contractileForce,
+                                    double serialVelocity, double serialForce,
+                                    double parallelVelocity, double parallelForce,
+                                    double timeIncrement)
+{
+    m_hasElements[muscle] = 1;
+
+    if (contractileVelocity < 0) m_positiveContractileWork[muscle] += -1 * contractileVelocity * contractileForce * timeIncrement;
+    else m_negativeContractileWork[muscle] += -1 * contractileVelocity * contractileForce * timeIncrement;
+
+    if (serialVelocity < 0) m_positiveSerialElasticWork[muscle] += -1 * serialVelocity * serialForce * timeIncrement;
+    else m_negativeSerialElasticWork[muscle] += -1 * serialVelocity * serialForce * timeIncrement;
+
+    if (parallelVelocity < 0) m_positiveParallelElasticWork[muscle] += -1 * parallelVelocity * parallelForce * timeIncrement;
+    else m_negativeParallelElasticWork[muscle] += -1 * parallelVelocity * parallelForce * timeIncrement;
+
+    m_contractilePower[muscle] = contractileVelocity * -contractileForce;
+    m_serialElasticPower[muscle] = serialVelocity * -serialForce;
+    m_parallelElasticPower[muscle] = parallelVelocity * -parallelForce;
+}
+
+double EnergyAccounts::Sum(const std::vector<double> &list)
+{
+    double total = 0;
+    for (unsigned int i = 0; i < list.size(); i++) total += list[i];
+    return total;
+}
@@ -0,0 +1,125 @@
+/*
+ *  EnergyAccounts.h
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+// EnergyAccounts collects the muscle energy terms. Each muscle adds its own
+// contributions at the end of its update using the index of the muscle in the
+// simulation muscle list, so the simulation does not need to know which muscle
+// type it is dealing with. The work terms are kept as one array per term with
+// one entry per muscle and the totals are only summed when they are asked for.
+// The mechanical and metabolic energies are also kept as running totals
+// because they are checked every step.
+
+#ifndef EnergyAccounts_h
+#define EnergyAccounts_h
+
+#include <vector>
+
+class EnergyAccounts
+{
+public:
+    EnergyAccounts();
+
+    void SetNumMuscles(int numMuscles);
+    int GetNumMuscles() { return m_numMuscles; }
+
+    // the elastic energies are only needed for reporting so they are only recorded when requested
+    void SetRecordElasticEnergy(bool recordElasticEnergy) { m_recordElasticEnergy = recordElasticEnergy; }
+    bool GetRecordElasticEnergy() { return m_recordElasticEnergy; }
+
+    // called by the muscles once per step
+    void AddMechanicalPower(int muscle, double power, double timeIncrement)
+    {
+        m_mechanicalEnergy += power * timeIncrement;
+        m_mechanicalPower[muscle] = power;
+        if (power > 0) m_positiveMechanicalWork[muscle] += power * timeIncrement;
+        else m_negativeMechanicalWork[muscle] += power * timeIncrement;
+    }
+    void AddMetabolicPower(int muscle, double power, double timeIncrement)
+    {
+        m_metabolicEnergy += power * timeIncrement;
+        m_muscleMetabolicEnergy[muscle] += power * timeIncrement;
+    }
+    // only muscles with an elastic element call this
+    void SetElasticEnergy(int muscle, double elasticEnergy)
+    {
+        m_elasticEnergy[muscle] = elasticEnergy;
+        m_hasElasticEnergy[muscle] = 1;
+    }
+
+    // only muscles with separate contractile, serial and parallel elements call these
+    // the sign of the work follows the sign of the element velocity (shortening is positive work)
+    void AddElementWork(int muscle,
+                        double contractileVelocity, double contractileForce,
+                        double serialVelocity, double serialForce,
+                        double parallelVelocity, double parallelForce,
+                        double timeIncrement);
+    void SetElementEnergies(int muscle, double serialElasticEnergy, double parallelElasticEnergy)
+    {
+        m_serialElasticEnergy[muscle] = serialElasticEnergy;
+        m_parallelElasticEnergy[muscle] = parallelElasticEnergy;
+    }
+
+    void AddBasalMetabolicPower(double power, double timeIncrement) { m_metabolicEnergy += power * timeIncrement; }
+
+    double GetMechanicalEnergy() { return m_mechanicalEnergy; }
+    double GetMetabolicEnergy() { return m_metabolicEnergy; }
+
+    double GetPositiveMechanicalWork() { return Sum(m_positiveMechanicalWork); }
+    double GetNegativeMechanicalWork() { return Sum(m_negativeMechanicalWork); }
+    double GetPositiveContractileWork() { return Sum(m_positiveContractileWork); }
+    double GetNegativeContractileWork() { return Sum(m_negativeContractileWork); }
+    double GetPositiveSerialElasticWork() { return Sum(m_positiveSerialElasticWork); }
+    double GetNegativeSerialElasticWork() { return Sum(m_negativeSerialElasticWork); }
+    double GetPositiveParallelElasticWork() { return Sum(m_positiveParallelElasticWork); }
+    double GetNegativeParallelElasticWork() { return Sum(m_negativeParallelElasticWork); }
+    double GetSerialElasticEnergy() { return Sum(m_serialElasticEnergy); }
+    double GetParallelElasticEnergy() { return Sum(m_parallelElasticEnergy); }
+
+    // per muscle values from the last step
+    bool HasElements(int muscle) { return m_hasElements[muscle] != 0; }
+    bool HasElasticEnergy(int muscle) { return m_hasElasticEnergy[muscle] != 0; }
+    double GetMetabolicEnergy(int muscle) { return m_muscleMetabolicEnergy[muscle]; }
+    double GetMechanicalPower(int muscle) { return m_mechanicalPower[muscle]; }
+    double GetContractilePower(int muscle) { return m_contractilePower[muscle]; }
+    double GetSerialElasticPower(int muscle) { return m_serialElasticPower[muscle]; }
+    double GetParallelElasticPower(int muscle) { return m_parallelElasticPower[muscle]; }
+    double GetElasticEnergy(int muscle) { return m_elasticEnergy[muscle]; }
+    double GetSerialElasticEnergy(int muscle) { return m_serialElasticEnergy[muscle]; }
+    double GetParallelElasticEnergy(int muscle) { return m_parallelElasticEnergy[muscle]; }
+
+protected:
+    static double Sum(const std::vector<double> &list);
+
+    int m_numMuscles;
+    bool m_recordElasticEnergy;
+    double m_mechanicalEnergy;
+    double m_metabolicEnergy;
+
+    std::vector<double> m_positiveMechanicalWork;
+    std::vector<double> m_negativeMechanicalWork;
+    std::vector<double> m_positiveContractileWork;
+    std::vector<double> m_negativeContractileWork;
+    std::vector<double> m_positiveSerialElasticWork;
+    std::vector<double> m_negativeSerialElasticWork;
+    std::vector<double> m_positiveParallelElasticWork;
+    std::vector<double> m_negativeParallelElasticWork;
+    std::vector<double> m_muscleMetabolicEnergy;
+
+    std::vector<double> m_mechanicalPower;
+    std::vector<double> m_contractilePower;
+    std::vector<double> m_serialElasticPower;
+    std::vector<double> m_parallelElasticPower;
+    std::vector<double> m_elasticEnergy;
+    std::vector<double> m_serialElasticEnergy;
+    std::vector<double> m_parallelElasticEnergy;
+    std::vector<char> m_hasElements;
+    std::vector<char> m_hasElasticEnergy;
+};
+
+#endif // EnergyAccounts_h
@@ -27,6 +27,7 @@
 #include "Environment.h"
 #include "Geom.h"
 #include "PlaneGeom.h"
+#include "HeightfieldGeom.h"
 
 
 Environment::Environment()
@@ -140,9 +141,23 @@ void Environment::Draw(SimulationWindow *window)
 void Environment::WriteToXMLStream(std::ostream &outputStream)
 {
     outputStream << "<ENVIRONMENT";
-    if (m_GeomList.size() > 0)
+    for (unsigned int i = 0; i < m_GeomList.size(); i++)
     {
-        PlaneGeom *planeGeom = dynamic_cast<PlaneGeom *>(m_GeomList[0]);
+        HeightfieldGeom *heightfieldGeom = dynamic_cast<HeightfieldGeom *>(m_GeomList[i]);
+        if (heightfieldGeom)
+        {
+            const char *formats[] = {"Text", "Float", "Short"};
+            outputStream << " HeightfieldFile=\"" << heightfieldGeom->m_Filename << "\"";
+            outputStream << " HeightfieldFormat=\"" << formats[heightfieldGeom->m_Format] << "\"";
+            outputStream << " HeightfieldSamples=\"" << heightfieldGeom->m_Grid->xSamples << " " << heightfieldGeom->m_Grid->ySamples << "\"";
+            outputStream << " HeightfieldSize=\"" << heightfieldGeom->m_SizeX << " " << heightfieldGeom->m_SizeY << "\"";
+            outputStream << " HeightfieldScale=\"" << heightfieldGeom->m_Scale << "\"";
+            outputStream << " HeightfieldOffset=\"" << heightfieldGeom->m_Offset << "\"";
+            outputStream << " HeightfieldThickness=\"" << heightfieldGeom->m_Thickness << "\"";
+            outputStream << " HeightfieldPosition=\"" << heightfieldGeom->m_Position[0] << " " << heightfieldGeom->m_Position[1] << " " << heightfieldGeom->m_Position[2] << "\"";
+        }
+
+        PlaneGeom *planeGeom = dynamic_cast<PlaneGeom *>(m_GeomList[i]);
         if (planeGeom)
         {
             dVector4 result;
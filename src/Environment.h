@@ -29,6 +29,7 @@ public:
 
     void AddGeom(Geom *geom);
     Geom *GetGeom(int i) { return m_GeomList[i]; }
+    int GetNumGeoms() { return int(m_GeomList.size()); }
 
     virtual void WriteToXMLStream(std::ostream &outputStream);
 
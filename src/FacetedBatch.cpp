@@ -0,0 +1,248 @@
+/*
+ *  FacetedBatch.cpp
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+#ifdef USE_QT
+
+#include <cmath>
+
+#include "FacetedBatch.h"
+#include "SimulationWindow.h"
+
+FacetedBatch::FacetedBatch(int cylinderSides, int sphereSlices, int sphereStacks)
+{
+    m_NumInstances = 0;
+    m_NumIndices = 0;
+    m_TopologyChanged = false;
+    m_simulationWindow = 0;
+    m_meshBuffer = 0;
+    m_sceneNode = 0;
+
+    UnitVertex v;
+    int i, j;
+
+    // unit cylinder radius 1 from z = 0 to z = 1 with flat end caps
+    // the tube and the caps have separate vertices so the normals are sharp at the rim
+    for (j = 0; j < 2; j++)
+    {
+        for (i = 0; i < cylinderSides; i++)
+        {
+            double theta = 2 * M_PI * i / cylinderSides;
+            v.pos[0] = cos(theta); v.pos[1] = sin(theta); v.pos[2] = j;
+            v.normal[0] = v.pos[0]; v.normal[1] = v.pos[1]; v.normal[2] = 0;
+            m_CylinderVertices.push_back(v);
+        }
+    }
+    for (j = 0; j < 2; j++)
+    {
+        for (i = 0; i < cylinderSides; i++)
+        {
+            double theta = 2 * M_PI * i / cylinderSides;
+            v.pos[0] = cos(theta); v.pos[1] = sin(theta); v.pos[2] = j;
+            v.normal[0] = 0; v.normal[1] = 0; v.normal[2] = j ? 1 : -1;
+            m_CylinderVertices.push_back(v);
+        }
+        v.pos[0] = 0; v.pos[1] = 0; v.pos[2] = j;
+        v.normal[0] = 0; v.normal[1] = 0; v.normal[2] = j ? 1 : -1;
+        m_CylinderVertices.push_back(v);
+    }
+    // anticlockwise winding viewed from outside
+    unsigned int bottomCap = 2 * cylinderSides;
+    unsigned int topCap = 3 * cylinderSides + 1;
+    for (i = 0; i < cylinderSides; i++)
+    {
+        unsigned int i0 = i, i1 = (i + 1) % cylinderSides;
+        m_CylinderIndices.push_back(i0); m_CylinderIndices.push_back(i1); m_CylinderIndices.push_back(cylinderSides + i1);
+        m_CylinderIndices.push_back(i0); m_CylinderIndices.push_back(cylinderSides + i1); m_CylinderIndices.push_back(cylinderSides + i0);
+        m_CylinderIndices.push_back(bottomCap + cylinderSides); m_CylinderIndices.push_back(bottomCap + i1); m_CylinderIndices.push_back(bottomCap + i0);
+        m_CylinderIndices.push_back(topCap + cylinderSides); m_CylinderIndices.push_back(topCap + i0); m_CylinderIndices.push_back(topCap + i1);
+    }
+
+    // unit sphere as a latitude/longitude grid
+    for (j = 0; j <= sphereStacks; j++)
+    {
+        double latitude = M_PI * j / sphereStacks - M_PI / 2;
+        for (i = 0; i <= sphereSlices; i++)
+        {
+            double longitude = 2 * M_PI * i / sphereSlices;
+            v.pos[0] = cos(latitude) * cos(longitude); v.pos[1] = cos(latitude) * sin(longitude); v.pos[2] = sin(latitude);
+            v.normal[0] = v.pos[0]; v.normal[1] = v.pos[1]; v.normal[2] = v.pos[2];
+            m_SphereVertices.push_back(v);
+        }
+    }
+    for (j = 0; j < sphereStacks; j++)
+    {
+        for (i = 0; i < sphereSlices; i++)
+        {
+            unsigned int v00 = j * (sphereSlices + 1) + i;
+            unsigned int v01 = v00 + 1;
+            unsigned int v10 = v00 + sphereSlices + 1;
+            unsigned int v11 = v10 + 1;
+            m_SphereIndices.push_back(v00); m_SphereIndices.push_back(v01); m_SphereIndices.push_back(v11);
+            m_SphereIndices.push_back(v00); m_SphereIndices.push_back(v11); m_SphereIndices.push_back(v10);
+        }
+    }
+}
+
+FacetedBatch::~FacetedBatch()
+{
+    if (m_sceneNode)
+    {
+        m_sceneNode->remove();
+        m_sceneNode->drop();
+    }
+    if (m_meshBuffer) m_meshBuffer->drop();
+}
+
+// the index buffer is left alone so that it can be reused if the same primitives are added again
+void FacetedBatch::Clear()
+{
+    m_NumInstances = 0;
+    m_NumIndices = 0;
+    m_TopologyChanged = false;
+    if (m_meshBuffer) m_meshBuffer->getVertexBuffer().set_used(0);
+}
+
+void FacetedBatch::AddCylinder(const pgd::Vector &p0, const pgd::Vector &p1, double radius, const Colour &colour)
+{
+    pgd::Vector axis = p1 - p0;
+    double length = axis.Magnitude();
+    if (length <= 0) return;
+    pgd::Quaternion q = pgd::FindRotation(pgd::Vector(0, 0, 1), axis);
+    pgd::Vector ex = pgd::QVRotate(q, pgd::Vector(1, 0, 0));
+    pgd::Vector ey = pgd::QVRotate(q, pgd::Vector(0, 1, 0));
+    pgd::Vector ez = axis / length;
+    // the normals are either radial or axial so they are unaffected by the scaling
+    AddInstance(CylinderPrimitive, m_CylinderVertices, m_CylinderIndices, p0, ex * radius, ey * radius, ez * length, colour);
+}
+
+void FacetedBatch::AddSphere(const pgd::Vector &centre, double radius, const Colour &colour)
+{
+    AddInstance(SpherePrimitive, m_SphereVertices, m_SphereIndices, centre, pgd::Vector(radius, 0, 0), pgd::Vector(0, radius, 0), pgd::Vector(0, 0, radius), colour);
+}
+
+void FacetedBatch::AddPolyline(const std::vector<pgd::Vector> &polyline, double radius, const Colour &colour)
+{
+    if (polyline.size()) AddPolyline(&polyline[0], int(polyline.size()), radius, colour);
+}
+
+void FacetedBatch::AddPolyline(const pgd::Vector *polyline, int numPoints, double radius, const Colour &colour)
+{
+    for (int i = 1; i < numPoints; i++)
+    {
+        AddCylinder(polyline[i - 1], polyline[i], radius, colour);
+        if (i < numPoints - 1) AddSphere(polyline[i], radius, colour);
+    }
+}
+
+// the unit vertices are mapped with position = origin + ex * x + ey * y + ez * z
+// and the normals use the same axes normalised
+void FacetedBatch::AddInstance(PrimitiveType type, const std::vector<UnitVertex> &vertices, const std::vector<unsigned int> &indices,
+                               const pgd::Vector &origin, const pgd::Vector &ex, const pgd::Vector &ey, const pgd::Vector &ez, const Colour &colour)
+{
+    if (m_meshBuffer == 0) m_meshBuffer = new irr::scene::CDynamicMeshBuffer(irr::video::EVT_STANDARD, irr::video::EIT_32BIT);
+
+    pgd::Vector nx = ex, ny = ey, nz = ez;
+    nx.Normalize(); ny.Normalize(); nz.Normalize();
+    irr::video::SColor vertexColour(255 * colour.alpha, 255 * colour.r, 255 * colour.g, 255 * colour.b);
+
+    irr::scene::IVertexBuffer &vertexBuffer = m_meshBuffer->getVertexBuffer();
+    irr::u32 vertexBase = vertexBuffer.size();
+    // grow geometrically because set_used only allocates exactly what is asked for
+    if (vertexBuffer.allocated_size() < vertexBase + vertices.size()) vertexBuffer.reallocate(2 * (vertexBase + vertices.size()));
+    vertexBuffer.set_used(vertexBase + vertices.size());
+    irr::video::S3DVertex *vp = vertexBuffer.pointer() + vertexBase;
+    for (unsigned int i = 0; i < vertices.size(); i++, vp++)
+    {
+        const UnitVertex &u = vertices[i];
+        vp->Pos.set(origin.x + ex.x * u.pos[0] + ey.x * u.pos[1] + ez.x * u.pos[2],
+                    origin.y + ex.y * u.pos[0] + ey.y * u.pos[1] + ez.y * u.pos[2],
+                    origin.z + ex.z * u.pos[0] + ey.z * u.pos[1] + ez.z * u.pos[2]);
+        vp->Normal.set(nx.x * u.normal[0] + ny.x * u.normal[1] + nz.x * u.normal[2],
+                       nx.y * u.normal[0] + ny.y * u.normal[1] + nz.y * u.normal[2],
+                       nx.z * u.normal[0] + ny.z * u.normal[1] + nz.z * u.normal[2]);
+        vp->Color = vertexColour;
+        vp->TCoords.set(0, 0);
+    }
+
+    // the indices only depend on the order of the primitives so they are kept until that changes
+    if (m_TopologyChanged == false && (m_NumInstances >= int(m_InstanceTypes.size()) || m_InstanceTypes[m_NumInstances] != type))
+    {
+        m_TopologyChanged = true;
+        m_InstanceTypes.resize(m_NumInstances);
+    }
+    if (m_TopologyChanged)
+    {
+        irr::scene::IIndexBuffer &indexBuffer = m_meshBuffer->getIndexBuffer();
+        if (indexBuffer.allocated_size() < m_NumIndices + indices.size()) indexBuffer.reallocate(2 * (m_NumIndices + indices.size()));
+        indexBuffer.set_used(m_NumIndices + indices.size());
+        irr::u32 *ip = static_cast<irr::u32 *>(indexBuffer.pointer()) + m_NumIndices;
+        for (unsigned int i = 0; i < indices.size(); i++) *ip++ = vertexBase + indices[i];
+        m_InstanceTypes.push_back(type);
+    }
+
+    m_NumIndices += indices.size();
+    m_NumInstances++;
+}
+
+void FacetedBatch::Draw()
+{
+    if (m_simulationWindow == 0) return;
+    if (m_meshBuffer == 0) m_meshBuffer = new irr::scene::CDynamicMeshBuffer(irr::video::EVT_STANDARD, irr::video::EIT_32BIT);
+    if (m_sceneNode == 0) initializeSceneNode();
+    // SimulationWindow::initialiseScene clears the whole scene so put the node back if necessary
+    if (m_sceneNode->getParent() == 0) m_simulationWindow->sceneManager()->getRootSceneNode()->addChild(m_sceneNode);
+
+    // fewer primitives than last time so the end of the index buffer needs to go
+    if (m_NumInstances < int(m_InstanceTypes.size()))
+    {
+        m_TopologyChanged = true;
+        m_InstanceTypes.resize(m_NumInstances);
+        m_meshBuffer->getIndexBuffer().set_used(m_NumIndices);
+    }
+
+    m_meshBuffer->setDirty(m_TopologyChanged ? irr::scene::EBT_VERTEX_AND_INDEX : irr::scene::EBT_VERTEX);
+    m_meshBuffer->recalculateBoundingBox();
+    static_cast<irr::scene::SMesh *>(m_sceneNode->getMesh())->recalculateBoundingBox();
+    m_sceneNode->setVisible(m_NumInstances > 0);
+}
+
+void FacetedBatch::initializeSceneNode()
+{
+    // the buffer is rewritten every frame
+    m_meshBuffer->setHardwareMappingHint(irr::scene::EHM_STREAM);
+
+    irr::scene::SMesh *mesh = new irr::scene::SMesh();
+    mesh->addMeshBuffer(m_meshBuffer);
+    // white material so that the vertex colours set the diffuse colour
+    m_simulationWindow->SetMeshColour(mesh, irr::video::SColor(255, 255, 255, 255));
+
+    irr::s32 idBitMask = 0; // not pickable since the triangles change every frame
+    m_sceneNode = m_simulationWindow->sceneManager()->addMeshSceneNode(mesh, 0, idBitMask);
+    mesh->drop();
+    m_sceneNode->grab(); // keep hold of the node in case the scene is cleared
+    m_sceneNode->setName("FacetedBatch");
+    m_sceneNode->setAutomaticCulling(irr::scene::EAC_OFF); // no object based culling wanted
+}
+
+SimulationWindow *FacetedBatch::simulationWindow() const
+{
+    return m_simulationWindow;
+}
+
+void FacetedBatch::setSimulationWindow(SimulationWindow *simulationWindow)
+{
+    m_simulationWindow = simulationWindow;
+}
+
+irr::scene::IMeshSceneNode *FacetedBatch::sceneNode() const
+{
+    return m_sceneNode;
+}
+
+#endif
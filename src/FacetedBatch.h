@@ -0,0 +1,88 @@
+/*
+ *  FacetedBatch.h
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+// FacetedBatch collects lots of small cylinders and spheres (straps, wrapping
+// cylinders and force arrows) into a single dynamic mesh buffer so that they
+// are drawn by one scene node. The primitives are generated once at unit size
+// and each instance is just a transform of the unit vertices so nothing is
+// faceted or allocated per frame once the buffers have grown large enough.
+// The index buffer is only rewritten when the sequence of primitives changes
+// so a normal redraw just updates the vertex positions in place.
+
+#ifndef FacetedBatch_h
+#define FacetedBatch_h
+
+#ifdef USE_QT
+
+#include "PGDMath.h"
+#include "GLUtils.h"
+
+#include <vector>
+
+class SimulationWindow;
+
+namespace irr { namespace scene { class CDynamicMeshBuffer; class IMeshSceneNode; } }
+
+class FacetedBatch
+{
+public:
+    FacetedBatch(int cylinderSides = 32, int sphereSlices = 32, int sphereStacks = 16);
+    ~FacetedBatch();
+
+    // start a new frame
+    void Clear();
+
+    void AddCylinder(const pgd::Vector &p0, const pgd::Vector &p1, double radius, const Colour &colour);
+    void AddSphere(const pgd::Vector &centre, double radius, const Colour &colour);
+    // a chain of cylinders with spheres at the joins
+    void AddPolyline(const std::vector<pgd::Vector> &polyline, double radius, const Colour &colour);
+    void AddPolyline(const pgd::Vector *polyline, int numPoints, double radius, const Colour &colour);
+
+    // copy the accumulated geometry into the scene
+    void Draw();
+
+    SimulationWindow *simulationWindow() const;
+    void setSimulationWindow(SimulationWindow *simulationWindow);
+
+    irr::scene::IMeshSceneNode *sceneNode() const;
+
+    int GetNumInstances() { return m_NumInstances; }
+    bool GetTopologyChanged() { return m_TopologyChanged; }
+
+private:
+    struct UnitVertex
+    {
+        float pos[3];
+        float normal[3];
+    };
+
+    enum PrimitiveType { CylinderPrimitive, SpherePrimitive };
+
+    void AddInstance(PrimitiveType type, const std::vector<UnitVertex> &vertices, const std::vector<unsigned int> &indices,
+                     const pgd::Vector &origin, const pgd::Vector &ex, const pgd::Vector &ey, const pgd::Vector &ez, const Colour &colour);
+    void initializeSceneNode();
+
+    std::vector<UnitVertex> m_CylinderVertices;
+    std::vector<unsigned int> m_CylinderIndices;
+    std::vector<UnitVertex> m_SphereVertices;
+    std::vector<unsigned int> m_SphereIndices;
+
+    int m_NumInstances;
+    unsigned int m_NumIndices;
+    std::vector<PrimitiveType> m_InstanceTypes; // the sequence of primitives currently in the index buffer
+    bool m_TopologyChanged;
+
+    SimulationWindow *m_simulationWindow;
+    irr::scene::CDynamicMeshBuffer *m_meshBuffer;
+    irr::scene::IMeshSceneNode *m_sceneNode;
+};
+
+#endif
+
+#endif
@@ -20,15 +20,20 @@
 #include <list>
 #include <string>
 #include <sstream>
+#include <stdint.h>
+#include <algorithm>
+#include <thread>
 
 #if defined(USE_QT)
 #include <QFileInfo>
 #include <QDir>
 #include "GLUtils.h"
+#include "BVHTriangleSelector.h"
 #endif
 
 #include "FacetedObject.h"
 #include "FacetedSphere.h"
+#include "BinaryMesh.h"
 #include "Face.h"
 #include "DataFile.h"
 #include "DebugControl.h"
@@ -41,6 +46,8 @@ FacetedObject::FacetedObject()
 {
     mNumVertices = 0;
     mNumVerticesAllocated = 0;
+    mNumTriangles = 0;
+    mNumTrianglesAllocated = 0;
     mVertexList = 0;
     mNormalList = 0;
     mIndexList = 0;
@@ -73,9 +80,12 @@ FacetedObject::FacetedObject()
 // destroy object
 FacetedObject::~FacetedObject()
 {
-    if (mVertexList) delete mVertexList;
-    if (mNormalList) delete mNormalList;
-    if (mIndexList) delete mIndexList;
+    if (m_SharedMesh == 0)
+    {
+        if (mVertexList) delete [] mVertexList;
+        if (mNormalList) delete [] mNormalList;
+        if (mIndexList) delete [] mIndexList;
+    }
 #ifdef USE_QT
     if (m_sceneNode) m_sceneNode->remove();
 #endif
@@ -85,6 +95,9 @@ FacetedObject::~FacetedObject()
 // returns true on error
 bool FacetedObject::ParseOBJFile(const char *filename, const pgd::Vector &scale, const pgd::Vector &offset)
 {
+    // pre-processed meshes are accepted as well so that GraphicFile can use either format
+    if (BinaryMesh::IsBinaryMesh(filename)) return ReadBinaryMesh(filename, scale, offset);
+
     SetName(filename);
 #ifdef USE_QT
     if (m_sceneNode) m_sceneNode->remove();
@@ -126,8 +139,8 @@ bool FacetedObject::ParseOBJFile(const char *filename, const pgd::Vector &scale,
 
     irr::s32 idBitMask = 1 << 0;
     m_sceneNode = m_simulationWindow->sceneManager()->addAnimatedMeshSceneNode(mesh, 0, idBitMask);
-    int minimalPolysPerNode = 256;
-    irr::scene::ITriangleSelector* selector = m_simulationWindow->sceneManager()->createOctreeTriangleSelector(mesh, m_sceneNode, minimalPolysPerNode);
+    // the BVH is built once here in mesh coordinates and picking transforms the ray instead of the triangles
+    irr::scene::ITriangleSelector* selector = new BVHTriangleSelector(mesh->getMesh(0), m_sceneNode);
     m_sceneNode->setTriangleSelector(selector);
     selector->drop();
     irr::core::matrix4 matrix;
@@ -177,7 +190,6 @@ bool FacetedObject::ParseOBJFile(const char *filename, const pgd::Vector &scale,
     pgd::Vector min(DBL_MAX, DBL_MAX, DBL_MAX);
     pgd::Vector max(-DBL_MAX, -DBL_MAX, -DBL_MAX);
     long spaceToAllocate = 0;
-    int biggestPolygon = 0;
     double v;
 
     // parse the lines
@@ -190,8 +202,8 @@ bool FacetedObject::ParseOBJFile(const char *filename, const pgd::Vector &scale,
             if (numTokens > 3)
             {
                 vertex.x = atof(tokens[1]) * scale.x + offset.x;
-                vertex.y = atof(tokens[2]) * scale.x + offset.x;
-                vertex.z = atof(tokens[3]) * scale.x + offset.x;
+                vertex.y = atof(tokens[2]) * scale.y + offset.y;
+                vertex.z = atof(tokens[3]) * scale.z + offset.z;
                 vertexList.push_back(vertex);
 
                 if (gDebug == FacetedObjectDebug)
@@ -217,7 +229,6 @@ bool FacetedObject::ParseOBJFile(const char *filename, const pgd::Vector &scale,
                 triFace[2] = atol(tokens[3]) - 1;
                 faceList.push_back(triFace);
                 spaceToAllocate += 3;
-                if (biggestPolygon < 3) biggestPolygon = 3;
                 if (m_BadMesh) // currently duplicate the polygon but with reversed winding but this could be improved
                 {
                     v = triFace[1];
@@ -237,7 +248,6 @@ bool FacetedObject::ParseOBJFile(const char *filename, const pgd::Vector &scale,
                     for (j = 1; j < numTokens; j++)
                         faceList.back()[j - 1] = atol(tokens[j]) - 1;
                     spaceToAllocate += numTokens - 1;
-                    if (biggestPolygon < numTokens - 1) biggestPolygon = numTokens - 1;
                     if (m_BadMesh) // currently duplicate the polygon but with reversed winding but this could be improved
                     {
                         faceList.push_back(std::vector<long>(numTokens - 1));
@@ -259,56 +269,26 @@ bool FacetedObject::ParseOBJFile(const char *filename, const pgd::Vector &scale,
 
     if (m_VerticesAsSpheresRadius <= 0)
     {
-
-        // fill out the display object
-        m_AllocationIncrement = spaceToAllocate;
-        if (biggestPolygon == 3) // optimise for triangular mesh
+        // the OBJ file is already indexed so the vertices are copied once and shared by the faces
+        AllocateMemory(vertexList.size(), spaceToAllocate);
+        for (i = 0; i < (long)vertexList.size(); i++)
         {
-            for (i = 0; i < (long)faceList.size(); i++)
-            {
-                for (j = 0; j < 3; j++)
-                {
-                    tri[j * 3] = vertexList[faceList[i][j]].x;
-                    tri[j * 3 + 1] = vertexList[faceList[i][j]].y;
-                    tri[j * 3 + 2] = vertexList[faceList[i][j]].z;
-                }
-                AddTriangle(tri);
-            }
+            mVertexList[i * 3] = vertexList[i].x;
+            mVertexList[i * 3 + 1] = vertexList[i].y;
+            mVertexList[i * 3 + 2] = vertexList[i].z;
         }
-        else
+        mNumVertices = vertexList.size();
+        for (i = 0; i < (long)faceList.size(); i++)
         {
-            double *face = new double[biggestPolygon * 3];
-            for (i = 0; i < (long)faceList.size(); i++)
-            {
-                if (faceList[i].size() == 3) // optimise for triangles
-                {
-                    for (j = 0; j < 3; j++)
-                    {
-                        tri[j * 3] = vertexList[faceList[i][j]].x;
-                        tri[j * 3 + 1] = vertexList[faceList[i][j]].y;
-                        tri[j * 3 + 2] = vertexList[faceList[i][j]].z;
-                    }
-                    AddTriangle(tri);
-                }
-                else
-                {
-                    for (j = 0; j < (long)faceList[i].size(); j++)
-                    {
-                        face[j * 3] = vertexList[faceList[i][j]].x;
-                        face[j * 3 + 1] = vertexList[faceList[i][j]].y;
-                        face[j * 3 + 2] = vertexList[faceList[i][j]].z;
-                    }
-                    AddPolygon(face, faceList[i].size());
-                }
-            }
-            delete [] face;
+            // polygons are triangulated as a fan as in AddPolygon
+            for (j = 2; j < (long)faceList[i].size(); j++)
+                AddIndexedTriangle(faceList[i][0], faceList[i][j - 1], faceList[i][j]);
         }
     }
     else
     {
         FacetedSphere masterSphere(m_VerticesAsSpheresRadius, 2);
         int nTri = masterSphere.GetNumTriangles();
-        double *tri;
         pgd::Vector lastPos(0, 0, 0);
         m_AllocationIncrement = nTri * (int)vertexList.size();
         for (i = 0; i < (int)vertexList.size(); i++)
@@ -317,12 +297,15 @@ bool FacetedObject::ParseOBJFile(const char *filename, const pgd::Vector &scale,
             lastPos = vertexList[i];
             for (j = 0; j < nTri; j++)
             {
-                tri = masterSphere.GetTriangle(j);
+                masterSphere.GetTriangle(j, tri);
                 AddTriangle(tri);
             }
         }
     }
 
+    // the faces were added as separate triangles so now share the vertices again
+    WeldVertices();
+
     // clear memory
     delete [] tokens;
     delete [] linePtrs;
@@ -345,12 +328,12 @@ void FacetedObject::WritePOVRay(std::ostringstream &theString)
     theString << "  mesh {\n";
 
     // first faces
-    for (i = 0; i < mNumVertices / 3; i++)
+    for (i = 0; i < mNumTriangles; i++)
     {
         theString << "    triangle {\n";
         for (j = 0; j < 3; j++)
         {
-            vPtr = mVertexList + i * 9 + j * 3;
+            vPtr = mVertexList + mIndexList[i * 3 + j] * 3;
             prel[0] = *vPtr++;
             prel[1] = *vPtr++;
             prel[2] = *vPtr;
@@ -394,11 +377,11 @@ void FacetedObject::WriteOBJFile(std::ostringstream &out)
     {
         // write out the vertices, faces, groups and objects
         // this is the relative version - inefficient but allows concatenation of objects
-        for (i = 0; i < mNumVertices / 3; i++)
+        for (i = 0; i < mNumTriangles; i++)
         {
             for (j = 0; j < 3; j++)
             {
-                vPtr = mVertexList + i * 9 + j * 3;
+                vPtr = mVertexList + mIndexList[i * 3 + j] * 3;
                 prel[0] = *vPtr++;
                 prel[1] = *vPtr++;
                 prel[2] = *vPtr;
@@ -413,7 +396,7 @@ void FacetedObject::WriteOBJFile(std::ostringstream &out)
             out << "f ";
             for (j = 0; j < 3; j++)
             {
-                if (j == 3)
+                if (j == 2)
                     out << j - 3 << "\n";
                 else
                     out << j - 3 << " ";
@@ -422,24 +405,22 @@ void FacetedObject::WriteOBJFile(std::ostringstream &out)
     }
     else
     {
-        for (i = 0; i < mNumVertices / 3; i++)
+        // each shared vertex is only written once
+        for (i = 0; i < mNumVertices; i++)
         {
-            for (j = 0; j < 3; j++)
-            {
-                vPtr = mVertexList + i * 9 + j * 3;
-                prel[0] = *vPtr++;
-                prel[1] = *vPtr++;
-                prel[2] = *vPtr;
-                prel[3] = 0;
-                dMULTIPLY0_331(p, m_DisplayRotation, prel);
-                result[0] = p[0] + m_DisplayPosition[0];
-                result[1] = p[1] + m_DisplayPosition[1];
-                result[2] = p[2] + m_DisplayPosition[2];
-                out << "v " << result[0] << " " << result[1] << " " << result[2] << "\n";
-            }
+            vPtr = mVertexList + i * 3;
+            prel[0] = *vPtr++;
+            prel[1] = *vPtr++;
+            prel[2] = *vPtr;
+            prel[3] = 0;
+            dMULTIPLY0_331(p, m_DisplayRotation, prel);
+            result[0] = p[0] + m_DisplayPosition[0];
+            result[1] = p[1] + m_DisplayPosition[1];
+            result[2] = p[2] + m_DisplayPosition[2];
+            out << "v " << result[0] << " " << result[1] << " " << result[2] << "\n";
         }
 
-        for (i = 0; i < mNumVertices / 3; i++)
+        for (i = 0; i < mNumTriangles; i++)
         {
             out << "f ";
             for (j = 0; j < 3; j++)
@@ -547,6 +528,7 @@ void FacetedObject::ComputeFaceNormal(const double *v1, const double *v2, const
 // note this must be used before first draw call
 void FacetedObject::Move(double x, double y, double z)
 {
+    if (m_SharedMesh) UnshareMesh();
     for (int i = 0; i < mNumVertices; i++)
     {
         mVertexList[i * 3] += x;
@@ -588,6 +570,7 @@ void FacetedObject::Move(double x, double y, double z)
 // note this must be used before first draw call
 void FacetedObject::Scale(double x, double y, double z)
 {
+    if (m_SharedMesh) UnshareMesh();
     for (int i = 0; i < mNumVertices; i++)
     {
         mVertexList[i * 3] *= x;
@@ -650,56 +633,244 @@ void FacetedObject::AddPolygon(const double *vertices, int nSides)
 // it gets called by add polygon
 // vertices is a packed list of floating point numbers
 // x1, y1, z1, x2, y2, z2, x3, y3, z3
+// each triangle gets its own vertices and WeldVertices can be used to share them afterwards
 void FacetedObject::AddTriangle(const double *vertices)
 {
-    int newNumVertices = mNumVertices + 3;
-    if (newNumVertices > mNumVerticesAllocated)
+    if (m_SharedMesh) UnshareMesh();
+    if (mNumVertices + 3 > mNumVerticesAllocated || mNumTriangles + 1 > mNumTrianglesAllocated)
     {
-        AllocateMemory(mNumVerticesAllocated + m_AllocationIncrement);
+        AllocateMemory(mNumVerticesAllocated + m_AllocationIncrement, mNumTrianglesAllocated + m_AllocationIncrement / 3 + 1);
         m_AllocationIncrement *= 2;
     }
     memcpy(mVertexList + mNumVertices * 3, vertices, sizeof(double) * 9);
 
-    // now calculate the normals
-    double normal[3];
-    ComputeFaceNormal(vertices, vertices + 3, vertices + 6, normal);
-    memcpy(mNormalList + mNumVertices * 3, normal, sizeof(double) * 3);
-    memcpy(mNormalList + mNumVertices * 3 + 3, normal, sizeof(double) * 3);
-    memcpy(mNormalList + mNumVertices * 3 + 6, normal, sizeof(double) * 3);
+    // now calculate the face normal
+    ComputeFaceNormal(vertices, vertices + 3, vertices + 6, mNormalList + mNumTriangles * 3);
 
     // and finally the indices
-    mIndexList[mNumVertices] = mNumVertices;
-    mNumVertices++;
-    mIndexList[mNumVertices] = mNumVertices;
-    mNumVertices++;
-    mIndexList[mNumVertices] = mNumVertices;
-    mNumVertices++;
+    mIndexList[mNumTriangles * 3] = mNumVertices;
+    mIndexList[mNumTriangles * 3 + 1] = mNumVertices + 1;
+    mIndexList[mNumTriangles * 3 + 2] = mNumVertices + 2;
+    mNumVertices += 3;
+    mNumTriangles++;
+}
+
+// add a triangle using vertices that are already in the vertex list
+void FacetedObject::AddIndexedTriangle(int v0, int v1, int v2)
+{
+    if (m_SharedMesh) UnshareMesh();
+    if (mNumTriangles + 1 > mNumTrianglesAllocated)
+    {
+        AllocateMemory(mNumVerticesAllocated, mNumTrianglesAllocated + m_AllocationIncrement / 3 + 1);
+        m_AllocationIncrement *= 2;
+    }
+    ComputeFaceNormal(mVertexList + v0 * 3, mVertexList + v1 * 3, mVertexList + v2 * 3, mNormalList + mNumTriangles * 3);
+    mIndexList[mNumTriangles * 3] = v0;
+    mIndexList[mNumTriangles * 3 + 1] = v1;
+    mIndexList[mNumTriangles * 3 + 2] = v2;
+    mNumTriangles++;
 }
 
 // this routine handles the memory allocation
+// allocation is the number of vertices and enough space is reserved for unshared triangles
 void FacetedObject::AllocateMemory(int allocation)
 {
-    if (allocation > mNumVerticesAllocated)
+    AllocateMemory(allocation, allocation / 3);
+}
+
+void FacetedObject::AllocateMemory(int vertexAllocation, int triangleAllocation)
+{
+    if (m_SharedMesh) UnshareMesh();
+    if (vertexAllocation > mNumVerticesAllocated)
     {
-        mNumVerticesAllocated = allocation;
+        mNumVerticesAllocated = vertexAllocation;
         double *newVertexList = new double[mNumVerticesAllocated * 3];
-        double *newNormalList = new double[mNumVerticesAllocated * 3];
-        int *newIndexList = new int[mNumVerticesAllocated];
         if (mVertexList)
         {
             memcpy(newVertexList, mVertexList, sizeof(double) * mNumVertices * 3);
             delete [] mVertexList;
-            memcpy(newNormalList, mNormalList, sizeof(double) * mNumVertices * 3);
+        }
+        mVertexList = newVertexList;
+    }
+    if (triangleAllocation > mNumTrianglesAllocated)
+    {
+        mNumTrianglesAllocated = triangleAllocation;
+        double *newNormalList = new double[mNumTrianglesAllocated * 3];
+        int *newIndexList = new int[mNumTrianglesAllocated * 3];
+        if (mIndexList)
+        {
+            memcpy(newNormalList, mNormalList, sizeof(double) * mNumTriangles * 3);
             delete [] mNormalList;
-            memcpy(newIndexList, mIndexList, sizeof(int) * mNumVertices);
+            memcpy(newIndexList, mIndexList, sizeof(int) * mNumTriangles * 3);
             delete [] mIndexList;
         }
-        mVertexList = newVertexList;
         mNormalList = newNormalList;
         mIndexList = newIndexList;
     }
 }
 
+// hash of the exact bit patterns of a vertex
+// adding zero turns -0 into +0 so that they hash the same since they compare equal
+static size_t HashVertex(const double *v)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (int i = 0; i < 3; i++)
+    {
+        double x = v[i] + 0.0;
+        uint64_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        h = (h ^ bits) * 1099511628211ULL;
+        h ^= h >> 29;
+    }
+    return size_t(h);
+}
+
+// merge vertices with identical coordinates and renumber the triangles to use them
+// this uses an open addressing hash table of vertex numbers which is much quicker
+// than a std::unordered_map when there are millions of vertices
+void FacetedObject::WeldVertices()
+{
+    if (mNumVertices == 0) return;
+    if (m_SharedMesh) UnshareMesh();
+
+    size_t tableSize = 1;
+    while (tableSize < size_t(mNumVertices) * 2) tableSize *= 2;
+    std::vector<int> table(tableSize, -1);
+    std::vector<int> remap(mNumVertices);
+    int numUnique = 0;
+    int i;
+    for (i = 0; i < mNumVertices; i++)
+    {
+        double *v = mVertexList + i * 3;
+        size_t slot = HashVertex(v) & (tableSize - 1);
+        while (true)
+        {
+            int candidate = table[slot];
+            if (candidate < 0)
+            {
+                // vertices only ever move down the list so this can be done in place
+                double *u = mVertexList + numUnique * 3;
+                u[0] = v[0]; u[1] = v[1]; u[2] = v[2];
+                table[slot] = numUnique;
+                remap[i] = numUnique;
+                numUnique++;
+                break;
+            }
+            double *u = mVertexList + candidate * 3;
+            if (u[0] == v[0] && u[1] == v[1] && u[2] == v[2])
+            {
+                remap[i] = candidate;
+                break;
+            }
+            slot = (slot + 1) & (tableSize - 1);
+        }
+    }
+    for (i = 0; i < mNumTriangles * 3; i++) mIndexList[i] = remap[mIndexList[i]];
+
+    if (gDebug == FacetedObjectDebug)
+        std::cerr << "WeldVertices:\tvertices\t" << mNumVertices << "\twelded\t" << numUnique << "\ttriangles\t" << mNumTriangles << "\n";
+
+    // and release the unused space
+    double *newVertexList = new double[numUnique * 3];
+    memcpy(newVertexList, mVertexList, sizeof(double) * numUnique * 3);
+    delete [] mVertexList;
+    mVertexList = newVertexList;
+    mNumVertices = numUnique;
+    mNumVerticesAllocated = numUnique;
+}
+
+// shared mesh that keeps its own copy of the lists
+struct CopiedMesh : public FacetedObject::SharedMesh
+{
+    std::vector<double> vertexStorage;
+    std::vector<double> normalStorage;
+    std::vector<int> indexStorage;
+};
+
+// make a read only copy of the mesh that can be handed to other objects
+// unitMass should only be given if it is the mass properties of the current mesh at unit density
+std::shared_ptr<const FacetedObject::SharedMesh> FacetedObject::CreateSharedMesh(const dMass *unitMass)
+{
+    std::shared_ptr<CopiedMesh> sharedMesh(new CopiedMesh());
+    sharedMesh->vertexStorage.assign(mVertexList, mVertexList + mNumVertices * 3);
+    sharedMesh->normalStorage.assign(mNormalList, mNormalList + mNumTriangles * 3);
+    sharedMesh->indexStorage.assign(mIndexList, mIndexList + mNumTriangles * 3);
+    sharedMesh->numVertices = mNumVertices;
+    sharedMesh->numTriangles = mNumTriangles;
+    sharedMesh->vertices = sharedMesh->vertexStorage.data();
+    sharedMesh->normals = sharedMesh->normalStorage.data();
+    sharedMesh->indices = sharedMesh->indexStorage.data();
+    if (unitMass)
+    {
+        sharedMesh->hasMassProperties = true;
+        sharedMesh->unitMass = *unitMass;
+    }
+    return sharedMesh;
+}
+
+// use a read only mesh instead of the current one
+// the lists point straight into the shared mesh and any function that changes
+// the mesh calls UnshareMesh first to get a private copy
+void FacetedObject::SetSharedMesh(const std::shared_ptr<const SharedMesh> &sharedMesh)
+{
+    if (m_SharedMesh == 0)
+    {
+        if (mVertexList) delete [] mVertexList;
+        if (mNormalList) delete [] mNormalList;
+        if (mIndexList) delete [] mIndexList;
+    }
+    m_SharedMesh = sharedMesh;
+    mNumVertices = mNumVerticesAllocated = sharedMesh->numVertices;
+    mNumTriangles = mNumTrianglesAllocated = sharedMesh->numTriangles;
+    mVertexList = const_cast<double *>(sharedMesh->vertices);
+    mNormalList = const_cast<double *>(sharedMesh->normals);
+    mIndexList = const_cast<int *>(sharedMesh->indices);
+}
+
+void FacetedObject::UnshareMesh()
+{
+    std::shared_ptr<const SharedMesh> sharedMesh = m_SharedMesh;
+    m_SharedMesh.reset();
+    mVertexList = new double[mNumVertices * 3];
+    mNormalList = new double[mNumTriangles * 3];
+    mIndexList = new int[mNumTriangles * 3];
+    std::copy(sharedMesh->vertices, sharedMesh->vertices + mNumVertices * 3, mVertexList);
+    std::copy(sharedMesh->normals, sharedMesh->normals + mNumTriangles * 3, mNormalList);
+    std::copy(sharedMesh->indices, sharedMesh->indices + mNumTriangles * 3, mIndexList);
+}
+
+// the mass properties stored with a shared mesh are only valid until the mesh is changed
+// and any change unshares the mesh
+bool FacetedObject::GetStoredMassProperties(dMass *unitMass)
+{
+    if (m_SharedMesh == 0 || m_SharedMesh->hasMassProperties == false) return false;
+    *unitMass = m_SharedMesh->unitMass;
+    return true;
+}
+
+// read a mesh written by BinaryMesh::Write
+// the file is mapped straight into memory and only copied if it needs scaling or moving
+// returns true on error
+bool FacetedObject::ReadBinaryMesh(const char *filename, const pgd::Vector &scale, const pgd::Vector &offset)
+{
+    SetName(filename);
+    std::shared_ptr<const SharedMesh> sharedMesh = BinaryMesh::Read(filename);
+    if (sharedMesh == 0) return true;
+    SetSharedMesh(sharedMesh);
+    if (scale.x != 1 || scale.y != 1 || scale.z != 1) Scale(scale.x, scale.y, scale.z);
+    if (offset.x != 0 || offset.y != 0 || offset.z != 0) Move(offset.x, offset.y, offset.z);
+#ifdef USE_QT
+    // the mass properties come from the scene node in this version so it is needed straight away
+    if (m_sceneNode) m_sceneNode->remove();
+    m_sceneNode = 0;
+    initializeSceneNode();
+    if (m_sceneNode)
+        m_sceneNode->setName(QString::asprintf("BODY GraphicsFile=\"%s\" Offset=\"%.17e %.17e %.17e\" Scale=\"%.17e %.17e %.17e\"",
+                                                filename, offset.x, offset.y, offset.z, scale.x, scale.y, scale.z).toUtf8());
+#endif
+    return false;
+}
+
 // return an ODE style trimesh
 // note memory is allocated by this routine and will need to be released elsewhere
 void FacetedObject::CalculateTrimesh(double **vertices, int *numVertices, int *vertexStride, dTriIndex **triIndexes, int *numTriIndexes, int *triStride)
@@ -709,10 +880,10 @@ void FacetedObject::CalculateTrimesh(double **vertices, int *numVertices, int *v
     *triStride = 3 * sizeof(dTriIndex);
 
     *numVertices = mNumVertices;
-    *numTriIndexes = mNumVertices;
+    *numTriIndexes = mNumTriangles * 3;
 
     *vertices = new double[mNumVertices * 3];
-    *triIndexes = new dTriIndex[mNumVertices];
+    *triIndexes = new dTriIndex[mNumTriangles * 3];
 
     for (i = 0; i < mNumVertices; i++)
     {
@@ -721,7 +892,7 @@ void FacetedObject::CalculateTrimesh(double **vertices, int *numVertices, int *v
         (*vertices)[i * 3 + 2] = mVertexList[i * 3 + 2];
     }
 
-    for (i = 0; i < mNumVertices; i++)
+    for (i = 0; i < mNumTriangles * 3; i++)
     {
         (*triIndexes)[i] = mIndexList[i];
     }
@@ -736,10 +907,10 @@ void FacetedObject::CalculateTrimesh(float **vertices, int *numVertices, int *ve
     *triStride = 3 * sizeof(dTriIndex);
 
     *numVertices = mNumVertices;
-    *numTriIndexes = mNumVertices;
+    *numTriIndexes = mNumTriangles * 3;
 
     *vertices = new float[mNumVertices * 3];
-    *triIndexes = new dTriIndex[mNumVertices];
+    *triIndexes = new dTriIndex[mNumTriangles * 3];
 
     for (i = 0; i < mNumVertices; i++)
     {
@@ -748,49 +919,164 @@ void FacetedObject::CalculateTrimesh(float **vertices, int *numVertices, int *ve
         (*vertices)[i * 3 + 2] = mVertexList[i * 3 + 2];
     }
 
-    for (i = 0; i < mNumVertices; i++)
+    for (i = 0; i < mNumTriangles * 3; i++)
     {
         (*triIndexes)[i] = mIndexList[i];
     }
 }
 
 // calculate mass properties
-// based on dMassSetTrimesh
-/*
- * dMassSetTrimesh, implementation by Gero Mueller.
- * Based on Brian Mirtich, "Fast and Accurate Computation of
- * Polyhedral Mass Properties," journal of graphics tools, volume 1,
- * number 2, 1996.
- */
-
-#define	SQR(x)			((x)*(x))						//!< Returns x square
-#define	CUBE(x)			((x)*(x)*(x))					//!< Returns x cube
+// The volume integrals come from the divergence theorem applied triangle by triangle
+// as in Brian Mirtich, "Fast and Accurate Computation of Polyhedral Mass Properties,"
+// journal of graphics tools, volume 1, number 2, 1996 but using the simplification
+// in David Eberly, "Polyhedral Mass Properties (Revisited)" which needs no choice of
+// projection plane so every triangle goes through exactly the same arithmetic.
+// The triangles are gathered into arrays of coordinates and summed in independent
+// lanes so that the compiler can vectorise the loop without reordering any additions,
+// and large meshes are split into fixed size blocks that are shared between threads.
+// The blocks are always added together in the same order so the answer does not
+// depend on the number of threads. The makefile builds do not set -march so only
+// SSE2 is guaranteed. The lanes vectorise with whatever the build targets and the
+// order of the additions does not depend on the vector width, which would not be
+// true of hand written intrinsics for one instruction set.
 
 #define _I(i,j) I[(i)*4+(j)]
 
-void FacetedObject::CalculateMassProperties(dMass *m, double density, bool clockwise)
+static const int kMassLanes = 4; // independent sums, enough for 256 bit vectors of doubles
+static const int kMassChunkSize = 256; // triangles gathered at a time, a multiple of kMassLanes
+static const int kMassBlockSize = 65536; // triangles per block
+static const int kMassIntegrals = 10; // 1, x, y, z, x^2, y^2, z^2, xy, yz, zx
+
+class MassIntegrator
 {
-    dMassSetZero (m);
+public:
+    MassIntegrator()
+    {
+        m_Count = 0;
+        for (int i = 0; i < kMassIntegrals; i++)
+            for (int k = 0; k < kMassLanes; k++)
+                m_Sums[i][k] = 0;
+    }
 
-#ifdef USE_QT
+    // clockwise swaps x and z to reverse the handedness
+    void AddTriangle(const double *v0, const double *v1, const double *v2, bool clockwise)
+    {
+        const double *v[3] = {v0, v1, v2};
+        for (int j = 0; j < 3; j++)
+        {
+            m_Coords[j * 3][m_Count] = clockwise ? v[j][2] : v[j][0];
+            m_Coords[j * 3 + 1][m_Count] = v[j][1];
+            m_Coords[j * 3 + 2][m_Count] = clockwise ? v[j][0] : v[j][2];
+        }
+        m_Count++;
+        if (m_Count == kMassChunkSize) Flush();
+    }
 
-    // assumes anticlockwise winding
+    // the raw integrals scaled to give volume, first and second moments
+    void GetIntegrals(double integral[kMassIntegrals])
+    {
+        static const double kScale[kMassIntegrals] = {1.0 / 6.0, 1.0 / 24.0, 1.0 / 24.0, 1.0 / 24.0,
+                                                      1.0 / 60.0, 1.0 / 60.0, 1.0 / 60.0, 1.0 / 120.0, 1.0 / 120.0, 1.0 / 120.0};
+        Flush();
+        for (int i = 0; i < kMassIntegrals; i++)
+        {
+            integral[i] = 0;
+            for (int k = 0; k < kMassLanes; k++) integral[i] += m_Sums[i][k];
+            integral[i] *= kScale[i];
+        }
+    }
 
-    double nx, ny, nz;
-    unsigned int j, A, B, C;
-    // face integrals
-    double Fa, Fb, Fc, Faa, Fbb, Fcc, Faaa, Fbbb, Fccc, Faab, Fbbc, Fcca;
+private:
+    static inline void Subexpressions(double w0, double w1, double w2, double *f1, double *f2, double *f3, double *g0, double *g1, double *g2)
+    {
+        double temp0 = w0 + w1;
+        *f1 = temp0 + w2;
+        double temp1 = w0 * w0;
+        double temp2 = temp1 + w1 * temp0;
+        *f2 = temp2 + w2 * *f1;
+        *f3 = w0 * temp1 + w1 * temp2 + w2 * *f2;
+        *g0 = *f2 + w0 * (*f1 + w0);
+        *g1 = *f2 + w1 * (*f1 + w1);
+        *g2 = *f2 + w2 * (*f1 + w2);
+    }
 
-    // projection integrals
-    double P1, Pa, Pb, Paa, Pab, Pbb, Paaa, Paab, Pabb, Pbbb;
+    void Flush()
+    {
+        // pad with degenerate triangles which add nothing
+        while (m_Count % kMassLanes)
+        {
+            for (int j = 0; j < 9; j++) m_Coords[j][m_Count] = 0;
+            m_Count++;
+        }
+        for (int i = 0; i < m_Count; i += kMassLanes)
+        {
+            for (int k = 0; k < kMassLanes; k++)
+            {
+                double x0 = m_Coords[0][i + k], y0 = m_Coords[1][i + k], z0 = m_Coords[2][i + k];
+                double x1 = m_Coords[3][i + k], y1 = m_Coords[4][i + k], z1 = m_Coords[5][i + k];
+                double x2 = m_Coords[6][i + k], y2 = m_Coords[7][i + k], z2 = m_Coords[8][i + k];
+                // outward (unnormalised) normal for an anticlockwise triangle
+                double a1 = x1 - x0, b1 = y1 - y0, c1 = z1 - z0;
+                double a2 = x2 - x0, b2 = y2 - y0, c2 = z2 - z0;
+                double d0 = b1 * c2 - b2 * c1;
+                double d1 = a2 * c1 - a1 * c2;
+                double d2 = a1 * b2 - a2 * b1;
+                double f1x, f2x, f3x, g0x, g1x, g2x;
+                double f1y, f2y, f3y, g0y, g1y, g2y;
+                double f1z, f2z, f3z, g0z, g1z, g2z;
+                Subexpressions(x0, x1, x2, &f1x, &f2x, &f3x, &g0x, &g1x, &g2x);
+                Subexpressions(y0, y1, y2, &f1y, &f2y, &f3y, &g0y, &g1y, &g2y);
+                Subexpressions(z0, z1, z2, &f1z, &f2z, &f3z, &g0z, &g1z, &g2z);
+                m_Sums[0][k] += d0 * f1x;
+                m_Sums[1][k] += d0 * f2x;
+                m_Sums[2][k] += d1 * f2y;
+                m_Sums[3][k] += d2 * f2z;
+                m_Sums[4][k] += d0 * f3x;
+                m_Sums[5][k] += d1 * f3y;
+                m_Sums[6][k] += d2 * f3z;
+                m_Sums[7][k] += d0 * (y0 * g0x + y1 * g1x + y2 * g2x);
+                m_Sums[8][k] += d1 * (z0 * g0y + z1 * g1y + z2 * g2y);
+                m_Sums[9][k] += d2 * (x0 * g0z + x1 * g1z + x2 * g2z);
+            }
+        }
+        m_Count = 0;
+    }
 
-    double T0 = 0;
-    double T1[3] = {0., 0., 0.};
-    double T2[3] = {0., 0., 0.};
-    double TP[3] = {0., 0., 0.};
+    double m_Coords[9][kMassChunkSize]; // x0 y0 z0 x1 y1 z1 x2 y2 z2
+    double m_Sums[kMassIntegrals][kMassLanes];
+    int m_Count;
+};
 
-    dVector3 v[3];
+// mass at the given density with the inertia about the origin and c the centre of mass
+static void SetMassFromIntegrals(const double integral[kMassIntegrals], double density, dMass *m)
+{
+    m->mass = density * integral[0];
+    m->_I(0,0) = density * (integral[5] + integral[6]);
+    m->_I(1,1) = density * (integral[6] + integral[4]);
+    m->_I(2,2) = density * (integral[4] + integral[5]);
+    m->_I(0,1) = - density * integral[7];
+    m->_I(1,0) = - density * integral[7];
+    m->_I(2,1) = - density * integral[8];
+    m->_I(1,2) = - density * integral[8];
+    m->_I(2,0) = - density * integral[9];
+    m->_I(0,2) = - density * integral[9];
+
+    m->c[0] = integral[1] / integral[0];
+    m->c[1] = integral[2] / integral[0];
+    m->c[2] = integral[3] / integral[0];
+}
+
+void FacetedObject::CalculateMassProperties(dMass *m, double density, bool clockwise)
+{
+    dMassSetZero (m);
+    double integral[kMassIntegrals];
 
+#ifdef USE_QT
+
+    // assumes anticlockwise winding
+
+    MassIntegrator integrator;
+    double v[3][3];
     irr::scene::IMesh *frameMesh = m_sceneNode->getMesh()->getMesh(0); // get the first animated mesh frame (there should only be one anyway)
     irr::u32 meshBufferCount = frameMesh->getMeshBufferCount();
     for (irr::u32 iMeshBuffer = 0; iMeshBuffer < meshBufferCount; iMeshBuffer++) // loop over the mesh buffers
@@ -807,423 +1093,118 @@ void FacetedObject::CalculateMassProperties(dMass *m, double density, bool clock
                 if (dynamicMeshBuffer->getIndexType() == irr::video::EIT_32BIT)
                 {
                     irr::u32 *indices = (irr::u32 *)meshBuffer->getIndices();
-
                     for (irr::u32 index = 0; index < indexCount; index += 3)
                     {
-
-                        if (clockwise == false)
-                        {
-                            for (j = 0; j < 3; j++)
-                            {
-                                v[j][0] = vertices[indices[index + j]].Pos.X; // mVertexList[i * 9 + j * 3];
-                                v[j][1] = vertices[indices[index + j]].Pos.Y; // mVertexList[i * 9 + j * 3 + 1];
-                                v[j][2] = vertices[indices[index + j]].Pos.Z; // mVertexList[i * 9 + j * 3 + 2];
-                            }
-                        }
-                        else
-                        {
-                            for (j = 0; j < 3; j++)
-                            {
-                                v[j][2] = vertices[indices[index + j]].Pos.X; // mVertexList[i * 9 + j * 3];
-                                v[j][1] = vertices[indices[index + j]].Pos.Y; // mVertexList[i * 9 + j * 3 + 1];
-                                v[j][0] = vertices[indices[index + j]].Pos.Z; // mVertexList[i * 9 + j * 3 + 2];
-                            }
-                        }
-
-                        dVector3 n, a, b;
-                        dOP( a, -, v[1], v[0] );
-                        dOP( b, -, v[2], v[0] );
-                        dCROSS( n, =, b, a );
-                        nx = fabs(n[0]);
-                        ny = fabs(n[1]);
-                        nz = fabs(n[2]);
-
-                        if( nx > ny && nx > nz )
-                            C = 0;
-                        else
-                            C = (ny > nz) ? 1 : 2;
-
-                        // Even though all triangles might be initially valid,
-                        // a triangle may degenerate into a segment after applying
-                        // space transformation.
-                        if (n[C] != REAL(0.0))
+                        for (int j = 0; j < 3; j++)
                         {
-                            A = (C + 1) % 3;
-                            B = (A + 1) % 3;
-
-                            // calculate face integrals
-                            {
-                                double w;
-                                double k1, k2, k3, k4;
-
-                                //compProjectionIntegrals(f);
-                                {
-                                    double a0, a1, da;
-                                    double b0, b1, db;
-                                    double a0_2, a0_3, a0_4, b0_2, b0_3, b0_4;
-                                    double a1_2, a1_3, b1_2, b1_3;
-                                    double C1, Ca, Caa, Caaa, Cb, Cbb, Cbbb;
-                                    double Cab, Kab, Caab, Kaab, Cabb, Kabb;
-
-                                    P1 = Pa = Pb = Paa = Pab = Pbb = Paaa = Paab = Pabb = Pbbb = 0.0;
-
-                                    for( j = 0; j < 3; j++)
-                                    {
-                                        switch(j)
-                                        {
-                                        case 0:
-                                            a0 = v[0][A];
-                                            b0 = v[0][B];
-                                            a1 = v[1][A];
-                                            b1 = v[1][B];
-                                            break;
-                                        case 1:
-                                            a0 = v[1][A];
-                                            b0 = v[1][B];
-                                            a1 = v[2][A];
-                                            b1 = v[2][B];
-                                            break;
-                                        case 2:
-                                            a0 = v[2][A];
-                                            b0 = v[2][B];
-                                            a1 = v[0][A];
-                                            b1 = v[0][B];
-                                            break;
-                                        }
-                                        da = a1 - a0;
-                                        db = b1 - b0;
-                                        a0_2 = a0 * a0; a0_3 = a0_2 * a0; a0_4 = a0_3 * a0;
-                                        b0_2 = b0 * b0; b0_3 = b0_2 * b0; b0_4 = b0_3 * b0;
-                                        a1_2 = a1 * a1; a1_3 = a1_2 * a1;
-                                        b1_2 = b1 * b1; b1_3 = b1_2 * b1;
-
-                                        C1 = a1 + a0;
-                                        Ca = a1*C1 + a0_2; Caa = a1*Ca + a0_3; Caaa = a1*Caa + a0_4;
-                                        Cb = b1*(b1 + b0) + b0_2; Cbb = b1*Cb + b0_3; Cbbb = b1*Cbb + b0_4;
-                                        Cab = 3*a1_2 + 2*a1*a0 + a0_2; Kab = a1_2 + 2*a1*a0 + 3*a0_2;
-                                        Caab = a0*Cab + 4*a1_3; Kaab = a1*Kab + 4*a0_3;
-                                        Cabb = 4*b1_3 + 3*b1_2*b0 + 2*b1*b0_2 + b0_3;
-                                        Kabb = b1_3 + 2*b1_2*b0 + 3*b1*b0_2 + 4*b0_3;
-
-                                        P1 += db*C1;
-                                        Pa += db*Ca;
-                                        Paa += db*Caa;
-                                        Paaa += db*Caaa;
-                                        Pb += da*Cb;
-                                        Pbb += da*Cbb;
-                                        Pbbb += da*Cbbb;
-                                        Pab += db*(b1*Cab + b0*Kab);
-                                        Paab += db*(b1*Caab + b0*Kaab);
-                                        Pabb += da*(a1*Cabb + a0*Kabb);
-                                    }
-
-                                    P1 /= 2.0;
-                                    Pa /= 6.0;
-                                    Paa /= 12.0;
-                                    Paaa /= 20.0;
-                                    Pb /= -6.0;
-                                    Pbb /= -12.0;
-                                    Pbbb /= -20.0;
-                                    Pab /= 24.0;
-                                    Paab /= 60.0;
-                                    Pabb /= -60.0;
-                                }
-
-                                w = - dDOT(n, v[0]);
-
-                                k1 = 1 / n[C]; k2 = k1 * k1; k3 = k2 * k1; k4 = k3 * k1;
-
-                                Fa = k1 * Pa;
-                                Fb = k1 * Pb;
-                                Fc = -k2 * (n[A]*Pa + n[B]*Pb + w*P1);
-
-                                Faa = k1 * Paa;
-                                Fbb = k1 * Pbb;
-                                Fcc = k3 * (SQR(n[A])*Paa + 2*n[A]*n[B]*Pab + SQR(n[B])*Pbb +
-                                            w*(2*(n[A]*Pa + n[B]*Pb) + w*P1));
-
-                                Faaa = k1 * Paaa;
-                                Fbbb = k1 * Pbbb;
-                                Fccc = -k4 * (CUBE(n[A])*Paaa + 3*SQR(n[A])*n[B]*Paab
-                                              + 3*n[A]*SQR(n[B])*Pabb + CUBE(n[B])*Pbbb
-                                              + 3*w*(SQR(n[A])*Paa + 2*n[A]*n[B]*Pab + SQR(n[B])*Pbb)
-                                              + w*w*(3*(n[A]*Pa + n[B]*Pb) + w*P1));
-
-                                Faab = k1 * Paab;
-                                Fbbc = -k2 * (n[A]*Pabb + n[B]*Pbbb + w*Pbb);
-                                Fcca = k3 * (SQR(n[A])*Paaa + 2*n[A]*n[B]*Paab + SQR(n[B])*Pabb
-                                             + w*(2*(n[A]*Paa + n[B]*Pab) + w*Pa));
-                            }
-
-
-                            T0 += n[0] * ((A == 0) ? Fa : ((B == 0) ? Fb : Fc));
-
-                            T1[A] += n[A] * Faa;
-                            T1[B] += n[B] * Fbb;
-                            T1[C] += n[C] * Fcc;
-                            T2[A] += n[A] * Faaa;
-                            T2[B] += n[B] * Fbbb;
-                            T2[C] += n[C] * Fccc;
-                            TP[A] += n[A] * Faab;
-                            TP[B] += n[B] * Fbbc;
-                            TP[C] += n[C] * Fcca;
+                            v[j][0] = vertices[indices[index + j]].Pos.X;
+                            v[j][1] = vertices[indices[index + j]].Pos.Y;
+                            v[j][2] = vertices[indices[index + j]].Pos.Z;
                         }
+                        integrator.AddTriangle(v[0], v[1], v[2], clockwise);
                     }
                 }
             }
         }
     }
-
-    T1[0] /= 2; T1[1] /= 2; T1[2] /= 2;
-    T2[0] /= 3; T2[1] /= 3; T2[2] /= 3;
-    TP[0] /= 2; TP[1] /= 2; TP[2] /= 2;
-
-    m->mass = density * T0;
-    m->_I(0,0) = density * (T2[1] + T2[2]);
-    m->_I(1,1) = density * (T2[2] + T2[0]);
-    m->_I(2,2) = density * (T2[0] + T2[1]);
-    m->_I(0,1) = - density * TP[0];
-    m->_I(1,0) = - density * TP[0];
-    m->_I(2,1) = - density * TP[1];
-    m->_I(1,2) = - density * TP[1];
-    m->_I(2,0) = - density * TP[2];
-    m->_I(0,2) = - density * TP[2];
-
-    m->c[0] = T1[0] / T0;
-    m->c[1] = T1[1] / T0;
-    m->c[2] = T1[2] / T0;
+    integrator.GetIntegrals(integral);
+    SetMassFromIntegrals(integral, density, m);
 #else
     // assumes anticlockwise winding
 
-    unsigned int triangles = mNumVertices / 3;
-
-    double nx, ny, nz;
-    unsigned int i, j, A, B, C;
-    // face integrals
-    double Fa, Fb, Fc, Faa, Fbb, Fcc, Faaa, Fbbb, Fccc, Faab, Fbbc, Fcca;
-
-    // projection integrals
-    double P1, Pa, Pb, Paa, Pab, Pbb, Paaa, Paab, Pabb, Pbbb;
-
-    double T0 = 0;
-    double T1[3] = {0., 0., 0.};
-    double T2[3] = {0., 0., 0.};
-    double TP[3] = {0., 0., 0.};
+    // mass and inertia are linear in density so a mesh that already knows its unit density
+    // values (a binary mesh or a MeshCache entry) does not need integrating again
+    dMass unitMass;
+    if (clockwise == false && GetStoredMassProperties(&unitMass))
+    {
+        *m = unitMass;
+        m->mass *= density;
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                m->_I(i,j) *= density;
+        return;
+    }
 
-    dVector3 v[3];
-    for( i = 0; i < triangles; i++ )
+    int numBlocks = (mNumTriangles + kMassBlockSize - 1) / kMassBlockSize;
+    std::vector<double> blockIntegrals(size_t(numBlocks) * kMassIntegrals);
+    auto integrateBlocks = [this, clockwise, numBlocks, &blockIntegrals](int firstBlock, int step)
     {
-        if (clockwise == false)
+        for (int block = firstBlock; block < numBlocks; block += step)
         {
-            for (j = 0; j < 3; j++)
+            MassIntegrator integrator;
+            int lastTriangle = std::min(mNumTriangles, (block + 1) * kMassBlockSize);
+            for (int i = block * kMassBlockSize; i < lastTriangle; i++)
             {
-                v[j][0] = mVertexList[i * 9 + j * 3];
-                v[j][1] = mVertexList[i * 9 + j * 3 + 1];
-                v[j][2] = mVertexList[i * 9 + j * 3 + 2];
+                const int *triangle = mIndexList + i * 3;
+                integrator.AddTriangle(mVertexList + triangle[0] * 3, mVertexList + triangle[1] * 3, mVertexList + triangle[2] * 3, clockwise);
             }
+            integrator.GetIntegrals(&blockIntegrals[size_t(block) * kMassIntegrals]);
         }
-        else
-        {
-            for (j = 0; j < 3; j++)
-            {
-                v[j][2] = mVertexList[i * 9 + j * 3];
-                v[j][1] = mVertexList[i * 9 + j * 3 + 1];
-                v[j][0] = mVertexList[i * 9 + j * 3 + 2];
-            }
-        }
-
-        dVector3 n, a, b;
-        dOP( a, -, v[1], v[0] );
-        dOP( b, -, v[2], v[0] );
-        dCROSS( n, =, b, a );
-        nx = fabs(n[0]);
-        ny = fabs(n[1]);
-        nz = fabs(n[2]);
-
-        if( nx > ny && nx > nz )
-            C = 0;
-        else
-            C = (ny > nz) ? 1 : 2;
-
-        // Even though all triangles might be initially valid,
-        // a triangle may degenerate into a segment after applying
-        // space transformation.
-        if (n[C] != REAL(0.0))
-        {
-            A = (C + 1) % 3;
-            B = (A + 1) % 3;
-
-            // calculate face integrals
-            {
-                double w;
-                double k1, k2, k3, k4;
-
-                //compProjectionIntegrals(f);
-                {
-                    double a0, a1, da;
-                    double b0, b1, db;
-                    double a0_2, a0_3, a0_4, b0_2, b0_3, b0_4;
-                    double a1_2, a1_3, b1_2, b1_3;
-                    double C1, Ca, Caa, Caaa, Cb, Cbb, Cbbb;
-                    double Cab, Kab, Caab, Kaab, Cabb, Kabb;
-
-                    P1 = Pa = Pb = Paa = Pab = Pbb = Paaa = Paab = Pabb = Pbbb = 0.0;
-
-                    for( j = 0; j < 3; j++)
-                    {
-                        switch(j)
-                        {
-                        case 0:
-                            a0 = v[0][A];
-                            b0 = v[0][B];
-                            a1 = v[1][A];
-                            b1 = v[1][B];
-                            break;
-                        case 1:
-                            a0 = v[1][A];
-                            b0 = v[1][B];
-                            a1 = v[2][A];
-                            b1 = v[2][B];
-                            break;
-                        case 2:
-                            a0 = v[2][A];
-                            b0 = v[2][B];
-                            a1 = v[0][A];
-                            b1 = v[0][B];
-                            break;
-                        }
-                        da = a1 - a0;
-                        db = b1 - b0;
-                        a0_2 = a0 * a0; a0_3 = a0_2 * a0; a0_4 = a0_3 * a0;
-                        b0_2 = b0 * b0; b0_3 = b0_2 * b0; b0_4 = b0_3 * b0;
-                        a1_2 = a1 * a1; a1_3 = a1_2 * a1;
-                        b1_2 = b1 * b1; b1_3 = b1_2 * b1;
-
-                        C1 = a1 + a0;
-                        Ca = a1*C1 + a0_2; Caa = a1*Ca + a0_3; Caaa = a1*Caa + a0_4;
-                        Cb = b1*(b1 + b0) + b0_2; Cbb = b1*Cb + b0_3; Cbbb = b1*Cbb + b0_4;
-                        Cab = 3*a1_2 + 2*a1*a0 + a0_2; Kab = a1_2 + 2*a1*a0 + 3*a0_2;
-                        Caab = a0*Cab + 4*a1_3; Kaab = a1*Kab + 4*a0_3;
-                        Cabb = 4*b1_3 + 3*b1_2*b0 + 2*b1*b0_2 + b0_3;
-                        Kabb = b1_3 + 2*b1_2*b0 + 3*b1*b0_2 + 4*b0_3;
-
-                        P1 += db*C1;
-                        Pa += db*Ca;
-                        Paa += db*Caa;
-                        Paaa += db*Caaa;
-                        Pb += da*Cb;
-                        Pbb += da*Cbb;
-                        Pbbb += da*Cbbb;
-                        Pab += db*(b1*Cab + b0*Kab);
-                        Paab += db*(b1*Caab + b0*Kaab);
-                        Pabb += da*(a1*Cabb + a0*Kabb);
-                    }
-
-                    P1 /= 2.0;
-                    Pa /= 6.0;
-                    Paa /= 12.0;
-                    Paaa /= 20.0;
-                    Pb /= -6.0;
-                    Pbb /= -12.0;
-                    Pbbb /= -20.0;
-                    Pab /= 24.0;
-                    Paab /= 60.0;
-                    Pabb /= -60.0;
-                }
-
-                w = - dDOT(n, v[0]);
-
-                k1 = 1 / n[C]; k2 = k1 * k1; k3 = k2 * k1; k4 = k3 * k1;
+    };
 
-                Fa = k1 * Pa;
-                Fb = k1 * Pb;
-                Fc = -k2 * (n[A]*Pa + n[B]*Pb + w*P1);
-
-                Faa = k1 * Paa;
-                Fbb = k1 * Pbb;
-                Fcc = k3 * (SQR(n[A])*Paa + 2*n[A]*n[B]*Pab + SQR(n[B])*Pbb +
-                            w*(2*(n[A]*Pa + n[B]*Pb) + w*P1));
-
-                Faaa = k1 * Paaa;
-                Fbbb = k1 * Pbbb;
-                Fccc = -k4 * (CUBE(n[A])*Paaa + 3*SQR(n[A])*n[B]*Paab
-                              + 3*n[A]*SQR(n[B])*Pabb + CUBE(n[B])*Pbbb
-                              + 3*w*(SQR(n[A])*Paa + 2*n[A]*n[B]*Pab + SQR(n[B])*Pbb)
-                              + w*w*(3*(n[A]*Pa + n[B]*Pb) + w*P1));
-
-                Faab = k1 * Paab;
-                Fbbc = -k2 * (n[A]*Pabb + n[B]*Pbbb + w*Pbb);
-                Fcca = k3 * (SQR(n[A])*Paaa + 2*n[A]*n[B]*Paab + SQR(n[B])*Pabb
-                             + w*(2*(n[A]*Paa + n[B]*Pab) + w*Pa));
-            }
-
-
-            T0 += n[0] * ((A == 0) ? Fa : ((B == 0) ? Fb : Fc));
-
-            T1[A] += n[A] * Faa;
-            T1[B] += n[B] * Fbb;
-            T1[C] += n[C] * Fcc;
-            T2[A] += n[A] * Faaa;
-            T2[B] += n[B] * Fbbb;
-            T2[C] += n[C] * Fccc;
-            TP[A] += n[A] * Faab;
-            TP[B] += n[B] * Fbbc;
-            TP[C] += n[C] * Fcca;
-        }
+    int numThreads = std::min(int(std::thread::hardware_concurrency()), numBlocks);
+    if (numThreads > 1)
+    {
+        std::vector<std::thread> threads;
+        for (int i = 1; i < numThreads; i++) threads.push_back(std::thread(integrateBlocks, i, numThreads));
+        integrateBlocks(0, numThreads);
+        for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+    }
+    else
+    {
+        integrateBlocks(0, 1);
     }
 
-    T1[0] /= 2; T1[1] /= 2; T1[2] /= 2;
-    T2[0] /= 3; T2[1] /= 3; T2[2] /= 3;
-    TP[0] /= 2; TP[1] /= 2; TP[2] /= 2;
-
-    m->mass = density * T0;
-    m->_I(0,0) = density * (T2[1] + T2[2]);
-    m->_I(1,1) = density * (T2[2] + T2[0]);
-    m->_I(2,2) = density * (T2[0] + T2[1]);
-    m->_I(0,1) = - density * TP[0];
-    m->_I(1,0) = - density * TP[0];
-    m->_I(2,1) = - density * TP[1];
-    m->_I(1,2) = - density * TP[1];
-    m->_I(2,0) = - density * TP[2];
-    m->_I(0,2) = - density * TP[2];
-
-    m->c[0] = T1[0] / T0;
-    m->c[1] = T1[1] / T0;
-    m->c[2] = T1[2] / T0;
+    for (int i = 0; i < kMassIntegrals; i++)
+    {
+        integral[i] = 0;
+        for (int block = 0; block < numBlocks; block++) integral[i] += blockIntegrals[size_t(block) * kMassIntegrals + i];
+    }
+    SetMassFromIntegrals(integral, density, m);
 #endif
 }
 
 // reverse the face winding
 void FacetedObject::ReverseWinding()
 {
-    double t;
-    int numTriangles = mNumVertices / 3;
-    int i, j;
-    for (i = 0; i < numTriangles; i++)
+    if (m_SharedMesh) UnshareMesh();
+    int t;
+    int i;
+    for (i = 0; i < mNumTriangles; i++)
     {
-        for (j = 0; j < 3; j++)
-        {
-            t = mVertexList[i * 9 + 3 + j];
-            mVertexList[i * 9 + 3 + j] = mVertexList[i * 9 + 6 + j];
-            mVertexList[i * 9 + 6 + j] = t;
-        }
+        t = mIndexList[i * 3 + 1];
+        mIndexList[i * 3 + 1] = mIndexList[i * 3 + 2];
+        mIndexList[i * 3 + 2] = t;
+    }
+    for (i = 0; i < mNumTriangles * 3; i++) mNormalList[i] = -mNormalList[i];
+}
+
+// copy the vertices of a triangle into a packed list
+// x1, y1, z1, x2, y2, z2, x3, y3, z3
+void FacetedObject::GetTriangle(int i, double *triangle)
+{
+    for (int j = 0; j < 3; j++)
+    {
+        const double *p = mVertexList + mIndexList[i * 3 + j] * 3;
+        triangle[j * 3] = p[0];
+        triangle[j * 3 + 1] = p[1];
+        triangle[j * 3 + 2] = p[2];
     }
-    for (i = 0; i < mNumVertices * 3; i++) mNormalList[i] = -mNormalList[i];
 }
 
 // add the faces from one faceted object to another
 void FacetedObject::AddFacetedObject(FacetedObject *object, bool useDisplayRotation)
 {
     int numTriangles = object->GetNumTriangles();
-    double *triangle, *p1;
-    double triangle2[9];
+    double *p1;
+    double triangle[9], triangle2[9];
     dVector3 v1, v1r;
 
     if (useDisplayRotation)
     {
         for (int i = 0; i < numTriangles; i++)
         {
-            triangle = object->GetTriangle(i);
+            object->GetTriangle(i, triangle);
             for (int j =0; j < 3; j++)
             {
                 p1 = triangle + 3 * j;
@@ -1244,7 +1225,7 @@ void FacetedObject::AddFacetedObject(FacetedObject *object, bool useDisplayRotat
     {
         for (int i = 0; i < numTriangles; i++)
         {
-            triangle = object->GetTriangle(i);
+            object->GetTriangle(i, triangle);
             AddTriangle(triangle);
         }
     }
@@ -1333,7 +1314,8 @@ void FacetedObject::initializeSceneNode()
     }
 
     meshbuffer->setBoundingBox(irr::core::aabbox3df(minx, miny, minz, maxx, maxy, maxz));
-    m_simulationWindow->sceneManager()->getMeshManipulator()->recalculateNormals(meshbuffer);
+    // shared vertices need smoothed normals otherwise each vertex just gets the normal of one of its faces
+    m_simulationWindow->sceneManager()->getMeshManipulator()->recalculateNormals(meshbuffer, GetNumVertices() < GetNumTriangles() * 3);
 
     irr::scene::SMesh *mesh = new irr::scene::SMesh();
     mesh->addMeshBuffer(meshbuffer);
@@ -1348,8 +1330,7 @@ void FacetedObject::initializeSceneNode()
     irr::s32 idBitMask = 1 << 0;
     m_sceneNode = m_simulationWindow->sceneManager()->addAnimatedMeshSceneNode(animatedMesh, 0, idBitMask);
     animatedMesh->drop();
-    int minimalPolysPerNode = 256;
-    irr::scene::ITriangleSelector* selector = m_simulationWindow->sceneManager()->createOctreeTriangleSelector(m_sceneNode->getMesh(), m_sceneNode, minimalPolysPerNode);
+    irr::scene::ITriangleSelector* selector = new BVHTriangleSelector(m_sceneNode->getMesh()->getMesh(0), m_sceneNode);
     m_sceneNode->setTriangleSelector(selector);
     selector->drop();
     irr::core::matrix4 matrix;
@@ -14,6 +14,9 @@
 
 #include <ode/ode.h>
 
+#include <memory>
+#include <vector>
+
 #ifdef USE_QT
 #include "SimulationWindow.h"
 #endif
@@ -34,19 +37,21 @@ public:
     virtual void WritePOVRay(std::ostringstream &theString);
     virtual void WriteOBJFile(std::ostringstream &out);
 
+    // vertices can be shared between triangles so use the index list to find the triangle vertices
     int GetNumVertices() { return mNumVertices; }
     double *GetVertex(int i) { return mVertexList + (3 * i); }
-    double *GetNormal(int i) { return mNormalList + (3 * i); }
+    double *GetNormal(int i) { return mNormalList + (3 * i); } // face normal of triangle i
     double *GetVertexList() { return mVertexList; }
     double *GetNormalList() { return mNormalList; }
     int *GetIndexList() { return mIndexList; }
 
     void AddPolygon(const double *vertices, int nSides);
     void AddTriangle(const double *vertices);
+    void AddIndexedTriangle(int v0, int v1, int v2);
     void AddFacetedObject(FacetedObject *object, bool useDisplayRotation);
 
-    int GetNumTriangles() { return mNumVertices / 3; }
-    double *GetTriangle(int i) { return mVertexList + (9 * i); }
+    int GetNumTriangles() { return mNumTriangles; }
+    void GetTriangle(int i, double *triangle);
     int *GetTriangleIndices(int i) { return mIndexList + (3 * i); }
 
     virtual void Draw();
@@ -70,7 +75,9 @@ public:
 
     // utility
     void ReverseWinding();
+    void WeldVertices();
     void AllocateMemory(int allocation);
+    void AllocateMemory(int vertexAllocation, int triangleAllocation);
     void SetVerticesAsSpheresRadius(double verticesAsSpheresRadius) { m_VerticesAsSpheresRadius = verticesAsSpheresRadius; }
 
     // ODE link
@@ -80,6 +87,28 @@ public:
 
     void SetBadMesh(bool v) { m_BadMesh = v; }
 
+    // read only mesh data that can be used by several objects at once (see MeshCache and BinaryMesh)
+    // the storage belongs to the derived class
+    struct SharedMesh
+    {
+        SharedMesh() { numVertices = 0; numTriangles = 0; vertices = 0; normals = 0; indices = 0; hasMassProperties = false; }
+        virtual ~SharedMesh() {}
+
+        int numVertices;
+        int numTriangles;
+        const double *vertices;
+        const double *normals;
+        const int *indices;
+        bool hasMassProperties;
+        dMass unitMass; // mass properties at unit density if known
+    };
+    std::shared_ptr<const SharedMesh> CreateSharedMesh(const dMass *unitMass = 0);
+    void SetSharedMesh(const std::shared_ptr<const SharedMesh> &sharedMesh);
+    const std::shared_ptr<const SharedMesh> &GetSharedMesh() { return m_SharedMesh; }
+    bool GetStoredMassProperties(dMass *unitMass);
+
+    bool ReadBinaryMesh(const char *filename, const pgd::Vector &scale, const pgd::Vector &offset);
+
 #ifdef USE_QT
     void setTexture(irr::u32 textureLayer, irr::video::ITexture *texture);
     void setMaterialFlag(irr::video::E_MATERIAL_FLAG flag, bool newvalue);
@@ -95,9 +124,11 @@ private:
 
     int mNumVertices;
     int mNumVerticesAllocated;
+    int mNumTriangles;
+    int mNumTrianglesAllocated;
     double *mVertexList;
-    double *mNormalList;
-    int *mIndexList;
+    double *mNormalList; // one per triangle
+    int *mIndexList; // three per triangle
     dVector3 m_DisplayPosition;
     dMatrix3 m_DisplayRotation;
     bool m_UseRelativeOBJ;
@@ -105,6 +136,9 @@ private:
     bool m_BadMesh;
     int m_AllocationIncrement;
 
+    void UnshareMesh();
+    std::shared_ptr<const SharedMesh> m_SharedMesh;
+
     std::ofstream *m_POVRayFile;
     std::ofstream *m_OBJFile;
     std::string m_OBJName;
@@ -0,0 +1,118 @@
+/*
+ *  FilterBank.cpp
+ *  GaitSym2016
+ *
+ *  Created by Bill Sellers on Sat Jun 19 2016.
+ *  Copyright (c) 2016 Bill Sellers. All rights reserved.
+ *
+ *  Implements a bank of identical low pass filters with one channel per input
+ *  The arithmetic per channel is the same as ButterworthFilter and MovingAverage
+ *
+ */
+
+#include "FilterBank.h"
+
+#include <cmath>
+#include <cfloat>
+
+#ifndef M_PI
+#define M_PI       3.14159265358979323846
+#endif
+#ifndef M_SQRT2
+#define M_SQRT2    1.41421356237309504880
+#endif
+
+FilterBank::FilterBank()
+{
+    m_filterType = NoFilter;
+    m_numChannels = 0;
+    m_b0 = 0;
+    m_b1 = 0;
+    m_b2 = 0;
+    m_a1 = 0;
+    m_a2 = 0;
+    m_window = 0;
+    m_index = 0;
+}
+
+void FilterBank::InitialiseMovingAverage(int numChannels, int window)
+{
+    m_filterType = MovingAverageFilter;
+    m_numChannels = numChannels;
+    m_window = window;
+    m_index = 0;
+    m_buffer.assign(size_t(m_window) * size_t(m_numChannels), 0);
+    m_sum.assign(m_numChannels, 0);
+    m_output.assign(m_numChannels, 0);
+}
+
+void FilterBank::InitialiseButterworth(int numChannels, double cutoffFrequency, double samplingFrequency)
+{
+    m_filterType = Butterworth2ndOrderFilter;
+    m_numChannels = numChannels;
+
+    // calculate the 2nd Order Butterworth Low Pass Filter coefficients for the IIR filter
+    double ff = cutoffFrequency / samplingFrequency;
+    const double ita = 1.0 / tan(M_PI * ff);
+    const double q = M_SQRT2;
+    m_b0 = 1.0 / (1.0 + q*ita + ita*ita);
+    m_b1 = 2 * m_b0;
+    m_b2 = m_b0;
+    m_a1 = 2.0 * (ita * ita - 1.0) * m_b0;
+    m_a2 = -(1.0 - q * ita + ita * ita) * m_b0;
+
+    m_xnminus1.assign(m_numChannels, 0);
+    m_xnminus2.assign(m_numChannels, 0);
+    m_ynminus1.assign(m_numChannels, 0);
+    m_ynminus2.assign(m_numChannels, 0);
+    m_output.assign(m_numChannels, 0);
+}
+
+void FilterBank::NextSample()
+{
+    if (m_filterType == MovingAverageFilter) m_index = (m_index + 1) % m_window; // ring buffer shared by all the channels
+}
+
+void FilterBank::AddNewSamples(const double *x, int start, int end, double *minOutput, double *maxOutput)
+{
+    double minValue = DBL_MAX;
+    double maxValue = -DBL_MAX;
+    double *output = m_output.data();
+    int i;
+
+    if (m_filterType == Butterworth2ndOrderFilter)
+    {
+        double *xnminus1 = m_xnminus1.data();
+        double *xnminus2 = m_xnminus2.data();
+        double *ynminus1 = m_ynminus1.data();
+        double *ynminus2 = m_ynminus2.data();
+        for (i = start; i < end; i++)
+        {
+            double yn = m_b0*x[i] + m_b1*xnminus1[i] + m_b2*xnminus2[i] + m_a1*ynminus1[i] + m_a2*ynminus2[i];
+            xnminus2[i] = xnminus1[i];
+            xnminus1[i] = x[i];
+            ynminus2[i] = ynminus1[i];
+            ynminus1[i] = yn;
+            output[i] = yn;
+            minValue = (yn < minValue) ? yn : minValue;
+            maxValue = (yn > maxValue) ? yn : maxValue;
+        }
+    }
+    else if (m_filterType == MovingAverageFilter)
+    {
+        double *buffer = m_buffer.data() + size_t(m_index) * size_t(m_numChannels);
+        double *sum = m_sum.data();
+        for (i = start; i < end; i++)
+        {
+            sum[i] -= buffer[i];
+            buffer[i] = x[i];
+            sum[i] += x[i];
+            output[i] = sum[i] / m_window;
+            minValue = (output[i] < minValue) ? output[i] : minValue;
+            maxValue = (output[i] > maxValue) ? output[i] : maxValue;
+        }
+    }
+
+    *minOutput = minValue;
+    *maxOutput = maxValue;
+}
@@ -0,0 +1,63 @@
+/*
+ *  FilterBank.h
+ *  GaitSym2016
+ *
+ *  Created by Bill Sellers on Sat Jun 19 2016.
+ *  Copyright (c) 2016 Bill Sellers. All rights reserved.
+ *
+ *  Implements a bank of identical low pass filters with one channel per input
+ *  The filter state is stored as arrays so that all the channels are updated
+ *  in a single pass rather than through a separate Filter object per channel
+ *
+ */
+
+#ifndef FILTERBANK_H
+#define FILTERBANK_H
+
+#include <vector>
+
+class FilterBank
+{
+public:
+    FilterBank();
+
+    enum FilterType { NoFilter = 0, MovingAverageFilter, Butterworth2ndOrderFilter };
+
+    void InitialiseMovingAverage(int numChannels, int window);
+    void InitialiseButterworth(int numChannels, double cutoffFrequency, double samplingFrequency);
+
+    // must be called once before the channels are given a new set of samples
+    void NextSample();
+    // adds x[start] to x[end - 1] to the matching channels and returns the range of the outputs
+    // different ranges can be processed in parallel after NextSample
+    void AddNewSamples(const double *x, int start, int end, double *minOutput, double *maxOutput);
+
+    const double *Output() const { return m_output.data(); }
+    int GetNumChannels() const { return m_numChannels; }
+    FilterType GetFilterType() const { return m_filterType; }
+
+protected:
+    FilterType m_filterType;
+    int m_numChannels;
+
+    // y(n)  =  b0*x(n) + b1*x(n-1) + b2*x(n-2) + a1*y(n-1) + a2*y(n-2)
+    double m_b0;
+    double m_b1;
+    double m_b2;
+    double m_a1;
+    double m_a2;
+    std::vector<double> m_xnminus1;
+    std::vector<double> m_xnminus2;
+    std::vector<double> m_ynminus1;
+    std::vector<double> m_ynminus2;
+
+    // the ring buffer holds window rows of numChannels values and all channels share the index
+    int m_window;
+    int m_index;
+    std::vector<double> m_buffer;
+    std::vector<double> m_sum;
+
+    std::vector<double> m_output;
+};
+
+#endif // FILTERBANK_H
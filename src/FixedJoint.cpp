@@ -13,8 +13,6 @@
 #include "Simulation.h"
 #include "Util.h"
 #include "TIFFWrite.h"
-#include "ButterworthFilter.h"
-#include "MovingAverage.h"
 
 #ifdef USE_QT
 #include "GLUtils.h"
@@ -26,6 +24,11 @@
 
 #include <ode/ode.h>
 
+#include <algorithm>
+#include <cfloat>
+#include <thread>
+#include <vector>
+
 
 FixedJoint::FixedJoint(dWorldID worldID) : Joint()
 {
@@ -54,10 +57,9 @@ FixedJoint::FixedJoint(dWorldID worldID) : Joint()
     m_minStress = 0;
     m_maxStress = 0;
     m_stressCalculationType = none;
-    m_vectorList = 0;
     m_stressLimit = -1;
     m_dumpCount = 0;
-    m_filteredStress = 0;
+    m_stressThreads = 1;
     m_lowPassMinStress = 0;
     m_lowPassMaxStress = 0;
     m_lowPassType = NoLowPass;
@@ -79,12 +81,6 @@ FixedJoint::~FixedJoint()
     if (m_xDistances) delete [] m_xDistances;
     if (m_yDistances) delete [] m_yDistances;
     if (m_stress) delete [] m_stress;
-    if (m_vectorList) delete [] m_vectorList;
-    if (m_filteredStress)
-    {
-        for (int i = 0; i < m_nActivePixels; i++) delete m_filteredStress[i];
-        delete [] m_filteredStress;
-    }
 
 #ifdef USE_QT
     if (m_colourMap) delete [] m_colourMap;
@@ -122,10 +118,10 @@ void FixedJoint::CalculateStress()
     // now rotate new values to stress based coordinates
     const double *q = dBodyGetQuaternion (this->GetBody1()->GetBodyID());
     pgd::Quaternion bodyOrientation(q[0], q[1], q[2], q[3]);
-    m_torqueStressCoords = pgd::QVRotate(m_StressOrientation, pgd::QVRotate(bodyOrientation, torqueStressOrigin));
-    m_forceStressCoords = pgd::QVRotate(m_StressOrientation, pgd::QVRotate(bodyOrientation, forceCM));
-
-    int i;
+    pgd::QVRotator bodyRotator(bodyOrientation);
+    pgd::QVRotator stressRotator(m_StressOrientation);
+    m_torqueStressCoords = stressRotator.Rotate(bodyRotator.Rotate(torqueStressOrigin));
+    m_forceStressCoords = stressRotator.Rotate(bodyRotator.Rotate(forceCM));
 
     if (m_stressCalculationType == beam)
     {
@@ -172,21 +168,26 @@ void FixedJoint::CalculateStress()
         // precalculate invariant bits of the formula
         double t1 = (My * m_Ix + Mx * m_Ixy)/(m_Ix * m_Iy - m_Ixy * m_Ixy);
         double t2 = (Mx * m_Iy + My * m_Ixy)/(m_Ix * m_Iy - m_Ixy * m_Ixy);
-        double *xDistancePtr = m_xDistances;
-        double *yDistancePtr = m_yDistances;
+        const double *xDistances = m_xDistances;
+        const double *yDistances = m_yDistances;
+        double *stress = m_stress;
 
-        double *stressPtr = m_stress;
-        m_minStress = DBL_MAX;
-        m_maxStress = -DBL_MAX;
-        for (i = 0; i < m_nActivePixels; i++)
+        PixelBlockResult result = ForEachPixelBlock([=](int start, int end, PixelBlockResult *block)
         {
-            *stressPtr = -t1 * (*xDistancePtr) + t2 * (*yDistancePtr) + linearStress;
-            if (*stressPtr > m_maxStress) m_maxStress = *stressPtr;
-            if (*stressPtr < m_minStress) m_minStress = *stressPtr;
-            stressPtr++;
-            xDistancePtr++;
-            yDistancePtr++;
-        }
+            double minStress = DBL_MAX;
+            double maxStress = -DBL_MAX;
+            for (int i = start; i < end; i++)
+            {
+                double s = -t1 * xDistances[i] + t2 * yDistances[i] + linearStress;
+                stress[i] = s;
+                minStress = (s < minStress) ? s : minStress;
+                maxStress = (s > maxStress) ? s : maxStress;
+            }
+            block->minValue = minStress;
+            block->maxValue = maxStress;
+        });
+        m_minStress = result.minValue;
+        m_maxStress = result.maxValue;
     }
     else if (m_stressCalculationType == spring)
     {
@@ -196,81 +197,60 @@ void FixedJoint::CalculateStress()
         // assuming all the springs are the same then
         pgd::Vector forcePerSpring1 = m_forceStressCoords / m_nActivePixels;
 
-        // but for the torque we need to find the total torsional springiness
-        double *xDistancePtr = m_xDistances;
-        double *yDistancePtr = m_yDistances;
-        double totalNominalTorque = 0;
+        // the torsional force on each spring is along axis x r where r is the perpendicular from the torque axis
+        // to the pixel. The force per spring is proportional to the perpendicular distance and since the axis
+        // is a unit vector perpendicular to r the magnitude of axis x r is already that distance
+        // so it does not need normalising
+        double ax = m_torqueAxis.x, ay = m_torqueAxis.y, az = m_torqueAxis.z;
+        const double *xDistances = m_xDistances;
+        const double *yDistances = m_yDistances;
+        double *stress = m_stress;
 
-        for (i = 0; i < m_nActivePixels; i++)
+        // but for the torque we need to find the total torsional springiness
+        // the torque per spring is proportional to the perpendicular distance squared
+        PixelBlockResult result = ForEachPixelBlock([=](int start, int end, PixelBlockResult *block)
         {
-            pgd::Vector p(*xDistancePtr, *yDistancePtr, 0);
-            pgd::Vector closestPoint = m_torqueAxis * (m_torqueAxis * p);
-            pgd::Vector r = p - closestPoint;
-            double distance2 = r.Magnitude2();
-            double distance = sqrt(distance2);
-            if (distance2 > 1e-10)
+            double totalNominalTorque = 0;
+            for (int i = start; i < end; i++)
             {
-                pgd::Vector direction = m_torqueAxis ^ r;
-                direction.Normalize();
-                pgd::Vector forcePerSpring2 =  direction * distance; // force per spring is proportional to the perpendicular distance
-                totalNominalTorque += distance2; // but the torque per spring is proportional to the perpendicular distance squared
-                m_vectorList[i] = forcePerSpring2;
+                double axisDistance = ax * xDistances[i] + ay * yDistances[i];
+                double rx = xDistances[i] - ax * axisDistance;
+                double ry = yDistances[i] - ay * axisDistance;
+                double rz = -az * axisDistance;
+                double distance2 = rx * rx + ry * ry + rz * rz;
+                totalNominalTorque += (distance2 > 1e-10) ? distance2 : 0;
             }
-            else
-            {
-                m_vectorList[i] = pgd::Vector(0, 0, 0);
-            }
-            xDistancePtr++;
-            yDistancePtr++;
-        }
+            block->sum = totalNominalTorque;
+        });
 
-        double torqueScale = m_torqueScalar / totalNominalTorque; // this will make the total torque produced by the springs add up to the actual torque
-        m_minStress = DBL_MAX;
-        m_maxStress = -DBL_MAX;
-        double *stressPtr = m_stress;
+        double torqueScale = m_torqueScalar / result.sum; // this will make the total torque produced by the springs add up to the actual torque
         double dArea = m_dx * m_dy;
-        for (i = 0; i < m_nActivePixels; i++)
+        double f1x = forcePerSpring1.x, f1y = forcePerSpring1.y, f1z = forcePerSpring1.z;
+        result = ForEachPixelBlock([=](int start, int end, PixelBlockResult *block)
         {
-            //std::cerr << m_vectorList[i].x << " " << m_vectorList[i].y << " " << m_vectorList[i].z << "\n";
-            m_vectorList[i] = (m_vectorList[i] * torqueScale) + forcePerSpring1;
-            *stressPtr = m_vectorList[i].Magnitude() / dArea;
-            if (*stressPtr > m_maxStress) m_maxStress = *stressPtr;
-            if (*stressPtr < m_minStress) m_minStress = *stressPtr;
-            stressPtr++;
-        }
-
-//#define SANITY_CHECK
-#ifdef SANITY_CHECK
-        // check that my forces and my torqes add up
-        pgd::Vector totalForce;
-        pgd::Vector totalTorque;
-        i = 0;
-        ptr = m_stiffness;
-        for (iy = 0; iy < m_ny; iy++)
-        {
-            for (ix = 0; ix < m_nx; ix++)
+            double minStress = DBL_MAX;
+            double maxStress = -DBL_MAX;
+            for (int i = start; i < end; i++)
             {
-                if (*ptr)
-                {
-                    totalForce += m_vectorList[i];
-
-                    pgd::Vector p(((ix) + 0.5) * m_dx - m_xOrigin, ((iy) + 0.5) * m_dy - m_yOrigin, 0);
-                    pgd::Vector closestPoint = torqueAxis * (torqueAxis * p);
-                    pgd::Vector r = p - closestPoint;
-                    pgd::Vector torque = r ^ m_vectorList[i];
-                    std::cerr << "torque " << torque.x << " " << torque.y << " " << torque.z << "\n";
-                    totalTorque += torque;
-                    i++;
-                }
-                ptr++;
+                double axisDistance = ax * xDistances[i] + ay * yDistances[i];
+                double rx = xDistances[i] - ax * axisDistance;
+                double ry = yDistances[i] - ay * axisDistance;
+                double rz = -az * axisDistance;
+                double distance2 = rx * rx + ry * ry + rz * rz;
+                double scale = (distance2 > 1e-10) ? torqueScale : 0;
+                double fx = (ay * rz - az * ry) * scale + f1x;
+                double fy = (az * rx - ax * rz) * scale + f1y;
+                double fz = (ax * ry - ay * rx) * scale + f1z;
+                double s = sqrt(fx * fx + fy * fy + fz * fz) / dArea;
+                stress[i] = s;
+                minStress = (s < minStress) ? s : minStress;
+                maxStress = (s > maxStress) ? s : maxStress;
             }
-        }
-        std::cerr << "m_forceStressCoords " << m_forceStressCoords.x << " " << m_forceStressCoords.y << " " << m_forceStressCoords.z << "\n";
-        std::cerr << "totalForce " << totalForce.x << " " << totalForce.y << " " << totalForce.z << "\n";
-        std::cerr << "m_torqueStressCoords " << m_torqueStressCoords.x << " " << m_torqueStressCoords.y << " " << m_torqueStressCoords.z << "\n";
-        std::cerr << "totalTorque " << totalTorque.x << " " << totalTorque.y << " " << totalTorque.z << "\n";
-        std::cerr << "m_torqueStressCoords.Magnitude " << m_torqueStressCoords.Magnitude() << " " << "totalTorque.Magnitude " << totalTorque.Magnitude() << "\n";
-#endif
+            block->minValue = minStress;
+            block->maxValue = maxStress;
+        });
+        m_minStress = result.minValue;
+        m_maxStress = result.maxValue;
     }
 
     // update the stress list
@@ -283,20 +263,63 @@ void FixedJoint::CalculateStress()
 
     case MovingAverageLowPass:
     case Butterworth2ndOrderLowPass:
-        m_lowPassMinStress = DBL_MAX;
-        m_lowPassMaxStress = -DBL_MAX;
-        for (i = 0; i < m_nActivePixels; i++)
         {
-            m_filteredStress[i]->AddNewSample(m_stress[i]);
-            if (m_filteredStress[i]->Output() > m_lowPassMaxStress)
-                m_lowPassMaxStress = m_filteredStress[i]->Output();
-            if (m_filteredStress[i]->Output() < m_lowPassMinStress)
-                m_lowPassMinStress = m_filteredStress[i]->Output();
+            m_filteredStress.NextSample();
+            FilterBank *filteredStress = &m_filteredStress;
+            const double *stress = m_stress;
+            PixelBlockResult result = ForEachPixelBlock([=](int start, int end, PixelBlockResult *block)
+            {
+                filteredStress->AddNewSamples(stress, start, end, &block->minValue, &block->maxValue);
+            });
+            m_lowPassMinStress = result.minValue;
+            m_lowPassMaxStress = result.maxValue;
         }
         break;
     }
 }
 
+// runs function(start, end, block) over blocks of the active pixels and combines the block results
+// the blocks are the same size whatever the number of threads and their results are combined in
+// block order so the sums (and hence the stress) do not depend on the number of threads
+// threads are only used when each one gets at least one block
+template <typename F> FixedJoint::PixelBlockResult FixedJoint::ForEachPixelBlock(F function)
+{
+    const int pixelsPerBlock = 16384;
+    PixelBlockResult result;
+    result.minValue = DBL_MAX;
+    result.maxValue = -DBL_MAX;
+    result.sum = 0;
+
+    int numBlocks = std::max(1, (m_nActivePixels + pixelsPerBlock - 1) / pixelsPerBlock);
+    if (numBlocks == 1)
+    {
+        function(0, m_nActivePixels, &result);
+        return result;
+    }
+
+    std::vector<PixelBlockResult> blocks(numBlocks, result);
+    int nActivePixels = m_nActivePixels;
+    auto runBlocks = [&function, &blocks, nActivePixels](int firstBlock, int lastBlock)
+    {
+        for (int i = firstBlock; i < lastBlock; i++)
+            function(i * pixelsPerBlock, std::min(nActivePixels, (i + 1) * pixelsPerBlock), &blocks[i]);
+    };
+    int numThreads = std::max(1, std::min(m_stressThreads, numBlocks));
+    std::vector<std::thread> threads;
+    for (int i = 1; i < numThreads; i++)
+        threads.push_back(std::thread(runBlocks, numBlocks * i / numThreads, numBlocks * (i + 1) / numThreads));
+    runBlocks(0, numBlocks / numThreads);
+    for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+
+    for (int i = 0; i < numBlocks; i++)
+    {
+        if (blocks[i].minValue < result.minValue) result.minValue = blocks[i].minValue;
+        if (blocks[i].maxValue > result.maxValue) result.maxValue = blocks[i].maxValue;
+        result.sum += blocks[i].sum;
+    }
+    return result;
+}
+
 // this is where we set the cross section and precalculate the second moment of area
 // the cross section array is a unsigned char image with origin at bottom left (standard raster origin will need to have y reversed but this matches the OpenGL standard)
 // it scans row first and then vertically
@@ -375,10 +398,6 @@ void FixedJoint::SetCrossSection(unsigned char *stiffness, int nx, int ny, doubl
         }
     }
 
-    // allocate the vector list
-    if (m_vectorList) delete [] m_vectorList;
-    m_vectorList = new pgd::Vector[m_nActivePixels];
-
     if (m_stress) delete [] m_stress;
     m_stress = new double[m_nActivePixels];
 }
@@ -527,34 +546,15 @@ void FixedJoint::SetStressOrientation(const char *buf)
 
 void FixedJoint::SetWindow(int window)
 {
-//    m_minStressMovingAverage = new MovingAverage(window);
-//    m_maxStressMovingAverage = new MovingAverage(window);
     m_lowPassType = MovingAverageLowPass;
-    if (m_filteredStress)
-    {
-        for (int i = 0; i < m_nActivePixels; i++) delete m_filteredStress[i];
-        delete [] m_filteredStress;
-    }
-    m_filteredStress = new Filter *[m_nActivePixels];
-    for (int i = 0; i < m_nActivePixels; i++)
-        m_filteredStress[i] = new MovingAverage(window);
+    m_filteredStress.InitialiseMovingAverage(m_nActivePixels, window);
 }
 
 void FixedJoint::SetCutoffFrequency(double cutoffFrequency)
 {
     double samplingFrequency = 1.0 / m_simulation->GetTimeIncrement();
-//    m_minStressButterworth = new ButterworthFilter(cutoffFrequency, samplingFrequency);
-//    m_maxStressButterworth = new ButterworthFilter(cutoffFrequency, samplingFrequency);
     m_lowPassType = Butterworth2ndOrderLowPass;
-    if (m_filteredStress)
-    {
-        for (int i = 0; i < m_nActivePixels; i++) delete m_filteredStress[i];
-        delete [] m_filteredStress;
-    }
-    m_filteredStress = new Filter *[m_nActivePixels];
-    for (int i = 0; i < m_nActivePixels; i++)
-        m_filteredStress[i] = new SharedButterworthFilter();
-    SharedButterworthFilter::CalculateCoefficients(cutoffFrequency, samplingFrequency);
+    m_filteredStress.InitialiseButterworth(m_nActivePixels, cutoffFrequency, samplingFrequency);
 }
 
 
@@ -670,7 +670,7 @@ void FixedJoint::Dump()
                 int idx, ix, iy;
                 unsigned char *stiffnessPtr = m_stiffness;
                 double *stressPtr = m_stress;
-                Filter **filteredStressPtr = m_filteredStress;
+                const double *filteredStressPtr = m_filteredStress.Output();
                 for (iy = 0; iy < m_ny; iy++)
                 {
                     rowPtr = row;
@@ -699,12 +699,12 @@ void FixedJoint::Dump()
                             case Butterworth2ndOrderLowPass:
                                 if (m_lowRange != m_highRange)
                                 {
-                                    v = ((*filteredStressPtr)->Output() - m_lowRange) / (m_highRange - m_lowRange);
+                                    v = (*filteredStressPtr - m_lowRange) / (m_highRange - m_lowRange);
                                 }
                                 else
                                 {
                                     if (m_minStress != m_maxStress)
-                                        v = ((*filteredStressPtr)->Output() - m_minStress) / (m_maxStress - m_minStress);
+                                        v = (*filteredStressPtr - m_minStress) / (m_maxStress - m_minStress);
                                     else
                                         v = 0;
                                 }
@@ -819,7 +819,7 @@ void FixedJoint::Draw(SimulationWindow *window)
         else
         {
             double *stressPtr = m_stress;
-            Filter **filteredStressPtr = m_filteredStress;
+            const double *filteredStressPtr = m_filteredStress.Output();
             double v;
             for (iy = 0; iy < m_ny; iy++)
             {
@@ -848,12 +848,12 @@ void FixedJoint::Draw(SimulationWindow *window)
                         case Butterworth2ndOrderLowPass:
                             if (m_lowRange != m_highRange)
                             {
-                                v = ((*filteredStressPtr)->Output() - m_lowRange) / (m_highRange - m_lowRange);
+                                v = (*filteredStressPtr - m_lowRange) / (m_highRange - m_lowRange);
                             }
                             else
                             {
                                 if (m_minStress != m_maxStress)
-                                    v = ((*filteredStressPtr)->Output() - m_minStress) / (m_maxStress - m_minStress);
+                                    v = (*filteredStressPtr - m_minStress) / (m_maxStress - m_minStress);
                                 else
                                     v = 0;
                             }
@@ -12,6 +12,7 @@
 
 #include "Joint.h"
 #include "PGDMath.h"
+#include "FilterBank.h"
 
 #include <ode/ode.h>
 
@@ -22,10 +23,6 @@ namespace irr { namespace scene { class IMesh; } }
 namespace irr { namespace scene { class ISceneNode; } }
 #endif
 
-class ButterworthFilter;
-class MovingAverage;
-class Filter;
-
 class FixedJoint: public Joint
 {
     public:
@@ -52,6 +49,7 @@ class FixedJoint: public Joint
 
     void SetStressLimit(double stressLimit) { m_stressLimit = stressLimit; };
     bool CheckStressAbort();
+    bool HasStressLimit() { return m_stressCalculationType != none; }
 
     enum LowPassType { NoLowPass = 0, MovingAverageLowPass, Butterworth2ndOrderLowPass };
     void SetLowPassType(LowPassType lowPassType) { m_lowPassType = lowPassType; }
@@ -63,6 +61,9 @@ class FixedJoint: public Joint
 
     double *GetStress() { return m_stress; }
 
+    // very large cross sections can be split between threads (1 or less uses the calling thread only)
+    void SetStressThreads(int stressThreads) { m_stressThreads = stressThreads; }
+
     virtual void Update();
     virtual void Dump();
 
@@ -76,7 +77,15 @@ class FixedJoint: public Joint
 
 protected:
 
+    struct PixelBlockResult
+    {
+        double minValue;
+        double maxValue;
+        double sum;
+    };
+
     void CalculateStress();
+    template <typename F> PixelBlockResult ForEachPixelBlock(F function);
 
     // these are used for the stress/strain calculations
     unsigned char *m_stiffness;
@@ -106,12 +115,12 @@ protected:
     double m_torqueScalar;
 
     double m_stressLimit;
-    Filter **m_filteredStress;
+    FilterBank m_filteredStress;
     double m_lowPassMinStress;
     double m_lowPassMaxStress;
     LowPassType m_lowPassType;
 
-    pgd::Vector *m_vectorList;
+    int m_stressThreads;
 
     int m_dumpCount;
 
@@ -0,0 +1,403 @@
+/*
+ *  HeadlessRenderer.cpp
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+#ifdef USE_HEADLESS
+
+#include <ode/ode.h>
+#include <irrlicht.h>
+#include "CCameraSceneNode.h"
+#include <zlib.h>
+
+#include "HeadlessRenderer.h"
+#include "Simulation.h"
+#include "Body.h"
+#include "FacetedObject.h"
+#include "TIFFWrite.h"
+#include "DebugControl.h"
+
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+// irr::createDeviceEx is not thread safe and the console device grabs the signal handlers
+static std::mutex gDeviceMutex;
+
+HeadlessRenderer::HeadlessRenderer(Simulation *simulation)
+{
+    m_Simulation = simulation;
+    m_Interface = *simulation->GetInterface();
+    m_Width = 850;
+    m_Height = 850;
+    m_FilenamePrefix = "Frame";
+    m_ImageFormat = PNG;
+    m_NumThreads = 0;
+
+    // take a copy of the meshes so that rendering does not depend on the simulation
+    std::map<std::string, Body *> *bodyList = simulation->GetBodyList();
+    for (std::map<std::string, Body *>::const_iterator iter = bodyList->begin(); iter != bodyList->end(); iter++)
+    {
+        BodyMesh bodyMesh;
+        const Colour *colour = iter->second->GetColour();
+        bodyMesh.colour[0] = (unsigned char)(255 * colour->r);
+        bodyMesh.colour[1] = (unsigned char)(255 * colour->g);
+        bodyMesh.colour[2] = (unsigned char)(255 * colour->b);
+        bodyMesh.colour[3] = (unsigned char)(255 * colour->alpha);
+        bodyMesh.visible = iter->second->GetVisible();
+        FacetedObject *facetedObject = iter->second->physRep();
+        if (facetedObject)
+        {
+            // expand any shared vertices so that the normals stay flat
+            int numTriangles = facetedObject->GetNumTriangles();
+            double *vertexList = facetedObject->GetVertexList();
+            int *indexList = facetedObject->GetIndexList();
+            bodyMesh.vertices.resize(numTriangles * 9);
+            for (int i = 0; i < numTriangles * 3; i++)
+                for (int j = 0; j < 3; j++) bodyMesh.vertices[i * 3 + j] = float(vertexList[indexList[i] * 3 + j]);
+        }
+        m_BodyMeshes.push_back(bodyMesh);
+    }
+}
+
+HeadlessRenderer::~HeadlessRenderer()
+{
+}
+
+// store the current body poses as a new frame
+void HeadlessRenderer::RecordFrame()
+{
+    m_FrameTimes.push_back(m_Simulation->GetTime());
+    std::map<std::string, Body *> *bodyList = m_Simulation->GetBodyList();
+    for (std::map<std::string, Body *>::const_iterator iter = bodyList->begin(); iter != bodyList->end(); iter++)
+    {
+        const double *p = iter->second->GetPosition();
+        const double *q = iter->second->GetQuaternion();
+        m_Poses.push_back(p[0]); m_Poses.push_back(p[1]); m_Poses.push_back(p[2]);
+        m_Poses.push_back(q[0]); m_Poses.push_back(q[1]); m_Poses.push_back(q[2]); m_Poses.push_back(q[3]);
+    }
+}
+
+// read the frames from a file written by OutputKinematics
+// the bodies are in map order so the file must come from the same model
+int HeadlessRenderer::ReadKinematics(const char *filename)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        std::cerr << "Error opening kinematics file " << filename << "\n";
+        return __LINE__;
+    }
+
+    size_t numValues = 7 * m_BodyMeshes.size();
+    std::string line;
+    std::getline(file, line); // column headings
+    int lineNumber = 1;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        std::istringstream values(line);
+        double time;
+        if (!(values >> time)) continue; // blank line
+        std::vector<double> pose(numValues);
+        for (size_t i = 0; i < numValues; i++)
+        {
+            if (!(values >> pose[i]))
+            {
+                std::cerr << "Error reading kinematics file " << filename << " line " << lineNumber << ": expected " << numValues + 1 << " values\n";
+                return __LINE__;
+            }
+        }
+        m_FrameTimes.push_back(time);
+        m_Poses.insert(m_Poses.end(), pose.begin(), pose.end());
+    }
+    return 0;
+}
+
+// render all the stored frames splitting them into contiguous ranges, one per thread
+int HeadlessRenderer::RenderFrames()
+{
+    int numFrames = int(m_FrameTimes.size());
+    if (numFrames == 0) return 0;
+
+    int numThreads = m_NumThreads;
+    if (numThreads <= 0) numThreads = std::thread::hardware_concurrency();
+    if (numThreads < 1) numThreads = 1;
+    if (numThreads > numFrames) numThreads = numFrames;
+
+    std::vector<std::thread> threads;
+    std::vector<int> status(numThreads, 0);
+    for (int i = 0; i < numThreads; i++)
+    {
+        int firstFrame = int((long long)numFrames * i / numThreads);
+        int lastFrame = int((long long)numFrames * (i + 1) / numThreads);
+        threads.push_back(std::thread(&HeadlessRenderer::RenderRange, this, firstFrame, lastFrame, &status[i]));
+    }
+    int err = 0;
+    for (int i = 0; i < numThreads; i++)
+    {
+        threads[i].join();
+        if (status[i]) err = status[i];
+    }
+    return err;
+}
+
+// each thread has its own device since the Irrlicht scene manager and driver are not thread safe
+void HeadlessRenderer::RenderRange(int firstFrame, int lastFrame, int *status)
+{
+    irr::IrrlichtDevice *device;
+    FILE *nullOutput = fopen("/dev/null", "w"); // the console device writes its ASCII art and log here
+    {
+        std::lock_guard<std::mutex> lock(gDeviceMutex);
+        irr::SIrrlichtCreationParameters params;
+        params.DeviceType = irr::EIDT_CONSOLE;
+        params.DriverType = irr::video::EDT_BURNINGSVIDEO;
+        params.WindowSize = irr::core::dimension2d<irr::u32>(m_Width, m_Height);
+        params.Bits = 32;
+        params.ZBufferBits = 32;
+        params.LoggingLevel = irr::ELL_NONE;
+        params.WindowId = nullOutput;
+        device = irr::createDeviceEx(params);
+        // the console device installs its own handlers which stop the program being killed normally
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGABRT, SIG_DFL);
+    }
+    if (device == 0)
+    {
+        std::cerr << "Error creating software rendering device\n";
+        if (nullOutput) fclose(nullOutput);
+        *status = __LINE__;
+        return;
+    }
+
+    irr::video::IVideoDriver *driver = device->getVideoDriver();
+    irr::scene::ISceneManager *sceneManager = device->getSceneManager();
+
+    // lights as SimulationWindow
+    sceneManager->setAmbientLight(irr::video::SColorf(0.3f, 0.3f, 0.3f));
+    irr::scene::ILightSceneNode *light = sceneManager->addLightSceneNode(0, irr::core::vector3df(0, 0, 0), irr::video::SColorf(.8f, .8f, .8f), 1000.0f);
+    light->setLightType(irr::video::ELT_DIRECTIONAL);
+    light->setRotation(irr::core::vector3df(-135, 45, 0));
+
+    // camera as SimulationWindow::updateCamera
+    irr::scene::ICameraSceneNode *cameraNode = sceneManager->addCameraSceneNode();
+    irr::scene::CCameraSceneNode *camera = dynamic_cast<irr::scene::CCameraSceneNode *>(cameraNode);
+    irr::core::vector3df COI(m_Interface.COI[0], m_Interface.COI[1], m_Interface.COI[2]);
+    irr::core::vector3df cameraVec(m_Interface.CameraVec[0], m_Interface.CameraVec[1], m_Interface.CameraVec[2]);
+    cameraVec.normalize();
+    if (camera)
+    {
+        camera->setOrthogonal(m_Interface.OrthographicProjection);
+        camera->setRHCoordinates(true);
+    }
+    cameraNode->setFOV(irr::core::DEGTORAD * m_Interface.FOV);
+    cameraNode->setAspectRatio(float(m_Width) / float(m_Height));
+    cameraNode->setNearValue(m_Interface.FrontClip);
+    cameraNode->setFarValue(m_Interface.BackClip);
+    cameraNode->setPosition(COI - cameraVec * m_Interface.CameraDistance);
+    cameraNode->setTarget(COI);
+    cameraNode->setUpVector(irr::core::vector3df(m_Interface.Up[0], m_Interface.Up[1], m_Interface.Up[2]));
+    if (camera) camera->updateMatrices();
+
+    // mesh nodes with the same material settings as SimulationWindow::SetMeshColour
+    std::vector<irr::scene::ISceneNode *> nodes;
+    for (unsigned int i = 0; i < m_BodyMeshes.size(); i++)
+    {
+        const BodyMesh &bodyMesh = m_BodyMeshes[i];
+        if (bodyMesh.vertices.size() == 0)
+        {
+            nodes.push_back(0);
+            continue;
+        }
+        irr::video::SColor colour(bodyMesh.colour[3], bodyMesh.colour[0], bodyMesh.colour[1], bodyMesh.colour[2]);
+        irr::scene::CDynamicMeshBuffer *buffer = new irr::scene::CDynamicMeshBuffer(irr::video::EVT_STANDARD, irr::video::EIT_32BIT);
+        unsigned int numVertices = bodyMesh.vertices.size() / 3;
+        buffer->getVertexBuffer().set_used(numVertices);
+        buffer->getIndexBuffer().set_used(numVertices);
+        for (unsigned int j = 0; j < numVertices; j++)
+        {
+            irr::video::S3DVertex &v = static_cast<irr::video::S3DVertex *>(buffer->getVertexBuffer().pointer())[j];
+            v.Pos.set(bodyMesh.vertices[j * 3], bodyMesh.vertices[j * 3 + 1], bodyMesh.vertices[j * 3 + 2]);
+            v.Color = colour;
+            v.TCoords.set(0, 0);
+            buffer->getIndexBuffer().setValue(j, j);
+        }
+        buffer->recalculateBoundingBox();
+        irr::scene::SMesh *mesh = new irr::scene::SMesh();
+        mesh->addMeshBuffer(buffer);
+        buffer->drop();
+        mesh->recalculateBoundingBox();
+        sceneManager->getMeshManipulator()->recalculateNormals(mesh);
+
+        irr::video::SMaterial &material = buffer->getMaterial();
+        material.MaterialType = irr::video::EMT_SOLID;
+        material.AmbientColor.set(colour.getAlpha() * 0.2, colour.getRed() * 0.2, colour.getGreen() * 0.2, colour.getBlue() * 0.2);
+        material.DiffuseColor.set(colour.getAlpha() * 0.8, colour.getRed() * 0.8, colour.getGreen() * 0.8, colour.getBlue() * 0.8);
+        material.EmissiveColor.set(0, 0, 0, 0);
+        material.SpecularColor.set(colour.getAlpha() * 0.3, colour.getRed() * 0.3, colour.getGreen() * 0.3, colour.getBlue() * 0.3);
+        material.Shininess = 20;
+        material.BackfaceCulling = false;
+        material.FrontfaceCulling = true;
+        material.NormalizeNormals = true;
+        material.Lighting = true;
+        material.ColorMaterial = irr::video::ECM_DIFFUSE;
+
+        irr::scene::IMeshSceneNode *node = sceneManager->addMeshSceneNode(mesh);
+        mesh->drop();
+        node->setVisible(bodyMesh.visible);
+        nodes.push_back(node);
+    }
+
+    size_t numBodies = m_BodyMeshes.size();
+    std::vector<unsigned char> rgb(m_Width * m_Height * 3);
+    for (int frame = firstFrame; frame < lastFrame; frame++)
+    {
+        const double *pose = &m_Poses[frame * numBodies * 7];
+        for (size_t i = 0; i < numBodies; i++, pose += 7)
+        {
+            if (nodes[i] == 0) continue;
+            dQuaternion q;
+            dMatrix3 R;
+            q[0] = pose[3]; q[1] = pose[4]; q[2] = pose[5]; q[3] = pose[6];
+            dNormalize4(q);
+            dQtoR(q, R);
+            irr::core::matrix4 matrix;
+            matrix[0]=R[0];   matrix[1]=R[4];  matrix[2]=R[8];    matrix[3]=0;
+            matrix[4]=R[1];   matrix[5]=R[5];  matrix[6]=R[9];    matrix[7]=0;
+            matrix[8]=R[2];   matrix[9]=R[6];  matrix[10]=R[10];  matrix[11]=0;
+            matrix[12]=pose[0];  matrix[13]=pose[1]; matrix[14]=pose[2];   matrix[15]=1;
+            nodes[i]->setRotation(matrix.getRotationDegrees());
+            nodes[i]->setPosition(matrix.getTranslation());
+        }
+
+        // no endScene because presenting to the console device just draws ASCII art
+        driver->beginScene(irr::video::ECBF_COLOR | irr::video::ECBF_DEPTH, irr::video::SColor(255, 100, 101, 140));
+        sceneManager->drawAll();
+        irr::video::IImage *image = driver->createScreenShot(irr::video::ECF_R8G8B8);
+        if (image == 0)
+        {
+            std::cerr << "Error reading frame " << frame << " from the software framebuffer\n";
+            *status = __LINE__;
+            break;
+        }
+        image->copyToScaling(&rgb[0], m_Width, m_Height, irr::video::ECF_R8G8B8, m_Width * 3);
+        image->drop();
+
+        char filename[32];
+        int err = 0;
+        switch (m_ImageFormat)
+        {
+        case PPM:
+            sprintf(filename, "%06d.ppm", frame);
+            err = WritePPM((m_FilenamePrefix + filename).c_str(), m_Width, m_Height, &rgb[0]);
+            break;
+        case TIFF:
+            sprintf(filename, "%06d.tif", frame);
+            err = WriteTIFF((m_FilenamePrefix + filename).c_str(), m_Width, m_Height, &rgb[0]);
+            break;
+        case PNG:
+            sprintf(filename, "%06d.png", frame);
+            err = WritePNG((m_FilenamePrefix + filename).c_str(), m_Width, m_Height, &rgb[0]);
+            break;
+        }
+        if (err)
+        {
+            std::cerr << "Error writing " << m_FilenamePrefix << filename << "\n";
+            *status = err;
+            break;
+        }
+        if (gDebug == SimulationDebug) *gDebugStream << "HeadlessRenderer frame " << frame << " time " << m_FrameTimes[frame] << "\n";
+    }
+
+    device->drop();
+    if (nullOutput) fclose(nullOutput);
+}
+
+// write a PPM file with the rows top to bottom
+int HeadlessRenderer::WritePPM(const char *pathname, int width, int height, const unsigned char *rgb)
+{
+    FILE *out = fopen(pathname, "wb");
+    if (out == 0) return __LINE__;
+    fprintf(out, "P6\n%d %d\n255\n", width, height);
+    size_t written = fwrite(rgb, width * 3, height, out);
+    fclose(out);
+    if (int(written) != height) return __LINE__;
+    return 0;
+}
+
+// write a TIFF file
+int HeadlessRenderer::WriteTIFF(const char *pathname, int width, int height, const unsigned char *rgb)
+{
+    TIFFWrite tiff;
+    tiff.initialiseImage(width, height, 72, 72, 3);
+    // need to invert write order
+    for (int i = 0; i < height; i++)
+        tiff.copyRow(height - i - 1, const_cast<unsigned char *>(rgb + (i * width * 3)));
+    tiff.writeToFile(const_cast<char *>(pathname));
+    return 0;
+}
+
+static void WritePNGChunk(FILE *out, const char *type, const unsigned char *data, unsigned int length)
+{
+    unsigned char header[8];
+    header[0] = (unsigned char)(length >> 24); header[1] = (unsigned char)(length >> 16);
+    header[2] = (unsigned char)(length >> 8); header[3] = (unsigned char)(length);
+    memcpy(header + 4, type, 4);
+    uLong crc = crc32(0, header + 4, 4);
+    if (length) crc = crc32(crc, data, length);
+    unsigned char trailer[4];
+    trailer[0] = (unsigned char)(crc >> 24); trailer[1] = (unsigned char)(crc >> 16);
+    trailer[2] = (unsigned char)(crc >> 8); trailer[3] = (unsigned char)(crc);
+    fwrite(header, 8, 1, out);
+    if (length) fwrite(data, length, 1, out);
+    fwrite(trailer, 4, 1, out);
+}
+
+// write an 8 bit RGB PNG file using zlib for the compression
+int HeadlessRenderer::WritePNG(const char *pathname, int width, int height, const unsigned char *rgb)
+{
+    // each row is preceded by its filter type (0, none)
+    size_t rowBytes = width * 3;
+    std::vector<unsigned char> raw((rowBytes + 1) * height);
+    for (int i = 0; i < height; i++)
+    {
+        raw[i * (rowBytes + 1)] = 0;
+        memcpy(&raw[i * (rowBytes + 1) + 1], rgb + i * rowBytes, rowBytes);
+    }
+    uLongf compressedLength = compressBound(raw.size());
+    std::vector<unsigned char> compressed(compressedLength);
+    if (compress2(&compressed[0], &compressedLength, &raw[0], raw.size(), Z_DEFAULT_COMPRESSION) != Z_OK) return __LINE__;
+
+    FILE *out = fopen(pathname, "wb");
+    if (out == 0) return __LINE__;
+    static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    fwrite(signature, 8, 1, out);
+    unsigned char ihdr[13];
+    ihdr[0] = (unsigned char)(width >> 24); ihdr[1] = (unsigned char)(width >> 16);
+    ihdr[2] = (unsigned char)(width >> 8); ihdr[3] = (unsigned char)(width);
+    ihdr[4] = (unsigned char)(height >> 24); ihdr[5] = (unsigned char)(height >> 16);
+    ihdr[6] = (unsigned char)(height >> 8); ihdr[7] = (unsigned char)(height);
+    ihdr[8] = 8; // bit depth
+    ihdr[9] = 2; // colour type RGB
+    ihdr[10] = 0; // compression
+    ihdr[11] = 0; // filter
+    ihdr[12] = 0; // interlace
+    WritePNGChunk(out, "IHDR", ihdr, 13);
+    WritePNGChunk(out, "IDAT", &compressed[0], (unsigned int)compressedLength);
+    WritePNGChunk(out, "IEND", 0, 0);
+    int err = ferror(out) ? __LINE__ : 0;
+    fclose(out);
+    return err;
+}
+
+#endif
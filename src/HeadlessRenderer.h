@@ -0,0 +1,75 @@
+/*
+ *  HeadlessRenderer.h
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+// HeadlessRenderer draws the body meshes into an offscreen Irrlicht software
+// (Burning's Video) framebuffer so that movies can be made on machines with
+// no GPU and no display. The body poses are recorded as the simulation runs
+// (or read from an OutputKinematics file) and the frames are then rendered
+// and encoded in parallel with each thread handling a contiguous frame range.
+
+#ifndef HeadlessRenderer_h
+#define HeadlessRenderer_h
+
+#ifdef USE_HEADLESS
+
+#include "Simulation.h"
+
+#include <vector>
+#include <string>
+
+class HeadlessRenderer
+{
+public:
+    HeadlessRenderer(Simulation *simulation);
+    ~HeadlessRenderer();
+
+    enum ImageFormat { PPM, TIFF, PNG };
+
+    void SetWindowSize(int width, int height) { m_Width = width; m_Height = height; }
+    void SetFilenamePrefix(const char *prefix) { m_FilenamePrefix = prefix; }
+    void SetImageFormat(ImageFormat imageFormat) { m_ImageFormat = imageFormat; }
+    void SetNumThreads(int numThreads) { m_NumThreads = numThreads; }
+
+    void RecordFrame();
+    int ReadKinematics(const char *filename);
+    int RenderFrames();
+
+    int GetNumFrames() { return int(m_FrameTimes.size()); }
+
+    static int WritePNG(const char *pathname, int width, int height, const unsigned char *rgb);
+    static int WritePPM(const char *pathname, int width, int height, const unsigned char *rgb);
+    static int WriteTIFF(const char *pathname, int width, int height, const unsigned char *rgb);
+
+protected:
+    struct BodyMesh
+    {
+        std::vector<float> vertices; // x, y, z triangle soup in body local coordinates
+        unsigned char colour[4]; // r, g, b, a
+        bool visible;
+    };
+
+    void RenderRange(int firstFrame, int lastFrame, int *status);
+
+    std::vector<BodyMesh> m_BodyMeshes;
+    std::vector<double> m_FrameTimes;
+    std::vector<double> m_Poses; // 7 values (x, y, z, q0, q1, q2, q3) per body per frame
+
+    Interface m_Interface;
+    int m_Width;
+    int m_Height;
+    std::string m_FilenamePrefix;
+    ImageFormat m_ImageFormat;
+    int m_NumThreads;
+
+    Simulation *m_Simulation;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,272 @@
+/*
+ *  HeightfieldGeom.cpp
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+#include <ode/ode.h>
+
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <fstream>
+#include <iostream>
+
+#include "HeightfieldGeom.h"
+#include "DebugControl.h"
+
+#ifdef USE_QT
+#include "FacetedObject.h"
+#include <algorithm>
+#endif
+
+std::map<HeightfieldGeom::GridKey, std::shared_ptr<const HeightfieldGeom::Grid> > HeightfieldGeom::m_GridCache;
+std::mutex HeightfieldGeom::m_GridCacheMutex;
+
+// The ODE heightfield has its heights along the local Y axis and is centred on the geom
+// position. Rotating by +90 degrees about X puts local Y along world Z and local Z along
+// world -Y so the first row of the grid (local Z = -depth / 2) is at the maximum world Y.
+// The heights are used in place so the grid must outlive the ODE data which is why the
+// geom holds a reference to it.
+HeightfieldGeom::HeightfieldGeom(dSpaceID space, const std::shared_ptr<const Grid> &grid, double sizeX, double sizeY,
+                                 double scale, double offset, double thickness, double x, double y, double z)
+{
+    m_Grid = grid;
+    m_Format = TextFormat;
+    m_SizeX = sizeX;
+    m_SizeY = sizeY;
+    m_Scale = scale;
+    m_Offset = offset;
+    m_Thickness = thickness;
+    m_Position[0] = x;
+    m_Position[1] = y;
+    m_Position[2] = z;
+
+    m_HeightfieldDataID = dGeomHeightfieldDataCreate();
+    dGeomHeightfieldDataBuildDouble(m_HeightfieldDataID, m_Grid->heights.data(), 0, sizeX, sizeY, m_Grid->xSamples, m_Grid->ySamples,
+                                    scale, offset, thickness, 0);
+
+    m_GeomID = dCreateHeightfield(space, m_HeightfieldDataID, 1);
+    dGeomSetData(m_GeomID, this);
+    dGeomSetPosition(m_GeomID, x, y, z);
+    dQuaternion q = {M_SQRT1_2, M_SQRT1_2, 0, 0};
+    dGeomSetQuaternion(m_GeomID, q);
+}
+
+HeightfieldGeom::~HeightfieldGeom()
+{
+    // the geom has to go before the data it uses
+    dGeomDestroy(m_GeomID);
+    m_GeomID = 0;
+    dGeomHeightfieldDataDestroy(m_HeightfieldDataID);
+}
+
+std::shared_ptr<const HeightfieldGeom::Grid> HeightfieldGeom::GetGrid(const std::string &filename, GridFormat format, int xSamples, int ySamples)
+{
+    struct stat fileStat;
+    if (stat(filename.c_str(), &fileStat))
+    {
+        std::cerr << "Error: HeightfieldGeom::GetGrid(" << filename << ") - Cannot find file\n";
+        return std::shared_ptr<const Grid>();
+    }
+
+    GridKey key;
+    key.filename = filename;
+    key.modificationTime = fileStat.st_mtime;
+    key.fileSize = fileStat.st_size;
+    key.format = format;
+    key.xSamples = xSamples;
+    key.ySamples = ySamples;
+
+    {
+        std::lock_guard<std::mutex> lock(m_GridCacheMutex);
+        std::map<GridKey, std::shared_ptr<const Grid> >::const_iterator found = m_GridCache.find(key);
+        if (found != m_GridCache.end()) return found->second;
+    }
+
+    // read without holding the lock (see MeshCache::GetMesh)
+    std::shared_ptr<Grid> grid(new Grid());
+    grid->xSamples = xSamples;
+    grid->ySamples = ySamples;
+    bool err = (format == TextFormat) ? ReadTextGrid(filename, grid.get()) : ReadBinaryGrid(filename, format, grid.get());
+    if (err) return std::shared_ptr<const Grid>();
+    if (grid->xSamples < 2 || grid->ySamples < 2)
+    {
+        std::cerr << "Error: HeightfieldGeom::GetGrid(" << filename << ") - Grid must be at least 2 x 2\n";
+        return std::shared_ptr<const Grid>();
+    }
+
+    if (gDebug == FacetedObjectDebug)
+        std::cerr << "HeightfieldGeom::GetGrid\tread\t" << filename << "\txSamples\t" << grid->xSamples << "\tySamples\t" << grid->ySamples << "\n";
+
+    std::lock_guard<std::mutex> lock(m_GridCacheMutex);
+    // remove any versions of this file that are out of date
+    for (std::map<GridKey, std::shared_ptr<const Grid> >::iterator iter = m_GridCache.begin(); iter != m_GridCache.end();)
+    {
+        if (iter->first.filename == filename && (iter->first.modificationTime != key.modificationTime || iter->first.fileSize != key.fileSize))
+            iter = m_GridCache.erase(iter);
+        else
+            iter++;
+    }
+    std::pair<std::map<GridKey, std::shared_ptr<const Grid> >::iterator, bool> inserted = m_GridCache.insert(std::make_pair(key, grid));
+    return inserted.first->second;
+}
+
+void HeightfieldGeom::ClearGridCache()
+{
+    std::lock_guard<std::mutex> lock(m_GridCacheMutex);
+    m_GridCache.clear();
+}
+
+// one row per line, blank lines are ignored
+// returns true on error
+bool HeightfieldGeom::ReadTextGrid(const std::string &filename, Grid *grid)
+{
+    std::ifstream file(filename.c_str());
+    if (!file.is_open())
+    {
+        std::cerr << "Error: HeightfieldGeom::ReadTextGrid(" << filename << ") - Cannot open file\n";
+        return true;
+    }
+    int expectedXSamples = grid->xSamples;
+    int expectedYSamples = grid->ySamples;
+    grid->xSamples = 0;
+    grid->ySamples = 0;
+    grid->heights.clear();
+    if (expectedXSamples > 0 && expectedYSamples > 0) grid->heights.reserve(size_t(expectedXSamples) * size_t(expectedYSamples));
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        const char *ptr = line.c_str();
+        char *end;
+        int count = 0;
+        while (true)
+        {
+            // values can be separated by white space or commas
+            while (*ptr == ' ' || *ptr == '\t' || *ptr == ',' || *ptr == '\r') ptr++;
+            if (*ptr == 0) break;
+            double v = strtod(ptr, &end);
+            if (end == ptr)
+            {
+                std::cerr << "Error: HeightfieldGeom::ReadTextGrid(" << filename << ") - Cannot read row " << grid->ySamples + 1 << "\n";
+                return true;
+            }
+            grid->heights.push_back(v);
+            ptr = end;
+            count++;
+        }
+        if (count == 0) continue;
+        if (grid->ySamples == 0) grid->xSamples = count;
+        if (count != grid->xSamples)
+        {
+            std::cerr << "Error: HeightfieldGeom::ReadTextGrid(" << filename << ") - Row " << grid->ySamples + 1 << " has " << count << " values, expected " << grid->xSamples << "\n";
+            return true;
+        }
+        grid->ySamples++;
+    }
+
+    if ((expectedXSamples > 0 && expectedXSamples != grid->xSamples) || (expectedYSamples > 0 && expectedYSamples != grid->ySamples))
+    {
+        std::cerr << "Error: HeightfieldGeom::ReadTextGrid(" << filename << ") - Grid is " << grid->xSamples << " x " << grid->ySamples <<
+                     ", expected " << expectedXSamples << " x " << expectedYSamples << "\n";
+        return true;
+    }
+    return false;
+}
+
+// native byte order 32 bit floats or 16 bit signed integers with no header
+// returns true on error
+bool HeightfieldGeom::ReadBinaryGrid(const std::string &filename, GridFormat format, Grid *grid)
+{
+    if (grid->xSamples <= 0 || grid->ySamples <= 0)
+    {
+        std::cerr << "Error: HeightfieldGeom::ReadBinaryGrid(" << filename << ") - Binary grids need the number of samples\n";
+        return true;
+    }
+    size_t numSamples = size_t(grid->xSamples) * size_t(grid->ySamples);
+    size_t sampleSize = (format == FloatFormat) ? sizeof(float) : sizeof(int16_t);
+
+    FILE *file = fopen(filename.c_str(), "rb");
+    if (file == 0)
+    {
+        std::cerr << "Error: HeightfieldGeom::ReadBinaryGrid(" << filename << ") - Cannot open file\n";
+        return true;
+    }
+    std::vector<char> data(numSamples * sampleSize);
+    size_t n = fread(data.data(), sampleSize, numSamples, file);
+    fclose(file);
+    if (n != numSamples)
+    {
+        std::cerr << "Error: HeightfieldGeom::ReadBinaryGrid(" << filename << ") - File too short\n";
+        return true;
+    }
+
+    grid->heights.resize(numSamples);
+    if (format == FloatFormat)
+    {
+        const float *samples = reinterpret_cast<const float *>(data.data());
+        for (size_t i = 0; i < numSamples; i++) grid->heights[i] = samples[i];
+    }
+    else
+    {
+        const int16_t *samples = reinterpret_cast<const int16_t *>(data.data());
+        for (size_t i = 0; i < numSamples; i++) grid->heights[i] = samples[i];
+    }
+    return false;
+}
+
+bool HeightfieldGeom::GridKey::operator<(const GridKey &other) const
+{
+    if (filename != other.filename) return filename < other.filename;
+    if (modificationTime != other.modificationTime) return modificationTime < other.modificationTime;
+    if (fileSize != other.fileSize) return fileSize < other.fileSize;
+    if (format != other.format) return format < other.format;
+    if (xSamples != other.xSamples) return xSamples < other.xSamples;
+    return ySamples < other.ySamples;
+}
+
+#ifdef USE_QT
+void HeightfieldGeom::Draw(SimulationWindow *window)
+{
+    if (m_Visible == false) return;
+
+    // perform late initialisation
+    // the terrain does not move so it is built in world coordinates
+    if (m_FirstDraw)
+    {
+        m_FirstDraw = false;
+        m_physRep = new FacetedObject();
+        int nx = m_Grid->xSamples, ny = m_Grid->ySamples;
+        double dx = m_SizeX / (nx - 1), dy = m_SizeY / (ny - 1);
+        double x0 = m_Position[0] - m_SizeX / 2, y0 = m_Position[1] + m_SizeY / 2;
+        const double *h = m_Grid->heights.data();
+        double triangle[9];
+        for (int j = 0; j < ny - 1; j++)
+        {
+            for (int i = 0; i < nx - 1; i++)
+            {
+                // corners are named by their offsets in the grid and row j + 1 is at lower Y
+                double v00[3] = {x0 + i * dx, y0 - j * dy, m_Position[2] + h[j * nx + i] * m_Scale + m_Offset};
+                double v10[3] = {x0 + (i + 1) * dx, y0 - j * dy, m_Position[2] + h[j * nx + i + 1] * m_Scale + m_Offset};
+                double v01[3] = {x0 + i * dx, y0 - (j + 1) * dy, m_Position[2] + h[(j + 1) * nx + i] * m_Scale + m_Offset};
+                double v11[3] = {x0 + (i + 1) * dx, y0 - (j + 1) * dy, m_Position[2] + h[(j + 1) * nx + i + 1] * m_Scale + m_Offset};
+                // anticlockwise viewed from above
+                std::copy(v01, v01 + 3, triangle); std::copy(v11, v11 + 3, triangle + 3); std::copy(v10, v10 + 3, triangle + 6);
+                m_physRep->AddTriangle(triangle);
+                std::copy(v01, v01 + 3, triangle); std::copy(v10, v10 + 3, triangle + 3); std::copy(v00, v00 + 3, triangle + 6);
+                m_physRep->AddTriangle(triangle);
+            }
+        }
+        m_physRep->WeldVertices();
+        m_physRep->setSimulationWindow(window);
+    }
+
+    m_physRep->SetColour(m_Colour);
+    m_physRep->Draw();
+}
+#endif
@@ -0,0 +1,96 @@
+/*
+ *  HeightfieldGeom.h
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+// HeightfieldGeom is an uneven terrain made from a regular grid of heights and
+// uses the ODE heightfield collider so a contact test is a grid lookup rather
+// than a search of a triangle mesh. The grid is read from a text file (one row
+// of heights per line) or a raw binary file of floats or shorts and the first
+// row is the most positive Y so that the file reads like a map. The heights
+// are along the world Z axis and the grid is centred on the given position.
+// Grids are cached for the lifetime of the process and the ODE data refers to
+// the cached heights directly so reloading a model does not reread the file.
+
+#ifndef HeightfieldGeom_h
+#define HeightfieldGeom_h
+
+#include "Geom.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class HeightfieldGeom : public Geom
+{
+public:
+
+    enum GridFormat { TextFormat = 0, FloatFormat, ShortFormat };
+
+    struct Grid
+    {
+        int xSamples;
+        int ySamples;
+        std::vector<double> heights; // ySamples rows of xSamples values, first row is maximum Y
+    };
+
+    // sizeX and sizeY are the total extent of the grid, heights are height * scale + offset
+    // thickness adds a solid block under the lowest point so that objects cannot fall through
+    HeightfieldGeom(dSpaceID space, const std::shared_ptr<const Grid> &grid, double sizeX, double sizeY,
+                    double scale, double offset, double thickness, double x, double y, double z);
+    virtual ~HeightfieldGeom();
+
+    // returns the grid, reading it in if necessary
+    // for the binary formats xSamples and ySamples must be set and for text they are checked if non-zero
+    // returns a null pointer if the file cannot be read
+    static std::shared_ptr<const Grid> GetGrid(const std::string &filename, GridFormat format, int xSamples, int ySamples);
+    static void ClearGridCache();
+
+    // only used when the model is written out
+    void SetFilename(const std::string &filename, GridFormat format) { m_Filename = filename; m_Format = format; }
+
+#ifdef USE_QT
+    virtual void Draw(SimulationWindow *window);
+#endif
+
+    friend class Environment;
+
+protected:
+
+    struct GridKey
+    {
+        std::string filename;
+        long long modificationTime;
+        long long fileSize;
+        GridFormat format;
+        int xSamples;
+        int ySamples;
+
+        bool operator<(const GridKey &other) const;
+    };
+
+    static bool ReadTextGrid(const std::string &filename, Grid *grid);
+    static bool ReadBinaryGrid(const std::string &filename, GridFormat format, Grid *grid);
+
+    std::shared_ptr<const Grid> m_Grid;
+    dHeightfieldDataID m_HeightfieldDataID;
+    std::string m_Filename;
+    GridFormat m_Format;
+    double m_SizeX;
+    double m_SizeY;
+    double m_Scale;
+    double m_Offset;
+    double m_Thickness;
+    double m_Position[3];
+
+    static std::map<GridKey, std::shared_ptr<const Grid> > m_GridCache;
+    static std::mutex m_GridCacheMutex;
+};
+
+#endif
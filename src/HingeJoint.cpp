@@ -19,6 +19,7 @@
 #include "Body.h"
 #include "Simulation.h"
 #include "DebugControl.h"
+#include "Trace.h"
 #include "PGDMath.h"
 
 #ifdef USE_QT
@@ -254,11 +255,11 @@ void HingeJoint::CalculateStopTorque()
         t = (loStop - angle) * kp;
     }
 
-    if (gDebug == HingeJointDebug)
+    if (TRACE_ON(HingeJointDebug))
     {
         if (DebugFilters("GetStopTorque", m_Name))
-            // std::cerr << m_Name << " angle " << GetHingeAngle() << " dangle " << GetHingeAngleRate() << " kp " << kp << " kd " << kd << " t " << t << "\n";
-            std::cerr << m_Name << " loStop " <<  loStop + m_StartAngleReference <<  " hiStop " <<  hiStop + m_StartAngleReference <<  " angle " << GetHingeAngle() << " kp " << kp << " t " << t << "\n";
+            Trace::Record(HingeJointStopTorqueEvent, m_Name,
+                          {loStop + m_StartAngleReference, hiStop + m_StartAngleReference, GetHingeAngle(), kp, t});
     }
 #endif
 
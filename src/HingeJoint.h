@@ -45,6 +45,7 @@ public:
         m_HiStopTorqueLimit = hiStopTorqueLimit;
     }
     int TestLimits();
+    bool HasTorqueLimits() { return m_LoStopTorqueLimit > -dInfinity || m_HiStopTorqueLimit < dInfinity; }
     void SetStopTorqueWindow(int window);
 
     virtual void Update();
@@ -17,6 +17,7 @@
 #include "Strap.h"
 #include "MAMuscle.h"
 #include "DebugControl.h"
+#include "Trace.h"
 #include "Simulation.h"
 
 // constructor
@@ -70,18 +71,10 @@ void MAMuscle::SetAlpha(double alpha)
     fCE = m_Alpha * fFull;
     m_Strap->SetTension(fCE);
 
-    if (gDebug == MAMuscleDebug)
+    if (TRACE_ON(MAMuscleDebug))
     {
-        *gDebugStream << "MAMuscle::SetAlpha " << m_Name <<
-        " alpha " << alpha <<
-        " m_Alpha " << m_Alpha <<
-        " m_F0 " << m_F0 <<
-        " m_VMax " << m_VMax <<
-        " m_Velocity " << m_Strap->GetVelocity() <<
-        " fFull " << fFull <<
-        " m_Length " << m_Strap->GetLength() <<
-        " fCE " << fCE <<
-        "\n";
+        Trace::Record(MAMuscleSetAlphaEvent, m_Name,
+                      {alpha, m_Alpha, m_F0, m_VMax, m_Strap->GetVelocity(), fFull, m_Strap->GetLength(), fCE});
     }
 }
 
@@ -103,19 +96,21 @@ double MAMuscle::GetMetabolicPower()
     double sigma = (0.054 + 0.506 * relV + 2.46 * relVSquared) /
         (1 - 1.13 * relV + 12.8 * relVSquared - 1.64 * relVCubed);
 
-    if (gDebug == MAMuscleDebug)
+    if (TRACE_ON(MAMuscleDebug))
     {
-        *gDebugStream << "MAMuscle::GetMetabolicPower " << m_Name <<
-        " m_Alpha " << m_Alpha <<
-        " m_F0 " << m_F0 <<
-        " m_VMax " << m_VMax <<
-        " m_Velocity " << m_Strap->GetVelocity() <<
-        " sigma " << sigma <<
-        " power " << m_Alpha * m_F0 * m_VMax * sigma << "\n";
+        Trace::Record(MAMuscleMetabolicPowerEvent, m_Name,
+                      {m_Alpha, m_F0, m_VMax, m_Strap->GetVelocity(), sigma, m_Alpha * m_F0 * m_VMax * sigma});
     }
     return (m_Alpha * m_F0 * m_VMax * sigma);
 }
 
+// there is no elastic element so only the power terms are recorded
+void MAMuscle::AccumulateEnergy(EnergyAccounts *accounts, int muscleIndex, double timeIncrement)
+{
+    accounts->AddMechanicalPower(muscleIndex, GetPower(), timeIncrement);
+    accounts->AddMetabolicPower(muscleIndex, GetMetabolicPower(), timeIncrement);
+}
+
 void MAMuscle::Dump()
 {
     if (m_Dump == false) return;
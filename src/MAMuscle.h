@@ -37,6 +37,7 @@ public:
     virtual void SetActivation(double activation, double /* duration */) { SetAlpha(activation); }
     virtual double GetActivation() { return m_Alpha; }
     virtual double GetElasticEnergy() { return 0; }
+    virtual void AccumulateEnergy(EnergyAccounts *accounts, int muscleIndex, double timeIncrement);
 
     virtual void Dump();
 
@@ -23,6 +23,7 @@
 #include "Strap.h"
 #include "MAMuscleComplete.h"
 #include "DebugControl.h"
+#include "Trace.h"
 #include "Simulation.h"
 
 static double CalculateForceError (double lce, void *params);
@@ -78,7 +79,6 @@ MAMuscleComplete::MAMuscleComplete(Strap *strap): Muscle(strap)
     m_Tolerance = 1e-8; // solution tolerance (m) - small because the serial tendons are quite stiff
     m_MaxIter = 100; // max iterations to find solution
 
-    m_SetActivationFirstTimeFlag = true;
 
 }
 
@@ -383,82 +383,19 @@ void MAMuscleComplete::SetActivation(double activation, double timeIncrement)
 
     m_Strap->SetTension(m_Params.fse);
 
-    if (gDebug == MAMuscleCompleteDebug)
+    if (TRACE_ON(MAMuscleCompleteDebug))
     {
         if (DebugFilters("SetActivation", m_Name))
         {
-            if (m_SetActivationFirstTimeFlag) // only happens once
-            {
-                m_SetActivationFirstTimeFlag = false;
-                *gDebugStream << "MAMuscleComplete::SetActivation " <<
-                                 " " << "spe" <<  // slack length parallel element (m)
-                                 " " << "epe" <<  // elastic constant parallel element (N/m)
-                                 " " << "dpe" <<  // damping constant parallel element (N/m)
-                                 " " << "smpe" << // strain model for parallel element
-                                 " " << "sse" <<  // slack length serial element (m)
-                                 " " << "ese" <<  // elastic constant serial element (N/m)
-                                 " " << "dse" <<  // damping constant serial element (N/m)
-                                 " " << "smse" << // strain model for serial element
-                                 " " << "k" <<  // shape constant
-                                 " " << "vmax" <<  // maximum shortening velocity (m/s)
-                                 " " << "fmax" <<  // maximum isometric force (N)
-                                 " " << "width" <<  // relative width of length/tension peak
-
-                                 // variable input parameters
-                                 " " << "alpha" <<  // proportion of muscle activated
-                                 " " << "timeIncrement" <<  // inegration step size for simulation (s)
-                                 " " << "len" <<  // length of the whole element (m)
-                                 " " << "v" <<  // contraction velocity of the whole element (m/s)
-                                 " " << "lastlpe" <<  // last calculated lpe value (m)
-
-                                 // output parameters
-                                 " " << "fce" <<  // contractile force (N)
-                                 " " << "lpe" <<  // contractile and parallel length (m)
-                                 " " << "fpe" <<  // parallel element force (N)
-                                 " " << "lse" <<  // serial length (m)
-                                 " " << "fse" <<  // serial element force (N)
-                                 " " << "vce" <<  // contractile element velocity (m/s)
-                                 " " << "vse" <<  // serial element velocity (m/s)
-                                 " " << "targetFce" <<  // fce calculated from elastic elements (N)
-                                 " " << "f0" <<  // length corrected fmax (N)
-                                 " " << "err" <<  // error term in lpe (m)
-
-                                 "\n";
-            }
-
-            *gDebugStream << m_Name <<
-                             " " << m_Params.spe <<  // slack length parallel element (m)
-                             " " << m_Params.epe <<  // elastic constant parallel element (N/m)
-                             " " << m_Params.dpe <<  // damping constant parallel element (N/m)
-                             " " << m_Params.smpe << // strain model for parallel element
-                             " " << m_Params.sse <<  // slack length serial element (m)
-                             " " << m_Params.ese <<  // elastic constant serial element (N/m)
-                             " " << m_Params.dse <<  // damping constant serial element (N/m)
-                             " " << m_Params.smse << // strain model for serial element
-                             " " << m_Params.k <<  // shape constant
-                             " " << m_Params.vmax <<  // maximum shortening velocity (m/s)
-                             " " << m_Params.fmax <<  // maximum isometric force (N)
-                             " " << m_Params.width <<  // relative width of length/tension peak
-
-                             // variable input parameters
-                             " " << m_Params.alpha <<  // proportion of muscle activated
-                             " " << m_Params.timeIncrement <<  // inegration step size for simulation (s)
-                             " " << m_Params.len <<  // length of the whole element (m)
-                             " " << m_Params.v <<  // contraction velocity of the whole element (m/s)
-                             " " << m_Params.lastlpe <<  // last calculated lpe value (m)
-
-                             // output parameters
-                             " " << m_Params.fce <<  // contractile force (N)
-                             " " << m_Params.lpe <<  // contractile and parallel length (m)
-                             " " << m_Params.fpe <<  // parallel element force (N)
-                             " " << m_Params.lse <<  // serial length (m)
-                             " " << m_Params.fse <<  // serial element force (N)
-                             " " << m_Params.vce <<  // contractile element velocity (m/s)
-                             " " << m_Params.vse <<  // serial element velocity (m/s)
-                             " " << m_Params.targetFce <<  // fce calculated from elastic elements (N)
-                             " " << m_Params.f0 <<  // length corrected fmax (N)
-                             " " << m_Params.err <<  // error term in lpe (m)
-                             "\n";
+            Trace::Record(MAMuscleCompleteActivationEvent, m_Name,
+                          {m_Params.spe, m_Params.epe, m_Params.dpe, double(m_Params.smpe),
+                           m_Params.sse, m_Params.ese, m_Params.dse, double(m_Params.smse),
+                           m_Params.k, m_Params.vmax, m_Params.fmax, m_Params.width,
+                           // variable input parameters
+                           m_Params.alpha, m_Params.timeIncrement, m_Params.len, m_Params.v, m_Params.lastlpe,
+                           // output parameters
+                           m_Params.fce, m_Params.lpe, m_Params.fpe, m_Params.lse, m_Params.fse,
+                           m_Params.vce, m_Params.vse, m_Params.targetFce, m_Params.f0, m_Params.err});
         }
     }
 }
@@ -483,18 +420,11 @@ double MAMuscleComplete::GetMetabolicPower()
 
     double power = m_Params.alpha * m_Params.f0 * m_Params.vmax * sigma;
 
-    if (gDebug == MAMuscleCompleteDebug)
+    if (TRACE_ON(MAMuscleCompleteDebug))
     {
         if (DebugFilters("GetMetabolicPower", m_Name))
-        {
-            *gDebugStream << "MAMuscle::GetMetabolicPower " << m_Name <<
-            " alpha " << m_Params.alpha <<
-            " f0 " << m_Params.f0 <<
-            " vmax " << m_Params.vmax <<
-            " m_Velocity " << m_Strap->GetVelocity() <<
-            " sigma " << sigma <<
-            " power " << power << "\n";
-        }
+            Trace::Record(MAMuscleCompleteMetabolicPowerEvent, m_Name,
+                          {m_Params.alpha, m_Params.f0, m_Params.vmax, m_Strap->GetVelocity(), sigma, power});
     }
     return (power);
 }
@@ -637,6 +567,13 @@ double CalculateForceError (double lce, void *params)
 
 }
 
+void MAMuscleComplete::AccumulateEnergy(EnergyAccounts *accounts, int muscleIndex, double timeIncrement)
+{
+    Muscle::AccumulateEnergy(accounts, muscleIndex, timeIncrement);
+    accounts->AddElementWork(muscleIndex, GetVCE(), GetFCE(), GetVSE(), GetFSE(), GetVPE(), GetFPE(), timeIncrement);
+    if (accounts->GetRecordElasticEnergy()) accounts->SetElementEnergies(muscleIndex, GetESE(), GetEPE());
+}
+
 void MAMuscleComplete::Dump()
 {
     if (m_Dump == false) return;
@@ -111,6 +111,7 @@ public:
 
     virtual void Dump();
     virtual void LateInitialisation();
+    virtual void AccumulateEnergy(EnergyAccounts *accounts, int muscleIndex, double timeIncrement);
 
 protected:
 
@@ -130,7 +131,6 @@ protected:
     double m_Tolerance;
     int m_MaxIter;
 
-    int m_SetActivationFirstTimeFlag;
 
 };
 
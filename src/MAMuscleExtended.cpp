@@ -17,6 +17,7 @@
 #include "SimpleStrap.h"
 #include "MAMuscleExtended.h"
 #include "DebugControl.h"
+#include "Trace.h"
 #include "Simulation.h"
 
 // defines for Mathematica CForm output
@@ -52,7 +53,6 @@ MAMuscleExtended::MAMuscleExtended(Strap *strap): Muscle(strap)
 
     lastlpe = -1; // last parallel element length (m) flag value to show that the previous length of the parallel element has not been set
 
-    m_SetActivationFirstTimeFlag = true;
 
 }
 
@@ -472,51 +472,15 @@ void MAMuscleExtended::CalculateForceWithParallelElement(double timeIncrement)
     lastlpe = lpe;
     m_Strap->SetTension(fse);
 
-    if (gDebug == MAMuscleExtendedDebug)
+    if (TRACE_ON(MAMuscleExtendedDebug))
     {
         if (DebugFilters("SetActivation", m_Name))
         {
-            static int m_SetActivationFirstTimeFlag = true;
-            if (m_SetActivationFirstTimeFlag) // only happens once
-            {
-                m_SetActivationFirstTimeFlag = false;
-                *gDebugStream << "MAMuscleExtended::SetActivation " <<
-                        " progress " <<
-                        " m_Stim " <<
-                        " m_Act " <<
-                        " len " <<
-                        " fpe " <<
-                        " lpe " <<
-                        " lse " <<
-                        " fse " <<
-                        " fce " <<
-                        " m_Velocity " <<
-                        " m_Tension " <<
-                        " vce " <<
-                        " serialStrainEnergy " <<
-                        " parallelStrainEnergy " <<
-                        "\n";
-            }
-
             double serialStrainEnergy = 0.5 * (lse - sse) * (lse - sse) * ese;
             double parallelStrainEnergy = 0.5 * (lpe - spe) * (lpe - spe) * epe;
-
-            *gDebugStream << m_Name <<
-                    " " << progress <<
-                    " " << m_Stim <<
-                    " " << m_Act <<
-                    " " << len <<
-                    " " << fpe <<
-                    " " << lpe <<
-                    " " << lse <<
-                    " " << fse <<
-                    " " << fce <<
-                    " " << m_Strap->GetVelocity() <<
-                    " " << m_Strap->GetTension() <<
-                    " " << vce <<
-                    " " << serialStrainEnergy <<
-                    " " << parallelStrainEnergy <<
-                    "\n";
+            Trace::Record(MAMuscleExtendedActivationEvent, m_Name,
+                          {double(progress), m_Stim, m_Act, len, fpe, lpe, lse, fse, fce,
+                           m_Strap->GetVelocity(), m_Strap->GetTension(), vce, serialStrainEnergy, parallelStrainEnergy});
         }
     }
 }
@@ -620,50 +584,15 @@ void MAMuscleExtended::CalculateForceWithoutParallelElement(double timeIncrement
     lastlpe = lpe;
     m_Strap->SetTension(fse);
 
-    if (gDebug == MAMuscleExtendedDebug)
+    if (TRACE_ON(MAMuscleExtendedDebug))
     {
         if (DebugFilters("SetActivation", m_Name))
         {
-            if (m_SetActivationFirstTimeFlag) // only happens once
-            {
-                m_SetActivationFirstTimeFlag = false;
-                *gDebugStream << "MAMuscleExtended::SetActivation " <<
-                        " progress " <<
-                        " m_Stim " <<
-                        " m_Act " <<
-                        " len " <<
-                        " fpe " <<
-                        " lpe " <<
-                        " lse " <<
-                        " fse " <<
-                        " fce " <<
-                        " m_Velocity " <<
-                        " m_Tension " <<
-                        " vce " <<
-                        " serialStrainEnergy " <<
-                        " parallelStrainEnergy " <<
-                        "\n";
-            }
-
             double serialStrainEnergy = 0.5 * (lse - sse) * (lse - sse) * ese;
             double parallelStrainEnergy = 0.5 * (lpe - spe) * (lpe - spe) * epe;
-
-            *gDebugStream << m_Name <<
-                    " " << progress <<
-                    " " << m_Stim <<
-                    " " << m_Act <<
-                    " " << len <<
-                    " " << fpe <<
-                    " " << lpe <<
-                    " " << lse <<
-                    " " << fse <<
-                    " " << fce <<
-                    " " << m_Strap->GetVelocity() <<
-                    " " << m_Strap->GetTension() <<
-                    " " << vce <<
-                    " " << serialStrainEnergy <<
-                    " " << parallelStrainEnergy <<
-                    "\n";
+            Trace::Record(MAMuscleExtendedActivationEvent, m_Name,
+                          {double(progress), m_Stim, m_Act, len, fpe, lpe, lse, fse, fce,
+                           m_Strap->GetVelocity(), m_Strap->GetTension(), vce, serialStrainEnergy, parallelStrainEnergy});
         }
     }
 }
@@ -687,22 +616,22 @@ double MAMuscleExtended::GetMetabolicPower()
     double sigma = (0.054 + 0.506 * relV + 2.46 * relVSquared) /
                    (1 - 1.13 * relV + 12.8 * relVSquared - 1.64 * relVCubed);
 
-    if (gDebug == MAMuscleExtendedDebug)
+    if (TRACE_ON(MAMuscleExtendedDebug))
     {
         if (DebugFilters("GetMetabolicPower", m_Name))
-        {
-            *gDebugStream << "MAMuscle::GetMetabolicPower " << m_Name <<
-                    " m_Act " << m_Act <<
-                    " f0 " << f0 <<
-                    " vmax " << vmax <<
-                    " m_Velocity " << m_Strap->GetVelocity() <<
-                    " sigma " << sigma <<
-                    " power " << m_Act * f0 * vmax * sigma << "\n";
-        }
+            Trace::Record(MAMuscleExtendedMetabolicPowerEvent, m_Name,
+                          {m_Act, f0, vmax, m_Strap->GetVelocity(), sigma, m_Act * f0 * vmax * sigma});
     }
     return (m_Act * f0 * vmax * sigma);
 }
 
+void MAMuscleExtended::AccumulateEnergy(EnergyAccounts *accounts, int muscleIndex, double timeIncrement)
+{
+    Muscle::AccumulateEnergy(accounts, muscleIndex, timeIncrement);
+    accounts->AddElementWork(muscleIndex, GetVCE(), GetFCE(), GetVSE(), GetFSE(), GetVPE(), GetFPE(), timeIncrement);
+    if (accounts->GetRecordElasticEnergy()) accounts->SetElementEnergies(muscleIndex, GetESE(), GetEPE());
+}
+
 void MAMuscleExtended::Dump()
 {
     if (m_Dump == false) return;
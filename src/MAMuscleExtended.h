@@ -65,6 +65,7 @@ public:
 
     virtual void Dump();
     virtual void LateInitialisation();
+    virtual void AccumulateEnergy(EnergyAccounts *accounts, int muscleIndex, double timeIncrement);
 
 protected:
 
@@ -95,7 +96,6 @@ protected:
     void CalculateForceWithParallelElement(double timeIncrement);
     void CalculateForceWithoutParallelElement(double timeIncrement);
 
-    int m_SetActivationFirstTimeFlag;
 
 };
 
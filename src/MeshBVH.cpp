@@ -0,0 +1,225 @@
+/*
+ *  MeshBVH.cpp
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "MeshBVH.h"
+
+MeshBVH::MeshBVH()
+{
+    m_LeafSize = 4;
+}
+
+// builds the tree by splitting at the median centroid along the longest axis
+// which is O(n log n) and gives a balanced tree
+void MeshBVH::Build(const float *vertices, int numTriangles)
+{
+    m_Nodes.clear();
+    m_Vertices.clear();
+    if (numTriangles <= 0) return;
+
+    std::vector<float> centroids(3 * numTriangles);
+    std::vector<int> order(numTriangles);
+    for (int i = 0; i < numTriangles; i++)
+    {
+        const float *t = vertices + 9 * i;
+        centroids[3 * i] = (t[0] + t[3] + t[6]) / 3;
+        centroids[3 * i + 1] = (t[1] + t[4] + t[7]) / 3;
+        centroids[3 * i + 2] = (t[2] + t[5] + t[8]) / 3;
+        order[i] = i;
+    }
+
+    m_Nodes.reserve(2 * (numTriangles / m_LeafSize + 1));
+    m_Nodes.push_back(Node());
+    BuildNode(0, 0, numTriangles, &order, centroids, vertices);
+
+    // store the triangles in leaf order
+    m_Vertices.resize(9 * numTriangles);
+    for (int i = 0; i < numTriangles; i++)
+        std::copy(vertices + 9 * order[i], vertices + 9 * order[i] + 9, m_Vertices.begin() + 9 * i);
+}
+
+int MeshBVH::BuildNode(int nodeIndex, int start, int count, std::vector<int> *order, const std::vector<float> &centroids, const float *vertices)
+{
+    int i, j;
+    float boxMin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float boxMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    float centroidMin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float centroidMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (i = start; i < start + count; i++)
+    {
+        const float *t = vertices + 9 * (*order)[i];
+        const float *c = &centroids[3 * (*order)[i]];
+        for (j = 0; j < 3; j++)
+        {
+            boxMin[j] = std::min(boxMin[j], std::min(t[j], std::min(t[j + 3], t[j + 6])));
+            boxMax[j] = std::max(boxMax[j], std::max(t[j], std::max(t[j + 3], t[j + 6])));
+            centroidMin[j] = std::min(centroidMin[j], c[j]);
+            centroidMax[j] = std::max(centroidMax[j], c[j]);
+        }
+    }
+    for (j = 0; j < 3; j++)
+    {
+        m_Nodes[nodeIndex].boxMin[j] = boxMin[j];
+        m_Nodes[nodeIndex].boxMax[j] = boxMax[j];
+    }
+
+    int axis = 0;
+    if (centroidMax[1] - centroidMin[1] > centroidMax[axis] - centroidMin[axis]) axis = 1;
+    if (centroidMax[2] - centroidMin[2] > centroidMax[axis] - centroidMin[axis]) axis = 2;
+
+    // leaf if small enough or if all the centroids coincide and cannot be split
+    if (count <= m_LeafSize || centroidMax[axis] <= centroidMin[axis])
+    {
+        m_Nodes[nodeIndex].start = start;
+        m_Nodes[nodeIndex].count = count;
+        return nodeIndex;
+    }
+
+    int mid = start + count / 2;
+    std::nth_element(order->begin() + start, order->begin() + mid, order->begin() + start + count,
+                     [&centroids, axis](int a, int b) { return centroids[3 * a + axis] < centroids[3 * b + axis]; });
+
+    int left = int(m_Nodes.size());
+    m_Nodes.push_back(Node());
+    m_Nodes.push_back(Node());
+    m_Nodes[nodeIndex].start = left;
+    m_Nodes[nodeIndex].count = 0;
+    BuildNode(left, start, mid - start, order, centroids, vertices);
+    BuildNode(left + 1, mid, start + count - mid, order, centroids, vertices);
+    return nodeIndex;
+}
+
+bool MeshBVH::IntersectRay(const float origin[3], const float direction[3], float maxT, float *hitT, int *hitTriangle) const
+{
+    if (m_Nodes.size() == 0) return false;
+
+    float inverseDirection[3];
+    for (int j = 0; j < 3; j++) inverseDirection[j] = (direction[j] != 0) ? 1 / direction[j] : FLT_MAX;
+
+    float bestT = maxT;
+    int bestTriangle = -1;
+    float tEntry, tLeft, tRight, t;
+
+    int stack[128]; // balanced tree so the depth is about log2(n / leafSize)
+    int stackSize = 0;
+    if (IntersectBox(origin, inverseDirection, m_Nodes[0].boxMin, m_Nodes[0].boxMax, bestT, &tEntry)) stack[stackSize++] = 0;
+    while (stackSize)
+    {
+        const Node &node = m_Nodes[stack[--stackSize]];
+        if (node.count)
+        {
+            for (int i = node.start; i < node.start + node.count; i++)
+            {
+                if (IntersectTriangle(origin, direction, &m_Vertices[9 * i], &t) && t <= bestT)
+                {
+                    bestT = t;
+                    bestTriangle = i;
+                }
+            }
+            continue;
+        }
+        // push the nearer child last so that it is visited first and shrinks bestT early
+        bool hitLeft = IntersectBox(origin, inverseDirection, m_Nodes[node.start].boxMin, m_Nodes[node.start].boxMax, bestT, &tLeft);
+        bool hitRight = IntersectBox(origin, inverseDirection, m_Nodes[node.start + 1].boxMin, m_Nodes[node.start + 1].boxMax, bestT, &tRight);
+        if (hitLeft && hitRight)
+        {
+            if (tLeft < tRight) { stack[stackSize++] = node.start + 1; stack[stackSize++] = node.start; }
+            else { stack[stackSize++] = node.start; stack[stackSize++] = node.start + 1; }
+        }
+        else if (hitLeft) stack[stackSize++] = node.start;
+        else if (hitRight) stack[stackSize++] = node.start + 1;
+    }
+
+    if (bestTriangle < 0) return false;
+    *hitT = bestT;
+    if (hitTriangle) *hitTriangle = bestTriangle;
+    return true;
+}
+
+void MeshBVH::GetTrianglesInBox(const float boxMin[3], const float boxMax[3], std::vector<int> *triangleList) const
+{
+    if (m_Nodes.size() == 0) return;
+
+    int stack[128];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize)
+    {
+        const Node &node = m_Nodes[stack[--stackSize]];
+        if (node.boxMin[0] > boxMax[0] || node.boxMax[0] < boxMin[0] ||
+                node.boxMin[1] > boxMax[1] || node.boxMax[1] < boxMin[1] ||
+                node.boxMin[2] > boxMax[2] || node.boxMax[2] < boxMin[2]) continue;
+        if (node.count)
+        {
+            for (int i = node.start; i < node.start + node.count; i++) triangleList->push_back(i);
+            continue;
+        }
+        stack[stackSize++] = node.start;
+        stack[stackSize++] = node.start + 1;
+    }
+}
+
+void MeshBVH::GetBounds(float boxMin[3], float boxMax[3]) const
+{
+    for (int j = 0; j < 3; j++)
+    {
+        boxMin[j] = m_Nodes.size() ? m_Nodes[0].boxMin[j] : 0;
+        boxMax[j] = m_Nodes.size() ? m_Nodes[0].boxMax[j] : 0;
+    }
+}
+
+// slab test
+bool MeshBVH::IntersectBox(const float origin[3], const float inverseDirection[3], const float boxMin[3], const float boxMax[3], float maxT, float *tEntry)
+{
+    float tMin = 0, tMax = maxT;
+    for (int j = 0; j < 3; j++)
+    {
+        float t0 = (boxMin[j] - origin[j]) * inverseDirection[j];
+        float t1 = (boxMax[j] - origin[j]) * inverseDirection[j];
+        if (t0 > t1) std::swap(t0, t1);
+        if (t0 > tMin) tMin = t0;
+        if (t1 < tMax) tMax = t1;
+        if (tMin > tMax) return false;
+    }
+    *tEntry = tMin;
+    return true;
+}
+
+// Moller-Trumbore ray triangle intersection (double sided)
+bool MeshBVH::IntersectTriangle(const float origin[3], const float direction[3], const float *triangle, float *t)
+{
+    const float epsilon = 1e-12f;
+    float e1[3], e2[3], p[3], s[3], q[3];
+    for (int j = 0; j < 3; j++)
+    {
+        e1[j] = triangle[3 + j] - triangle[j];
+        e2[j] = triangle[6 + j] - triangle[j];
+        s[j] = origin[j] - triangle[j];
+    }
+    p[0] = direction[1] * e2[2] - direction[2] * e2[1];
+    p[1] = direction[2] * e2[0] - direction[0] * e2[2];
+    p[2] = direction[0] * e2[1] - direction[1] * e2[0];
+    float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+    if (std::fabs(det) < epsilon) return false;
+    float inverseDet = 1 / det;
+    float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverseDet;
+    if (u < 0 || u > 1) return false;
+    q[0] = s[1] * e1[2] - s[2] * e1[1];
+    q[1] = s[2] * e1[0] - s[0] * e1[2];
+    q[2] = s[0] * e1[1] - s[1] * e1[0];
+    float v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * inverseDet;
+    if (v < 0 || u + v > 1) return false;
+    float tHit = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inverseDet;
+    if (tHit < 0) return false;
+    *t = tHit;
+    return true;
+}
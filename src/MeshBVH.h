@@ -0,0 +1,59 @@
+/*
+ *  MeshBVH.h
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+// MeshBVH is a bounding volume hierarchy over a triangle soup. It is built
+// once in the mesh local coordinate system and then answers ray and box
+// queries in roughly log(n) time so that picking stays interactive even with
+// very large meshes. The triangles are copied into the node order so that a
+// leaf is a contiguous block of memory.
+
+#ifndef MeshBVH_h
+#define MeshBVH_h
+
+#include <vector>
+
+class MeshBVH
+{
+public:
+    MeshBVH();
+
+    // vertices are 9 floats per triangle (x0 y0 z0 x1 y1 z1 x2 y2 z2)
+    void Build(const float *vertices, int numTriangles);
+
+    // returns true if the ray origin + t * direction (0 <= t <= maxT) hits a triangle
+    // hitT and hitTriangle are only set if there is a hit and hitTriangle can be null
+    bool IntersectRay(const float origin[3], const float direction[3], float maxT, float *hitT, int *hitTriangle) const;
+
+    // appends the triangles whose bounding boxes overlap the box
+    void GetTrianglesInBox(const float boxMin[3], const float boxMax[3], std::vector<int> *triangleList) const;
+
+    int GetNumTriangles() const { return int(m_Vertices.size() / 9); }
+    const float *GetTriangle(int i) const { return &m_Vertices[9 * i]; }
+    void GetBounds(float boxMin[3], float boxMax[3]) const;
+
+    static bool IntersectTriangle(const float origin[3], const float direction[3], const float *triangle, float *t);
+
+private:
+    struct Node
+    {
+        float boxMin[3];
+        float boxMax[3];
+        int start; // first triangle for a leaf, left child for an internal node (the right child is start + 1)
+        int count; // number of triangles, 0 for an internal node
+    };
+
+    int BuildNode(int nodeIndex, int start, int count, std::vector<int> *order, const std::vector<float> &centroids, const float *vertices);
+    static bool IntersectBox(const float origin[3], const float inverseDirection[3], const float boxMin[3], const float boxMax[3], float maxT, float *tEntry);
+
+    std::vector<Node> m_Nodes;
+    std::vector<float> m_Vertices;
+    int m_LeafSize;
+};
+
+#endif
@@ -0,0 +1,126 @@
+/*
+ *  MeshCache.cpp
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+#include <sys/stat.h>
+#include <iostream>
+
+#include "MeshCache.h"
+#include "DebugControl.h"
+
+std::map<MeshCache::Key, std::shared_ptr<const MeshCache::Entry> > MeshCache::m_Entries;
+std::mutex MeshCache::m_Mutex;
+
+#define _I(i,j) I[(i)*4+(j)]
+
+// mass and inertia are linear in density so scaling the unit density values gives exactly
+// the same numbers as calculating them at the required density
+void MeshCache::Entry::GetMass(double density, bool centred, dMass *mass) const
+{
+    *mass = centred ? unitCentredMass : unitMass;
+    mass->mass *= density;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            mass->_I(i,j) *= density;
+}
+
+std::shared_ptr<const MeshCache::Entry> MeshCache::GetMesh(const std::string &filename, const pgd::Vector &scale, const pgd::Vector &offset,
+                                                           bool badMesh, double verticesAsSpheresRadius, bool clockwise, bool centre)
+{
+    struct stat fileStat;
+    if (stat(filename.c_str(), &fileStat)) return std::shared_ptr<const Entry>();
+
+    Key key;
+    key.filename = filename;
+    key.modificationTime = fileStat.st_mtime;
+    key.fileSize = fileStat.st_size;
+    key.scale[0] = scale.x; key.scale[1] = scale.y; key.scale[2] = scale.z;
+    key.offset[0] = offset.x; key.offset[1] = offset.y; key.offset[2] = offset.z;
+    key.badMesh = badMesh;
+    key.verticesAsSpheresRadius = verticesAsSpheresRadius;
+    key.clockwise = clockwise;
+    key.centre = centre;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        std::map<Key, std::shared_ptr<const Entry> >::const_iterator found = m_Entries.find(key);
+        if (found != m_Entries.end()) return found->second;
+    }
+
+    // the file is read without holding the lock so that other threads are not held up
+    // if two threads read the same file at once the first one to finish is kept
+    FacetedObject facetedObject;
+    facetedObject.SetBadMesh(badMesh);
+    facetedObject.SetVerticesAsSpheresRadius(verticesAsSpheresRadius);
+    if (facetedObject.ParseOBJFile(filename.c_str(), scale, offset)) return std::shared_ptr<const Entry>();
+    if (clockwise) facetedObject.ReverseWinding();
+
+    std::shared_ptr<Entry> entry(new Entry());
+    dMassSetZero(&entry->unitMass);
+    dMassSetZero(&entry->unitCentredMass);
+    entry->centred = centre;
+    if (centre)
+    {
+        // binary meshes already know their mass properties and CalculateMassProperties uses them
+        // the centred values are a parallel axis shift of the uncentred ones
+        facetedObject.CalculateMassProperties(&entry->unitMass, 1.0, false); // generally we assume anticlockwise winding
+        entry->unitCentredMass = entry->unitMass;
+        dMassTranslate(&entry->unitCentredMass, -entry->unitMass.c[0], -entry->unitMass.c[1], -entry->unitMass.c[2]);
+        if (entry->unitMass.c[0] != 0 || entry->unitMass.c[1] != 0 || entry->unitMass.c[2] != 0)
+            facetedObject.Move(-entry->unitMass.c[0], -entry->unitMass.c[1], -entry->unitMass.c[2]);
+    }
+    // a binary mesh that has not been changed still points into the mapped file so it is used as it is
+    // otherwise store the mass properties with the mesh so that anything else that uses it does not recalculate them
+    if (facetedObject.GetSharedMesh())
+        entry->mesh = facetedObject.GetSharedMesh();
+    else
+        entry->mesh = facetedObject.CreateSharedMesh(centre ? &entry->unitCentredMass : 0);
+
+    if (gDebug == FacetedObjectDebug)
+        std::cerr << "MeshCache::GetMesh\tread\t" << filename << "\tvertices\t" << facetedObject.GetNumVertices() << "\ttriangles\t" << facetedObject.GetNumTriangles() << "\n";
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    // remove any versions of this file that are out of date
+    for (std::map<Key, std::shared_ptr<const Entry> >::iterator iter = m_Entries.begin(); iter != m_Entries.end();)
+    {
+        if (iter->first.filename == filename && (iter->first.modificationTime != key.modificationTime || iter->first.fileSize != key.fileSize))
+            iter = m_Entries.erase(iter);
+        else
+            iter++;
+    }
+    std::pair<std::map<Key, std::shared_ptr<const Entry> >::iterator, bool> inserted = m_Entries.insert(std::make_pair(key, entry));
+    return inserted.first->second;
+}
+
+void MeshCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Entries.clear();
+}
+
+size_t MeshCache::GetNumEntries()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Entries.size();
+}
+
+bool MeshCache::Key::operator<(const Key &other) const
+{
+    if (filename != other.filename) return filename < other.filename;
+    if (modificationTime != other.modificationTime) return modificationTime < other.modificationTime;
+    if (fileSize != other.fileSize) return fileSize < other.fileSize;
+    for (int i = 0; i < 3; i++)
+    {
+        if (scale[i] != other.scale[i]) return scale[i] < other.scale[i];
+        if (offset[i] != other.offset[i]) return offset[i] < other.offset[i];
+    }
+    if (badMesh != other.badMesh) return badMesh < other.badMesh;
+    if (verticesAsSpheresRadius != other.verticesAsSpheresRadius) return verticesAsSpheresRadius < other.verticesAsSpheresRadius;
+    if (clockwise != other.clockwise) return clockwise < other.clockwise;
+    return centre < other.centre;
+}
@@ -0,0 +1,76 @@
+/*
+ *  MeshCache.h
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+// MeshCache keeps every mesh that has been read in for the lifetime of the
+// process so that loading the same model again (typically once per genome)
+// does not reparse the OBJ files. Entries are identified by the file name,
+// modification time and size plus all the settings that change the mesh so
+// an edited file is always reread. The meshes are read only and shared by
+// all the FacetedObjects that use them, and the mass properties are
+// calculated once at unit density since they scale linearly with density.
+// The cache is protected by a mutex so it can be used from several threads.
+// The Qt build does not use it because Irrlicht keeps its own mesh cache.
+
+#ifndef MeshCache_h
+#define MeshCache_h
+
+#include "FacetedObject.h"
+#include "PGDMath.h"
+
+#include <ode/ode.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+class MeshCache
+{
+public:
+    struct Entry
+    {
+        std::shared_ptr<const FacetedObject::SharedMesh> mesh;
+        bool centred; // the mesh has been moved so the centre of mass is at the origin
+        dMass unitMass; // mass properties at unit density before centring
+        dMass unitCentredMass; // mass properties at unit density after centring
+
+        void GetMass(double density, bool centred, dMass *mass) const;
+    };
+
+    // returns the processed mesh, reading it in if necessary
+    // clockwise meshes are reversed and if centre is set the mass properties are calculated
+    // and the mesh is moved so that the centre of mass is at the origin
+    // returns a null pointer if the file cannot be read
+    static std::shared_ptr<const Entry> GetMesh(const std::string &filename, const pgd::Vector &scale, const pgd::Vector &offset,
+                                                bool badMesh, double verticesAsSpheresRadius, bool clockwise, bool centre);
+
+    static void Clear();
+    static size_t GetNumEntries();
+
+private:
+    struct Key
+    {
+        std::string filename;
+        long long modificationTime;
+        long long fileSize;
+        double scale[3];
+        double offset[3];
+        bool badMesh;
+        double verticesAsSpheresRadius;
+        bool clockwise;
+        bool centre;
+
+        bool operator<(const Key &other) const;
+    };
+
+    static std::map<Key, std::shared_ptr<const Entry> > m_Entries;
+    static std::mutex m_Mutex;
+};
+
+#endif
@@ -9,16 +9,19 @@
 
 #include <ode/ode.h>
 #include <string>
+#include <iostream>
 
 #ifdef USE_QT
 #include "GLUtils.h"
 #endif
 
 #include "Muscle.h"
+#include "DebugControl.h"
 
 Muscle::Muscle(Strap *strap)
 {
     m_Strap = strap;
+    m_CurveMaxRelativeError = 0;
 #ifdef USE_QT
     m_ElasticEnergyColourFullScale = 50.0;
     m_drawMuscleForces = false;
@@ -32,6 +35,35 @@ Muscle::~Muscle()
     delete m_Strap;
 }
 
+void Muscle::AccumulateEnergy(EnergyAccounts *accounts, int muscleIndex, double timeIncrement)
+{
+    accounts->AddMechanicalPower(muscleIndex, GetPower(), timeIncrement);
+    accounts->AddMetabolicPower(muscleIndex, GetMetabolicPower(), timeIncrement);
+    if (accounts->GetRecordElasticEnergy()) accounts->SetElasticEnergy(muscleIndex, GetElasticEnergy());
+}
+
+// builds a table for one of the muscle curves using the current accuracy setting
+// returns true if the table could not be built in which case the exact function should be used
+bool Muscle::BuildCurveTable(CurveTable *table, const char *curveName, std::function<double(double)> function,
+                             double minX, double maxX, CurveTable::GridType gridType)
+{
+    if (m_CurveMaxRelativeError <= 0) return true;
+    if (table->Build(function, minX, maxX, gridType, m_CurveMaxRelativeError))
+    {
+        std::cerr << "Warning: " << m_Name << " " << curveName << " could not be tabulated to a relative error of " << m_CurveMaxRelativeError << " so the exact curve will be used\n";
+        return true;
+    }
+    if (gDebug == MuscleDebug)
+    {
+        *gDebugStream << "Muscle::BuildCurveTable " << m_Name << " " << curveName <<
+                " points " << table->GetNumPoints() <<
+                " requested_error " << m_CurveMaxRelativeError <<
+                " achieved_error " << table->GetMaxRelativeError() <<
+                " speedup " << table->Benchmark(100000) << "\n";
+    }
+    return false;
+}
+
 #ifdef USE_QT
 void Muscle::Draw(SimulationWindow *window)
 {
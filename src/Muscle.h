@@ -13,6 +13,8 @@
 #include "Drivable.h"
 #include "Strap.h"
 #include "Simulation.h"
+#include "CurveTable.h"
+#include "EnergyAccounts.h"
 #include <vector>
 #include <string>
 
@@ -35,7 +37,10 @@ public:
     virtual double GetMetabolicPower() = 0;
     virtual double GetElasticEnergy() = 0;
 
-    std::vector<PointForce *> *GetPointForceList() { return m_Strap->GetPointForceList(); }
+    // adds this step's energy terms to the accounts (called after CalculateStrap)
+    virtual void AccumulateEnergy(EnergyAccounts *accounts, int muscleIndex, double timeIncrement);
+
+    std::vector<PointForce> *GetPointForceList() { return m_Strap->GetPointForceList(); }
 
     Strap *GetStrap() { return m_Strap; }
 
@@ -48,6 +53,10 @@ public:
 
     virtual void LateInitialisation() { CalculateStrap(0); m_Strap->SetName(m_Name + std::string("Strap")); }
 
+    // if this is > 0 then the expensive curves are replaced by tables at LateInitialisation
+    void SetCurveMaxRelativeError(double curveMaxRelativeError) { m_CurveMaxRelativeError = curveMaxRelativeError; }
+    double GetCurveMaxRelativeError() { return m_CurveMaxRelativeError; }
+
 #ifdef USE_QT
     virtual void Draw(SimulationWindow *window);
     void SetForceColour(Colour &colour) { m_ForceColour = colour; }
@@ -66,7 +75,11 @@ public:
 
 protected:
 
+    bool BuildCurveTable(CurveTable *table, const char *curveName, std::function<double(double)> function,
+                         double minX, double maxX, CurveTable::GridType gridType);
+
     Strap *m_Strap;
+    double m_CurveMaxRelativeError;
 
 #ifdef USE_QT
     Colour m_ForceColour;
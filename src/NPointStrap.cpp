@@ -20,13 +20,17 @@
 #include "Simulation.h"
 #include "Util.h"
 #include "DebugControl.h"
+#include "Trace.h"
 
 #ifdef USE_QT
-#include "FacetedPolyline.h"
+#include "FacetedBatch.h"
+#include "SimulationWindow.h"
 #endif
 
 NPointStrap::NPointStrap(): TwoPointStrap()
 {
+    m_Mapping.push_back(0);
+    m_Mapping.push_back(1);
 }
 
 NPointStrap::~NPointStrap()
@@ -45,14 +49,24 @@ void NPointStrap::SetViaPoints(std::vector<Body *> *bodyList, std::vector<double
     }
     for (unsigned int i = 0; i < pointList->size(); i++)
     {
-        PointForce *viaPointForce = new PointForce();
-        viaPointForce->body = (*bodyList)[i];
+        PointForce viaPointForce = PointForce();
+        viaPointForce.body = (*bodyList)[i];
         m_PointForceList.push_back(viaPointForce);
-        m_ViaBodyList.push_back(viaPointForce->body);
+        m_ViaBodyList.push_back(viaPointForce.body);
         double *point = new double[sizeof(dVector3)];
         memcpy(point, (*pointList)[i], sizeof(dVector3));
         m_ViaPointList.push_back(point);
     }
+
+    // the path goes origin, via points, insertion but the insertion is stored second
+    m_Mapping.resize(m_PointForceList.size());
+    for (unsigned int i = 0; i < m_PointForceList.size(); i++)
+    {
+        if (i == 0) m_Mapping[i] = 0;
+        else
+            if (i == m_PointForceList.size() - 1) m_Mapping[i] = 1;
+            else m_Mapping[i] = i + 1;
+    }
 }
 
 // parses the position allowing a relative position specified by BODY IDk
@@ -129,8 +143,8 @@ void NPointStrap::SetViaPoints(std::vector<Body *> *bodyList, std::vector<std::s
 
 void NPointStrap::Calculate(double deltaT)
 {
-    PointForce *theOrigin = m_PointForceList[0];
-    PointForce *theInsertion = m_PointForceList[1];
+    PointForce *theOrigin = &m_PointForceList[0];
+    PointForce *theInsertion = &m_PointForceList[1];
     unsigned int i;
     double *ptr;
 
@@ -143,17 +157,10 @@ void NPointStrap::Calculate(double deltaT)
     {
         ptr = m_ViaPointList[i];
         dBodyGetRelPointPos(m_ViaBodyList[i]->GetBodyID(), ptr[0], ptr[1], ptr[2],
-                        m_PointForceList[i + 2]->point);
+                        m_PointForceList[i + 2].point);
     }
 
-    unsigned int *mapping = new unsigned int[m_PointForceList.size()];
-    for (i = 0; i < m_PointForceList.size(); i++)
-    {
-        if (i == 0) mapping[i] = 0;
-        else
-            if (i == m_PointForceList.size() - 1) mapping[i] = 1;
-            else mapping[i] = i + 1;
-    }
+    const unsigned int *mapping = m_Mapping.data();
 
     m_LastLength = m_Length;
     pgd::Vector line, line2;
@@ -163,57 +170,54 @@ void NPointStrap::Calculate(double deltaT)
     {
         if (i == 0)
         {
-            line.x = m_PointForceList[mapping[i + 1]]->point[0] - m_PointForceList[mapping[i]]->point[0];
-            line.y = m_PointForceList[mapping[i + 1]]->point[1] - m_PointForceList[mapping[i]]->point[1];
-            line.z = m_PointForceList[mapping[i + 1]]->point[2] - m_PointForceList[mapping[i]]->point[2];
+            line.x = m_PointForceList[mapping[i + 1]].point[0] - m_PointForceList[mapping[i]].point[0];
+            line.y = m_PointForceList[mapping[i + 1]].point[1] - m_PointForceList[mapping[i]].point[1];
+            line.z = m_PointForceList[mapping[i + 1]].point[2] - m_PointForceList[mapping[i]].point[2];
             len = line.Magnitude();
             m_Length += len;
             line /= len;
         }
         else if (i == m_PointForceList.size() - 1)
         {
-            line.x = m_PointForceList[mapping[i - 1]]->point[0] - m_PointForceList[mapping[i]]->point[0];
-            line.y = m_PointForceList[mapping[i - 1]]->point[1] - m_PointForceList[mapping[i]]->point[1];
-            line.z = m_PointForceList[mapping[i - 1]]->point[2] - m_PointForceList[mapping[i]]->point[2];
+            line.x = m_PointForceList[mapping[i - 1]].point[0] - m_PointForceList[mapping[i]].point[0];
+            line.y = m_PointForceList[mapping[i - 1]].point[1] - m_PointForceList[mapping[i]].point[1];
+            line.z = m_PointForceList[mapping[i - 1]].point[2] - m_PointForceList[mapping[i]].point[2];
             line.Normalize();
         }
         else
         {
-            line.x = m_PointForceList[mapping[i + 1]]->point[0] - m_PointForceList[mapping[i]]->point[0];
-            line.y = m_PointForceList[mapping[i + 1]]->point[1] - m_PointForceList[mapping[i]]->point[1];
-            line.z = m_PointForceList[mapping[i + 1]]->point[2] - m_PointForceList[mapping[i]]->point[2];
+            line.x = m_PointForceList[mapping[i + 1]].point[0] - m_PointForceList[mapping[i]].point[0];
+            line.y = m_PointForceList[mapping[i + 1]].point[1] - m_PointForceList[mapping[i]].point[1];
+            line.z = m_PointForceList[mapping[i + 1]].point[2] - m_PointForceList[mapping[i]].point[2];
             len = line.Magnitude();
             m_Length += len;
             line /= len;
-            line2.x = m_PointForceList[mapping[i - 1]]->point[0] - m_PointForceList[mapping[i]]->point[0];
-            line2.y = m_PointForceList[mapping[i - 1]]->point[1] - m_PointForceList[mapping[i]]->point[1];
-            line2.z = m_PointForceList[mapping[i - 1]]->point[2] - m_PointForceList[mapping[i]]->point[2];
+            line2.x = m_PointForceList[mapping[i - 1]].point[0] - m_PointForceList[mapping[i]].point[0];
+            line2.y = m_PointForceList[mapping[i - 1]].point[1] - m_PointForceList[mapping[i]].point[1];
+            line2.z = m_PointForceList[mapping[i - 1]].point[2] - m_PointForceList[mapping[i]].point[2];
             line2.Normalize();
             line += line2;
         }
 
-        m_PointForceList[mapping[i]]->vector[0] = line.x;
-        m_PointForceList[mapping[i]]->vector[1] = line.y;
-        m_PointForceList[mapping[i]]->vector[2] = line.z;
+        m_PointForceList[mapping[i]].vector[0] = line.x;
+        m_PointForceList[mapping[i]].vector[1] = line.y;
+        m_PointForceList[mapping[i]].vector[2] = line.z;
     }
 
-    if (deltaT != 0.0) m_Velocity = (m_Length - m_LastLength) / deltaT;
-    else m_Velocity = 0;
+    CalculateVelocity(deltaT);
 
-    if (gDebug == StrapDebug)
+    if (TRACE_ON(StrapDebug))
     {
         pgd::Vector totalF(0, 0, 0);
         for (i = 0; i < m_PointForceList.size(); i++)
         {
-            *gDebugStream << "NPointStrap::Calculate " <<
-            *m_PointForceList[i]->body->GetName() << " " <<
-            m_PointForceList[i]->point[0] << " " << m_PointForceList[i]->point[1] << " " << m_PointForceList[i]->point[2] << " " <<
-            m_PointForceList[i]->vector[0] << " " << m_PointForceList[i]->vector[1] << " " << m_PointForceList[i]->vector[2] << "\n";
-            totalF.x += m_PointForceList[i]->vector[0]; totalF.y += m_PointForceList[i]->vector[1]; totalF.z += m_PointForceList[i]->vector[2];
+            Trace::Record(StrapPointForceEvent, *m_PointForceList[i].body->GetName(),
+                          {m_PointForceList[i].point[0], m_PointForceList[i].point[1], m_PointForceList[i].point[2],
+                           m_PointForceList[i].vector[0], m_PointForceList[i].vector[1], m_PointForceList[i].vector[2]});
+            totalF.x += m_PointForceList[i].vector[0]; totalF.y += m_PointForceList[i].vector[1]; totalF.z += m_PointForceList[i].vector[2];
         }
-        *gDebugStream << "Total F " << totalF.x << " " << totalF.y << " " << totalF.z << "\n";
+        Trace::Record(StrapTotalForceEvent, m_Name, {totalF.x, totalF.y, totalF.z});
     }
-    delete [] mapping;
 }
 
 int NPointStrap::SanityCheck(Strap *otherStrap, AxisType axis, const std::string &sanityCheckLeft, const std::string &sanityCheckRight)
@@ -298,50 +302,22 @@ int NPointStrap::SanityCheck(Strap *otherStrap, AxisType axis, const std::string
 void
 NPointStrap::Draw(SimulationWindow *window)
 {
-    const int kSides = 128;
-    FacetedPolyline *facetedPolyline;
+    FacetedBatch *batch = window->strapBatch();
     unsigned int i;
 
-    if (m_simulation->GetTime() != m_LastDrawTime)
+    if (m_Visible)
     {
-        m_LastDrawTime = m_simulation->GetTime();
-        std::vector<FacetedObject *>::const_iterator iterFO;
-        for (iterFO = m_DrawList.begin(); iterFO != m_DrawList.end(); iterFO++)
-            delete *iterFO;
-        m_DrawList.clear();
-
-        std::vector<pgd::Vector> polyline;
-        polyline.push_back(pgd::Vector(m_PointForceList[0]->point[0], m_PointForceList[0]->point[1], m_PointForceList[0]->point[2]));
+        m_DrawPolyline.clear();
+        m_DrawPolyline.push_back(pgd::Vector(m_PointForceList[0].point[0], m_PointForceList[0].point[1], m_PointForceList[0].point[2]));
         for (i = 2; i < m_PointForceList.size(); i++)
         {
-            polyline.push_back(pgd::Vector(m_PointForceList[i]->point[0], m_PointForceList[i]->point[1], m_PointForceList[i]->point[2]));
-        }
-        polyline.push_back(pgd::Vector(m_PointForceList[1]->point[0], m_PointForceList[1]->point[1], m_PointForceList[1]->point[2]));
-        facetedPolyline = new FacetedPolyline(&polyline, m_Radius, kSides);
-        facetedPolyline->SetColour(m_Colour);
-        facetedPolyline->setSimulationWindow(window);
-        facetedPolyline->SetVisible(m_Visible);
-        m_DrawList.push_back(facetedPolyline);
-
-        if (m_drawMuscleForces)
-        {
-            for (i = 0; i < m_PointForceList.size(); i++)
-            {
-                polyline.clear();
-                pgd::Vector f = pgd::Vector(m_PointForceList[i]->vector[0], m_PointForceList[i]->vector[1], m_PointForceList[i]->vector[2]) * m_Tension * m_ForceScale;
-                polyline.push_back(pgd::Vector(m_PointForceList[i]->point[0], m_PointForceList[i]->point[1], m_PointForceList[i]->point[2]));
-                polyline.push_back(pgd::Vector(m_PointForceList[i]->point[0], m_PointForceList[i]->point[1], m_PointForceList[i]->point[2]) + f);
-                facetedPolyline = new FacetedPolyline(&polyline, m_ForceRadius, kSides);
-                facetedPolyline->SetColour(m_Colour);
-                facetedPolyline->setSimulationWindow(window);
-                facetedPolyline->SetVisible(m_drawMuscleForces);
-                m_DrawList.push_back(facetedPolyline);
-            }
+            m_DrawPolyline.push_back(pgd::Vector(m_PointForceList[i].point[0], m_PointForceList[i].point[1], m_PointForceList[i].point[2]));
         }
+        m_DrawPolyline.push_back(pgd::Vector(m_PointForceList[1].point[0], m_PointForceList[1].point[1], m_PointForceList[1].point[2]));
+        batch->AddPolyline(m_DrawPolyline, m_Radius, m_Colour);
     }
 
-    for (i = 0; i < m_DrawList.size(); i++)
-        m_DrawList[i]->Draw();
+    DrawPointForces(batch);
 }
 #endif
 
@@ -39,6 +39,7 @@ protected:
 
     std::vector<Body *> m_ViaBodyList;
     std::vector<double *> m_ViaPointList;
+    std::vector<unsigned int> m_Mapping; // index into m_PointForceList in path order
     //std::vector<dVector3 *> m_WorldViaPointList;
 };
 
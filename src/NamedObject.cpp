@@ -34,7 +34,7 @@ NamedObject::NamedObject()
     m_CaseSensitiveXMLAttributes = false;
     m_simulation = 0;
 
-#ifdef USE_QT
+#if defined(USE_QT) || defined(USE_HEADLESS)
     m_AxisSize[0] = m_AxisSize[1] = m_AxisSize[2] = 1;
     m_Colour.SetColour(1, 1, 1, 1);
     m_physRep = 0;
@@ -49,7 +49,7 @@ NamedObject::~NamedObject()
         m_DumpStream->close();
         delete(m_DumpStream);
     }
-#ifdef USE_QT
+#if defined(USE_QT) || defined(USE_HEADLESS)
     if (m_physRep) delete m_physRep;
 #endif
 }
@@ -277,7 +277,7 @@ rapidxml::xml_attribute<char> *NamedObject::FindXMLAttribute(rapidxml::xml_node<
     return ptr;
 }
 
-#ifdef USE_QT
+#if defined(USE_QT) || defined(USE_HEADLESS)
 FacetedObject *NamedObject::physRep() const
 {
     return m_physRep;
@@ -16,7 +16,7 @@
 #include <iostream>
 #include <sstream>
 
-#ifdef USE_QT
+#if defined(USE_QT) || defined(USE_HEADLESS)
 #include "GLUtils.h"
 #endif
 
@@ -27,7 +27,7 @@ namespace rapidxml { template<class Ch> class xml_document; }
 namespace rapidxml { template<class Ch> class xml_node; }
 namespace rapidxml { template<class Ch> class xml_attribute; }
 
-#ifdef USE_QT
+#if defined(USE_QT) || defined(USE_HEADLESS)
 namespace irr { namespace scene { class IMesh; } }
 namespace irr { namespace video { class SColor; } }
 #endif
@@ -68,7 +68,7 @@ public:
     Simulation *simulation() const;
     void setSimulation(Simulation *simulation);
 
-#ifdef USE_QT
+#if defined(USE_QT) || defined(USE_HEADLESS)
     void SetAxisSize(float axisSize[3]) {m_AxisSize[0] = axisSize[0]; m_AxisSize[1] = axisSize[1]; m_AxisSize[2] = axisSize[2]; }
     void SetColour(Colour &colour) { m_Colour = colour; }
     void SetColour(float r, float g, float b, float alpha) { m_Colour.SetColour(r, g, b, alpha); }
@@ -99,7 +99,7 @@ protected:
     bool m_CaseSensitiveXMLAttributes;
     Simulation *m_simulation;
 
-#ifdef USE_QT
+#if defined(USE_QT) || defined(USE_HEADLESS)
     float m_AxisSize[3];
     Colour m_Colour;
     FacetedObject *m_physRep;
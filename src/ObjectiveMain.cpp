@@ -12,6 +12,7 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
@@ -78,8 +79,15 @@ int carbonMain(int argc, char* argv[]);
 #include "mainwindow.h"
 #endif
 
+#ifdef USE_HEADLESS
+#include "HeadlessRenderer.h"
+#include "FacetedObject.h"
+#include "BinaryMesh.h"
+#endif
+
 #define DEBUG_MAIN
 #include "DebugControl.h"
+#include "Trace.h"
 
 // Simulation global
 Simulation *gSimulation = 0;
@@ -143,6 +151,21 @@ static char *gModelConfigFile = 0;
 static double gSimulationTimeLimit = -1;
 static int gRunTimeLimit = 0;
 static double gWarehouseFailDistanceAbort = 0;
+static bool gPruneFlag = false;
+static double gPruneThreshold = 0;
+static double gPruneMaximumSpeed = -1;
+static char *gTraceFilenamePtr = 0;
+static char *gDecodeTraceFilenamePtr = 0;
+
+#ifdef USE_HEADLESS
+static char *gMovieFilenamePrefixPtr = 0;
+static HeadlessRenderer::ImageFormat gMovieImageFormat = HeadlessRenderer::PNG;
+static int gMovieThreads = 0;
+static HeadlessRenderer *gHeadlessRenderer = 0;
+static char *gConvertMeshInputPtr = 0;
+static char *gConvertMeshOutputPtr = 0;
+static bool gConvertMeshSinglePrecision = false;
+#endif
 
 #ifndef USE_QT
 static double gLastTime = 0;
@@ -210,6 +233,38 @@ int GaitSymMain(int argc, char *argv[])
     // start by parsing the command line arguments
     ParseArguments(argc - 1, &(argv[1]));
 
+#ifdef USE_HEADLESS
+    if (gConvertMeshInputPtr)
+    {
+        FacetedObject facetedObject;
+        if (facetedObject.ParseOBJFile(gConvertMeshInputPtr, pgd::Vector(1, 1, 1), pgd::Vector(0, 0, 0)))
+        {
+            std::cerr << "Error reading mesh " << gConvertMeshInputPtr << "\n";
+            return 1;
+        }
+        if (BinaryMesh::Write(gConvertMeshOutputPtr, &facetedObject, gConvertMeshSinglePrecision)) return 1;
+        std::cerr << "Converted " << gConvertMeshInputPtr << " to " << gConvertMeshOutputPtr << ": " << facetedObject.GetNumVertices() << " vertices " << facetedObject.GetNumTriangles() << " triangles\n";
+        return 0;
+    }
+#endif
+
+    if (gDecodeTraceFilenamePtr)
+    {
+        if (Trace::Decode(gDecodeTraceFilenamePtr, std::cout)) return 1;
+        return 0;
+    }
+
+    if (gTraceFilenamePtr)
+    {
+        if (Trace::OpenFile(gTraceFilenamePtr))
+        {
+            std::cerr << "Error opening trace file " << gTraceFilenamePtr << "\n";
+            return 1;
+        }
+        // the file stays open for every run and is closed however the program exits
+        atexit(Trace::CloseFile);
+    }
+
     if (gModelConfigFile)
     {
         gXMLConverter.LoadBaseXMLFile(gModelConfigFile);
@@ -267,6 +322,27 @@ int GaitSymMain(int argc, char *argv[])
             {
                 gFinishedFlag = false;
 
+#ifdef USE_HEADLESS
+                if (gMovieFilenamePrefixPtr)
+                {
+                    gHeadlessRenderer = new HeadlessRenderer(gSimulation);
+                    gHeadlessRenderer->SetWindowSize(gWindowWidth, gWindowHeight);
+                    gHeadlessRenderer->SetFilenamePrefix(gMovieFilenamePrefixPtr);
+                    gHeadlessRenderer->SetImageFormat(gMovieImageFormat);
+                    gHeadlessRenderer->SetNumThreads(gMovieThreads);
+                    if (gInputKinematicsFilenamePtr)
+                    {
+                        // just replay the kinematics without running the simulation
+                        int err = gHeadlessRenderer->ReadKinematics(gInputKinematicsFilenamePtr);
+                        if (err == 0) err = gHeadlessRenderer->RenderFrames();
+                        delete gHeadlessRenderer;
+                        gHeadlessRenderer = 0;
+                        delete gSimulation;
+                        return err ? 1 : 0;
+                    }
+                }
+#endif
+
                 for (unsigned int i = 0; i < gOutputList.size(); i++)
                 {
                     if (gSimulation->GetBodyList()->find(gOutputList[i]) != gSimulation->GetBodyList()->end()) (*gSimulation->GetBodyList())[gOutputList[i]]->SetDump(true);
@@ -292,6 +368,9 @@ int GaitSymMain(int argc, char *argv[])
             gLastTime = gCurrentTime;
             while (gSimulation->ShouldQuit() == false)
             {
+#ifdef USE_HEADLESS
+                if (gHeadlessRenderer && gSimulation->GetStepCount() % gDisplaySkip == 0) gHeadlessRenderer->RecordFrame();
+#endif
                 gSimulation->UpdateSimulation();
 
                 if (gSimulation->TestForCatastrophy()) break;
@@ -300,6 +379,15 @@ int GaitSymMain(int argc, char *argv[])
             gSimulationTime += (gCurrentTime - gLastTime);
             gLastTime = gCurrentTime;
 
+#ifdef USE_HEADLESS
+            if (gHeadlessRenderer)
+            {
+                gHeadlessRenderer->RenderFrames();
+                delete gHeadlessRenderer;
+                gHeadlessRenderer = 0;
+            }
+#endif
+
             gFinishedFlag = true;
             if (WriteModel()) return 0;
         }
@@ -333,6 +421,19 @@ void ParseArguments(int argc, char ** argv)
     gSimulationTimeLimit = -1;
     gRunTimeLimit = 0;
     gWarehouseFailDistanceAbort = 0;
+    gPruneFlag = false;
+    gPruneThreshold = 0;
+    gPruneMaximumSpeed = -1;
+    gTraceFilenamePtr = 0;
+    gDecodeTraceFilenamePtr = 0;
+#ifdef USE_HEADLESS
+    gMovieFilenamePrefixPtr = 0;
+    gMovieImageFormat = HeadlessRenderer::PNG;
+    gMovieThreads = 0;
+    gConvertMeshInputPtr = 0;
+    gConvertMeshOutputPtr = 0;
+    gConvertMeshSinglePrecision = false;
+#endif
 
     int i;
 
@@ -419,6 +520,30 @@ void ParseArguments(int argc, char ** argv)
                 }
                 gDebugNameFilter = argv[i];
             }
+        else
+            if (strcmp(argv[i], "--traceFile") == 0 ||
+                strcmp(argv[i], "-tf") == 0)
+            {
+                i++;
+                if (i >= argc)
+                {
+                    std::cerr << "Error parsing trace filename\n";
+                    exit(1);
+                }
+                gTraceFilenamePtr = argv[i];
+            }
+        else
+            if (strcmp(argv[i], "--decodeTrace") == 0 ||
+                strcmp(argv[i], "-dt") == 0)
+            {
+                i++;
+                if (i >= argc)
+                {
+                    std::cerr << "Error parsing decode trace filename\n";
+                    exit(1);
+                }
+                gDecodeTraceFilenamePtr = argv[i];
+            }
         else
             if (strcmp(argv[i], "--outputName") == 0 ||
                 strcmp(argv[i], "-on") == 0)
@@ -541,6 +666,31 @@ void ParseArguments(int argc, char ** argv)
                 }
                 gWarehouseFailDistanceAbort = strtod(argv[i], 0);
             }
+        else
+            if (strcmp(argv[i], "--pruneThreshold") == 0 ||
+                strcmp(argv[i], "-PT") == 0)
+            {
+                i++;
+                if (i >= argc)
+                {
+                    std::cerr << "Error parsing --pruneThreshold\n";
+                    exit(1);
+                }
+                gPruneThreshold = strtod(argv[i], 0);
+                gPruneFlag = true;
+            }
+        else
+            if (strcmp(argv[i], "--pruneMaximumSpeed") == 0 ||
+                strcmp(argv[i], "-PS") == 0)
+            {
+                i++;
+                if (i >= argc)
+                {
+                    std::cerr << "Error parsing --pruneMaximumSpeed\n";
+                    exit(1);
+                }
+                gPruneMaximumSpeed = strtod(argv[i], 0);
+            }
         else
             if (strcmp(argv[i], "--outputKinematics") == 0 ||
                 strcmp(argv[i], "-K") == 0)
@@ -565,6 +715,67 @@ void ParseArguments(int argc, char ** argv)
                 }
                 gInputKinematicsFilenamePtr = argv[i];
             }
+#ifdef USE_HEADLESS
+        else
+            if (strcmp(argv[i], "--movie") == 0 ||
+                strcmp(argv[i], "-MV") == 0)
+            {
+                i++;
+                if (i >= argc)
+                {
+                    std::cerr << "Error parsing movie filename prefix\n";
+                    exit(1);
+                }
+                gMovieFilenamePrefixPtr = argv[i];
+            }
+        else
+            if (strcmp(argv[i], "--movieFormat") == 0 ||
+                strcmp(argv[i], "-MF") == 0)
+            {
+                i++;
+                if (i >= argc)
+                {
+                    std::cerr << "Error parsing movie format\n";
+                    exit(1);
+                }
+                if (strcmp(argv[i], "png") == 0) gMovieImageFormat = HeadlessRenderer::PNG;
+                else if (strcmp(argv[i], "tiff") == 0) gMovieImageFormat = HeadlessRenderer::TIFF;
+                else if (strcmp(argv[i], "ppm") == 0) gMovieImageFormat = HeadlessRenderer::PPM;
+                else
+                {
+                    std::cerr << "Error parsing movie format: must be png, tiff or ppm\n";
+                    exit(1);
+                }
+            }
+        else
+            if (strcmp(argv[i], "--movieThreads") == 0 ||
+                strcmp(argv[i], "-MT") == 0)
+            {
+                i++;
+                if (i >= argc)
+                {
+                    std::cerr << "Error parsing movie threads\n";
+                    exit(1);
+                }
+                gMovieThreads = strtol(argv[i], 0, 10);
+            }
+        else
+            if (strcmp(argv[i], "--convertMesh") == 0 ||
+                strcmp(argv[i], "-CM") == 0 ||
+                strcmp(argv[i], "--convertMeshFloat") == 0 ||
+                strcmp(argv[i], "-CMF") == 0)
+            {
+                gConvertMeshSinglePrecision = (strcmp(argv[i], "--convertMeshFloat") == 0 || strcmp(argv[i], "-CMF") == 0);
+                i += 2;
+                if (i >= argc)
+                {
+                    std::cerr << "Error parsing convert mesh filenames\n";
+                    exit(1);
+                }
+                gConvertMeshInputPtr = argv[i - 1];
+                gConvertMeshOutputPtr = argv[i];
+            }
+#endif
         else
             if (strcmp(argv[i], "--outputWarehouse") == 0 ||
                 strcmp(argv[i], "-H") == 0)
@@ -761,10 +972,27 @@ void ParseArguments(int argc, char ** argv)
                 std::cerr << "Quits the program after it has run the simulation for x seconds of simulation time\n\n";
                 std::cerr << "-WF x, --warehouseFailDistanceAbort n\n";
                 std::cerr << "Quits the program when the warehouse distance is greater than n (if n is negative, when less than -n\n\n";
+                std::cerr << "-PT x, --pruneThreshold x\n";
+                std::cerr << "Stops the simulation early when the score can no longer reach x and reports the partial score as pruned\n\n";
+                std::cerr << "-PS x, --pruneMaximumSpeed x\n";
+                std::cerr << "Sets the maximum speed used to bound the DistanceTravelled score when pruning\n\n";
                 std::cerr << "-J filename, --inputKinematics filename\n";
                 std::cerr << "Reads tab-delimited kinematic data from filename\n\n";
                 std::cerr << "-K filename, --outputKinematics filename\n";
                 std::cerr << "Writes tab-delimited kinematic data to filename\n\n";
+#ifdef USE_HEADLESS
+                std::cerr << "-MV prefix, --movie prefix\n";
+                std::cerr << "Renders a frame every displaySkip steps offscreen and writes them as prefixNNNNNN\n";
+                std::cerr << "If inputKinematics is also set the kinematics file is rendered without running the simulation\n\n";
+                std::cerr << "-MF format, --movieFormat format\n";
+                std::cerr << "Sets the movie frame format: png (default), tiff or ppm\n\n";
+                std::cerr << "-MT n, --movieThreads n\n";
+                std::cerr << "Renders the movie frames using n threads (default is one per core)\n\n";
+                std::cerr << "-CM input output, --convertMesh input output\n";
+                std::cerr << "Converts the OBJ file input to a binary mesh file output that loads without parsing and exits\n\n";
+                std::cerr << "-CMF input output, --convertMeshFloat input output\n";
+                std::cerr << "As --convertMesh but stores the vertices in single precision to halve their size\n\n";
+#endif
                 std::cerr << "-H filename, --outputWarehouse filename\n";
                 std::cerr << "Writes tab-delimited gait warehouse data to filename\n\n";
                 std::cerr << "-M filename, --outputModelStateFile filename\n";
@@ -805,6 +1033,10 @@ void ParseArguments(int argc, char ** argv)
                 std::cerr << "Filters debugging information by function.\n";
                 std::cerr << "-dn name, --debugNameFilter name\n";
                 std::cerr << "Filters debugging information by name.\n";
+                std::cerr << "-tf filename, --traceFile filename\n";
+                std::cerr << "Writes the high frequency debugging information to filename in binary rather than as text.\n";
+                std::cerr << "-dt filename, --decodeTrace filename\n";
+                std::cerr << "Prints the text version of the binary debugging information in filename and exits.\n";
                 std::cerr << "Debug numbers:\n";
                 for (i = 0; i < nDebugLabels; i++)
                     fprintf(stderr, "%3d %s\n", i, gDebugLabels[i]);
@@ -1180,6 +1412,11 @@ int ReadModel(void *userData)
     gSimulation->SetMainWindow(static_cast<MainWindow *>(userData));
 #endif
 
+#ifdef USE_HEADLESS
+    // the body meshes are read relative to the graphics root
+    if (gGraphicsRoot) gSimulation->SetGraphicsRoot(gGraphicsRoot);
+#endif
+
     if (gSimulation->LoadModel(myFile.GetRawData()))
     {
         delete gSimulation;
@@ -1190,6 +1427,8 @@ int ReadModel(void *userData)
     // late initialisation options
     if (gSimulationTimeLimit >= 0) gSimulation->SetTimeLimit(gSimulationTimeLimit);
     if (gWarehouseFailDistanceAbort != 0) gSimulation->SetWarehouseFailDistanceAbort(gWarehouseFailDistanceAbort);
+    if (gPruneFlag) gSimulation->SetPruneThreshold(gPruneThreshold);
+    if (gPruneMaximumSpeed >= 0) gSimulation->SetPruneMaximumSpeed(gPruneMaximumSpeed);
 
     return 0;
 }
@@ -1217,7 +1456,8 @@ int WriteModel()
                  " Mechanical Energy: " << gSimulation->GetMechanicalEnergy() <<
                  " Metabolic Energy: " << gSimulation->GetMetabolicEnergy() <<
                  " CPUTimeSimulation: " << gSimulationTime <<
-                 " CPUTimeIO: " << gIOTime << "\n";
+                 " CPUTimeIO: " << gIOTime <<
+                 (gSimulation->GetPruned() ? " Pruned" : "") << "\n";
 #else
     std::cerr << "Simulation Time: " << gSimulation->GetTime() <<
                  " Steps: " << gSimulation->GetStepCount() <<
@@ -1225,7 +1465,8 @@ int WriteModel()
                  " Mechanical Energy: " << gSimulation->GetMechanicalEnergy() <<
                  " Metabolic Energy: " << gSimulation->GetMetabolicEnergy() <<
                  " CPUTimeSimulation: " << gSimulationTime <<
-                 " CPUTimeIO: " << gIOTime << "\n";
+                 " CPUTimeIO: " << gIOTime <<
+                 (gSimulation->GetPruned() ? " Pruned" : "") << "\n";
 #endif
 
 #if defined(USE_SOCKETS)
@@ -64,48 +64,34 @@ public:
         pgd_floating_point_type y;
         pgd_floating_point_type z;
 
-        Vector(void);
-        Vector(pgd_floating_point_type xi, pgd_floating_point_type yi, pgd_floating_point_type zi);
+        constexpr Vector(void) : x(0), y(0), z(0) {}
+        constexpr Vector(pgd_floating_point_type xi, pgd_floating_point_type yi, pgd_floating_point_type zi) : x(xi), y(yi), z(zi) {}
 
         void Set(pgd_floating_point_type xi, pgd_floating_point_type yi, pgd_floating_point_type zi);
 
-        pgd_floating_point_type Magnitude(void);
-        pgd_floating_point_type Magnitude2(void);
+        pgd_floating_point_type Magnitude(void) const;
+        constexpr pgd_floating_point_type Magnitude2(void) const { return x*x + y*y + z*z; }
         void  Normalize(void);
         void  Reverse(void);
 
-        Vector& operator+=(Vector u);   // vector addition
-        Vector& operator-=(Vector u);   // vector subtraction
+        Vector& operator+=(const Vector &u);   // vector addition
+        Vector& operator-=(const Vector &u);   // vector subtraction
         Vector& operator*=(pgd_floating_point_type s);    // scalar multiply
         Vector& operator/=(pgd_floating_point_type s);    // scalar divide
         Vector& operator=(pgd_floating_point_type *s);    // assign from POD array
 
-        Vector operator-(void);
+        constexpr Vector operator-(void) const { return Vector(-x, -y, -z); }
 
     };
 
-    inline  Vector operator+(Vector u, Vector v);
-    inline  Vector operator-(Vector u, Vector v);
-    inline  Vector operator^(Vector u, Vector v);
-    inline  pgd_floating_point_type operator*(Vector u, Vector v);
-    inline  Vector operator*(pgd_floating_point_type s, Vector u);
-    inline  Vector operator*(Vector u, pgd_floating_point_type s);
-    inline  Vector operator/(Vector u, pgd_floating_point_type s);
-    inline  pgd_floating_point_type TripleScalarProduct(Vector u, Vector v, Vector w);
-
-    inline Vector::Vector(void)
-    {
-        x = 0;
-        y = 0;
-        z = 0;
-    }
-
-    inline Vector::Vector(pgd_floating_point_type xi, pgd_floating_point_type yi, pgd_floating_point_type zi)
-    {
-        x = xi;
-        y = yi;
-        z = zi;
-    }
+    inline  Vector operator+(const Vector &u, const Vector &v);
+    inline  Vector operator-(const Vector &u, const Vector &v);
+    inline  Vector operator^(const Vector &u, const Vector &v);
+    inline  pgd_floating_point_type operator*(const Vector &u, const Vector &v);
+    inline  Vector operator*(pgd_floating_point_type s, const Vector &u);
+    inline  Vector operator*(const Vector &u, pgd_floating_point_type s);
+    inline  Vector operator/(const Vector &u, pgd_floating_point_type s);
+    inline  pgd_floating_point_type TripleScalarProduct(const Vector &u, const Vector &v, const Vector &w);
 
     inline void Vector::Set(pgd_floating_point_type xi, pgd_floating_point_type yi, pgd_floating_point_type zi)
     {
@@ -114,16 +100,11 @@ public:
         z = zi;
     }
 
-    inline  pgd_floating_point_type Vector::Magnitude(void)
+    inline  pgd_floating_point_type Vector::Magnitude(void) const
     {
         return (pgd_floating_point_type) sqrt(x*x + y*y + z*z);
     }
 
-    inline  pgd_floating_point_type Vector::Magnitude2(void)
-    {
-        return (pgd_floating_point_type) (x*x + y*y + z*z);
-    }
-
     inline  void  Vector::Normalize(void)
     {
         // wis - to cope with very small vectors (quite common) we need to divide by the largest magnitude element
@@ -171,7 +152,7 @@ public:
         z = -z;
     }
 
-    inline Vector& Vector::operator+=(Vector u)
+    inline Vector& Vector::operator+=(const Vector &u)
     {
         x += u.x;
         y += u.y;
@@ -179,7 +160,7 @@ public:
         return *this;
     }
 
-    inline  Vector& Vector::operator-=(Vector u)
+    inline  Vector& Vector::operator-=(const Vector &u)
     {
         x -= u.x;
         y -= u.y;
@@ -211,24 +192,19 @@ public:
         return *this;
     }
 
-    inline  Vector Vector::operator-(void)
-    {
-        return Vector(-x, -y, -z);
-    }
-
 
-    inline  Vector operator+(Vector u, Vector v)
+    inline  Vector operator+(const Vector &u, const Vector &v)
     {
         return Vector(u.x + v.x, u.y + v.y, u.z + v.z);
     }
 
-    inline  Vector operator-(Vector u, Vector v)
+    inline  Vector operator-(const Vector &u, const Vector &v)
     {
         return Vector(u.x - v.x, u.y - v.y, u.z - v.z);
     }
 
     // Vector cross product (u cross v)
-    inline  Vector operator^(Vector u, Vector v)
+    inline  Vector operator^(const Vector &u, const Vector &v)
     {
         return Vector(  u.y*v.z - u.z*v.y,
                         -u.x*v.z + u.z*v.x,
@@ -236,28 +212,28 @@ public:
     }
 
     // Vector dot product
-    inline  pgd_floating_point_type operator*(Vector u, Vector v)
+    inline  pgd_floating_point_type operator*(const Vector &u, const Vector &v)
     {
         return (u.x*v.x + u.y*v.y + u.z*v.z);
     }
 
-    inline  Vector operator*(pgd_floating_point_type s, Vector u)
+    inline  Vector operator*(pgd_floating_point_type s, const Vector &u)
     {
         return Vector(u.x*s, u.y*s, u.z*s);
     }
 
-    inline  Vector operator*(Vector u, pgd_floating_point_type s)
+    inline  Vector operator*(const Vector &u, pgd_floating_point_type s)
     {
         return Vector(u.x*s, u.y*s, u.z*s);
     }
 
-    inline  Vector operator/(Vector u, pgd_floating_point_type s)
+    inline  Vector operator/(const Vector &u, pgd_floating_point_type s)
     {
         return Vector(u.x/s, u.y/s, u.z/s);
     }
 
     // triple scalar product (u dot (v cross w))
-    inline  pgd_floating_point_type TripleScalarProduct(Vector u, Vector v, Vector w)
+    inline  pgd_floating_point_type TripleScalarProduct(const Vector &u, const Vector &v, const Vector &w)
     {
         return pgd_floating_point_type(   (u.x * (v.y*w.z - v.z*w.y)) +
                         (u.y * (-v.x*w.z + v.z*w.x)) +
@@ -275,34 +251,34 @@ public:
         pgd_floating_point_type   n;  // number (scalar) part
         Vector  v;  // vector part: v.x, v.y, v.z
 
-        Quaternion(void);
-        Quaternion(pgd_floating_point_type e0, pgd_floating_point_type e1, pgd_floating_point_type e2, pgd_floating_point_type e3);
+        constexpr Quaternion(void) : n(0), v() {}
+        constexpr Quaternion(pgd_floating_point_type e0, pgd_floating_point_type e1, pgd_floating_point_type e2, pgd_floating_point_type e3) : n(e0), v(e1, e2, e3) {}
 
         void Set(pgd_floating_point_type e0, pgd_floating_point_type e1, pgd_floating_point_type e2, pgd_floating_point_type e3);
 
-        pgd_floating_point_type   Magnitude(void);
-        Vector  GetVector(void);
-        pgd_floating_point_type   GetScalar(void);
+        pgd_floating_point_type   Magnitude(void) const;
+        constexpr Vector  GetVector(void) const { return v; }
+        constexpr pgd_floating_point_type   GetScalar(void) const { return n; }
         void Normalize();
-        Quaternion  operator+=(Quaternion q);
-        Quaternion  operator-=(Quaternion q);
+        Quaternion  operator+=(const Quaternion &q);
+        Quaternion  operator-=(const Quaternion &q);
         Quaternion operator*=(pgd_floating_point_type s);
         Quaternion operator/=(pgd_floating_point_type s);
-        Quaternion  operator~(void) const { return Quaternion(n, -v.x, -v.y, -v.z);}
+        constexpr Quaternion  operator~(void) const { return Quaternion(n, -v.x, -v.y, -v.z);}
     };
 
-    inline  Quaternion operator+(Quaternion q1, Quaternion q2);
-    inline  Quaternion operator-(Quaternion q1, Quaternion q2);
-    inline  Quaternion operator*(Quaternion q1, Quaternion q2);
-    inline  Quaternion operator*(Quaternion q, pgd_floating_point_type s);
-    inline  Quaternion operator*(pgd_floating_point_type s, Quaternion q);
-    inline  Quaternion operator*(Quaternion q, Vector v);
-    inline  Quaternion operator*(Vector v, Quaternion q);
-    inline  Quaternion operator/(Quaternion q, pgd_floating_point_type s);
-    inline  pgd_floating_point_type QGetAngle(Quaternion q);
+    inline  Quaternion operator+(const Quaternion &q1, const Quaternion &q2);
+    inline  Quaternion operator-(const Quaternion &q1, const Quaternion &q2);
+    inline  Quaternion operator*(const Quaternion &q1, const Quaternion &q2);
+    inline  Quaternion operator*(const Quaternion &q, pgd_floating_point_type s);
+    inline  Quaternion operator*(pgd_floating_point_type s, const Quaternion &q);
+    inline  Quaternion operator*(const Quaternion &q, const Vector &v);
+    inline  Quaternion operator*(const Vector &v, const Quaternion &q);
+    inline  Quaternion operator/(const Quaternion &q, pgd_floating_point_type s);
+    inline  pgd_floating_point_type QGetAngle(const Quaternion &q);
     inline  Vector QGetAxis(Quaternion q);
-    inline  Quaternion QRotate(Quaternion q1, Quaternion q2);
-    inline  Vector  QVRotate(Quaternion q, Vector v);
+    inline  Quaternion QRotate(const Quaternion &q1, const Quaternion &q2);
+    inline  Vector  QVRotate(const Quaternion &q, const Vector &v);
     inline  Quaternion  MakeQFromEulerAngles(pgd_floating_point_type x, pgd_floating_point_type y, pgd_floating_point_type z);
     inline  Vector  MakeEulerAnglesFromQ(Quaternion q);
     inline  Quaternion  MakeQFromAxis(pgd_floating_point_type x, pgd_floating_point_type y, pgd_floating_point_type z, pgd_floating_point_type angle);
@@ -311,22 +287,6 @@ public:
     inline Vector FindAxis(Quaternion qa, Quaternion qb);
     inline Quaternion FindRotation(Vector v1, Vector v2);
 
-    inline  Quaternion::Quaternion(void)
-    {
-        n = 0;
-        v.x = 0;
-        v.y = 0;
-        v.z = 0;
-    }
-
-
-    inline  Quaternion::Quaternion(pgd_floating_point_type e0, pgd_floating_point_type e1, pgd_floating_point_type e2, pgd_floating_point_type e3)
-    {
-        n = e0;
-        v.x = e1;
-        v.y = e2;
-        v.z = e3;
-    }
 
     inline  void Quaternion::Set(pgd_floating_point_type e0, pgd_floating_point_type e1, pgd_floating_point_type e2, pgd_floating_point_type e3)
     {
@@ -336,22 +296,12 @@ public:
         v.z = e3;
     }
 
-    inline  pgd_floating_point_type   Quaternion::Magnitude(void)
+    inline  pgd_floating_point_type   Quaternion::Magnitude(void) const
     {
         return (pgd_floating_point_type) sqrt(n*n + v.x*v.x + v.y*v.y + v.z*v.z);
     }
 
-    inline  Vector  Quaternion::GetVector(void)
-    {
-        return Vector(v.x, v.y, v.z);
-    }
-
-    inline  pgd_floating_point_type   Quaternion::GetScalar(void)
-    {
-        return n;
-    }
-
-    inline  Quaternion  Quaternion::operator+=(Quaternion q)
+    inline  Quaternion  Quaternion::operator+=(const Quaternion &q)
     {
         n += q.n;
         v.x += q.v.x;
@@ -360,7 +310,7 @@ public:
         return *this;
     }
 
-    inline  Quaternion  Quaternion::operator-=(Quaternion q)
+    inline  Quaternion  Quaternion::operator-=(const Quaternion &q)
     {
         n -= q.n;
         v.x -= q.v.x;
@@ -392,7 +342,7 @@ public:
         return Quaternion(n, -v.x, -v.y, -v.z);
     }*/
 
-    inline  Quaternion operator+(Quaternion q1, Quaternion q2)
+    inline  Quaternion operator+(const Quaternion &q1, const Quaternion &q2)
     {
         return  Quaternion( q1.n + q2.n,
                             q1.v.x + q2.v.x,
@@ -400,7 +350,7 @@ public:
                             q1.v.z + q2.v.z);
     }
 
-    inline  Quaternion operator-(Quaternion q1, Quaternion q2)
+    inline  Quaternion operator-(const Quaternion &q1, const Quaternion &q2)
     {
         return  Quaternion( q1.n - q2.n,
                             q1.v.x - q2.v.x,
@@ -408,7 +358,7 @@ public:
                             q1.v.z - q2.v.z);
     }
 
-    inline  Quaternion operator*(Quaternion q1, Quaternion q2)
+    inline  Quaternion operator*(const Quaternion &q1, const Quaternion &q2)
     {
         return  Quaternion( q1.n*q2.n - q1.v.x*q2.v.x - q1.v.y*q2.v.y - q1.v.z*q2.v.z,
                             q1.n*q2.v.x + q1.v.x*q2.n + q1.v.y*q2.v.z - q1.v.z*q2.v.y,
@@ -416,17 +366,17 @@ public:
                             q1.n*q2.v.z + q1.v.z*q2.n + q1.v.x*q2.v.y - q1.v.y*q2.v.x);
     }
 
-    inline  Quaternion operator*(Quaternion q, pgd_floating_point_type s)
+    inline  Quaternion operator*(const Quaternion &q, pgd_floating_point_type s)
     {
         return  Quaternion(q.n*s, q.v.x*s, q.v.y*s, q.v.z*s);
     }
 
-    inline  Quaternion operator*(pgd_floating_point_type s, Quaternion q)
+    inline  Quaternion operator*(pgd_floating_point_type s, const Quaternion &q)
     {
         return  Quaternion(q.n*s, q.v.x*s, q.v.y*s, q.v.z*s);
     }
 
-    inline  Quaternion operator*(Quaternion q, Vector v)
+    inline  Quaternion operator*(const Quaternion &q, const Vector &v)
     {
         return  Quaternion( -(q.v.x*v.x + q.v.y*v.y + q.v.z*v.z),
                             q.n*v.x + q.v.y*v.z - q.v.z*v.y,
@@ -434,7 +384,7 @@ public:
                             q.n*v.z + q.v.x*v.y - q.v.y*v.x);
     }
 
-    inline  Quaternion operator*(Vector v, Quaternion q)
+    inline  Quaternion operator*(const Vector &v, const Quaternion &q)
     {
         return  Quaternion( -(q.v.x*v.x + q.v.y*v.y + q.v.z*v.z),
                             q.n*v.x + q.v.z*v.y - q.v.y*v.z,
@@ -442,12 +392,12 @@ public:
                             q.n*v.z + q.v.y*v.x - q.v.x*v.y);
     }
 
-    inline  Quaternion operator/(Quaternion q, pgd_floating_point_type s)
+    inline  Quaternion operator/(const Quaternion &q, pgd_floating_point_type s)
     {
         return  Quaternion(q.n/s, q.v.x/s, q.v.y/s, q.v.z/s);
     }
 
-    inline  pgd_floating_point_type QGetAngle(Quaternion q)
+    inline  pgd_floating_point_type QGetAngle(const Quaternion &q)
     {
         if (q.n <= -1) return 0; // 2 * pi
         if (q.n >= 1) return 0; // 2 * 0
@@ -461,49 +411,96 @@ public:
         return v;
     }
 
-    inline  Quaternion QRotate(Quaternion q1, Quaternion q2)
+    inline  Quaternion QRotate(const Quaternion &q1, const Quaternion &q2)
     {
         return  q1*q2*(~q1);
     }
 
-    inline  Vector  QVRotate(Quaternion q, Vector v)
+    // QVRotate with the quaternion terms formed once so that many vectors can be rotated
+    // by the same quaternion. Each vector uses exactly the arithmetic of QVRotate so the
+    // results are identical, and the array forms are simple loops the compiler can vectorise.
+    class QVRotator {
+public:
+        explicit QVRotator(const Quaternion &q);
+
+        Vector Rotate(const Vector &v) const;
+        void Rotate(const Vector *in, Vector *out, int n) const;
+        // out = rotated in + translation
+        void Transform(const Vector &translation, const Vector *in, Vector *out, int n) const;
+
+private:
+        pgd_floating_point_type m_xx, m_xy, m_xz;
+        pgd_floating_point_type m_yx, m_yy, m_yz;
+        pgd_floating_point_type m_zx, m_zy, m_zz;
+    };
+
+    inline  QVRotator::QVRotator(const Quaternion &q)
     {
-#ifdef EASY_TO_READ
-        Quaternion t;
+        // optimisation based on OpenSG code
+        pgd_floating_point_type QwQx, QwQy, QwQz, QxQy, QxQz, QyQz;
 
+        QwQx = q.n * q.v.x;
+        QwQy = q.n * q.v.y;
+        QwQz = q.n * q.v.z;
+        QxQy = q.v.x * q.v.y;
+        QxQz = q.v.x * q.v.z;
+        QyQz = q.v.y * q.v.z;
 
-        t = q*v*(~q);
+        m_xy = -QwQz + QxQy;
+        m_xz =  QwQy + QxQz;
+        m_yx =  QwQz + QxQy;
+        m_yz = -QwQx + QyQz;
+        m_zx = -QwQy + QxQz;
+        m_zy =  QwQx + QyQz;
 
-        return  t.GetVector();
-#else
-    // optimisation based on OpenSG code
-    pgd_floating_point_type rx,ry,rz;
-    pgd_floating_point_type QwQx, QwQy, QwQz, QxQy, QxQz, QyQz;
+        pgd_floating_point_type QwQw, QxQx, QyQy, QzQz;
 
-    QwQx = q.n * q.v.x;
-    QwQy = q.n * q.v.y;
-    QwQz = q.n * q.v.z;
-    QxQy = q.v.x * q.v.y;
-    QxQz = q.v.x * q.v.z;
-    QyQz = q.v.y * q.v.z;
+        QwQw = q.n * q.n;
+        QxQx = q.v.x * q.v.x;
+        QyQy = q.v.y * q.v.y;
+        QzQz = q.v.z * q.v.z;
 
-    rx = 2* (v.y * (-QwQz + QxQy) + v.z *( QwQy + QxQz));
-    ry = 2* (v.x * ( QwQz + QxQy) + v.z *(-QwQx + QyQz));
-    rz = 2* (v.x * (-QwQy + QxQz) + v.y *( QwQx + QyQz));
+        m_xx = QwQw + QxQx - QyQy - QzQz;
+        m_yy = QwQw - QxQx + QyQy - QzQz;
+        m_zz = QwQw - QxQx - QyQy + QzQz;
+    }
 
-    pgd_floating_point_type QwQw, QxQx, QyQy, QzQz;
+    inline  Vector QVRotator::Rotate(const Vector &v) const
+    {
+        pgd_floating_point_type rx,ry,rz;
 
-    QwQw = q.n * q.n;
-    QxQx = q.v.x * q.v.x;
-    QyQy = q.v.y * q.v.y;
-    QzQz = q.v.z * q.v.z;
+        rx = 2* (v.y * m_xy + v.z * m_xz);
+        ry = 2* (v.x * m_yx + v.z * m_yz);
+        rz = 2* (v.x * m_zx + v.y * m_zy);
 
-    rx+= v.x * (QwQw + QxQx - QyQy - QzQz);
-    ry+= v.y * (QwQw - QxQx + QyQy - QzQz);
-    rz+= v.z * (QwQw - QxQx - QyQy + QzQz);
+        rx+= v.x * m_xx;
+        ry+= v.y * m_yy;
+        rz+= v.z * m_zz;
 
-    return Vector(rx,ry,rz);
+        return Vector(rx,ry,rz);
+    }
 
+    inline  void QVRotator::Rotate(const Vector *in, Vector *out, int n) const
+    {
+        for (int i = 0; i < n; i++) out[i] = Rotate(in[i]);
+    }
+
+    inline  void QVRotator::Transform(const Vector &translation, const Vector *in, Vector *out, int n) const
+    {
+        for (int i = 0; i < n; i++) out[i] = Rotate(in[i]) + translation;
+    }
+
+    inline  Vector  QVRotate(const Quaternion &q, const Vector &v)
+    {
+#ifdef EASY_TO_READ
+        Quaternion t;
+
+
+        t = q*v*(~q);
+
+        return  t.GetVector();
+#else
+        return QVRotator(q).Rotate(v);
 #endif
     }
 
@@ -688,9 +685,9 @@ public:
                     pgd_floating_point_type r2c1, pgd_floating_point_type r2c2, pgd_floating_point_type r2c3,
                     pgd_floating_point_type r3c1, pgd_floating_point_type r3c2, pgd_floating_point_type r3c3 );
 
-        pgd_floating_point_type   det(void);
-        Matrix3x3   Transpose(void);
-        Matrix3x3   Inverse(void);
+        pgd_floating_point_type   det(void) const;
+        Matrix3x3   Transpose(void) const;
+        Matrix3x3   Inverse(void) const;
 
         Matrix3x3& operator+=(Matrix3x3 m);
         Matrix3x3& operator-=(Matrix3x3 m);
@@ -704,8 +701,8 @@ public:
     inline  Matrix3x3 operator*(Matrix3x3 m1, Matrix3x3 m2);
     inline  Matrix3x3 operator*(Matrix3x3 m, pgd_floating_point_type s);
     inline  Matrix3x3 operator*(pgd_floating_point_type s, Matrix3x3 m);
-    inline  Vector operator*(Matrix3x3 m, Vector u);
-    inline  Vector operator*(Vector u, Matrix3x3 m);
+    inline  Vector operator*(const Matrix3x3 &m, const Vector &u);
+    inline  Vector operator*(const Vector &u, const Matrix3x3 &m);
 
 
 
@@ -786,7 +783,7 @@ public:
         e23 = 2.0 * (tmp1 - tmp2)*invs ;
     }
 
-    inline  pgd_floating_point_type   Matrix3x3::det(void)
+    inline  pgd_floating_point_type   Matrix3x3::det(void) const
     {
         return  e11*e22*e33 -
         e11*e32*e23 +
@@ -796,12 +793,12 @@ public:
         e31*e22*e13;
     }
 
-    inline  Matrix3x3   Matrix3x3::Transpose(void)
+    inline  Matrix3x3   Matrix3x3::Transpose(void) const
     {
         return Matrix3x3(e11,e21,e31,e12,e22,e32,e13,e23,e33);
     }
 
-    inline  Matrix3x3   Matrix3x3::Inverse(void)
+    inline  Matrix3x3   Matrix3x3::Inverse(void) const
     {
         pgd_floating_point_type   d = e11*e22*e33 -
         e11*e32*e23 +
@@ -957,14 +954,14 @@ public:
                             m.e33*s);
     }
 
-    inline  Vector operator*(Matrix3x3 m, Vector u)
+    inline  Vector operator*(const Matrix3x3 &m, const Vector &u)
     {
         return Vector(  m.e11*u.x + m.e12*u.y + m.e13*u.z,
                         m.e21*u.x + m.e22*u.y + m.e23*u.z,
                         m.e31*u.x + m.e32*u.y + m.e33*u.z);
     }
 
-    inline  Vector operator*(Vector u, Matrix3x3 m)
+    inline  Vector operator*(const Vector &u, const Matrix3x3 &m)
     {
         return Vector(  u.x*m.e11 + u.y*m.e21 + u.z*m.e31,
                         u.x*m.e12 + u.y*m.e22 + u.z*m.e32,
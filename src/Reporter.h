@@ -20,6 +20,7 @@ public:
     Reporter();
 
     virtual bool ShouldAbort() { return false; }
+    virtual bool CanAbort() { return false; } // true if ShouldAbort ever needs to be called
 
 #ifdef USE_QT
     virtual void Draw(SimulationWindow *window) = 0;
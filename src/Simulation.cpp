@@ -14,6 +14,7 @@
 
 #include "Util.h"
 #include "DebugControl.h"
+#include "Trace.h"
 #include "CyclicDriver.h"
 #include "StepDriver.h"
 #include "DataTarget.h"
@@ -45,6 +46,7 @@
 #include "NPointStrap.h"
 #include "FixedJoint.h"
 #include "TrimeshGeom.h"
+#include "HeightfieldGeom.h"
 #include "Marker.h"
 #include "Reporter.h"
 #include "TorqueReporter.h"
@@ -64,8 +66,14 @@
 
 #ifdef USE_QT
 #include "SimulationWindow.h"
+#include "FacetedBatch.h"
+#endif
+#if defined(USE_QT) || defined(USE_HEADLESS)
 #include "FacetedObject.h"
 #endif
+#if defined(USE_HEADLESS)
+#include "MeshCache.h"
+#endif
 
 #if defined(USE_QT) // && !defined(USE_WI_BB) // this is a bit odd - I'm not sure why it is here in the USE_WI_BB version
 #include "mainwindow.h"
@@ -91,6 +99,8 @@
 #include <ctype.h>
 #include <cmath>
 #include <cmath>
+#include <algorithm>
+#include <climits>
 
 #define _I(i,j) I[(i)*4+(j)]
 
@@ -122,8 +132,6 @@ Simulation::Simulation()
     m_StepSize = 0;
     m_DisplaySkip = 1;
     m_CycleTime = -1;
-    m_MechanicalEnergy = 0;
-    m_MetabolicEnergy = 0;
     m_FitnessType = DistanceTravelled;
     m_DistanceTravelledBodyID = 0;
     m_BMR = 0;
@@ -132,6 +140,10 @@ Simulation::Simulation()
     m_TimeLimit = 0;
     m_MechanicalEnergyLimit = 0;
     m_MetabolicEnergyLimit = 0;
+    m_PruneFlag = false;
+    m_PruneThreshold = 0;
+    m_PruneMaximumSpeed = 0;
+    m_Pruned = false;
     m_InputKinematicsFlag = false;
     m_OutputKinematicsFlag = false;
     m_OutputWarehouseFlag = false;
@@ -146,11 +158,20 @@ Simulation::Simulation()
     m_ModelStateRelative = true;
     m_AllowInternalCollisions = true;
     m_AllowConnectedCollisions = false;
+    m_ConnectedCollisionsInBroadphase = false;
     m_StepType = WorldStep;
+    m_StrapVelocityType = FiniteDifferenceVelocity;
+    m_MuscleCurveMaxRelativeError = 0;
+    m_DriverUpdateInterval = 1;
+    m_DriverInterpolation = DriverEngine::HoldValue;
+    m_MuscleUpdateInterval = 1;
+    m_DumpInterval = 1;
     m_ContactAbort = false;
     m_SimulationError = 0;
     m_DataTargetAbort = false;
     m_AbortOnODEMessage = false;
+    m_DataTargetQueueNext = 0;
+    m_DataTargetQueueBounded = false;
     m_KinematicMatchMiniMaxFitness = 0;
     m_StraightenBody = false;
     m_ClosestWarehouseFitness = -DBL_MAX;
@@ -166,21 +187,13 @@ Simulation::Simulation()
     m_CaseSensitiveXMLAttributes = false;
 
     // values for energy partition
-    m_PositiveMechanicalWork = 0;
-    m_NegativeMechanicalWork = 0;
-    m_PositiveContractileWork = 0;
-    m_NegativeContractileWork = 0;
-    m_PositiveSerialElasticWork = 0;
-    m_NegativeSerialElasticWork = 0;
-    m_PositiveParallelElasticWork = 0;
-    m_NegativeParallelElasticWork = 0;
 
     // format controls
     m_SanityCheckAxis = YAxis;
 
     dSetMessageHandler(ODEMessageTrap);
 
-#ifdef USE_QT
+#if defined(USE_QT) || defined(USE_HEADLESS)
     m_Interface.EnvironmentAxisSize[0] = m_Interface.EnvironmentAxisSize[1] = m_Interface.EnvironmentAxisSize[2] = 1.0;
     m_Interface.EnvironmentColour.SetColour(1, 0, 1, 1);
     m_Interface.BodyAxisSize[0] = m_Interface.BodyAxisSize[1] = m_Interface.BodyAxisSize[2] = 0.05;
@@ -207,7 +220,17 @@ Simulation::Simulation()
     m_Interface.MarkerColour.SetColour(1, 1, 0, 0.5);
     m_Interface.MarkerRadius = 0.03;
     m_Interface.TrackBodyID = "Torso";
+    m_Interface.CameraDistance = 50;
+    m_Interface.FOV = 5;
+    m_Interface.CameraVec[0] = 0; m_Interface.CameraVec[1] = 1; m_Interface.CameraVec[2] = 0;
+    m_Interface.COI[0] = 0; m_Interface.COI[1] = 0; m_Interface.COI[2] = 0;
+    m_Interface.Up[0] = 0; m_Interface.Up[1] = 0; m_Interface.Up[2] = 1;
+    m_Interface.FrontClip = 1;
+    m_Interface.BackClip = 100;
+    m_Interface.OrthographicProjection = true;
+#endif
 
+#ifdef USE_QT
     m_nextTextureID = 1;
     m_MainWindow = 0;
     m_drawContactForces = false;
@@ -222,14 +245,14 @@ Simulation::~Simulation()
 
     if (gDebug == EnergyPartitionDebug)
     {
-        *gDebugStream << "m_PositiveMechanicalWork " << m_PositiveMechanicalWork <<
-                " m_NegativeMechanicalWork " << m_NegativeMechanicalWork <<
-                " m_PositiveContractileWork " << m_PositiveContractileWork <<
-                " m_NegativeContractileWork " << m_NegativeContractileWork <<
-                " m_PositiveSerialElasticWork " << m_PositiveSerialElasticWork <<
-                " m_NegativeSerialElasticWork " << m_NegativeSerialElasticWork <<
-                " m_PositiveParallelElasticWork " << m_PositiveParallelElasticWork <<
-                " m_NegativeParallelElasticWork " << m_NegativeParallelElasticWork <<
+        *gDebugStream << "m_PositiveMechanicalWork " << m_EnergyAccounts.GetPositiveMechanicalWork() <<
+                " m_NegativeMechanicalWork " << m_EnergyAccounts.GetNegativeMechanicalWork() <<
+                " m_PositiveContractileWork " << m_EnergyAccounts.GetPositiveContractileWork() <<
+                " m_NegativeContractileWork " << m_EnergyAccounts.GetNegativeContractileWork() <<
+                " m_PositiveSerialElasticWork " << m_EnergyAccounts.GetPositiveSerialElasticWork() <<
+                " m_NegativeSerialElasticWork " << m_EnergyAccounts.GetNegativeSerialElasticWork() <<
+                " m_PositiveParallelElasticWork " << m_EnergyAccounts.GetPositiveParallelElasticWork() <<
+                " m_NegativeParallelElasticWork " << m_EnergyAccounts.GetNegativeParallelElasticWork() <<
                 "\n";
     }
 
@@ -256,6 +279,7 @@ Simulation::~Simulation()
     dJointGroupDestroy(m_ContactGroup);
     dSpaceDestroy(m_SpaceID);
     dWorldDestroy(m_WorldID);
+    TrimeshGeom::ClearDataCache(); // the geoms have all gone and the data has to be destroyed while ODE is still open
     dCloseODE();
 
     // clear the stored xml data
@@ -349,7 +373,7 @@ int Simulation::LoadModel(char *xmlDataBuffer)
                 if ((!strcmp(cur->name(), "REPORTER"))) ParseReporter(cur);
                 if ((!strcmp(cur->name(), "CONTROLLER"))) ParseController(cur);
                 if ((!strcmp(cur->name(), "WAREHOUSE"))) ParseWarehouse(cur);
-#ifdef USE_QT
+#if defined(USE_QT) || defined(USE_HEADLESS)
                 if ((!strcmp(cur->name(), "INTERFACE"))) ParseInterface(cur);
 #endif
             }
@@ -377,6 +401,7 @@ int Simulation::LoadModel(char *xmlDataBuffer)
             {
                 *gDebugStream << iter2->first << " late initialisation\n";
             }
+            iter2->second->SetCurveMaxRelativeError(m_MuscleCurveMaxRelativeError);
             iter2->second->LateInitialisation();
         }
 
@@ -391,6 +416,17 @@ int Simulation::LoadModel(char *xmlDataBuffer)
             throw __LINE__;
         }
 
+        // the collision filtering depends on the bodies and joints so it has to wait until they all exist
+        SetCollisionBits();
+        BuildAbortCheckLists();
+        BuildDataTargetQueue();
+        BuildMuscleForceLists();
+        m_DriverEngine.Build(m_DriverList);
+        m_DriverEngine.SetUpdateInterval(m_DriverUpdateInterval, m_StepSize, m_DriverInterpolation);
+        m_EnergyAccounts.SetNumMuscles(int(m_MuscleList.size()));
+        for (std::map<std::string, Muscle *>::const_iterator iter = m_MuscleList.begin(); iter != m_MuscleList.end(); iter++)
+            iter->second->GetStrap()->SetVelocityType(m_StrapVelocityType);
+
         // for the time being just set the current warehouse to the first one in the list
         if (m_CurrentWarehouse.length() == 0 && m_WarehouseList.size() > 0) m_CurrentWarehouse = m_WarehouseList.begin()->first;
 
@@ -504,6 +540,8 @@ int Simulation::LoadModel(char *xmlDataBuffer)
 //----------------------------------------------------------------------------
 void Simulation::UpdateSimulation()
 {
+    Trace::SetTime(m_SimulationTime);
+
     // read in external kinematics if used
     if (m_InputKinematicsFlag)
     {
@@ -526,25 +564,30 @@ void Simulation::UpdateSimulation()
 
             double minScore = DBL_MAX;
             double matchScore;
-            std::map<std::string, DataTarget *>::const_iterator iter3;
-            for (iter3=m_DataTargetList.begin(); iter3 != m_DataTargetList.end(); iter3++)
+            // the queue is in time order so only its head needs checking and each target time is used exactly once
+            // since the step size is much smaller than the interval between targets (probably)
+            double tolerance = m_StepSize * 0.50000000001;
+            while (m_DataTargetQueueNext < m_DataTargetQueue.size() && m_SimulationTime - m_DataTargetQueue[m_DataTargetQueueNext].time > tolerance)
+                m_DataTargetQueueNext++; // missed targets (e.g. before the start time) are never scored
+            m_DueDataTargetEvents.clear();
+            while (m_DataTargetQueueNext < m_DataTargetQueue.size() && fabs(m_DataTargetQueue[m_DataTargetQueueNext].time - m_SimulationTime) <= tolerance)
+                m_DueDataTargetEvents.push_back(m_DataTargetQueue[m_DataTargetQueueNext++]);
+            if (m_DueDataTargetEvents.size() > 1)
+                std::sort(m_DueDataTargetEvents.begin(), m_DueDataTargetEvents.end(),
+                          [](const DataTargetEvent &a, const DataTargetEvent &b) { return a.order < b.order; });
+            for (size_t i = 0; i < m_DueDataTargetEvents.size(); i++)
             {
-                int lastIndex = iter3->second->GetLastMatchIndex();
-                int index = iter3->second->TargetMatch(m_SimulationTime, m_StepSize * 0.50000000001);
-                // on rare occasions because of rounding we may get two matches we can check this using the lastIndex since this is the only palce where a match is requested
-                if (index != -1 && index != lastIndex) // since step size is much smaller than the interval between targets (probably), this should get called exactly once per target time defintion
-                {
-                    matchScore = iter3->second->GetMatchValue(index);
-                    m_KinematicMatchFitness += matchScore;
-                    if (matchScore < minScore)
-                        minScore = matchScore;
-                    if (gDebug == FitnessDebug) *gDebugStream <<
-                                                                 "Simulation::UpdateSimulation m_SimulationTime " << m_SimulationTime <<
-                                                                 " DataTarget->name " << *iter3->second->GetName() <<
-                                                                 " matchScore " << matchScore <<
-                                                                 " minScore " << minScore <<
-                                                                 " m_KinematicMatchFitness " << m_KinematicMatchFitness << "\n";
-                }
+                DataTarget *dataTarget = m_DueDataTargetEvents[i].dataTarget;
+                matchScore = dataTarget->GetMatchValue(m_DueDataTargetEvents[i].index);
+                m_KinematicMatchFitness += matchScore;
+                if (matchScore < minScore)
+                    minScore = matchScore;
+                if (TRACE_ON(FitnessDebug)) *gDebugStream <<
+                                                             "Simulation::UpdateSimulation m_SimulationTime " << m_SimulationTime <<
+                                                             " DataTarget->name " << *dataTarget->GetName() <<
+                                                             " matchScore " << matchScore <<
+                                                             " minScore " << minScore <<
+                                                             " m_KinematicMatchFitness " << m_KinematicMatchFitness << "\n";
             }
             if (minScore < DBL_MAX)
                 m_KinematicMatchMiniMaxFitness += minScore;
@@ -562,6 +605,7 @@ void Simulation::UpdateSimulation()
     dSpaceCollide(m_SpaceID, this, &NearCallback);
 
     bool activationsDone = false;
+    if (activationsDone == false) m_DriverEngine.Update(m_SimulationTime);
 
 //    if (activationsDone == false)
 //    {
@@ -576,36 +620,66 @@ void Simulation::UpdateSimulation()
 //    }
 
     // update the muscles
+    // the forces are accumulated per body in the same way as dBodyAddForceAtPos and then added once for each body
+    // the muscles are only recalculated every m_MuscleUpdateInterval steps and the body forces are held in between
     double tension;
-    std::vector<PointForce *> *pointForceList;
+    std::vector<PointForce> *pointForceList;
     std::map<std::string, Muscle *>::const_iterator iter1;
     PointForce *pointForce;
-    for (iter1 = m_MuscleList.begin(); iter1 != m_MuscleList.end(); iter1++)
+    BodyForceAccumulator *accumulator;
+    const double *bodyPosition;
+    double f[3], q[3];
+    if (m_StepCount % m_MuscleUpdateInterval == 0)
     {
-        if (activationsDone == false) iter1->second->SumDrivers(m_SimulationTime);
-        iter1->second->SetActivation(iter1->second->GetCurrentDriverSum(), m_StepSize);
-        iter1->second->CalculateStrap(m_StepSize);
+        double muscleTimeIncrement = m_StepSize * m_MuscleUpdateInterval;
+        for (size_t i = 0; i < m_MuscleForceBodyList.size(); i++)
+        {
+            accumulator = &m_MuscleForceBodyList[i];
+            accumulator->force[0] = accumulator->force[1] = accumulator->force[2] = 0;
+            accumulator->torque[0] = accumulator->torque[1] = accumulator->torque[2] = 0;
+        }
+        // the elastic energies are only recorded for the energy partition output
+        m_EnergyAccounts.SetRecordElasticEnergy(TRACE_ON(EnergyPartitionDebug));
+        const int *bodyIndex = m_MuscleForceBodyIndexList.data();
+        int muscleIndex = 0;
+        for (iter1 = m_MuscleList.begin(); iter1 != m_MuscleList.end(); iter1++, muscleIndex++)
+        {
+            iter1->second->SetActivation(iter1->second->GetCurrentDriverSum(), muscleTimeIncrement);
+            iter1->second->CalculateStrap(muscleTimeIncrement);
+            iter1->second->AccumulateEnergy(&m_EnergyAccounts, muscleIndex, muscleTimeIncrement);
 
-        pointForceList = iter1->second->GetPointForceList();
-        tension = iter1->second->GetTension();
+            pointForceList = iter1->second->GetPointForceList();
+            tension = iter1->second->GetTension();
 #ifdef DEBUG_CHECK_FORCES
-        pgd::Vector force(0, 0, 0);
+            pgd::Vector force(0, 0, 0);
 #endif
-        for (unsigned int i = 0; i < pointForceList->size(); i++)
-        {
-            pointForce = (*pointForceList)[i];
-            dBodyAddForceAtPos(pointForce->body->GetBodyID(),
-                               pointForce->vector[0] * tension, pointForce->vector[1] * tension, pointForce->vector[2] * tension,
-                               pointForce->point[0], pointForce->point[1], pointForce->point[2]);
+            for (unsigned int i = 0; i < pointForceList->size(); i++)
+            {
+                pointForce = &(*pointForceList)[i];
+                accumulator = &m_MuscleForceBodyList[*bodyIndex++];
+                bodyPosition = dBodyGetPosition(accumulator->bodyID);
+                f[0] = pointForce->vector[0] * tension; f[1] = pointForce->vector[1] * tension; f[2] = pointForce->vector[2] * tension;
+                q[0] = pointForce->point[0] - bodyPosition[0]; q[1] = pointForce->point[1] - bodyPosition[1]; q[2] = pointForce->point[2] - bodyPosition[2];
+                accumulator->force[0] += f[0]; accumulator->force[1] += f[1]; accumulator->force[2] += f[2];
+                accumulator->torque[0] += q[1] * f[2] - q[2] * f[1];
+                accumulator->torque[1] += q[2] * f[0] - q[0] * f[2];
+                accumulator->torque[2] += q[0] * f[1] - q[1] * f[0];
 #ifdef DEBUG_CHECK_FORCES
-            force += pgd::Vector(pointForce->vector[0] * tension, pointForce->vector[1] * tension, pointForce->vector[2] * tension);
+                force += pgd::Vector(f[0], f[1], f[2]);
 #endif
-        }
+            }
 #ifdef DEBUG_CHECK_FORCES
-        std::cerr.setf(std::ios::floatfield, std::ios::fixed);
-        std::cerr << iter1->first << " " << force.x << " " << force.y << " " << force.z << "\n";
-        std::cerr.unsetf(std::ios::floatfield);
+            std::cerr.setf(std::ios::floatfield, std::ios::fixed);
+            std::cerr << iter1->first << " " << force.x << " " << force.y << " " << force.z << "\n";
+            std::cerr.unsetf(std::ios::floatfield);
 #endif
+        }
+    }
+    for (size_t i = 0; i < m_MuscleForceBodyList.size(); i++)
+    {
+        accumulator = &m_MuscleForceBodyList[i];
+        dBodyAddForce(accumulator->bodyID, accumulator->force[0], accumulator->force[1], accumulator->force[2]);
+        dBodyAddTorque(accumulator->bodyID, accumulator->torque[0], accumulator->torque[1], accumulator->torque[2]);
     }
 
     // update the joints (needed for motors, end stops and stress calculations)
@@ -651,17 +725,13 @@ void Simulation::UpdateSimulation()
 
     // update the time counter
     m_SimulationTime += m_StepSize;
+    Trace::SetTime(m_SimulationTime);
 
     // update the step counter
     m_StepCount++;
 
-    // calculate the energies
-    for (iter1 = m_MuscleList.begin(); iter1 != m_MuscleList.end(); iter1++)
-    {
-        m_MechanicalEnergy += iter1->second->GetPower() * m_StepSize;
-        m_MetabolicEnergy += iter1->second->GetMetabolicPower() * m_StepSize;
-    }
-    m_MetabolicEnergy += m_BMR * m_StepSize;
+    // the muscle energies are added during the muscle update so only the basal rate is needed here
+    m_EnergyAccounts.AddBasalMetabolicPower(m_BMR, m_StepSize);
 
 #ifdef USE_QT
     // update the footprint indicator
@@ -699,189 +769,47 @@ void Simulation::UpdateSimulation()
 
     // all reporting is done after a simulation step
 
-    Dump();
+    // m_StepCount has already been incremented so this uses the same phase as the muscle updates and the first step is dumped
+    if ((m_StepCount - 1) % m_DumpInterval == 0) Dump();
 
-    if (gDebug == MuscleDebug)
+    if (TRACE_ON(MuscleDebug))
     {
         for (iter1 = m_MuscleList.begin(); iter1 != m_MuscleList.end(); iter1++)
         {
-            *gDebugStream << *iter1->second->GetName() << " " << m_SimulationTime
-                    << " length " << iter1->second->GetLength()
-                    << " velocity " << iter1->second->GetVelocity()
-                    << " tension " << iter1->second->GetTension()
-                    << " power " << iter1->second->GetPower()
-                    << " activation " << iter1->second->GetActivation()
-                    << " metabolic " << iter1->second->GetMetabolicPower()
-                    << "\n";
+            Trace::Record(MuscleStateEvent, *iter1->second->GetName(),
+                          {iter1->second->GetLength(), iter1->second->GetVelocity(), iter1->second->GetTension(),
+                           iter1->second->GetPower(), iter1->second->GetActivation(), iter1->second->GetMetabolicPower()});
         }
     }
 
-    double totalESE = 0;
-    double totalEPE = 0;
-    double totalElasticEnergy = 0;
-    if (gDebug == EnergyPartitionDebug)
+    if (TRACE_ON(EnergyPartitionDebug))
     {
-        for (iter1 = m_MuscleList.begin(); iter1 != m_MuscleList.end(); iter1++)
+        int muscleIndex = 0;
+        for (iter1 = m_MuscleList.begin(); iter1 != m_MuscleList.end(); iter1++, muscleIndex++)
         {
-            UGMMuscle *ugm = dynamic_cast<UGMMuscle *>(iter1->second);
-            if (ugm)
-            {
-                if (ugm->GetPower() > 0)
-                    m_PositiveMechanicalWork += ugm->GetPower() * m_StepSize;
-                else
-                    m_NegativeMechanicalWork += ugm->GetPower() * m_StepSize;
-
-                if (ugm->GetVCE() < 0)
-                    m_PositiveContractileWork += -1 * ugm->GetVCE() *
-                                                 ugm->GetFCE() * m_StepSize;
-                else
-                    m_NegativeContractileWork += -1 * ugm->GetVCE() *
-                                                 ugm->GetFCE() * m_StepSize;
-
-                if (ugm->GetVSE() < 0)
-                    m_PositiveSerialElasticWork += -1 * ugm->GetVSE() *
-                                                   ugm->GetFSE() * m_StepSize;
-                else
-                    m_NegativeSerialElasticWork += -1 * ugm->GetVSE() *
-                                                   ugm->GetFSE() * m_StepSize;
-
-                if (ugm->GetVPE() < 0)
-                    m_PositiveParallelElasticWork += -1 * ugm->GetVPE() *
-                                                     ugm->GetFPE() * m_StepSize;
-                else
-                    m_NegativeParallelElasticWork += -1 * ugm->GetVPE() *
-                                                     ugm->GetFPE() * m_StepSize;
-
-                *gDebugStream << *ugm->GetName() << " "
-                        << m_SimulationTime << " MechanicalPower "
-                        << ugm->GetPower() << " ContractilePower "
-                        << ugm->GetFCE() << " SerialElasticPower "
-                        << ugm->GetFSE() << " ParallelElasticPower "
-                        << ugm->GetFPE() << " SerialElasticEnergy "
-                        << ugm->GetESE() << " ParallelElasticEnergy "
-                        << ugm->GetEPE() << "\n";
-
-                totalESE += ugm->GetESE();
-                totalEPE += ugm->GetEPE();
-                totalElasticEnergy += ugm->GetESE();
-                totalElasticEnergy += ugm->GetEPE();
-            }
-
-            MAMuscle *mam = dynamic_cast<MAMuscle *>(iter1->second);
-            if (mam)
-            {
-                if (mam->GetPower() > 0)
-                    m_PositiveMechanicalWork += mam->GetPower() * m_StepSize;
-                else
-                    m_NegativeMechanicalWork += mam->GetPower() * m_StepSize;
-
-                *gDebugStream << *mam->GetName() << " "
-                        << m_SimulationTime << " MechanicalPower "
-                        << mam->GetPower() << "\n";
-            }
-
-            MAMuscleExtended *mamext = dynamic_cast<MAMuscleExtended *>(iter1->second);
-            if (mamext)
+            if (m_EnergyAccounts.HasElements(muscleIndex))
             {
-                if (mamext->GetPower() > 0)
-                    m_PositiveMechanicalWork += mamext->GetPower() * m_StepSize;
-                else
-                    m_NegativeMechanicalWork += mamext->GetPower() * m_StepSize;
-
-                if (mamext->GetVCE() < 0)
-                    m_PositiveContractileWork += -1 * mamext->GetVCE() *
-                                                 mamext->GetFCE() * m_StepSize;
-                else
-                    m_NegativeContractileWork += -1 * mamext->GetVCE() *
-                                                 mamext->GetFCE() * m_StepSize;
-
-                if (mamext->GetVSE() < 0)
-                    m_PositiveSerialElasticWork += -1 * mamext->GetVSE() *
-                                                   mamext->GetFSE() * m_StepSize;
-                else
-                    m_NegativeSerialElasticWork += -1 * mamext->GetVSE() *
-                                                   mamext->GetFSE() * m_StepSize;
-
-                if (mamext->GetVPE() < 0)
-                    m_PositiveParallelElasticWork += -1 * mamext->GetVPE() *
-                                                     mamext->GetFPE() * m_StepSize;
-                else
-                    m_NegativeParallelElasticWork += -1 * mamext->GetVPE() *
-                                                     mamext->GetFPE() * m_StepSize;
-
-                *gDebugStream << *mamext->GetName() << " "
+                *gDebugStream << *iter1->second->GetName() << " "
                         << m_SimulationTime << " MechanicalPower "
-                        << mamext->GetPower() << " ContractilePower "
-                        << mamext->GetPCE() << " SerialElasticPower "
-                        << mamext->GetPSE() << " ParallelElasticPower "
-                        << mamext->GetPPE() << " SerialElasticEnergy "
-                        << mamext->GetESE() << " ParallelElasticEnergy "
-                        << mamext->GetEPE() << "\n";
-
-                totalESE += mamext->GetESE();
-                totalEPE += mamext->GetEPE();
-                totalElasticEnergy += mamext->GetESE();
-                totalElasticEnergy += mamext->GetEPE();
+                        << m_EnergyAccounts.GetMechanicalPower(muscleIndex) << " ContractilePower "
+                        << m_EnergyAccounts.GetContractilePower(muscleIndex) << " SerialElasticPower "
+                        << m_EnergyAccounts.GetSerialElasticPower(muscleIndex) << " ParallelElasticPower "
+                        << m_EnergyAccounts.GetParallelElasticPower(muscleIndex) << " SerialElasticEnergy "
+                        << m_EnergyAccounts.GetSerialElasticEnergy(muscleIndex) << " ParallelElasticEnergy "
+                        << m_EnergyAccounts.GetParallelElasticEnergy(muscleIndex) << "\n";
             }
-
-            MAMuscleComplete *mamcomplete = dynamic_cast<MAMuscleComplete *>(iter1->second);
-            if (mamcomplete)
+            else if (m_EnergyAccounts.HasElasticEnergy(muscleIndex))
             {
-                if (mamcomplete->GetPower() > 0)
-                    m_PositiveMechanicalWork += mamcomplete->GetPower() * m_StepSize;
-                else
-                    m_NegativeMechanicalWork += mamcomplete->GetPower() * m_StepSize;
-
-                if (mamcomplete->GetVCE() < 0)
-                    m_PositiveContractileWork += -1 * mamcomplete->GetVCE() *
-                                                 mamcomplete->GetFCE() * m_StepSize;
-                else
-                    m_NegativeContractileWork += -1 * mamcomplete->GetVCE() *
-                                                 mamcomplete->GetFCE() * m_StepSize;
-
-                if (mamcomplete->GetVSE() < 0)
-                    m_PositiveSerialElasticWork += -1 * mamcomplete->GetVSE() *
-                                                   mamcomplete->GetFSE() * m_StepSize;
-                else
-                    m_NegativeSerialElasticWork += -1 * mamcomplete->GetVSE() *
-                                                   mamcomplete->GetFSE() * m_StepSize;
-
-                if (mamcomplete->GetVPE() < 0)
-                    m_PositiveParallelElasticWork += -1 * mamcomplete->GetVPE() *
-                                                     mamcomplete->GetFPE() * m_StepSize;
-                else
-                    m_NegativeParallelElasticWork += -1 * mamcomplete->GetVPE() *
-                                                     mamcomplete->GetFPE() * m_StepSize;
-
-                *gDebugStream << *mamcomplete->GetName() << " "
+                *gDebugStream << *iter1->second->GetName() << " "
                         << m_SimulationTime << " MechanicalPower "
-                        << mamcomplete->GetPower() << " ContractilePower "
-                        << mamcomplete->GetPCE() << " SerialElasticPower "
-                        << mamcomplete->GetPSE() << " ParallelElasticPower "
-                        << mamcomplete->GetPPE() << " SerialElasticEnergy "
-                        << mamcomplete->GetESE() << " ParallelElasticEnergy "
-                        << mamcomplete->GetEPE() << "\n";
-
-                totalESE += mamcomplete->GetESE();
-                totalEPE += mamcomplete->GetEPE();
-                totalElasticEnergy += mamcomplete->GetESE();
-                totalElasticEnergy += mamcomplete->GetEPE();
+                        << m_EnergyAccounts.GetMechanicalPower(muscleIndex) << " ElasticEnergy "
+                        << m_EnergyAccounts.GetElasticEnergy(muscleIndex) << "\n";
             }
-
-            DampedSpringMuscle *dsm = dynamic_cast<DampedSpringMuscle *>(iter1->second);
-            if (dsm)
+            else
             {
-                if (dsm->GetPower() > 0)
-                    m_PositiveMechanicalWork += dsm->GetPower() * m_StepSize;
-                else
-                    m_NegativeMechanicalWork += dsm->GetPower() * m_StepSize;
-
-                *gDebugStream << *dsm->GetName() << " "
+                *gDebugStream << *iter1->second->GetName() << " "
                         << m_SimulationTime << " MechanicalPower "
-                        << dsm->GetPower() << " ElasticEnergy "
-                        << dsm->GetElasticEnergy() << "\n";
-
-                totalElasticEnergy += dsm->GetElasticEnergy();
+                        << m_EnergyAccounts.GetMechanicalPower(muscleIndex) << "\n";
             }
         }
 
@@ -915,11 +843,11 @@ void Simulation::UpdateSimulation()
                 << totalPotentialEnergy << " "
                 << totalLinearKineticEnergy[0] << " " << totalLinearKineticEnergy[1] << " " << totalLinearKineticEnergy[2] << " "
                 << totalRotationalKineticEnergy << " "
-                << totalESE << " "
-                << totalEPE << "\n";
+                << m_EnergyAccounts.GetSerialElasticEnergy() << " "
+                << m_EnergyAccounts.GetParallelElasticEnergy() << "\n";
     }
 
-    if (gDebug == CentreOfMassDebug)
+    if (TRACE_ON(CentreOfMassDebug))
     {
         dVector3 cm = {0, 0, 0, 0};
         dVector3 cmv = {0, 0, 0, 0};
@@ -948,7 +876,7 @@ void Simulation::UpdateSimulation()
                 << " " << cmv[0] << " " << cmv[1] << " " << cmv[2] << "\n";
     }
 
-    if (gDebug == JointDebug)
+    if (TRACE_ON(JointDebug))
     {
         dJointFeedback *jointFeedback;
         std::map<std::string, Joint *>::const_iterator iter3;
@@ -988,7 +916,7 @@ void Simulation::UpdateSimulation()
             }        }
     }
 
-    if (gDebug == ContactDebug)
+    if (TRACE_ON(ContactDebug))
     {
         dJointFeedback *jointFeedback;
         dBodyID bodyID;
@@ -1029,7 +957,7 @@ void Simulation::UpdateSimulation()
         }
     }
 
-    if (gDebug == ActivationSegmentStateDebug)
+    if (TRACE_ON(ActivationSegmentStateDebug))
     {
         *gDebugStream << m_DriverList.size();
         std::map<std::string, Driver *>::const_iterator iter6;
@@ -1146,11 +1074,10 @@ bool Simulation::TestForCatastrophy()
 
     // check that all bodies meet velocity and stop conditions
 
-    std::map<std::string, Body *>::const_iterator iter1;
     LimitTestResult p;
-    for (iter1 = m_BodyList.begin(); iter1 != m_BodyList.end(); iter1++)
+    for (size_t i = 0; i < m_LimitTestBodyList.size(); i++)
     {
-        p = iter1->second->TestLimits();
+        p = m_LimitTestBodyList[i]->TestLimits();
         switch (p)
         {
         case WithinLimits:
@@ -1160,88 +1087,81 @@ bool Simulation::TestForCatastrophy()
         case YPosError:
         case ZPosError:
 #if defined(USE_QT) && !defined(USE_WI_BB)
-            ss << "Failed due to position error " << p << " in: " << *iter1->second->GetName();
+            ss << "Failed due to position error " << p << " in: " << *m_LimitTestBodyList[i]->GetName();
             m_MainWindow->log(ss.str().c_str());
 #endif
-            std::cerr << "Failed due to position error " << p << " in: " << *iter1->second->GetName() << "\n";
+            std::cerr << "Failed due to position error " << p << " in: " << *m_LimitTestBodyList[i]->GetName() << "\n";
             return true;
 
         case XVelError:
         case YVelError:
         case ZVelError:
 #if defined(USE_QT) && !defined(USE_WI_BB)
-            ss << "Failed due to velocity error " << p << " in: " << *iter1->second->GetName();
+            ss << "Failed due to velocity error " << p << " in: " << *m_LimitTestBodyList[i]->GetName();
             m_MainWindow->log(ss.str().c_str());
 #endif
-            std::cerr << "Failed due to velocity error " << p << " in: " << *iter1->second->GetName() << "\n";
+            std::cerr << "Failed due to velocity error " << p << " in: " << *m_LimitTestBodyList[i]->GetName() << "\n";
             return true;
 
         case NumericalError:
 #if defined(USE_QT) && !defined(USE_WI_BB)
-            ss << "Failed due to numerical error " << p << " in: " << *iter1->second->GetName();
+            ss << "Failed due to numerical error " << p << " in: " << *m_LimitTestBodyList[i]->GetName();
             m_MainWindow->log(ss.str().c_str());
 #endif
-            std::cerr << "Failed due to numerical error " << p << " in: " << *iter1->second->GetName() << "\n";
+            std::cerr << "Failed due to numerical error " << p << " in: " << *m_LimitTestBodyList[i]->GetName() << "\n";
             return true;
         }
     }
 
-    std::map<std::string, Joint *>::const_iterator iter3;
-    HingeJoint *j;
-    FixedJoint *f;
     int t;
-    for (iter3 = m_JointList.begin(); iter3 != m_JointList.end(); iter3++)
+    for (size_t i = 0; i < m_TorqueLimitHingeJointList.size(); i++)
     {
-        j = dynamic_cast<HingeJoint *>(iter3->second);
-        if (j)
+        HingeJoint *j = m_TorqueLimitHingeJointList[i];
+        t = j->TestLimits();
+        if (t < 0)
         {
-            t = j->TestLimits();
-            if (t < 0)
-            {
 #if defined(USE_QT) && !defined(USE_WI_BB)
-                ss << __FILE__ << "Failed due to LoStopTorqueLimit error in: " << *iter3->second->GetName();
-                m_MainWindow->log(ss.str().c_str());
+            ss << __FILE__ << "Failed due to LoStopTorqueLimit error in: " << *j->GetName();
+            m_MainWindow->log(ss.str().c_str());
 #endif
-                std::cerr << "Failed due to LoStopTorqueLimit error in: " << *iter3->second->GetName() << "\n";
-                return true;
-            }
-            else if (t > 0)
-            {
+            std::cerr << "Failed due to LoStopTorqueLimit error in: " << *j->GetName() << "\n";
+            return true;
+        }
+        else if (t > 0)
+        {
 #if defined(USE_QT) && !defined(USE_WI_BB)
-                ss << __FILE__ << "Failed due to HiStopTorqueLimit error in: " << *iter3->second->GetName();
-                m_MainWindow->log(ss.str().c_str());
+            ss << __FILE__ << "Failed due to HiStopTorqueLimit error in: " << *j->GetName();
+            m_MainWindow->log(ss.str().c_str());
 #endif
-                std::cerr << "Failed due to HiStopTorqueLimit error in: " << *iter3->second->GetName() << "\n";
-                return true;
-            }
+            std::cerr << "Failed due to HiStopTorqueLimit error in: " << *j->GetName() << "\n";
+            return true;
         }
+    }
 
-        f = dynamic_cast<FixedJoint *>(iter3->second);
-        if (f)
+    for (size_t i = 0; i < m_StressLimitFixedJointList.size(); i++)
+    {
+        FixedJoint *f = m_StressLimitFixedJointList[i];
+        if (f->CheckStressAbort())
         {
-            if (f->CheckStressAbort())
-            {
 #if defined(USE_QT) && !defined(USE_WI_BB)
-                ss << __FILE__ << "Failed due to stress limit error in: " << *iter3->second->GetName() << " " << f->GetLowPassMinStress() << " " << f->GetLowPassMaxStress();
-                m_MainWindow->log(ss.str().c_str());
+            ss << __FILE__ << "Failed due to stress limit error in: " << *f->GetName() << " " << f->GetLowPassMinStress() << " " << f->GetLowPassMaxStress();
+            m_MainWindow->log(ss.str().c_str());
 #endif
-                std::cerr << "Failed due to stress limit error in: " << *iter3->second->GetName() << " " << f->GetLowPassMinStress() << " " << f->GetLowPassMaxStress() << "\n";
-                return true;
-            }
+            std::cerr << "Failed due to stress limit error in: " << *f->GetName() << " " << f->GetLowPassMinStress() << " " << f->GetLowPassMaxStress() << "\n";
+            return true;
         }
     }
 
     // and test the reporters for stop conditions
-    std::map<std::string, Reporter *>::const_iterator ReporterIter;
-    for (ReporterIter = m_ReporterList.begin(); ReporterIter != m_ReporterList.end(); ReporterIter++)
+    for (size_t i = 0; i < m_AbortReporterList.size(); i++)
     {
-        if (ReporterIter->second->ShouldAbort())
+        if (m_AbortReporterList[i]->ShouldAbort())
         {
 #if defined(USE_QT) && !defined(USE_WI_BB)
-            ss << __FILE__ << "Failed due to Reporter Abort in: " << *ReporterIter->second->GetName();
+            ss << __FILE__ << "Failed due to Reporter Abort in: " << *m_AbortReporterList[i]->GetName();
             m_MainWindow->log(ss.str().c_str());
 #endif
-            std::cerr << "Failed due to Reporter Abort in: " << *ReporterIter->second->GetName() << "\n";
+            std::cerr << "Failed due to Reporter Abort in: " << *m_AbortReporterList[i]->GetName() << "\n";
             return true;
         }
     }
@@ -1396,6 +1316,51 @@ void Simulation::ParseGlobal(rapidxml::xml_node<char> * cur)
         else throw __LINE__;
     }
 
+    // strap velocities are either the change in length over the last step
+    // or the instantaneous rate calculated from the body velocities
+    buf = DoXmlGetProp(cur, "StrapVelocity");
+    if (buf)
+    {
+        if (strcmp((char *)buf, "FiniteDifference") == 0) m_StrapVelocityType = FiniteDifferenceVelocity;
+        else if (strcmp((char *)buf, "Analytic") == 0) m_StrapVelocityType = AnalyticVelocity;
+        else throw __LINE__;
+    }
+
+    // muscle curves can be replaced by lookup tables accurate to this relative error
+    buf = DoXmlGetProp(cur, "MuscleCurveMaxRelativeError");
+    if (buf) m_MuscleCurveMaxRelativeError = Util::Double(buf);
+
+    // the drivers, muscles and dumps can be updated less often than the physics
+    // the intervals are in steps and the driver sums are either held or interpolated in between
+    buf = DoXmlGetProp(cur, "DriverUpdateInterval");
+    if (buf)
+    {
+        m_DriverUpdateInterval = Util::Int(buf);
+        if (m_DriverUpdateInterval < 1) throw __LINE__;
+    }
+
+    buf = DoXmlGetProp(cur, "DriverInterpolation");
+    if (buf)
+    {
+        if (strcmp((char *)buf, "Hold") == 0) m_DriverInterpolation = DriverEngine::HoldValue;
+        else if (strcmp((char *)buf, "Linear") == 0) m_DriverInterpolation = DriverEngine::LinearInterpolation;
+        else throw __LINE__;
+    }
+
+    buf = DoXmlGetProp(cur, "MuscleUpdateInterval");
+    if (buf)
+    {
+        m_MuscleUpdateInterval = Util::Int(buf);
+        if (m_MuscleUpdateInterval < 1) throw __LINE__;
+    }
+
+    buf = DoXmlGetProp(cur, "DumpInterval");
+    if (buf)
+    {
+        m_DumpInterval = Util::Int(buf);
+        if (m_DumpInterval < 1) throw __LINE__;
+    }
+
     // allow internal collisions
     buf = DoXmlGetProp(cur, "AllowInternalCollisions");
     if (buf == 0) throw __LINE__;
@@ -1405,6 +1370,64 @@ void Simulation::ParseGlobal(rapidxml::xml_node<char> * cur)
     buf = DoXmlGetProp(cur, "AllowConnectedCollisions");
     if (buf) m_AllowConnectedCollisions = Util::Bool(buf);
 
+    // collision space
+    // Simple tests every pair, Hash uses a multi-resolution grid, SAP uses sweep and prune
+    // and Quadtree uses a fixed region subdivided to a given depth
+    buf = DoXmlGetProp(cur, "SpaceType");
+    if (buf)
+    {
+        dSpaceID space;
+        if (strcmp((char *)buf, "Simple") == 0)
+        {
+            space = dSimpleSpaceCreate(0);
+        }
+        else if (strcmp((char *)buf, "Hash") == 0)
+        {
+            space = dHashSpaceCreate(0);
+            // the cell sizes go from 2^min to 2^max
+            buf = DoXmlGetProp(cur, "HashSpaceLevels");
+            if (buf)
+            {
+                int levels[2];
+                Util::Int(buf, 2, levels);
+                dHashSpaceSetLevels(space, levels[0], levels[1]);
+            }
+        }
+        else if (strcmp((char *)buf, "SAP") == 0)
+        {
+            // the first axis is the one the geoms are sorted along so it should have the most spread
+            int axisOrder = dSAP_AXES_XYZ;
+            buf = DoXmlGetProp(cur, "SAPAxisOrder");
+            if (buf)
+            {
+                if (strcmp((char *)buf, "XYZ") == 0) axisOrder = dSAP_AXES_XYZ;
+                else if (strcmp((char *)buf, "XZY") == 0) axisOrder = dSAP_AXES_XZY;
+                else if (strcmp((char *)buf, "YXZ") == 0) axisOrder = dSAP_AXES_YXZ;
+                else if (strcmp((char *)buf, "YZX") == 0) axisOrder = dSAP_AXES_YZX;
+                else if (strcmp((char *)buf, "ZXY") == 0) axisOrder = dSAP_AXES_ZXY;
+                else if (strcmp((char *)buf, "ZYX") == 0) axisOrder = dSAP_AXES_ZYX;
+                else throw __LINE__;
+            }
+            space = dSweepAndPruneSpaceCreate(0, axisOrder);
+        }
+        else if (strcmp((char *)buf, "Quadtree") == 0)
+        {
+            dVector3 centre, extents;
+            THROWIFZERO(buf = DoXmlGetProp(cur, "QuadtreeCentre"));
+            Util::Double(buf, 3, m_DoubleList);
+            centre[0] = m_DoubleList[0]; centre[1] = m_DoubleList[1]; centre[2] = m_DoubleList[2];
+            THROWIFZERO(buf = DoXmlGetProp(cur, "QuadtreeExtents"));
+            Util::Double(buf, 3, m_DoubleList);
+            extents[0] = m_DoubleList[0]; extents[1] = m_DoubleList[1]; extents[2] = m_DoubleList[2];
+            int depth = 6;
+            buf = DoXmlGetProp(cur, "QuadtreeDepth");
+            if (buf) depth = Util::Int(buf);
+            space = dQuadTreeSpaceCreate(0, centre, extents, depth);
+        }
+        else throw __LINE__;
+        ReplaceSpace(space);
+    }
+
     // now some run parameters
 
     buf = DoXmlGetProp(cur, "BMR");
@@ -1431,6 +1454,11 @@ void Simulation::ParseGlobal(rapidxml::xml_node<char> * cur)
     else if (strcmp((char *)buf, "ClosestWarehouse") == 0) m_FitnessType = ClosestWarehouse;
     else throw __LINE__;
 
+    buf = DoXmlGetProp(cur, "PruneThreshold");
+    if (buf) SetPruneThreshold(Util::Double(buf));
+    buf = DoXmlGetProp(cur, "PruneMaximumSpeed");
+    if (buf) SetPruneMaximumSpeed(Util::Double(buf));
+
     buf = DoXmlGetProp(cur, "OutputModelStateFilename");
     if (buf) SetOutputModelStateFile((char *)buf);
 
@@ -1470,15 +1498,82 @@ void Simulation::ParseEnvironment(rapidxml::xml_node<char> * cur)
     char *buf;
 
     // planes
-    THROWIFZERO(buf = DoXmlGetProp(cur, "Plane"));
-    Util::Double(buf, 4, m_DoubleList);
-    PlaneGeom *plane = new PlaneGeom(m_SpaceID, m_DoubleList[0], m_DoubleList[1], m_DoubleList[2], m_DoubleList[3]);
-    plane->SetGeomLocation(Geom::environment);
-    m_Environment->AddGeom(plane);
+    // the plane is optional if there is a heightfield
+    PlaneGeom *plane = 0;
+    buf = DoXmlGetProp(cur, "Plane");
+    if (buf)
+    {
+        Util::Double(buf, 4, m_DoubleList);
+        plane = new PlaneGeom(m_SpaceID, m_DoubleList[0], m_DoubleList[1], m_DoubleList[2], m_DoubleList[3]);
+        plane->SetGeomLocation(Geom::environment);
+        m_Environment->AddGeom(plane);
+    }
+
+    // heightfield terrain
+    buf = DoXmlGetProp(cur, "HeightfieldFile");
+    if (buf)
+    {
+        std::string heightfieldFile((const char *)buf);
+        std::string filename;
+        if (m_GraphicsRoot.length() > 0) filename = std::string(m_GraphicsRoot) + std::string("/");
+        filename += heightfieldFile;
+
+        HeightfieldGeom::GridFormat format = HeightfieldGeom::TextFormat;
+        buf = DoXmlGetProp(cur, "HeightfieldFormat");
+        if (buf)
+        {
+            if (strcmp((const char *)buf, "Text") == 0) format = HeightfieldGeom::TextFormat;
+            else if (strcmp((const char *)buf, "Float") == 0) format = HeightfieldGeom::FloatFormat;
+            else if (strcmp((const char *)buf, "Short") == 0) format = HeightfieldGeom::ShortFormat;
+            else throw __LINE__;
+        }
+        int xSamples = 0, ySamples = 0;
+        buf = DoXmlGetProp(cur, "HeightfieldSamples");
+        if (buf)
+        {
+            Util::Double(buf, 2, m_DoubleList);
+            xSamples = int(m_DoubleList[0]);
+            ySamples = int(m_DoubleList[1]);
+        }
+
+        THROWIFZERO(buf = DoXmlGetProp(cur, "HeightfieldSize"));
+        Util::Double(buf, 2, m_DoubleList);
+        double sizeX = m_DoubleList[0];
+        double sizeY = m_DoubleList[1];
+        double scale = 1, offset = 0, thickness = 1;
+        buf = DoXmlGetProp(cur, "HeightfieldScale");
+        if (buf) scale = Util::Double(buf);
+        buf = DoXmlGetProp(cur, "HeightfieldOffset");
+        if (buf) offset = Util::Double(buf);
+        buf = DoXmlGetProp(cur, "HeightfieldThickness");
+        if (buf) thickness = Util::Double(buf);
+        pgd::Vector position(0, 0, 0);
+        buf = DoXmlGetProp(cur, "HeightfieldPosition");
+        if (buf)
+        {
+            Util::Double(buf, 3, m_DoubleList);
+            position = pgd::Vector(m_DoubleList[0], m_DoubleList[1], m_DoubleList[2]);
+        }
+
+        std::shared_ptr<const HeightfieldGeom::Grid> grid = HeightfieldGeom::GetGrid(filename, format, xSamples, ySamples);
+        THROWIFZERO(grid);
+        HeightfieldGeom *heightfield = new HeightfieldGeom(m_SpaceID, grid, sizeX, sizeY, scale, offset, thickness, position.x, position.y, position.z);
+        heightfield->SetFilename(heightfieldFile, format);
+        heightfield->setSimulation(this);
+        heightfield->SetGeomLocation(Geom::environment);
+#ifdef USE_QT
+        heightfield->SetColour(m_Interface.EnvironmentColour);
+#endif
+        m_Environment->AddGeom(heightfield);
+    }
+    else
+    {
+        THROWIFZERO(plane);
+    }
 
 #ifdef USE_QT
     buf = DoXmlGetProp(cur, "TrackSensitivity");
-    if (buf)
+    if (buf && plane)
     {
         Util::Double(buf, 2, m_DoubleList);
         // list is lowRange, highRange
@@ -1591,20 +1686,26 @@ void Simulation::ParseBody(rapidxml::xml_node<char> * cur)
     if (buf) theBody->SetMaxAngularSpeed(Util::Double(buf));
 
 
-#ifdef USE_QT
+#if defined(USE_QT) || defined(USE_HEADLESS)
     FacetedObject *facetedObject = new FacetedObject();
+#ifdef USE_QT
     facetedObject->setSimulationWindow(m_MainWindow->GetSimulationWindow());
+#endif
 
     // parameters that affect how the mesh is read in
+    double verticesAsSpheresRadius = 0;
     buf = DoXmlGetProp(cur, "VerticesAsSpheresRadius");
     if (buf)
     {
-        facetedObject->SetVerticesAsSpheresRadius(Util::Double(buf));
+        verticesAsSpheresRadius = Util::Double(buf);
+        facetedObject->SetVerticesAsSpheresRadius(verticesAsSpheresRadius);
     }
+    bool badMesh = false;
     buf = DoXmlGetProp(cur, "BadMesh");
     if (buf)
     {
-        facetedObject->SetBadMesh(Util::Bool(buf));
+        badMesh = Util::Bool(buf);
+        facetedObject->SetBadMesh(badMesh);
     }
 
     pgd::Vector scale(1.0, 1.0, 1.0);
@@ -1638,7 +1739,6 @@ void Simulation::ParseBody(rapidxml::xml_node<char> * cur)
     std::string filename;
     if (m_GraphicsRoot.length() > 0) filename = std::string(m_GraphicsRoot) + std::string("/");
     filename += std::string((const char *)buf);
-    facetedObject->ParseOBJFile(filename.c_str(), scale, offset);
 
     double density = -1;
     buf = DoXmlGetProp(cur, "Density");
@@ -1653,8 +1753,22 @@ void Simulation::ParseBody(rapidxml::xml_node<char> * cur)
     {
         clockwise = Util::Bool(buf);
     }
-    // but we always want anticlockwise objects
-    if (clockwise) facetedObject->ReverseWinding();
+
+#if defined(USE_HEADLESS)
+    // the meshes are kept for the whole process so reloading the model does not reread them
+    std::shared_ptr<const MeshCache::Entry> cachedMesh = MeshCache::GetMesh(filename, scale, offset, badMesh, verticesAsSpheresRadius, clockwise, density > 0);
+    if (cachedMesh)
+    {
+        facetedObject->SetName(filename);
+        facetedObject->SetSharedMesh(cachedMesh->mesh);
+    }
+    else
+#endif
+    {
+        facetedObject->ParseOBJFile(filename.c_str(), scale, offset);
+        // but we always want anticlockwise objects
+        if (clockwise) facetedObject->ReverseWinding();
+    }
 
     facetedObject->SetColour(m_Interface.BodyColour);
     theBody->setPhysRep(facetedObject);
@@ -1667,6 +1781,10 @@ void Simulation::ParseBody(rapidxml::xml_node<char> * cur)
         theBody->SetPosition(0, 0, 0);
         theBody->SetQuaternion(1, 0, 0, 0);
 
+#if defined(USE_HEADLESS)
+        if (cachedMesh) cachedMesh->GetMass(density, false, &mass);
+        else
+#endif
         facetedObject->CalculateMassProperties(&mass, density, false); // generally we assume anticlockwise winding
         std::cerr << *theBody->GetName() << " mass " << mass.mass
                 << " CM " << mass.c[0] << " " << mass.c[1] << " " << mass.c[2] << " "
@@ -1676,8 +1794,16 @@ void Simulation::ParseBody(rapidxml::xml_node<char> * cur)
         dVector3 newP;
         newP[0] = mass.c[0] + p[0]; newP[1] = mass.c[1] + p[1]; newP[2] = mass.c[2] + p[2];
         theBody->SetOffset(-mass.c[0], -mass.c[1], -mass.c[2]);
-        facetedObject->Move(-mass.c[0], -mass.c[1], -mass.c[2]);
-        facetedObject->CalculateMassProperties(&mass, density, false); // generally we assume anticlockwise winding
+#if defined(USE_HEADLESS)
+        if (cachedMesh) cachedMesh->GetMass(density, true, &mass); // the cached mesh has already been moved
+        else
+#endif
+        {
+            // the inertia is about the mesh origin so moving the centre of mass to the origin
+            // is a parallel axis shift and the integrals do not need calculating again
+            facetedObject->Move(-mass.c[0], -mass.c[1], -mass.c[2]);
+            dMassTranslate(&mass, -mass.c[0], -mass.c[1], -mass.c[2]);
+        }
         std::cerr << *theBody->GetName() << " mass " << mass.mass
                 << " CM " << mass.c[0] << " " << mass.c[1] << " " << mass.c[2] << " "
                 << " I11_I22_I33 " << mass._I(0,0) << " " << mass._I(1,1) << " " << mass._I(2,2) << " "
@@ -1952,6 +2078,8 @@ void Simulation::ParseJoint(rapidxml::xml_node<char> * cur)
                 else if (strcmp((const char *)buf, "Spring") == 0) fixedJoint->SetStressCalculationType(FixedJoint::spring);
                 else throw __LINE__;
             }
+            buf = DoXmlGetProp(cur, "StressThreads");
+            if (buf) fixedJoint->SetStressThreads(Util::Int(buf));
             buf = DoXmlGetProp(cur, "StressLimit");
             if (buf)
             {
@@ -2169,6 +2297,70 @@ void Simulation::ParseGeom(rapidxml::xml_node<char> * cur)
         geom->setSimulation(this);
     }
 
+#ifndef USE_QT
+    // the Qt build reads the meshes straight into Irrlicht so there are no vertices for the collision data
+    else if (strcmp((const char *)buf, "Trimesh") == 0)
+    {
+        pgd::Vector scale(1.0, 1.0, 1.0);
+        buf = DoXmlGetProp(cur, "Scale");
+        if (buf)
+        {
+            int nTokens = DataFile::CountTokens(buf);
+            switch (nTokens)
+            {
+            case 1:
+                scale.x = scale.y = scale.z = Util::Double(buf);
+                break;
+            case 3:
+                Util::Double(buf, 3, m_DoubleList);
+                scale = m_DoubleList;
+                break;
+            default:
+                throw __LINE__;
+            }
+        }
+        pgd::Vector offset;
+        buf = DoXmlGetProp(cur, "Offset");
+        if (buf)
+        {
+            Util::Double(buf, 3, m_DoubleList);
+            offset = m_DoubleList;
+        }
+        bool clockwise = false;
+        buf = DoXmlGetProp(cur, "Clockwise");
+        if (buf) clockwise = Util::Bool(buf);
+
+        THROWIFZERO(buf = DoXmlGetProp(cur, "GraphicFile"));
+        std::string filename;
+        if (m_GraphicsRoot.length() > 0) filename = std::string(m_GraphicsRoot) + std::string("/");
+        filename += std::string((const char *)buf);
+
+        FacetedObject *facetedObject = new FacetedObject();
+#if defined(USE_HEADLESS)
+        // the cached mesh is the same object every time the model is loaded so the collision data is shared too
+        std::shared_ptr<const MeshCache::Entry> cachedMesh = MeshCache::GetMesh(filename, scale, offset, false, 0, clockwise, false);
+        if (cachedMesh)
+        {
+            facetedObject->SetName(filename);
+            facetedObject->SetSharedMesh(cachedMesh->mesh);
+        }
+        else
+#endif
+        {
+            if (facetedObject->ParseOBJFile(filename.c_str(), scale, offset) || facetedObject->GetNumTriangles() == 0)
+            {
+                delete facetedObject;
+                throw __LINE__;
+            }
+            if (clockwise) facetedObject->ReverseWinding();
+        }
+
+        TrimeshGeom *trimeshGeom = new TrimeshGeom(m_SpaceID, facetedObject);
+        geom = trimeshGeom;
+        geom->setSimulation(this);
+    }
+#endif
+
     else
     {
         throw __LINE__;
@@ -3326,7 +3518,7 @@ void Simulation::ParseWarehouse(rapidxml::xml_node<char> * cur)
 {
 }
 
-#ifdef USE_QT
+#if defined(USE_QT) || defined(USE_HEADLESS)
 void Simulation::ParseInterface(rapidxml::xml_node<char> * cur)
 {
     char  *buf;
@@ -3337,6 +3529,36 @@ void Simulation::ParseInterface(rapidxml::xml_node<char> * cur)
         m_Interface.TrackBodyID = (char *)buf;
     }
 
+    buf = DoXmlGetProp(cur, "CameraDistance");
+    if (buf) m_Interface.CameraDistance = Util::Double(buf);
+    buf = DoXmlGetProp(cur, "FOV");
+    if (buf) m_Interface.FOV = Util::Double(buf);
+    buf = DoXmlGetProp(cur, "CameraVector");
+    if (buf)
+    {
+        Util::Double(buf, 3, m_DoubleList);
+        for (int i = 0; i < 3; i++) m_Interface.CameraVec[i] = m_DoubleList[i];
+    }
+    buf = DoXmlGetProp(cur, "COI");
+    if (buf)
+    {
+        Util::Double(buf, 3, m_DoubleList);
+        for (int i = 0; i < 3; i++) m_Interface.COI[i] = m_DoubleList[i];
+    }
+    buf = DoXmlGetProp(cur, "Up");
+    if (buf)
+    {
+        Util::Double(buf, 3, m_DoubleList);
+        for (int i = 0; i < 3; i++) m_Interface.Up[i] = m_DoubleList[i];
+    }
+    buf = DoXmlGetProp(cur, "FrontClip");
+    if (buf) m_Interface.FrontClip = Util::Double(buf);
+    buf = DoXmlGetProp(cur, "BackClip");
+    if (buf) m_Interface.BackClip = Util::Double(buf);
+    buf = DoXmlGetProp(cur, "OrthographicProjection");
+    if (buf) m_Interface.OrthographicProjection = Util::Bool(buf);
+
+#ifdef USE_QT
     const Preferences *prefs = m_MainWindow->GetPreferences();
     m_Interface.EnvironmentAxisSize[0] = prefs->EnvironmentX;
     m_Interface.EnvironmentAxisSize[1] = prefs->EnvironmentY;
@@ -3382,8 +3604,11 @@ void Simulation::ParseInterface(rapidxml::xml_node<char> * cur)
     m_Interface.StrapCylinderColour.SetColour(StrapCylinderColour.redF(), StrapCylinderColour.greenF(), StrapCylinderColour.blueF(), StrapCylinderColour.alphaF());
     m_Interface.ReporterColour.SetColour(ReporterColour.redF(), ReporterColour.greenF(), ReporterColour.blueF(), ReporterColour.alphaF());
     m_Interface.DataTargetColour.SetColour(DataTargetColour.redF(), DataTargetColour.greenF(), DataTargetColour.blueF(), DataTargetColour.alphaF());
+#endif
 }
+#endif
 
+#ifdef USE_QT
 bool Simulation::drawContactForces() const
 {
     return m_drawContactForces;
@@ -3517,8 +3742,7 @@ void Simulation::OutputWarehouse()
         pgd::Quaternion quat;
         rootBody->GetRelativePosition(0, &pos);
         rootBody->GetRelativeQuaternion(0, &quat);
-        rootBody->GetRelativeLinearVelocity(0, &vel);
-        rootBody->GetRelativeAngularVelocity(0, &avel);
+        rootBody->GetRelativeVelocities(0, &vel, &avel);
         double angle = QGetAngle(quat);
         pgd::Vector axis = QGetAxis(quat);
         m_OutputWarehouseFile << "\t" << pos.x << "\t" << pos.y << "\t" << pos.z;
@@ -3532,8 +3756,7 @@ void Simulation::OutputWarehouse()
             {
                 iter->second->GetRelativePosition(rootBody, &pos);
                 iter->second->GetRelativeQuaternion(rootBody, &quat);
-                iter->second->GetRelativeLinearVelocity(rootBody, &vel);
-                iter->second->GetRelativeAngularVelocity(rootBody, &avel);
+                iter->second->GetRelativeVelocities(rootBody, &vel, &avel);
                 angle = QGetAngle(quat);
                 axis = QGetAxis(quat);
                 m_OutputWarehouseFile << "\t" << pos.x << "\t" << pos.y << "\t" << pos.z;
@@ -3582,8 +3805,7 @@ void Simulation::OutputWarehouse()
         pgd::Quaternion quat;
         rootBody->GetRelativePosition(0, &pos);
         rootBody->GetRelativeQuaternion(0, &quat);
-        rootBody->GetRelativeLinearVelocity(0, &vel);
-        rootBody->GetRelativeAngularVelocity(0, &avel);
+        rootBody->GetRelativeVelocities(0, &vel, &avel);
         double angle = QGetAngle(quat);
         pgd::Vector axis = QGetAxis(quat);
         Util::BinaryOutput(m_OutputWarehouseFile, pos.x); Util::BinaryOutput(m_OutputWarehouseFile, pos.y); Util::BinaryOutput(m_OutputWarehouseFile, pos.z);
@@ -3597,8 +3819,7 @@ void Simulation::OutputWarehouse()
             {
                 iter->second->GetRelativePosition(rootBody, &pos);
                 iter->second->GetRelativeQuaternion(rootBody, &quat);
-                iter->second->GetRelativeLinearVelocity(rootBody, &vel);
-                iter->second->GetRelativeAngularVelocity(rootBody, &avel);
+                iter->second->GetRelativeVelocities(rootBody, &vel, &avel);
                 angle = QGetAngle(quat);
                 axis = QGetAxis(quat);
                 Util::BinaryOutput(m_OutputWarehouseFile, pos.x); Util::BinaryOutput(m_OutputWarehouseFile, pos.y); Util::BinaryOutput(m_OutputWarehouseFile, pos.z);
@@ -4392,12 +4613,53 @@ bool Simulation::ShouldQuit()
     if (m_TimeLimit > 0)
         if (m_SimulationTime > m_TimeLimit) return true;
     if (m_MechanicalEnergyLimit > 0)
-        if (m_MechanicalEnergy > m_MechanicalEnergyLimit) return true;
+        if (m_EnergyAccounts.GetMechanicalEnergy() > m_MechanicalEnergyLimit) return true;
     if (m_MetabolicEnergyLimit > 0)
-        if (m_MetabolicEnergy > m_MetabolicEnergyLimit) return true;
+        if (m_EnergyAccounts.GetMetabolicEnergy() > m_MetabolicEnergyLimit) return true;
+    if (m_PruneFlag)
+    {
+        if (CannotReachPruneThreshold())
+        {
+            m_Pruned = true;
+            if (gDebug == FitnessDebug) *gDebugStream << "Simulation::ShouldQuit pruned at m_SimulationTime " << m_SimulationTime <<
+                                                         " fitness " << CalculateInstantaneousFitness() << " m_PruneThreshold " << m_PruneThreshold << "\n";
+            return true;
+        }
+    }
     return false;
 }
 
+// returns true if the best possible final fitness is below m_PruneThreshold
+// the bound is only known when there is a time limit and for DistanceTravelled
+// it also needs the maximum speed of the DistanceTravelledBodyID
+bool Simulation::CannotReachPruneThreshold()
+{
+    if (m_TimeLimit <= 0 || m_InputKinematicsFlag) return false;
+    double remainingTime = m_TimeLimit - m_SimulationTime;
+    if (remainingTime < 0) remainingTime = 0;
+    switch (m_FitnessType)
+    {
+    case DistanceTravelled:
+        if (m_PruneMaximumSpeed <= 0) return false;
+        return m_DistanceTravelledBodyID->GetPosition()[0] + remainingTime * m_PruneMaximumSpeed < m_PruneThreshold;
+
+    case KinematicMatch:
+    {
+        if (m_DataTargetQueueBounded == false) return false;
+        // the targets still in the queue up to a step past the time limit can add to the score
+        DataTargetEvent limit;
+        limit.time = m_TimeLimit + m_StepSize;
+        limit.order = INT_MAX;
+        size_t end = std::upper_bound(m_DataTargetQueue.begin() + m_DataTargetQueueNext, m_DataTargetQueue.end(), limit) - m_DataTargetQueue.begin();
+        double maximumFitness = m_KinematicMatchFitness + m_DataTargetQueueMaximumFitness[m_DataTargetQueueNext] - m_DataTargetQueueMaximumFitness[end];
+        return maximumFitness < m_PruneThreshold;
+    }
+
+    default:
+        return false;
+    }
+}
+
 // this is called by dSpaceCollide when two objects in space are
 // potentially colliding.
 
@@ -4412,16 +4674,13 @@ void Simulation::NearCallback(void *data, dGeomID o1, dGeomID o2)
     dBodyID b2 = dGeomGetBody(o2);
     Contact *myContact;
 
-    if (s->m_AllowConnectedCollisions == false)
+    // internal collisions are always filtered by the category and collide bits (see SetCollisionBits)
+    // but connected bodies can only be filtered that way if there are few enough bodies
+    if (s->m_AllowConnectedCollisions == false && s->m_ConnectedCollisionsInBroadphase == false)
     {
         if (b1 && b2 && dAreConnectedExcluding(b1, b2, dJointTypeContact)) return;
     }
 
-    if (s->m_AllowInternalCollisions == false)
-    {
-        if (((Geom *)dGeomGetData(o1))->GetGeomLocation() == ((Geom *)dGeomGetData(o2))->GetGeomLocation()) return;
-    }
-
     dContact *contact = new dContact[s->m_MaxContacts];   // up to m_MaxContacts contacts per box-box
     double cfm = MAX(((Geom *)dGeomGetData(o1))->GetContactSoftCFM(),
                     ((Geom *)dGeomGetData(o2))->GetContactSoftCFM());
@@ -4463,7 +4722,7 @@ void Simulation::NearCallback(void *data, dGeomID o1, dGeomID o2)
             if (((Geom *)dGeomGetData(o2))->GetAbort()) s->SetContactAbort(true);
 
 #if !defined(USE_QT)
-            if (gDebug == ContactDebug)
+            if (TRACE_ON(ContactDebug))
 #endif
             {
                 myContact = new Contact();
@@ -4490,6 +4749,169 @@ void Simulation::NearCallback(void *data, dGeomID o1, dGeomID o2)
     delete [] contact;
 }
 
+// the limits are all set when the model is read so the objects that need testing are known
+// and each list keeps the name order of its map
+void Simulation::BuildAbortCheckLists()
+{
+    m_LimitTestBodyList.clear();
+    m_TorqueLimitHingeJointList.clear();
+    m_StressLimitFixedJointList.clear();
+    m_AbortReporterList.clear();
+
+    // bodies always need testing because the numerical error check is always active
+    for (std::map<std::string, Body *>::const_iterator iter = m_BodyList.begin(); iter != m_BodyList.end(); iter++)
+        m_LimitTestBodyList.push_back(iter->second);
+
+    for (std::map<std::string, Joint *>::const_iterator iter = m_JointList.begin(); iter != m_JointList.end(); iter++)
+    {
+        HingeJoint *hingeJoint = dynamic_cast<HingeJoint *>(iter->second);
+        if (hingeJoint && hingeJoint->HasTorqueLimits()) m_TorqueLimitHingeJointList.push_back(hingeJoint);
+        FixedJoint *fixedJoint = dynamic_cast<FixedJoint *>(iter->second);
+        if (fixedJoint && fixedJoint->HasStressLimit()) m_StressLimitFixedJointList.push_back(fixedJoint);
+    }
+
+    for (std::map<std::string, Reporter *>::const_iterator iter = m_ReporterList.begin(); iter != m_ReporterList.end(); iter++)
+        if (iter->second->CanAbort()) m_AbortReporterList.push_back(iter->second);
+}
+
+// the target times are all set when the model is read so they can be merged into a single
+// time ordered queue with a running total of the best possible score for pruning
+void Simulation::BuildDataTargetQueue()
+{
+    m_DataTargetQueue.clear();
+    m_DataTargetQueueNext = 0;
+    m_DataTargetQueueBounded = true;
+    int order = 0;
+    for (std::map<std::string, DataTarget *>::const_iterator iter = m_DataTargetList.begin(); iter != m_DataTargetList.end(); iter++)
+    {
+        DataTargetEvent event;
+        event.dataTarget = iter->second;
+        event.order = order++;
+        for (event.index = 0; event.index < iter->second->GetTargetTimeListLength(); event.index++)
+        {
+            event.time = iter->second->GetTargetTime(event.index);
+            m_DataTargetQueue.push_back(event);
+        }
+        if (iter->second->GetMaximumMatchValue() == DBL_MAX) m_DataTargetQueueBounded = false;
+    }
+    std::sort(m_DataTargetQueue.begin(), m_DataTargetQueue.end());
+
+    m_DataTargetQueueMaximumFitness.assign(m_DataTargetQueue.size() + 1, 0);
+    if (m_DataTargetQueueBounded)
+    {
+        for (size_t i = m_DataTargetQueue.size(); i > 0; i--)
+            m_DataTargetQueueMaximumFitness[i - 1] = m_DataTargetQueueMaximumFitness[i] + m_DataTargetQueue[i - 1].dataTarget->GetMaximumMatchValue();
+    }
+    m_DueDataTargetEvents.reserve(m_DataTargetList.size());
+}
+
+// the bodies that the muscles pull on do not change once the model is read so each point force
+// can be given its accumulator in advance
+void Simulation::BuildMuscleForceLists()
+{
+    m_MuscleForceBodyList.clear();
+    m_MuscleForceBodyIndexList.clear();
+    std::map<Body *, int> bodyIndexMap;
+    for (std::map<std::string, Muscle *>::const_iterator iter = m_MuscleList.begin(); iter != m_MuscleList.end(); iter++)
+    {
+        std::vector<PointForce> *pointForceList = iter->second->GetPointForceList();
+        for (size_t i = 0; i < pointForceList->size(); i++)
+        {
+            Body *body = (*pointForceList)[i].body;
+            std::map<Body *, int>::const_iterator found = bodyIndexMap.find(body);
+            if (found == bodyIndexMap.end())
+            {
+                BodyForceAccumulator accumulator;
+                accumulator.bodyID = body->GetBodyID();
+                found = bodyIndexMap.insert(std::make_pair(body, int(m_MuscleForceBodyList.size()))).first;
+                m_MuscleForceBodyList.push_back(accumulator);
+            }
+            m_MuscleForceBodyIndexList.push_back(found->second);
+        }
+    }
+}
+
+// move any geoms that already exist into the new space and use it from now on
+// the geoms are found from the lists because not all the ODE spaces can be iterated
+void Simulation::ReplaceSpace(dSpaceID space)
+{
+    std::vector<Geom *> geomList = GetAllGeoms();
+    for (size_t i = 0; i < geomList.size(); i++)
+    {
+        dSpaceRemove(m_SpaceID, geomList[i]->GetGeomID());
+        dSpaceAdd(space, geomList[i]->GetGeomID());
+    }
+    dSpaceDestroy(m_SpaceID);
+    m_SpaceID = space;
+}
+
+std::vector<Geom *> Simulation::GetAllGeoms()
+{
+    std::vector<Geom *> geomList;
+    for (int i = 0; i < m_Environment->GetNumGeoms(); i++) geomList.push_back(m_Environment->GetGeom(i));
+    for (std::map<std::string, Geom *>::const_iterator iter = m_GeomList.begin(); iter != m_GeomList.end(); iter++) geomList.push_back(iter->second);
+    return geomList;
+}
+
+// ODE only passes a pair of geoms to NearCallback if the category bits of one overlap
+// the collide bits of the other so the collision rules can be applied in the broadphase.
+// The environment has bit 0 and every body gets a bit of its own if there are enough,
+// otherwise the bodies share bit 1 and joint connections are checked in NearCallback.
+void Simulation::SetCollisionBits()
+{
+    const unsigned long environmentBit = 1;
+    const size_t numBodyBits = sizeof(unsigned long) * 8 - 1;
+    m_ConnectedCollisionsInBroadphase = (m_AllowConnectedCollisions == false && m_BodyList.size() <= numBodyBits);
+
+    std::map<dBodyID, unsigned long> bodyBits;
+    unsigned long allBodyBits = 0;
+    size_t index = 0;
+    std::map<std::string, Body *>::const_iterator iter1, iter2;
+    for (iter1 = m_BodyList.begin(); iter1 != m_BodyList.end(); iter1++)
+    {
+        unsigned long bit = 2;
+        if (m_ConnectedCollisionsInBroadphase) bit = 2ul << index++;
+        bodyBits[iter1->second->GetBodyID()] = bit;
+        allBodyBits |= bit;
+    }
+
+    std::map<dBodyID, unsigned long> bodyCollideBits;
+    for (iter1 = m_BodyList.begin(); iter1 != m_BodyList.end(); iter1++)
+    {
+        unsigned long collideBits = environmentBit;
+        if (m_AllowInternalCollisions)
+        {
+            collideBits |= allBodyBits;
+            if (m_ConnectedCollisionsInBroadphase)
+            {
+                for (iter2 = m_BodyList.begin(); iter2 != m_BodyList.end(); iter2++)
+                {
+                    if (iter1 != iter2 && dAreConnectedExcluding(iter1->second->GetBodyID(), iter2->second->GetBodyID(), dJointTypeContact))
+                        collideBits &= ~bodyBits[iter2->second->GetBodyID()];
+                }
+            }
+        }
+        bodyCollideBits[iter1->second->GetBodyID()] = collideBits;
+    }
+
+    std::vector<Geom *> geomList = GetAllGeoms();
+    for (size_t i = 0; i < geomList.size(); i++)
+    {
+        dGeomID geomID = geomList[i]->GetGeomID();
+        dBodyID bodyID = dGeomGetBody(geomID);
+        if (geomList[i]->GetGeomLocation() == Geom::environment || bodyID == 0)
+        {
+            dGeomSetCategoryBits(geomID, environmentBit);
+            dGeomSetCollideBits(geomID, m_AllowInternalCollisions ? ~0ul : ~environmentBit);
+        }
+        else
+        {
+            dGeomSetCategoryBits(geomID, bodyBits[bodyID]);
+            dGeomSetCollideBits(geomID, bodyCollideBits[bodyID]);
+        }
+    }
+}
+
 Body *Simulation::GetBody(const char *name)
 {
     // use find to allow null return if name not found
@@ -4692,9 +5114,12 @@ void Simulation::Draw(SimulationWindow *window)
     m_Environment->Draw(window);
     for (std::map<std::string, Body *>::const_iterator it = m_BodyList.begin(); it != m_BodyList.end(); it++) it->second->Draw(window);
     for (std::map<std::string, Joint *>::const_iterator it = m_JointList.begin(); it != m_JointList.end(); it++) it->second->Draw(window);
+    // straps and force arrows are collected into a single batch that is rebuilt every redraw
+    window->strapBatch()->Clear();
     for (std::map<std::string, Muscle *>::const_iterator it = m_MuscleList.begin(); it != m_MuscleList.end(); it++) it->second->Draw(window);
     for (std::map<std::string, Geom *>::const_iterator it = m_GeomList.begin(); it != m_GeomList.end(); it++) it->second->Draw(window);
     for (unsigned int c = 0; c < m_ContactList.size(); c++) m_ContactList[c]->Draw(window);
+    window->strapBatch()->Draw();
     for (std::map<std::string, Reporter *>::const_iterator it = m_ReporterList.begin(); it != m_ReporterList.end(); it++) it->second->Draw(window);
     for (std::map<std::string, Marker *>::const_iterator it = m_MarkerList.begin(); it != m_MarkerList.end(); it++) it->second->Draw(window);
     for (std::map<std::string, DataTarget *>::const_iterator it = m_DataTargetList.begin(); it != m_DataTargetList.end(); it++) it->second->Draw(window);
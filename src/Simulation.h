@@ -15,10 +15,13 @@
 
 #include "Environment.h"
 #include "DataFile.h"
+#include "DriverEngine.h"
+#include "EnergyAccounts.h"
 
 #include <ode/ode.h>
 
 #include <map>
+#include <vector>
 #include <string>
 #include <fstream>
 
@@ -33,6 +36,7 @@ class Marker;
 class Reporter;
 class Controller;
 class FixedJoint;
+class HingeJoint;
 class Warehouse;
 class SimulationWindow;
 
@@ -43,7 +47,7 @@ class MainWindow;
 namespace rapidxml { template<class Ch> class xml_node; }
 namespace rapidxml { template<class Ch> class xml_attribute; }
 
-#ifdef USE_QT
+#if defined(USE_QT) || defined(USE_HEADLESS)
 
 struct Interface
 {
@@ -73,6 +77,16 @@ struct Interface
     float MarkerRadius;
 
     std::string TrackBodyID;
+
+    // camera settings (only used by the headless renderer since the GUI keeps its own)
+    float CameraDistance;
+    float FOV;
+    float CameraVec[3];
+    float COI[3];
+    float Up[3];
+    float FrontClip;
+    float BackClip;
+    bool OrthographicProjection;
 };
 #endif
 
@@ -82,6 +96,12 @@ enum WorldStepType
     QuickStep
 };
 
+enum StrapVelocityType
+{
+    FiniteDifferenceVelocity,
+    AnalyticVelocity
+};
+
 enum AxisType
 {
     XAxis,
@@ -115,11 +135,13 @@ public:
     double GetTime(void) { return m_SimulationTime; }
     double GetTimeIncrement(void) { return m_StepSize; }
     long long GetStepCount(void) { return m_StepCount; }
-    double GetMechanicalEnergy(void) { return m_MechanicalEnergy; }
-    double GetMetabolicEnergy(void) { return m_MetabolicEnergy; }
+    double GetMechanicalEnergy(void) { return m_EnergyAccounts.GetMechanicalEnergy(); }
+    double GetMetabolicEnergy(void) { return m_EnergyAccounts.GetMetabolicEnergy(); }
+    EnergyAccounts *GetEnergyAccounts() { return &m_EnergyAccounts; }
     double GetTimeLimit(void) { return m_TimeLimit; }
     double GetMetabolicEnergyLimit(void) { return m_MetabolicEnergyLimit; }
     double GetMechanicalEnergyLimit(void) { return m_MechanicalEnergyLimit; }
+    bool GetPruned(void) { return m_Pruned; }
     Body *GetBody(const char *name);
     Joint *GetJoint(const char *name);
     Marker *GetMarker(const char *name);
@@ -128,6 +150,8 @@ public:
     void SetTimeLimit(double timeLimit) { m_TimeLimit = timeLimit; }
     void SetMetabolicEnergyLimit(double energyLimit) { m_MetabolicEnergyLimit = energyLimit; }
     void SetMechanicalEnergyLimit(double energyLimit) { m_MechanicalEnergyLimit = energyLimit; }
+    void SetPruneThreshold(double pruneThreshold) { m_PruneThreshold = pruneThreshold; m_PruneFlag = true; }
+    void SetPruneMaximumSpeed(double pruneMaximumSpeed) { m_PruneMaximumSpeed = pruneMaximumSpeed; }
     void SetOutputModelStateAtTime(double outputModelStateAtTime) { m_OutputModelStateAtTime = outputModelStateAtTime; }
     void SetOutputModelStateAtCycle(double outputModelStateAtCycle) { m_OutputModelStateAtCycle = outputModelStateAtCycle; }
     void SetOutputModelStateAtWarehouseDistance(double outputModelStateAtWarehouseDistance) { m_OutputModelStateAtWarehouseDistance = outputModelStateAtWarehouseDistance; }
@@ -161,6 +185,7 @@ public:
     bool TestForCatastrophy();
     double CalculateInstantaneousFitness();
     bool ShouldQuit();
+    bool CannotReachPruneThreshold();
     void SetContactAbort(bool contactAbort) { m_ContactAbort = contactAbort; }
     void SetDataTargetAbort(bool dataTargetAbort) { m_DataTargetAbort = dataTargetAbort; }
 
@@ -173,9 +198,11 @@ public:
     virtual void Dump();
 
     // draw the simulation
+#if defined(USE_QT) || defined(USE_HEADLESS)
+    Interface *GetInterface() { return &m_Interface; }
+#endif
 #ifdef USE_QT
     virtual void Draw(SimulationWindow *window);
-    Interface *GetInterface() { return &m_Interface; }
     void SetMainWindow(MainWindow *mainWindow) { m_MainWindow = mainWindow; }
     MainWindow *GetMainWindow() { return m_MainWindow; }
 #endif
@@ -199,6 +226,13 @@ protected:
     void ParseController(rapidxml::xml_node<char> * cur);
     void ParseWarehouse(rapidxml::xml_node<char> * cur);
 
+    void ReplaceSpace(dSpaceID space);
+    void SetCollisionBits();
+    std::vector<Geom *> GetAllGeoms();
+    void BuildAbortCheckLists();
+    void BuildDataTargetQueue();
+    void BuildMuscleForceLists();
+
    rapidxml::xml_document<char> *m_InputConfigDoc;
    char *m_InputConfigData;
 
@@ -220,6 +254,40 @@ protected:
     std::map<std::string, Warehouse *>m_WarehouseList;
     bool m_DataTargetAbort;
 
+    // only the objects that can abort the simulation so TestForCatastrophy does not search every list
+    std::vector<Body *> m_LimitTestBodyList;
+    std::vector<HingeJoint *> m_TorqueLimitHingeJointList;
+    std::vector<FixedJoint *> m_StressLimitFixedJointList;
+    std::vector<Reporter *> m_AbortReporterList;
+
+    // every target time of every DataTarget in time order so that only the next few need checking each step
+    struct DataTargetEvent
+    {
+        double time;
+        DataTarget *dataTarget;
+        int index;
+        int order; // position in m_DataTargetList so that matches are scored in name order
+        bool operator<(const DataTargetEvent &other) const { return time < other.time || (time == other.time && order < other.order); }
+    };
+    std::vector<DataTargetEvent> m_DataTargetQueue;
+    size_t m_DataTargetQueueNext;
+    std::vector<double> m_DataTargetQueueMaximumFitness; // maximum score from this event onwards
+    bool m_DataTargetQueueBounded;
+    std::vector<DataTargetEvent> m_DueDataTargetEvents;
+
+    // the muscle forces are summed for each body and applied once per body
+    struct BodyForceAccumulator
+    {
+        dBodyID bodyID;
+        double force[3];
+        double torque[3];
+    };
+    std::vector<BodyForceAccumulator> m_MuscleForceBodyList;
+    std::vector<int> m_MuscleForceBodyIndexList; // entry in m_MuscleForceBodyList for every point force in muscle order
+
+    // all the drivers grouped by type and evaluated in one pass before the muscles are updated
+    DriverEngine m_DriverEngine;
+
     // Simulation variables
     dWorldID m_WorldID;
     dSpaceID m_SpaceID;
@@ -228,7 +296,14 @@ protected:
     int m_MaxContacts;
     bool m_AllowInternalCollisions;
     bool m_AllowConnectedCollisions;
+    bool m_ConnectedCollisionsInBroadphase; // the category and collide bits exclude connected bodies
     WorldStepType m_StepType;
+    StrapVelocityType m_StrapVelocityType;
+    double m_MuscleCurveMaxRelativeError; // 0 means use the exact muscle curves
+    int m_DriverUpdateInterval; // steps between driver sum updates
+    DriverEngine::InterpolationType m_DriverInterpolation;
+    int m_MuscleUpdateInterval; // steps between muscle force updates, the forces are held in between
+    int m_DumpInterval; // steps between dumps
 
     // keep track of simulation time
 
@@ -240,8 +315,7 @@ protected:
 
     // and calculated energy
 
-    double m_MechanicalEnergy;
-    double m_MetabolicEnergy;
+    EnergyAccounts m_EnergyAccounts;
     double m_BMR;
 
     // FitnessType
@@ -249,6 +323,10 @@ protected:
     double m_TimeLimit;
     double m_MechanicalEnergyLimit;
     double m_MetabolicEnergyLimit;
+    bool m_PruneFlag;
+    double m_PruneThreshold;
+    double m_PruneMaximumSpeed;
+    bool m_Pruned;
     double m_KinematicMatchMiniMaxFitness;
     double m_ClosestWarehouseFitness;
 
@@ -302,23 +380,15 @@ protected:
     std::vector<Contact *> m_ContactList;
     bool m_ContactAbort;
 
-    // values for energy partition
-    double m_PositiveMechanicalWork;
-    double m_NegativeMechanicalWork;
-    double m_PositiveContractileWork;
-    double m_NegativeContractileWork;
-    double m_PositiveSerialElasticWork;
-    double m_NegativeSerialElasticWork;
-    double m_PositiveParallelElasticWork;
-    double m_NegativeParallelElasticWork;
-
     std::string m_SanityCheckLeft;
     std::string m_SanityCheckRight;
     AxisType m_SanityCheckAxis;
 
-#ifdef USE_QT
+#if defined(USE_QT) || defined(USE_HEADLESS)
     void ParseInterface(rapidxml::xml_node<char> * cur);
     Interface m_Interface;
+#endif
+#ifdef USE_QT
     int m_nextTextureID;
     MainWindow *m_MainWindow;
     bool m_drawContactForces;
@@ -22,6 +22,9 @@ public:
     
     void SetValueDurationPairs(int size, double *valueDurationPairs);
     double GetValue(double time);
+    int GetListLength() { return m_ListLength; }
+    const double *GetValueList() { return m_ValueList; }
+    const double *GetDurationList() { return m_DurationList; }
     
 protected:
     double *m_ValueList;
@@ -14,7 +14,7 @@
 #include "Simulation.h"
 
 #ifdef USE_QT
-#include "FacetedObject.h"
+#include "FacetedBatch.h"
 #endif
 
 Strap::Strap()
@@ -23,13 +23,14 @@ Strap::Strap()
     m_LastLength = 0;
     m_Velocity = 0;
     m_Tension = 0;
+    m_VelocityType = FiniteDifferenceVelocity;
+    m_JacobianValid = false;
 
 #ifdef USE_QT
     m_ForceColour.SetColour(1, 1, 1, 1);
     m_ForceRadius = 0;
     m_ForceScale = 0;
     m_Radius = 0;
-    m_LastDrawTime = -1;
     m_drawMuscleForces = false;
     m_activationDisplay = false;
 #endif
@@ -38,15 +39,69 @@ Strap::Strap()
 
 Strap::~Strap()
 {
-    std::vector<PointForce *>::const_iterator iter1;
-    for (iter1 = m_PointForceList.begin(); iter1 != m_PointForceList.end(); iter1++)
-        delete *iter1;
+}
 
-#ifdef USE_QT
-    std::vector<FacetedObject *>::const_iterator iterFO;
-    for (iterFO = m_DrawList.begin(); iterFO != m_DrawList.end(); iterFO++)
-        delete *iterFO;
-#endif
+// The point force vectors are the forces for unit tension so by virtual work the rate of
+// shortening is the power they deliver, and since the path is tangent to any wrapping
+// surface the movement of the tangent points along the surface does not change the length
+// to first order. This gives dL/dt = -sum(vector . velocity of the point on its body)
+void Strap::CalculateVelocity(double deltaT)
+{
+    m_JacobianValid = false;
+    if (m_VelocityType == AnalyticVelocity)
+    {
+        CalculateJacobian();
+        m_Velocity = 0;
+        for (unsigned int i = 0; i < m_Jacobian.size(); i++)
+        {
+            const dReal *v = dBodyGetLinearVel(m_Jacobian[i].body->GetBodyID());
+            const dReal *w = dBodyGetAngularVel(m_Jacobian[i].body->GetBodyID());
+            m_Velocity += m_Jacobian[i].linear[0] * v[0] + m_Jacobian[i].linear[1] * v[1] + m_Jacobian[i].linear[2] * v[2] +
+                    m_Jacobian[i].angular[0] * w[0] + m_Jacobian[i].angular[1] * w[1] + m_Jacobian[i].angular[2] * w[2];
+        }
+    }
+    else
+    {
+        if (deltaT != 0.0) m_Velocity = (m_Length - m_LastLength) / deltaT;
+        else m_Velocity = 0;
+    }
+}
+
+// the velocity of a point p on a body is v + w x (p - x) so each point force contributes
+// -vector to the linear term and -(p - x) x vector to the angular term
+void Strap::CalculateJacobian()
+{
+    m_Jacobian.clear(); // keeps its storage so this does not allocate after the first step
+    for (unsigned int i = 0; i < m_PointForceList.size(); i++)
+    {
+        const PointForce &pointForce = m_PointForceList[i];
+        unsigned int j;
+        for (j = 0; j < m_Jacobian.size(); j++)
+            if (m_Jacobian[j].body == pointForce.body) break;
+        if (j == m_Jacobian.size())
+        {
+            m_Jacobian.push_back(StrapJacobian());
+            m_Jacobian[j].body = pointForce.body;
+            for (int k = 0; k < 3; k++) m_Jacobian[j].linear[k] = m_Jacobian[j].angular[k] = 0;
+        }
+        StrapJacobian &entry = m_Jacobian[j];
+        const dReal *x = dBodyGetPosition(pointForce.body->GetBodyID());
+        double r[3] = {pointForce.point[0] - x[0], pointForce.point[1] - x[1], pointForce.point[2] - x[2]};
+        const dReal *f = pointForce.vector;
+        entry.linear[0] -= f[0];
+        entry.linear[1] -= f[1];
+        entry.linear[2] -= f[2];
+        entry.angular[0] -= r[1] * f[2] - r[2] * f[1];
+        entry.angular[1] -= r[2] * f[0] - r[0] * f[2];
+        entry.angular[2] -= r[0] * f[1] - r[1] * f[0];
+    }
+    m_JacobianValid = true;
+}
+
+const std::vector<StrapJacobian> *Strap::GetJacobian()
+{
+    if (m_JacobianValid == false) CalculateJacobian();
+    return &m_Jacobian;
 }
 
 void Strap::Dump()
@@ -73,12 +128,12 @@ void Strap::Dump()
 
     if (m_DumpStream)
     {
-        std::vector<PointForce *>::const_iterator iter1;
+        std::vector<PointForce>::const_iterator iter1;
         for (iter1 = m_PointForceList.begin(); iter1 != m_PointForceList.end(); iter1++)
         {
-            *m_DumpStream << m_simulation->GetTime() << "\t" << *((*iter1)->body->GetName()) << "\t" <<
-                             (*iter1)->point[0] << "\t" << (*iter1)->point[1] << "\t" << (*iter1)->point[2] << "\t" <<
-                             (*iter1)->vector[0] * m_Tension << "\t" << (*iter1)->vector[1] * m_Tension << "\t" << (*iter1)->vector[2] * m_Tension << "\n";
+            *m_DumpStream << m_simulation->GetTime() << "\t" << *(iter1->body->GetName()) << "\t" <<
+                             iter1->point[0] << "\t" << iter1->point[1] << "\t" << iter1->point[2] << "\t" <<
+                             iter1->vector[0] * m_Tension << "\t" << iter1->vector[1] * m_Tension << "\t" << iter1->vector[2] * m_Tension << "\n";
         }
     }
 }
@@ -103,5 +158,18 @@ void Strap::setActivationDisplay(bool activationDisplay)
 {
     m_activationDisplay = activationDisplay;
 }
+
+// force arrows start at the point of action and are scaled by the current tension
+void Strap::DrawPointForces(FacetedBatch *batch)
+{
+    if (m_drawMuscleForces == false) return;
+    std::vector<PointForce>::const_iterator iter;
+    for (iter = m_PointForceList.begin(); iter != m_PointForceList.end(); iter++)
+    {
+        pgd::Vector point(iter->point[0], iter->point[1], iter->point[2]);
+        pgd::Vector force(iter->vector[0], iter->vector[1], iter->vector[2]);
+        batch->AddCylinder(point, point + force * m_Tension * m_ForceScale, m_ForceRadius, m_Colour);
+    }
+}
 #endif
 
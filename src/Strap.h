@@ -15,7 +15,16 @@
 #include <vector>
 
 class Body;
-class FacetedObject;
+class FacetedBatch;
+
+// rate of change of strap length with respect to the velocities of a body
+// the generalised force on the body from the strap is -tension times this
+struct StrapJacobian
+{
+    Body *body;
+    dVector3 linear;    // with respect to the linear velocity of the body centre of mass (world coordinates)
+    dVector3 angular;   // with respect to the angular velocity of the body (world coordinates)
+};
 
 struct PointForce
 {
@@ -34,10 +43,16 @@ public:
     double GetLength() { return m_Length; };
     double GetVelocity() { return m_Velocity; };
 
+    void SetVelocityType(StrapVelocityType velocityType) { m_VelocityType = velocityType; };
+    StrapVelocityType GetVelocityType() { return m_VelocityType; };
+
+    // one entry per body that the strap acts on, valid until the next Calculate
+    const std::vector<StrapJacobian> *GetJacobian();
+
     void SetTension(double tension) { m_Tension = tension; };
     double GetTension() { return m_Tension; };
 
-    std::vector<PointForce *> *GetPointForceList() { return &m_PointForceList; };
+    std::vector<PointForce> *GetPointForceList() { return &m_PointForceList; };
 
     virtual void Calculate(double deltaT) = 0;
 
@@ -51,7 +66,6 @@ public:
     void SetForceColour(Colour &colour) { m_ForceColour = colour; };
     void SetForceRadius(float forceSize) { m_ForceRadius = forceSize; };
     void SetForceScale(float forceScale) { m_ForceScale = forceScale; };
-    void SetLastDrawTime(double lastDrawTime) { m_LastDrawTime = lastDrawTime; }
     float GetRadius() { return m_Radius; };
     const Colour *GetForceColour() { return &m_ForceColour; };
     float GetForceRadius() { return m_ForceRadius; };
@@ -67,12 +81,20 @@ public:
 
 protected:
 
+    // called at the end of Calculate once the point forces are set for unit tension
+    void CalculateVelocity(double deltaT);
+    void CalculateJacobian();
+
     double m_Length;
     double m_LastLength;
     double m_Velocity;
     double m_Tension;
+    StrapVelocityType m_VelocityType;
+
+    std::vector<PointForce> m_PointForceList;
 
-    std::vector<PointForce *> m_PointForceList;
+    std::vector<StrapJacobian> m_Jacobian;
+    bool m_JacobianValid;
 
 #ifdef USE_QT
     Colour m_ForceColour;
@@ -80,8 +102,10 @@ protected:
     float m_ForceScale;
     float m_Radius;
 
-    std::vector<FacetedObject *> m_DrawList;
-    double m_LastDrawTime;
+    void DrawPointForces(FacetedBatch *batch);
+
+    std::vector<pgd::Vector> m_DrawPolyline; // reused between draws so its storage is only allocated once
+
     bool m_drawMuscleForces;
     bool m_activationDisplay;
 #endif
@@ -28,6 +28,7 @@ public:
     void SetDirectionAxis(const char *buf);
 
     virtual bool ShouldAbort();
+    virtual bool CanAbort() { return true; }
     virtual void Dump();
 
 protected:
@@ -22,16 +22,17 @@
 #include "DataFile.h"
 #include "Simulation.h"
 #include "DebugControl.h"
+#include "Trace.h"
 
 #ifdef USE_QT
-#include "FacetedPolyline.h"
+#include "FacetedBatch.h"
+#include "SimulationWindow.h"
 #endif
 
 
 ThreePointStrap::ThreePointStrap(): TwoPointStrap()
 {
-    PointForce *midPoint = new PointForce();
-    m_PointForceList.push_back(midPoint);
+    m_PointForceList.resize(3); // origin, insertion, midpoint
 }
 
 ThreePointStrap::~ThreePointStrap()
@@ -41,7 +42,7 @@ ThreePointStrap::~ThreePointStrap()
 void ThreePointStrap::SetMidpoint(Body *body, dVector3 point)
 {
     m_MidpointBody = body;
-    m_PointForceList[2]->body = m_MidpointBody;
+    m_PointForceList[2].body = m_MidpointBody;
     memcpy(m_Midpoint, point, sizeof(m_Midpoint));
 }
 
@@ -102,9 +103,9 @@ ThreePointStrap::SetMidpoint(Body *body, const char *buf)
 
 void ThreePointStrap::Calculate(double deltaT)
 {
-    PointForce *theOrigin = m_PointForceList[0];
-    PointForce *theInsertion = m_PointForceList[1];
-    PointForce *theMidpoint = m_PointForceList[2];
+    PointForce *theOrigin = &m_PointForceList[0];
+    PointForce *theInsertion = &m_PointForceList[1];
+    PointForce *theMidpoint = &m_PointForceList[2];
 
     // calculate the world positions
     dBodyGetRelPointPos(m_OriginBody->GetBodyID(), m_Origin[0], m_Origin[1], m_Origin[2],
@@ -123,13 +124,11 @@ void ThreePointStrap::Calculate(double deltaT)
     line2[1] = theMidpoint->point[1] - theInsertion->point[1];
     line2[2] = theMidpoint->point[2] - theInsertion->point[2];
 
-    // calculate the length and velocity
+    // calculate the length
     m_LastLength = m_Length;
     double length1 = sqrt(line1[0]*line1[0] + line1[1]*line1[1] + line1[2]*line1[2]);
     double length2 = sqrt(line2[0]*line2[0] + line2[1]*line2[1] + line2[2]*line2[2]);
     m_Length = length1 + length2;
-    if (deltaT != 0.0) m_Velocity = (m_Length - m_LastLength) / deltaT;
-    else m_Velocity = 0;
 
     // normalise the direction vectors
     line1[0] /= length1;
@@ -150,18 +149,19 @@ void ThreePointStrap::Calculate(double deltaT)
     memcpy(theInsertion->vector, line2, sizeof(theInsertion->vector));
     memcpy(theMidpoint->vector, midpoint, sizeof(theMidpoint->vector));
 
-    if (gDebug == StrapDebug)
+    CalculateVelocity(deltaT);
+
+    if (TRACE_ON(StrapDebug))
     {
         pgd::Vector totalF(0, 0, 0);
         for (unsigned int i = 0; i < m_PointForceList.size(); i++)
         {
-            *gDebugStream << "ThreePointStrap::Calculate " <<
-            *m_PointForceList[i]->body->GetName() << " " <<
-            m_PointForceList[i]->point[0] << " " << m_PointForceList[i]->point[1] << " " << m_PointForceList[i]->point[2] << " " <<
-            m_PointForceList[i]->vector[0] << " " << m_PointForceList[i]->vector[1] << " " << m_PointForceList[i]->vector[2] << "\n";
-            totalF.x += m_PointForceList[i]->vector[0]; totalF.y += m_PointForceList[i]->vector[1]; totalF.z += m_PointForceList[i]->vector[2];
+            Trace::Record(StrapPointForceEvent, *m_PointForceList[i].body->GetName(),
+                          {m_PointForceList[i].point[0], m_PointForceList[i].point[1], m_PointForceList[i].point[2],
+                           m_PointForceList[i].vector[0], m_PointForceList[i].vector[1], m_PointForceList[i].vector[2]});
+            totalF.x += m_PointForceList[i].vector[0]; totalF.y += m_PointForceList[i].vector[1]; totalF.z += m_PointForceList[i].vector[2];
         }
-        *gDebugStream << "Total F " << totalF.x << " " << totalF.y << " " << totalF.z << "\n";
+        Trace::Record(StrapTotalForceEvent, m_Name, {totalF.x, totalF.y, totalF.z});
     }
 }
 
@@ -233,48 +233,18 @@ int ThreePointStrap::SanityCheck(Strap *otherStrap, AxisType axis, const std::st
 void
 ThreePointStrap::Draw(SimulationWindow *window)
 {
-    const int kSides = 128;
-    FacetedPolyline *facetedPolyline;
-    unsigned int i;
+    FacetedBatch *batch = window->strapBatch();
 
-    if (m_simulation->GetTime() != m_LastDrawTime)
+    if (m_Visible)
     {
-        m_LastDrawTime = m_simulation->GetTime();
-        std::vector<FacetedObject *>::const_iterator iterFO;
-        for (iterFO = m_DrawList.begin(); iterFO != m_DrawList.end(); iterFO++)
-            delete *iterFO;
-        m_DrawList.clear();
-
-        std::vector<pgd::Vector> polyline;
-        polyline.push_back(pgd::Vector(m_PointForceList[0]->point[0], m_PointForceList[0]->point[1], m_PointForceList[0]->point[2]));
-        polyline.push_back(pgd::Vector(m_PointForceList[2]->point[0], m_PointForceList[2]->point[1], m_PointForceList[2]->point[2]));
-        polyline.push_back(pgd::Vector(m_PointForceList[1]->point[0], m_PointForceList[1]->point[1], m_PointForceList[1]->point[2]));
-        facetedPolyline = new FacetedPolyline(&polyline, m_Radius, kSides);
-        facetedPolyline->SetColour(m_Colour);
-        facetedPolyline->setSimulationWindow(window);
-        facetedPolyline->SetVisible(m_Visible);
-        m_DrawList.push_back(facetedPolyline);
-
-        if (m_drawMuscleForces)
-        {
-            for (i = 0; i < m_PointForceList.size(); i++)
-            {
-                polyline.clear();
-                pgd::Vector f = pgd::Vector(m_PointForceList[i]->vector[0], m_PointForceList[i]->vector[1], m_PointForceList[i]->vector[2]) * m_Tension * m_ForceScale;
-                polyline.push_back(pgd::Vector(m_PointForceList[i]->point[0], m_PointForceList[i]->point[1], m_PointForceList[i]->point[2]));
-                polyline.push_back(pgd::Vector(m_PointForceList[i]->point[0], m_PointForceList[i]->point[1], m_PointForceList[i]->point[2]) + f);
-                facetedPolyline = new FacetedPolyline(&polyline, m_ForceRadius, kSides);
-                facetedPolyline->SetColour(m_Colour);
-                facetedPolyline->setSimulationWindow(window);
-                facetedPolyline->SetVisible(m_drawMuscleForces);
-                m_DrawList.push_back(facetedPolyline);
-            }
-        }
+        m_DrawPolyline.clear();
+        m_DrawPolyline.push_back(pgd::Vector(m_PointForceList[0].point[0], m_PointForceList[0].point[1], m_PointForceList[0].point[2]));
+        m_DrawPolyline.push_back(pgd::Vector(m_PointForceList[2].point[0], m_PointForceList[2].point[1], m_PointForceList[2].point[2]));
+        m_DrawPolyline.push_back(pgd::Vector(m_PointForceList[1].point[0], m_PointForceList[1].point[1], m_PointForceList[1].point[2]));
+        batch->AddPolyline(m_DrawPolyline, m_Radius, m_Colour);
     }
 
-    for (i = 0; i < m_DrawList.size(); i++)
-        m_DrawList[i]->Draw();
-
+    DrawPointForces(batch);
 }
 #endif
 
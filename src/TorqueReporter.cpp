@@ -173,7 +173,7 @@ void TorqueReporter::Dump()
     if (m_DumpStream)
     {
         // sum the torques acting on body 0 of the joint
-        std::vector<PointForce *> *pointForceList = mMuscle->GetPointForceList();
+        std::vector<PointForce> *pointForceList = mMuscle->GetPointForceList();
         double tension = mMuscle->GetTension();
         pgd::Vector torque, point, force, centre;
         double *forcePoint, *forceDirection;
@@ -187,12 +187,12 @@ void TorqueReporter::Dump()
 //        {
 //            for (unsigned int i = 0; i < pointForceList->size(); i++)
 //            {
-//                if ((*pointForceList)[i]->body == mBody)
+//                if ((*pointForceList)[i].body == mBody)
 //                {
 //                    //Torque = cross(Point - Center, Force)
-//                    forcePoint = (*pointForceList)[i]->point;
+//                    forcePoint = (*pointForceList)[i].point;
 //                    point = pgd::Vector(forcePoint[0], forcePoint[1], forcePoint[2]);
-//                    forceDirection = (*pointForceList)[i]->vector;
+//                    forceDirection = (*pointForceList)[i].vector;
 //                    force = pgd::Vector(forceDirection[0], forceDirection[1], forceDirection[2]) * tension;
 //                    torque = (point - centre) ^ force;
 //                    totalTorque += torque;
@@ -204,12 +204,12 @@ void TorqueReporter::Dump()
           {
             for (unsigned int i = 0; i < pointForceList->size(); i++)
             {
-                if ((*pointForceList)[i]->body == mBody)
+                if ((*pointForceList)[i].body == mBody)
                 {
                     //Torque = cross(Point - Center, Force)
-                    forcePoint = (*pointForceList)[i]->point;
+                    forcePoint = (*pointForceList)[i].point;
                     point = pgd::Vector(forcePoint[0], forcePoint[1], forcePoint[2]);
-                    forceDirection = (*pointForceList)[i]->vector;
+                    forceDirection = (*pointForceList)[i].vector;
                     force = pgd::Vector(forceDirection[0], forceDirection[1], forceDirection[2]);
                     torque = (point - centre) ^ force;
                     momentArm += torque;
@@ -0,0 +1,337 @@
+/*
+ *  Trace.cpp
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <iostream>
+
+#include "Trace.h"
+
+static const char gTraceMagic[8] = {'G', 'S', 'T', 'R', 'A', 'C', 'E', '1'};
+static const uint32_t gTraceVersion = 1;
+static const uint32_t gTraceByteOrder = 0x01020304;
+
+static const Trace::EventDescription gTraceEvents[NumTraceEvents] =
+{
+    {StrapDebug, "Strap::Calculate", "px py pz fx fy fz"},
+    {StrapDebug, "Strap::Calculate Total F", "fx fy fz"},
+    {CylinderWrapStrapDebug, "CylinderWrapStrap::Calculate",
+     "cylinderOriginPosition.x cylinderOriginPosition.y cylinderOriginPosition.z "
+     "cylinderInsertionPosition.x cylinderInsertionPosition.y cylinderInsertionPosition.z "
+     "theOriginForce.x theOriginForce.y theOriginForce.z "
+     "theInsertionForce.x theInsertionForce.y theInsertionForce.z "
+     "theCylinderForcePosition.x theCylinderForcePosition.y theCylinderForcePosition.z "
+     "theCylinderForce.x theCylinderForce.y theCylinderForce.z "
+     "m_Length m_Velocity m_WrapStatus"},
+    {TwoCylinderWrapStrapDebug, "TwoCylinderWrapStrap::Calculate",
+     "cylinderOriginPosition.x cylinderOriginPosition.y cylinderOriginPosition.z "
+     "cylinderInsertionPosition.x cylinderInsertionPosition.y cylinderInsertionPosition.z "
+     "theOriginForce.x theOriginForce.y theOriginForce.z "
+     "theInsertionForce.x theInsertionForce.y theInsertionForce.z "
+     "theCylinder1ForcePosition.x theCylinder1ForcePosition.y theCylinder1ForcePosition.z "
+     "theCylinder1Force.x theCylinder1Force.y theCylinder1Force.z "
+     "theCylinder2ForcePosition.x theCylinder2ForcePosition.y theCylinder2ForcePosition.z "
+     "theCylinder2Force.x theCylinder2Force.y theCylinder2Force.z "
+     "m_Length m_Velocity m_WrapStatus"},
+    {DampedSpringDebug, "DampedSpringMuscle::UpdateTension", "length m_UnloadedLength m_SpringConstant velocity m_Damping tension"},
+    {MAMuscleDebug, "MAMuscle::SetAlpha", "alpha m_Alpha m_F0 m_VMax m_Velocity fFull m_Length fCE"},
+    {MAMuscleDebug, "MAMuscle::GetMetabolicPower", "m_Alpha m_F0 m_VMax m_Velocity sigma power"},
+    {MAMuscleCompleteDebug, "MAMuscleComplete::SetActivation",
+     "spe epe dpe smpe sse ese dse smse k vmax fmax width "
+     "alpha timeIncrement len v lastlpe "
+     "fce lpe fpe lse fse vce vse targetFce f0 err"},
+    {MAMuscleCompleteDebug, "MAMuscleComplete::GetMetabolicPower", "alpha f0 vmax m_Velocity sigma power"},
+    {MAMuscleExtendedDebug, "MAMuscleExtended::SetActivation",
+     "progress m_Stim m_Act len fpe lpe lse fse fce m_Velocity m_Tension vce serialStrainEnergy parallelStrainEnergy"},
+    {MAMuscleExtendedDebug, "MAMuscleExtended::GetMetabolicPower", "m_Act f0 vmax m_Velocity sigma power"},
+    {UGMMuscleDebug, "UGMMuscle::SetStim concentric fixup", "m_vce"},
+    {UGMMuscleDebug, "UGMMuscle::SetStim eccentric fixup", "m_vce"},
+    {UGMMuscleDebug, "UGMMuscle::SetStim negative speed limit fixup", "m_vce"},
+    {UGMMuscleDebug, "UGMMuscle::SetStim positive speed limit fixup", "m_vce"},
+    {UGMMuscleDebug, "UGMMuscle::SetStim negative length fixup", "m_lce"},
+    {UGMMuscleDebug, "UGMMuscle::SetStim",
+     "m_act m_stim m_fiso m_lce m_vce concentricFlag m_fce fse fpe m_Tension m_Length m_Velocity"},
+    {UGMMuscleDebug, "UGMMuscle::GetMetabolicPower", "amhdot slhdot cewdot cehdot metabolicPower"},
+    {HingeJointDebug, "HingeJoint::GetStopTorque", "loStop hiStop angle kp t"},
+    {MuscleDebug, "Muscle", "length velocity tension power activation metabolic"}
+};
+
+struct Trace::Buffer
+{
+    std::vector<char> data;
+    size_t used;
+    uint32_t thread;
+    std::map<std::string, uint32_t> names; // copy of the name IDs this thread has used so the lookup does not need the mutex
+};
+
+double Trace::m_time = 0;
+FILE *Trace::m_file = 0;
+size_t Trace::m_bufferSize = 0;
+
+// the mutex protects the file, the buffer list and the name table
+static std::mutex gTraceMutex;
+static std::vector<Trace::Buffer *> gTraceBuffers;
+static std::map<std::string, uint32_t> gTraceNames;
+static int gTraceGeneration = 0; // incremented when a file is closed so that stale thread buffers are not reused
+static thread_local Trace::Buffer *gThreadBuffer = 0;
+static thread_local int gThreadBufferGeneration = -1;
+
+const Trace::EventDescription *Trace::GetEventDescription(TraceEvent event)
+{
+    if (event < 0 || event >= NumTraceEvents) return 0;
+    return &gTraceEvents[event];
+}
+
+bool Trace::OpenFile(const char *filename, size_t bufferSize)
+{
+    if (m_file) CloseFile();
+
+    std::lock_guard<std::mutex> lock(gTraceMutex);
+    FILE *file = fopen(filename, "wb");
+    if (file == 0) return true;
+
+    FileHeader header;
+    memcpy(header.magic, gTraceMagic, sizeof(header.magic));
+    header.version = gTraceVersion;
+    header.byteOrder = gTraceByteOrder;
+    if (fwrite(&header, sizeof(header), 1, file) != 1)
+    {
+        fclose(file);
+        return true;
+    }
+    m_file = file;
+    m_bufferSize = bufferSize;
+
+    // the event descriptions are stored in the file so that it can be decoded by other versions of the program
+    bool error = false;
+    for (int i = 0; i < NumTraceEvents; i++)
+    {
+        std::string description(gTraceEvents[i].label);
+        description.push_back(0);
+        description.append(gTraceEvents[i].valueNames);
+        description.push_back(0);
+        uint32_t ids[2] = {uint32_t(i), uint32_t(gTraceEvents[i].category)};
+        error |= WriteChunk(EventChunk, 0, ids, sizeof(ids), description.data(), description.size());
+    }
+    if (error)
+    {
+        fclose(m_file);
+        m_file = 0;
+        return true;
+    }
+    return false;
+}
+
+void Trace::CloseFile()
+{
+    std::lock_guard<std::mutex> lock(gTraceMutex);
+    if (m_file == 0) return;
+    for (size_t i = 0; i < gTraceBuffers.size(); i++)
+    {
+        Buffer *buffer = gTraceBuffers[i];
+        if (buffer->used) WriteChunk(RecordChunk, buffer->thread, buffer->data.data(), buffer->used, 0, 0);
+        delete buffer;
+    }
+    gTraceBuffers.clear();
+    gTraceNames.clear();
+    gTraceGeneration++;
+    fclose(m_file);
+    m_file = 0;
+}
+
+void Trace::Record(TraceEvent event, const std::string &name, const double *values, int numValues)
+{
+    if (m_file == 0)
+    {
+        FormatRecord(*gDebugStream, gTraceEvents[event].label, gTraceEvents[event].valueNames, name, m_time, values, numValues);
+        return;
+    }
+
+    Buffer *buffer = GetThreadBuffer();
+    std::map<std::string, uint32_t>::const_iterator found = buffer->names.find(name);
+    if (found == buffer->names.end()) found = buffer->names.insert(std::make_pair(name, GetNameID(name))).first;
+
+    RecordHeader header;
+    header.time = m_time;
+    header.nameID = found->second;
+    header.event = uint16_t(event);
+    header.numValues = uint16_t(numValues);
+    size_t valuesSize = sizeof(double) * numValues;
+    size_t size = sizeof(header) + valuesSize;
+
+    if (buffer->used + size > buffer->data.size())
+    {
+        FlushBuffer(buffer);
+        if (size > buffer->data.size()) buffer->data.resize(size);
+    }
+    memcpy(buffer->data.data() + buffer->used, &header, sizeof(header));
+    memcpy(buffer->data.data() + buffer->used + sizeof(header), values, valuesSize);
+    buffer->used += size;
+}
+
+Trace::Buffer *Trace::GetThreadBuffer()
+{
+    if (gThreadBufferGeneration == gTraceGeneration) return gThreadBuffer;
+
+    std::lock_guard<std::mutex> lock(gTraceMutex);
+    Buffer *buffer = new Buffer();
+    buffer->data.resize(m_bufferSize);
+    buffer->used = 0;
+    buffer->thread = uint32_t(gTraceBuffers.size());
+    gTraceBuffers.push_back(buffer);
+    gThreadBuffer = buffer;
+    gThreadBufferGeneration = gTraceGeneration;
+    return buffer;
+}
+
+uint32_t Trace::GetNameID(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(gTraceMutex);
+    std::map<std::string, uint32_t>::const_iterator found = gTraceNames.find(name);
+    if (found != gTraceNames.end()) return found->second;
+
+    // new names are written straight away so they always precede the records that use them
+    uint32_t id = uint32_t(gTraceNames.size());
+    gTraceNames[name] = id;
+    WriteChunk(NameChunk, 0, &id, sizeof(id), name.data(), name.size());
+    return id;
+}
+
+void Trace::FlushBuffer(Buffer *buffer)
+{
+    std::lock_guard<std::mutex> lock(gTraceMutex);
+    if (buffer->used) WriteChunk(RecordChunk, buffer->thread, buffer->data.data(), buffer->used, 0, 0);
+    buffer->used = 0;
+}
+
+// the caller must hold gTraceMutex
+bool Trace::WriteChunk(uint32_t type, uint32_t thread, const void *data1, size_t size1, const void *data2, size_t size2)
+{
+    ChunkHeader chunkHeader;
+    chunkHeader.type = type;
+    chunkHeader.thread = thread;
+    chunkHeader.size = size1 + size2;
+    bool error = false;
+    error |= fwrite(&chunkHeader, sizeof(chunkHeader), 1, m_file) != 1;
+    if (size1) error |= fwrite(data1, size1, 1, m_file) != 1;
+    if (size2) error |= fwrite(data2, size2, 1, m_file) != 1;
+    if (error) std::cerr << "Trace::WriteChunk error writing trace file\n";
+    return error;
+}
+
+void Trace::FormatRecord(std::ostream &outputStream, const char *label, const char *valueNames,
+                         const std::string &name, double time, const double *values, int numValues)
+{
+    outputStream << label << " " << name << " time " << time;
+    const char *p = valueNames;
+    for (int i = 0; i < numValues; i++)
+    {
+        while (*p == ' ') p++;
+        const char *start = p;
+        while (*p && *p != ' ') p++;
+        if (p != start)
+        {
+            outputStream << " ";
+            outputStream.write(start, p - start);
+        }
+        outputStream << " " << values[i];
+    }
+    outputStream << "\n";
+}
+
+bool Trace::Decode(const char *filename, std::ostream &outputStream)
+{
+    FILE *file = fopen(filename, "rb");
+    if (file == 0)
+    {
+        std::cerr << "Trace::Decode error opening " << filename << "\n";
+        return true;
+    }
+
+    FileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, gTraceMagic, sizeof(header.magic)) != 0)
+    {
+        std::cerr << "Trace::Decode error " << filename << " is not a trace file\n";
+        fclose(file);
+        return true;
+    }
+    if (header.byteOrder != gTraceByteOrder || header.version != gTraceVersion)
+    {
+        std::cerr << "Trace::Decode error " << filename << " has the wrong byte order or version\n";
+        fclose(file);
+        return true;
+    }
+
+    std::map<uint32_t, std::string> labels;
+    std::map<uint32_t, std::string> valueNames;
+    std::map<uint32_t, std::string> names;
+    std::vector<char> data;
+    std::vector<double> values;
+    ChunkHeader chunkHeader;
+    bool error = false;
+    while (fread(&chunkHeader, sizeof(chunkHeader), 1, file) == 1)
+    {
+        data.resize(size_t(chunkHeader.size));
+        if (chunkHeader.size && fread(data.data(), size_t(chunkHeader.size), 1, file) != 1)
+        {
+            std::cerr << "Trace::Decode error " << filename << " is truncated\n";
+            error = true;
+            break;
+        }
+
+        if (chunkHeader.type == EventChunk && data.size() > 2 * sizeof(uint32_t))
+        {
+            uint32_t event;
+            memcpy(&event, data.data(), sizeof(event));
+            const char *label = data.data() + 2 * sizeof(uint32_t);
+            size_t labelLength = strnlen(label, data.size() - 2 * sizeof(uint32_t));
+            labels[event] = std::string(label, labelLength);
+            if (label + labelLength + 1 < data.data() + data.size())
+                valueNames[event] = std::string(label + labelLength + 1);
+            continue;
+        }
+
+        if (chunkHeader.type == NameChunk && data.size() >= sizeof(uint32_t))
+        {
+            uint32_t id;
+            memcpy(&id, data.data(), sizeof(id));
+            names[id] = std::string(data.data() + sizeof(id), data.size() - sizeof(id));
+            continue;
+        }
+
+        if (chunkHeader.type == RecordChunk)
+        {
+            size_t position = 0;
+            while (position + sizeof(RecordHeader) <= data.size())
+            {
+                RecordHeader recordHeader;
+                memcpy(&recordHeader, data.data() + position, sizeof(recordHeader));
+                position += sizeof(recordHeader);
+                size_t valuesSize = sizeof(double) * recordHeader.numValues;
+                if (position + valuesSize > data.size()) break;
+                values.resize(recordHeader.numValues);
+                if (valuesSize) memcpy(values.data(), data.data() + position, valuesSize);
+                position += valuesSize;
+                FormatRecord(outputStream, labels[recordHeader.event].c_str(), valueNames[recordHeader.event].c_str(),
+                             names[recordHeader.nameID], recordHeader.time, values.data(), int(values.size()));
+            }
+            if (position != data.size())
+            {
+                std::cerr << "Trace::Decode error corrupt record chunk in " << filename << "\n";
+                error = true;
+            }
+        }
+        // unknown chunk types are skipped
+    }
+
+    fclose(file);
+    return error;
+}
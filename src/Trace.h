@@ -0,0 +1,133 @@
+/*
+ *  Trace.h
+ *  GaitSymODE
+ *
+ *  Created by Bill Sellers on 19/10/2016.
+ *  Copyright 2016 Bill Sellers. All rights reserved.
+ *
+ */
+
+// Trace handles the debug output from the functions that are called many
+// times per step. Each trace point is guarded by TRACE_ON(category) which is
+// a compile time constant false for categories that are not in the
+// TRACE_CATEGORIES bit mask (bit n is DebugControl value n) so those trace
+// points are removed completely by the compiler. When a category is compiled
+// in it is selected at run time with gDebug as before.
+// If a trace file has been opened the records are written in binary into a
+// buffer per thread and the buffers are written to the file when they are
+// full and when the file is closed. Otherwise each record is formatted
+// immediately on gDebugStream. Decode converts a trace file back into the
+// text form. The byte order is the native order of the machine that wrote
+// the file and files with the wrong byte order are rejected.
+
+#ifndef Trace_h
+#define Trace_h
+
+#include "DebugControl.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <initializer_list>
+
+#ifndef TRACE_CATEGORIES
+#define TRACE_CATEGORIES 0xffffffffffffffffULL // everything compiled in
+#endif
+
+#define TRACE_COMPILED(category) (((((unsigned long long)(TRACE_CATEGORIES)) >> (category)) & 1ULL) != 0)
+#define TRACE_ON(category) (TRACE_COMPILED(category) && gDebug == (category))
+
+enum TraceEvent
+{
+    StrapPointForceEvent = 0,
+    StrapTotalForceEvent,
+    CylinderWrapStrapEvent,
+    TwoCylinderWrapStrapEvent,
+    DampedSpringTensionEvent,
+    MAMuscleSetAlphaEvent,
+    MAMuscleMetabolicPowerEvent,
+    MAMuscleCompleteActivationEvent,
+    MAMuscleCompleteMetabolicPowerEvent,
+    MAMuscleExtendedActivationEvent,
+    MAMuscleExtendedMetabolicPowerEvent,
+    UGMMuscleConcentricFixupEvent,
+    UGMMuscleEccentricFixupEvent,
+    UGMMuscleNegativeSpeedLimitEvent,
+    UGMMusclePositiveSpeedLimitEvent,
+    UGMMuscleLengthFixupEvent,
+    UGMMuscleStimEvent,
+    UGMMuscleMetabolicPowerEvent,
+    HingeJointStopTorqueEvent,
+    MuscleStateEvent,
+    NumTraceEvents
+};
+
+class Trace
+{
+public:
+    struct EventDescription
+    {
+        DebugControl category;
+        const char *label;
+        const char *valueNames; // space separated, empty if the values are unlabelled
+    };
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+    };
+
+    enum ChunkType { EventChunk = 1, NameChunk = 2, RecordChunk = 3 };
+
+    struct ChunkHeader
+    {
+        uint32_t type;
+        uint32_t thread;
+        uint64_t size; // bytes following the chunk header
+    };
+
+    struct RecordHeader
+    {
+        double time;
+        uint32_t nameID;
+        uint16_t event;
+        uint16_t numValues; // number of doubles following the record header
+    };
+
+    static const EventDescription *GetEventDescription(TraceEvent event);
+
+    // the time stamp used for all subsequent records
+    static void SetTime(double time) { m_time = time; }
+
+    // returns true on error
+    static bool OpenFile(const char *filename, size_t bufferSize = 1 << 20);
+    static void CloseFile();
+    static bool IsFileOpen() { return m_file != 0; }
+
+    static void Record(TraceEvent event, const std::string &name, const double *values, int numValues);
+    static void Record(TraceEvent event, const std::string &name, std::initializer_list<double> values)
+    {
+        Record(event, name, values.begin(), int(values.size()));
+    }
+
+    // writes the text version of a trace file to outputStream, returns true on error
+    static bool Decode(const char *filename, std::ostream &outputStream);
+
+    struct Buffer;
+
+protected:
+    static Buffer *GetThreadBuffer();
+    static uint32_t GetNameID(const std::string &name);
+    static void FlushBuffer(Buffer *buffer);
+    static bool WriteChunk(uint32_t type, uint32_t thread, const void *data1, size_t size1, const void *data2, size_t size2);
+    static void FormatRecord(std::ostream &outputStream, const char *label, const char *valueNames,
+                             const std::string &name, double time, const double *values, int numValues);
+
+    static double m_time;
+    static FILE *m_file;
+    static size_t m_bufferSize;
+};
+
+#endif // Trace_h
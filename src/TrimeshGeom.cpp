@@ -9,33 +9,25 @@
 
 #include <ode/ode.h>
 #include <string>
+#include <iostream>
 
 #include "TrimeshGeom.h"
 #include "FacetedObject.h"
+#include "DebugControl.h"
+
+std::map<const FacetedObject::SharedMesh *, std::shared_ptr<TrimeshGeom::TrimeshData> > TrimeshGeom::m_DataCache;
+std::mutex TrimeshGeom::m_DataCacheMutex;
 
 // create the trimesh object
-// note FacetedObject is used for drawing so must remain valid
-// if drawing is required. However it isn't used for colision detection after creation
-// and it isn't deleted by the TrimeshGeom
+// note FacetedObject is used for drawing and is owned by the TrimeshGeom
+// The collision data is built from the FacetedObject shared mesh (one is created
+// if necessary) so that every geom using the same mesh uses the same data
 TrimeshGeom::TrimeshGeom(dSpaceID space, FacetedObject *facetedObject)
 {
-    /*
-    facetedObject->CalculateTrimesh(&m_Vertices, &m_NumVertices, &m_VertexStride, &m_TriIndexes, &m_NumTriIndexes, &m_TriStride);
-    m_TriMeshDataID = dGeomTriMeshDataCreate();
-    dGeomTriMeshDataBuildSingle (m_TriMeshDataID, m_Vertices, m_VertexStride, m_NumVertices, m_TriIndexes, m_NumTriIndexes, m_TriStride);
-    */
-
-    m_Vertices = facetedObject->GetVertexList();
-    m_TriIndexes = facetedObject->GetIndexList();
-    m_NumVertices = facetedObject->GetNumVertices();
-    m_NumTriIndexes = m_NumVertices;
-
-    m_TriMeshDataID = dGeomTriMeshDataCreate();
-    dGeomTriMeshDataBuildDouble(m_TriMeshDataID,
-                                m_Vertices, 3 * sizeof(double), m_NumVertices,
-                                m_TriIndexes, m_NumTriIndexes, 3 * sizeof(int));
-
-    m_GeomID =  dCreateTriMesh (space, m_TriMeshDataID, 0, 0, 0);
+    if (facetedObject->GetSharedMesh() == 0) facetedObject->SetSharedMesh(facetedObject->CreateSharedMesh());
+    m_TrimeshData = GetTrimeshData(facetedObject->GetSharedMesh());
+
+    m_GeomID =  dCreateTriMesh (space, m_TrimeshData->triMeshDataID, 0, 0, 0);
     dGeomSetData(m_GeomID, this);
 
     // and finally assign the faceted object
@@ -44,9 +36,48 @@ TrimeshGeom::TrimeshGeom(dSpaceID space, FacetedObject *facetedObject)
 
 TrimeshGeom::~TrimeshGeom()
 {
-    dGeomTriMeshDataDestroy(m_TriMeshDataID);
-    //delete [] m_Vertices;
-    //delete [] m_TriIndexes;
+    // the geom has to go before the data it uses
+    dGeomDestroy(m_GeomID);
+    m_GeomID = 0;
+    m_TrimeshData.reset();
+    delete m_FacetedObject;
+}
+
+TrimeshGeom::TrimeshData::~TrimeshData()
+{
+    dGeomTriMeshDataDestroy(triMeshDataID);
+}
+
+std::shared_ptr<TrimeshGeom::TrimeshData> TrimeshGeom::GetTrimeshData(const std::shared_ptr<const FacetedObject::SharedMesh> &mesh)
+{
+    std::lock_guard<std::mutex> lock(m_DataCacheMutex);
+    std::map<const FacetedObject::SharedMesh *, std::shared_ptr<TrimeshData> >::iterator iter = m_DataCache.find(mesh.get());
+    if (iter != m_DataCache.end()) return iter->second;
+
+    std::shared_ptr<TrimeshData> data(new TrimeshData());
+    data->mesh = mesh;
+    data->triMeshDataID = dGeomTriMeshDataCreate();
+    dGeomTriMeshDataBuildDouble(data->triMeshDataID,
+                                mesh->vertices, 3 * sizeof(double), mesh->numVertices,
+                                mesh->indices, mesh->numTriangles * 3, 3 * sizeof(int));
+
+    m_DataCache[mesh.get()] = data;
+    if (gDebug == FacetedObjectDebug)
+        *gDebugStream << "TrimeshGeom::GetTrimeshData\tbuilt\tvertices\t" << mesh->numVertices << "\ttriangles\t" << mesh->numTriangles << "\n";
+    return data;
+}
+
+// removes all the data not currently used by a geom
+void TrimeshGeom::ClearDataCache()
+{
+    std::lock_guard<std::mutex> lock(m_DataCacheMutex);
+    for (std::map<const FacetedObject::SharedMesh *, std::shared_ptr<TrimeshData> >::iterator iter = m_DataCache.begin(); iter != m_DataCache.end();)
+    {
+        if (iter->second.use_count() == 1)
+            iter = m_DataCache.erase(iter);
+        else
+            iter++;
+    }
 }
 
 #ifdef USE_QT
@@ -11,11 +11,11 @@
 #define TRIMESHGEOM_H
 
 #include "Geom.h"
+#include "FacetedObject.h"
 
-class FacetedObject;
-class StridedVertex;
-class StridedTri;
-class GimpactStridedVertex;
+#include <map>
+#include <memory>
+#include <mutex>
 
 class TrimeshGeom : public Geom
 {
@@ -27,23 +27,28 @@ public:
     virtual void Draw(SimulationWindow *window);
 #endif
 
+    // the collision data (including the OPCODE tree) is built once per shared mesh
+    // and reused by every TrimeshGeom that uses that mesh in any Simulation
+    // it has to be cleared before ODE is closed
+    static void ClearDataCache();
+
 protected:
 
-    FacetedObject *m_FacetedObject;
+    struct TrimeshData
+    {
+        ~TrimeshData();
 
-#ifdef USE_GIMPACT
-    GimpactStridedVertex *m_Vertices;
-#else
-    double *m_Vertices;
-#endif
-    int m_NumVertices;
-    int m_VertexStride;
-    int *m_TriIndexes;
-    int m_NumTriIndexes;
-    int m_TriStride;
-    dTriMeshDataID m_TriMeshDataID;
+        std::shared_ptr<const FacetedObject::SharedMesh> mesh; // keeps the vertices and indices valid
+        dTriMeshDataID triMeshDataID;
+    };
+
+    static std::shared_ptr<TrimeshData> GetTrimeshData(const std::shared_ptr<const FacetedObject::SharedMesh> &mesh);
 
+    FacetedObject *m_FacetedObject;
+    std::shared_ptr<TrimeshData> m_TrimeshData;
+
+    static std::map<const FacetedObject::SharedMesh *, std::shared_ptr<TrimeshData> > m_DataCache;
+    static std::mutex m_DataCacheMutex;
 };
 
 #endif // TRIMESHGEOM_H
-
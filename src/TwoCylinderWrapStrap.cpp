@@ -23,33 +23,24 @@
 #include "Util.h"
 
 #include "DebugControl.h"
+#include "Trace.h"
 
 #ifdef USE_QT
-#include "FacetedPolyline.h"
+#include "FacetedBatch.h"
+#include "SimulationWindow.h"
 #endif
 
 TwoCylinderWrapStrap::TwoCylinderWrapStrap()
 {
-    PointForce *origin = new PointForce();
-    PointForce *insertion = new PointForce();
-    PointForce *cylinder1 = new PointForce();
-    PointForce *cylinder2 = new PointForce();
-    m_PointForceList.push_back(origin);
-    m_PointForceList.push_back(insertion);
-    m_PointForceList.push_back(cylinder1);
-    m_PointForceList.push_back(cylinder2);
+    m_PointForceList.resize(4); // origin, insertion, cylinder1, cylinder2
 
     m_Cylinder1Radius = 1;
     m_Cylinder2Radius = 1;
     m_WrapStatus = -1;
     m_NumWrapSegments = 16;
     m_NumPathCoordinates = 0;
-
-#ifdef USE_QT
-    m_PathCoordinates = new pgd::Vector[m_NumWrapSegments * 2 + 6];
-#else
     m_PathCoordinates = 0;
-#endif
+    m_PathCoordinatesValid = false;
 }
 
 TwoCylinderWrapStrap::~TwoCylinderWrapStrap()
@@ -60,7 +51,7 @@ TwoCylinderWrapStrap::~TwoCylinderWrapStrap()
 void TwoCylinderWrapStrap::SetOrigin(Body *body, dVector3 point)
 {
     m_OriginBody = body;
-    m_PointForceList[0]->body = m_OriginBody;
+    m_PointForceList[0].body = m_OriginBody;
     m_OriginPosition.x = point[0];
     m_OriginPosition.y = point[1];
     m_OriginPosition.z = point[2];
@@ -124,7 +115,7 @@ void TwoCylinderWrapStrap::SetOrigin(Body *body, const char *buf)
 void TwoCylinderWrapStrap::SetInsertion(Body *body, dVector3 point)
 {
     m_InsertionBody = body;
-    m_PointForceList[1]->body = m_InsertionBody;
+    m_PointForceList[1].body = m_InsertionBody;
     m_InsertionPosition.x = point[0];
     m_InsertionPosition.y = point[1];
     m_InsertionPosition.z = point[2];
@@ -187,7 +178,7 @@ void TwoCylinderWrapStrap::SetInsertion(Body *body, const char *buf)
 void TwoCylinderWrapStrap::SetCylinder1Body(Body *body)
 {
     m_Cylinder1Body = body;
-    m_PointForceList[2]->body = m_Cylinder1Body;
+    m_PointForceList[2].body = m_Cylinder1Body;
 }
 
 void TwoCylinderWrapStrap::SetCylinder1Position(double x, double y, double z)
@@ -435,7 +426,7 @@ void TwoCylinderWrapStrap::SetCylinderQuaternion(const char *buf)
 void TwoCylinderWrapStrap::SetCylinder2Body(Body *body)
 {
     m_Cylinder2Body = body;
-    m_PointForceList[3]->body = m_Cylinder2Body;
+    m_PointForceList[3].body = m_Cylinder2Body;
 }
 
 void TwoCylinderWrapStrap::SetCylinder2Position(double x, double y, double z)
@@ -516,7 +507,6 @@ void TwoCylinderWrapStrap::SetCylinder2Position(const char *buf)
 
 void TwoCylinderWrapStrap::Calculate(double deltaT)
 {
-    int i;
     // get the necessary body orientations and positions
     const double *q;
     q = dBodyGetQuaternion(m_OriginBody->GetBodyID());
@@ -536,9 +526,9 @@ void TwoCylinderWrapStrap::Calculate(double deltaT)
     q = dBodyGetPosition(m_Cylinder2Body->GetBodyID());
     pgd::Vector vCylinder2Body(q[0], q[1], q[2]);
 
-    // calculate some inverses
-    pgd::Quaternion qCylinder1BodyInv = ~qCylinder1Body; // we only need qCylinder1Body because the m_CylinderQuaternion is relative to body 1
-    pgd::Quaternion qCylinderQuaternionInv = ~m_CylinderQuaternion;
+    // calculate some inverses (as rotators since each is used more than once)
+    pgd::QVRotator cylinder1BodyInvRotator(~qCylinder1Body); // we only need qCylinder1Body because the m_CylinderQuaternion is relative to body 1
+    pgd::QVRotator cylinderQuaternionInvRotator(~m_CylinderQuaternion);
 
     // get the world coordinates of the origin and insertion
     pgd::Vector worldOriginPosition = QVRotate(qOriginBody, m_OriginPosition) + vOriginBody;
@@ -549,10 +539,13 @@ void TwoCylinderWrapStrap::Calculate(double deltaT)
     pgd::Vector worldCylinder2Position = QVRotate(qCylinder2Body, m_Cylinder2Position) + vCylinder2Body;
 
     // now rotate so the cylider axes are lined up on the z axis
-    pgd::Vector cylinderOriginPosition = QVRotate(qCylinderQuaternionInv, QVRotate(qCylinder1BodyInv, worldOriginPosition));
-    pgd::Vector cylinderInsertionPosition = QVRotate(qCylinderQuaternionInv, QVRotate(qCylinder1BodyInv, worldInsertionPosition));
-    pgd::Vector cylinderCylinder1Position = QVRotate(qCylinderQuaternionInv, QVRotate(qCylinder1BodyInv, worldCylinder1Position));
-    pgd::Vector cylinderCylinder2Position = QVRotate(qCylinderQuaternionInv, QVRotate(qCylinder1BodyInv, worldCylinder2Position));
+    pgd::Vector cylinderPositions[4] = {worldOriginPosition, worldInsertionPosition, worldCylinder1Position, worldCylinder2Position};
+    cylinder1BodyInvRotator.Rotate(cylinderPositions, cylinderPositions, 4);
+    cylinderQuaternionInvRotator.Rotate(cylinderPositions, cylinderPositions, 4);
+    pgd::Vector cylinderOriginPosition = cylinderPositions[0];
+    pgd::Vector cylinderInsertionPosition = cylinderPositions[1];
+    pgd::Vector cylinderCylinder1Position = cylinderPositions[2];
+    pgd::Vector cylinderCylinder2Position = cylinderPositions[3];
 
     pgd::Vector theOriginForce;
     pgd::Vector theInsertionForce;
@@ -563,71 +556,100 @@ void TwoCylinderWrapStrap::Calculate(double deltaT)
     m_LastLength = m_Length;
     double tension = 1; // normalised initially because tension is applied by muscle
 
+    int numPathCoordinates;
     TwoCylinderWrap(cylinderOriginPosition, cylinderInsertionPosition, cylinderCylinder1Position, m_Cylinder1Radius,
                     cylinderCylinder2Position, m_Cylinder2Radius, tension, m_NumWrapSegments, M_PI,
                     theOriginForce, theInsertionForce, theCylinder1Force, theCylinder1ForcePosition,
                     theCylinder2Force, theCylinder2ForcePosition, &m_Length,
-                    m_PathCoordinates, &m_NumPathCoordinates, &m_WrapStatus);
+                    0, &numPathCoordinates, &m_WrapStatus);
 
-    // calculate the length and velocity
-    if (deltaT != 0.0) m_Velocity = (m_Length - m_LastLength) / deltaT;
-    else m_Velocity = 0;
+    m_CylinderOriginPosition = cylinderOriginPosition;
+    m_CylinderInsertionPosition = cylinderInsertionPosition;
+    m_CylinderCylinder1Position = cylinderCylinder1Position;
+    m_CylinderCylinder2Position = cylinderCylinder2Position;
+    m_Cylinder1BodyQuaternion = qCylinder1Body;
+    m_PathCoordinatesValid = false;
 
-    if (gDebug == TwoCylinderWrapStrapDebug)
-    {
-        *gDebugStream << "TwoCylinderWrapStrap::Calculate m_Name " << m_Name << " " <<
-                         "cylinderOriginPosition " << cylinderOriginPosition.x << " " << cylinderOriginPosition.y << " " << cylinderOriginPosition.z << " " <<
-                         "cylinderInsertionPosition " << cylinderInsertionPosition.x << " " << cylinderInsertionPosition.y << " " << cylinderInsertionPosition.z << "  " <<
-                         "theOriginForce " << theOriginForce.x << " " << theOriginForce.y << " " << theOriginForce.z << " " <<
-                         "theInsertionForce " << theInsertionForce.x << " " << theInsertionForce.y << " " << theInsertionForce.z << "  " <<
-                         "theCylinder1ForcePosition " << theCylinder1ForcePosition.x << " " << theCylinder1ForcePosition.y << " " << theCylinder1ForcePosition.z << "  " <<
-                         "theCylinder1Force " << theCylinder1Force.x << " " << theCylinder1Force.y << " " << theCylinder1Force.z << "  " <<
-                         "theCylinder2ForcePosition " << theCylinder2ForcePosition.x << " " << theCylinder2ForcePosition.y << " " << theCylinder2ForcePosition.z << "  " <<
-                         "theCylinder2Force " << theCylinder2Force.x << " " << theCylinder2Force.y << " " << theCylinder2Force.z << "  " <<
-                         "m_Length " << m_Length << " m_Velocity " << m_Velocity << " m_WrapStatus " << m_WrapStatus << "\n";
-    }
     // now rotate back to world reference frame
 
-    theOriginForce = QVRotate(qCylinder1Body, QVRotate(m_CylinderQuaternion, theOriginForce));
-    theInsertionForce = QVRotate(qCylinder1Body, QVRotate(m_CylinderQuaternion, theInsertionForce));
-    theCylinder1Force = QVRotate(qCylinder1Body, QVRotate(m_CylinderQuaternion, theCylinder1Force));
-    theCylinder1ForcePosition = QVRotate(qCylinder1Body, QVRotate(m_CylinderQuaternion, theCylinder1ForcePosition));
-    theCylinder2Force = QVRotate(qCylinder1Body, QVRotate(m_CylinderQuaternion, theCylinder2Force));
-    theCylinder2ForcePosition = QVRotate(qCylinder1Body, QVRotate(m_CylinderQuaternion, theCylinder2ForcePosition));
-
-
-    PointForce *theOrigin = m_PointForceList[0];
-    PointForce *theInsertion = m_PointForceList[1];
-    PointForce *theCylinder1 = m_PointForceList[2];
-    PointForce *theCylinder2 = m_PointForceList[3];
-    theOrigin->vector[0] = theOriginForce.x; theOrigin->vector[1] = theOriginForce.y; theOrigin->vector[2] = theOriginForce.z;
+    pgd::QVRotator cylinderQuaternionRotator(m_CylinderQuaternion);
+    pgd::QVRotator cylinder1BodyRotator(qCylinder1Body);
+    pgd::Vector forceVectors[6] = {theOriginForce, theInsertionForce, theCylinder1Force, theCylinder1ForcePosition, theCylinder2Force, theCylinder2ForcePosition};
+    cylinderQuaternionRotator.Rotate(forceVectors, forceVectors, 6);
+    cylinder1BodyRotator.Rotate(forceVectors, forceVectors, 6);
+    const pgd::Vector &worldOriginForce = forceVectors[0];
+    const pgd::Vector &worldInsertionForce = forceVectors[1];
+    const pgd::Vector &worldCylinder1Force = forceVectors[2];
+    const pgd::Vector &worldCylinder1ForcePosition = forceVectors[3];
+    const pgd::Vector &worldCylinder2Force = forceVectors[4];
+    const pgd::Vector &worldCylinder2ForcePosition = forceVectors[5];
+
+
+    PointForce *theOrigin = &m_PointForceList[0];
+    PointForce *theInsertion = &m_PointForceList[1];
+    PointForce *theCylinder1 = &m_PointForceList[2];
+    PointForce *theCylinder2 = &m_PointForceList[3];
+    theOrigin->vector[0] = worldOriginForce.x; theOrigin->vector[1] = worldOriginForce.y; theOrigin->vector[2] = worldOriginForce.z;
     theOrigin->point[0] = worldOriginPosition.x; theOrigin->point[1] = worldOriginPosition.y; theOrigin->point[2] = worldOriginPosition.z;
-    theInsertion->vector[0] = theInsertionForce.x; theInsertion->vector[1] = theInsertionForce.y; theInsertion->vector[2] = theInsertionForce.z;
+    theInsertion->vector[0] = worldInsertionForce.x; theInsertion->vector[1] = worldInsertionForce.y; theInsertion->vector[2] = worldInsertionForce.z;
     theInsertion->point[0] = worldInsertionPosition.x; theInsertion->point[1] = worldInsertionPosition.y; theInsertion->point[2] = worldInsertionPosition.z;
-    theCylinder1->vector[0] = theCylinder1Force.x; theCylinder1->vector[1] = theCylinder1Force.y; theCylinder1->vector[2] = theCylinder1Force.z;
-    theCylinder1->point[0] = theCylinder1ForcePosition.x; theCylinder1->point[1] = theCylinder1ForcePosition.y; theCylinder1->point[2] = theCylinder1ForcePosition.z;
-    theCylinder2->vector[0] = theCylinder2Force.x; theCylinder2->vector[1] = theCylinder2Force.y; theCylinder2->vector[2] = theCylinder2Force.z;
-    theCylinder2->point[0] = theCylinder2ForcePosition.x; theCylinder2->point[1] = theCylinder2ForcePosition.y; theCylinder2->point[2] = theCylinder2ForcePosition.z;
+    theCylinder1->vector[0] = worldCylinder1Force.x; theCylinder1->vector[1] = worldCylinder1Force.y; theCylinder1->vector[2] = worldCylinder1Force.z;
+    theCylinder1->point[0] = worldCylinder1ForcePosition.x; theCylinder1->point[1] = worldCylinder1ForcePosition.y; theCylinder1->point[2] = worldCylinder1ForcePosition.z;
+    theCylinder2->vector[0] = worldCylinder2Force.x; theCylinder2->vector[1] = worldCylinder2Force.y; theCylinder2->vector[2] = worldCylinder2Force.z;
+    theCylinder2->point[0] = worldCylinder2ForcePosition.x; theCylinder2->point[1] = worldCylinder2ForcePosition.y; theCylinder2->point[2] = worldCylinder2ForcePosition.z;
 
-    // and handle the path coordinates
-    for (i = 0; i < m_NumPathCoordinates; i++)
+    CalculateVelocity(deltaT);
+
+    // the wrap values are reported in the cylinder frame
+    if (TRACE_ON(TwoCylinderWrapStrapDebug))
     {
-        m_PathCoordinates[i] = QVRotate(qCylinder1Body, QVRotate(m_CylinderQuaternion, m_PathCoordinates[i]));
+        Trace::Record(TwoCylinderWrapStrapEvent, m_Name,
+                      {cylinderOriginPosition.x, cylinderOriginPosition.y, cylinderOriginPosition.z,
+                       cylinderInsertionPosition.x, cylinderInsertionPosition.y, cylinderInsertionPosition.z,
+                       theOriginForce.x, theOriginForce.y, theOriginForce.z,
+                       theInsertionForce.x, theInsertionForce.y, theInsertionForce.z,
+                       theCylinder1ForcePosition.x, theCylinder1ForcePosition.y, theCylinder1ForcePosition.z,
+                       theCylinder1Force.x, theCylinder1Force.y, theCylinder1Force.z,
+                       theCylinder2ForcePosition.x, theCylinder2ForcePosition.y, theCylinder2ForcePosition.z,
+                       theCylinder2Force.x, theCylinder2Force.y, theCylinder2Force.z,
+                       m_Length, m_Velocity, double(m_WrapStatus)});
     }
 
-    if (gDebug == StrapDebug)
+    if (TRACE_ON(StrapDebug))
     {
         pgd::Vector totalF(0, 0, 0);
-        for (i = 0; i < (int)m_PointForceList.size(); i++)
+        for (int i = 0; i < (int)m_PointForceList.size(); i++)
         {
-            *gDebugStream << "TwoCylinderWrapStrap::Calculate " <<
-                    *m_PointForceList[i]->body->GetName() << " " <<
-                    m_PointForceList[i]->point[0] << " " << m_PointForceList[i]->point[1] << " " << m_PointForceList[i]->point[2] << " " <<
-                    m_PointForceList[i]->vector[0] << " " << m_PointForceList[i]->vector[1] << " " << m_PointForceList[i]->vector[2] << "\n";
-            totalF.x += m_PointForceList[i]->vector[0]; totalF.y += m_PointForceList[i]->vector[1]; totalF.z += m_PointForceList[i]->vector[2];
+            Trace::Record(StrapPointForceEvent, *m_PointForceList[i].body->GetName(),
+                          {m_PointForceList[i].point[0], m_PointForceList[i].point[1], m_PointForceList[i].point[2],
+                           m_PointForceList[i].vector[0], m_PointForceList[i].vector[1], m_PointForceList[i].vector[2]});
+            totalF.x += m_PointForceList[i].vector[0]; totalF.y += m_PointForceList[i].vector[1]; totalF.z += m_PointForceList[i].vector[2];
         }
-        *gDebugStream << "Total F " << totalF.x << " " << totalF.y << " " << totalF.z << "\n";
+        Trace::Record(StrapTotalForceEvent, m_Name, {totalF.x, totalF.y, totalF.z});
+    }
+}
+
+// repeats the wrap from the stored cylinder frame positions with the path generation switched on
+// and then rotates the path back into the world frame used by the last Calculate
+const pgd::Vector *TwoCylinderWrapStrap::GetPathCoordinates(int *numPathCoordinates)
+{
+    if (m_PathCoordinatesValid == false)
+    {
+        if (m_PathCoordinates == 0) m_PathCoordinates = new pgd::Vector[m_NumWrapSegments * 2 + 6];
+        pgd::Vector originForce, insertionForce, cylinder1Force, cylinder1ForcePosition, cylinder2Force, cylinder2ForcePosition;
+        double pathLength;
+        int wrapStatus;
+        TwoCylinderWrap(m_CylinderOriginPosition, m_CylinderInsertionPosition, m_CylinderCylinder1Position, m_Cylinder1Radius,
+                        m_CylinderCylinder2Position, m_Cylinder2Radius, 1, m_NumWrapSegments, M_PI,
+                        originForce, insertionForce, cylinder1Force, cylinder1ForcePosition,
+                        cylinder2Force, cylinder2ForcePosition, &pathLength,
+                        m_PathCoordinates, &m_NumPathCoordinates, &wrapStatus);
+        pgd::QVRotator(m_CylinderQuaternion).Rotate(m_PathCoordinates, m_PathCoordinates, m_NumPathCoordinates);
+        pgd::QVRotator(m_Cylinder1BodyQuaternion).Rotate(m_PathCoordinates, m_PathCoordinates, m_NumPathCoordinates);
+        m_PathCoordinatesValid = true;
     }
+    *numPathCoordinates = m_NumPathCoordinates;
+    return m_PathCoordinates;
 }
 
 // function to wrap a line around two parallel cylinders
@@ -1271,28 +1293,13 @@ int TwoCylinderWrapStrap::SanityCheck(Strap *otherStrap, AxisType axis, const st
 #ifdef USE_QT
 void TwoCylinderWrapStrap::Draw(SimulationWindow *window)
 {
-    const int kSides = 128;
-    FacetedPolyline *facetedPolyline;
-    unsigned int i;
+    FacetedBatch *batch = window->strapBatch();
 
-    if (m_simulation->GetTime() != m_LastDrawTime)
+    if (m_Visible)
     {
-        m_LastDrawTime = m_simulation->GetTime();
-        std::vector<FacetedObject *>::const_iterator iterFO;
-        for (iterFO = m_DrawList.begin(); iterFO != m_DrawList.end(); iterFO++)
-            delete *iterFO;
-        m_DrawList.clear();
-
-        std::vector<pgd::Vector> polyline;
-        for (i = 0; i < (unsigned int)m_NumPathCoordinates; i++)
-        {
-            polyline.push_back(m_PathCoordinates[i]);
-        }
-        facetedPolyline = new FacetedPolyline(&polyline, m_Radius, kSides);
-        facetedPolyline->SetColour(m_Colour);
-        facetedPolyline->setSimulationWindow(window);
-        facetedPolyline->SetVisible(m_Visible);
-        m_DrawList.push_back(facetedPolyline);
+        int numPathCoordinates;
+        const pgd::Vector *pathCoordinates = GetPathCoordinates(&numPathCoordinates);
+        batch->AddPolyline(pathCoordinates, numPathCoordinates, m_Radius, m_Colour);
 
         // calculate the quaternion that rotates from cylinder coordinates to world coordinates
         const double *q = dBodyGetQuaternion(m_Cylinder1Body->GetBodyID());
@@ -1303,44 +1310,15 @@ void TwoCylinderWrapStrap::Draw(SimulationWindow *window)
         dVector3 position;
         dBodyGetRelPointPos(m_Cylinder1Body->GetBodyID(), m_Cylinder1Position.x, m_Cylinder1Position.y, m_Cylinder1Position.z, position);
         // and draw it
-        polyline.clear();
-        polyline.push_back(pgd::Vector(position[0] - cylinderVecWorld.x, position[1] - cylinderVecWorld.y, position[2] - cylinderVecWorld.z));
-        polyline.push_back(pgd::Vector(position[0] + cylinderVecWorld.x, position[1] + cylinderVecWorld.y, position[2] + cylinderVecWorld.z));
-        facetedPolyline = new FacetedPolyline(&polyline, m_Cylinder1Radius, kSides);
-        facetedPolyline->SetColour(m_CylinderColour);
-        facetedPolyline->setSimulationWindow(window);
-        facetedPolyline->SetVisible(m_Visible);
-        m_DrawList.push_back(facetedPolyline);
+        pgd::Vector cylinderCentre(position[0], position[1], position[2]);
+        batch->AddCylinder(cylinderCentre - cylinderVecWorld, cylinderCentre + cylinderVecWorld, m_Cylinder1Radius, m_CylinderColour);
 
         dBodyGetRelPointPos(m_Cylinder2Body->GetBodyID(), m_Cylinder2Position.x, m_Cylinder2Position.y, m_Cylinder2Position.z, position);
         // and draw it
-        polyline.clear();
-        polyline.push_back(pgd::Vector(position[0] - cylinderVecWorld.x, position[1] - cylinderVecWorld.y, position[2] - cylinderVecWorld.z));
-        polyline.push_back(pgd::Vector(position[0] + cylinderVecWorld.x, position[1] + cylinderVecWorld.y, position[2] + cylinderVecWorld.z));
-        facetedPolyline = new FacetedPolyline(&polyline, m_Cylinder2Radius, kSides);
-        facetedPolyline->SetColour(m_CylinderColour);
-        facetedPolyline->setSimulationWindow(window);
-        facetedPolyline->SetVisible(m_Visible);
-        m_DrawList.push_back(facetedPolyline);
-
-        if (m_drawMuscleForces)
-        {
-            for (i = 0; i < m_PointForceList.size(); i++)
-            {
-                polyline.clear();
-                pgd::Vector f = pgd::Vector(m_PointForceList[i]->vector[0], m_PointForceList[i]->vector[1], m_PointForceList[i]->vector[2]) * m_Tension * m_ForceScale;
-                polyline.push_back(pgd::Vector(m_PointForceList[i]->point[0], m_PointForceList[i]->point[1], m_PointForceList[i]->point[2]));
-                polyline.push_back(pgd::Vector(m_PointForceList[i]->point[0], m_PointForceList[i]->point[1], m_PointForceList[i]->point[2]) + f);
-                facetedPolyline = new FacetedPolyline(&polyline, m_ForceRadius, kSides);
-                facetedPolyline->SetColour(m_Colour);
-                facetedPolyline->setSimulationWindow(window);
-                facetedPolyline->SetVisible(m_drawMuscleForces);
-                m_DrawList.push_back(facetedPolyline);
-            }
-        }
+        cylinderCentre = pgd::Vector(position[0], position[1], position[2]);
+        batch->AddCylinder(cylinderCentre - cylinderVecWorld, cylinderCentre + cylinderVecWorld, m_Cylinder2Radius, m_CylinderColour);
     }
 
-    for (i = 0; i < m_DrawList.size(); i++)
-        m_DrawList[i]->Draw();
+    DrawPointForces(batch);
 }
 #endif
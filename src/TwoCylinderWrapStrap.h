@@ -37,7 +37,7 @@ public:
     void SetCylinder2Radius(double radius) { m_Cylinder2Radius = radius; };
     void SetCylinder2Position(double x, double y, double z);
     void SetCylinder2Position(const char *buf);
-    void SetNumWrapSegments(int num) { m_NumWrapSegments = num; };
+    void SetNumWrapSegments(int num) { m_NumWrapSegments = num; delete [] m_PathCoordinates; m_PathCoordinates = 0; m_PathCoordinatesValid = false; };
 
     virtual void Calculate(double deltaT);
 
@@ -46,6 +46,9 @@ public:
     void GetCylinder1(Body **body, dVector3 pos, double *radius, dQuaternion q);
     void GetCylinder2(Body **body, dVector3 pos, double *radius, dQuaternion q);
 
+    // the path is only needed for drawing so it is generated on request from the last Calculate
+    const pgd::Vector *GetPathCoordinates(int *numPathCoordinates);
+
     virtual int SanityCheck(Strap *otherStrap, AxisType axis, const std::string &sanityCheckLeft, const std::string &sanityCheckRight);
 
 #ifdef USE_QT
@@ -88,8 +91,16 @@ protected:
 
     int m_WrapStatus;
 
+    // the cylinder frame state from the last Calculate which is all the path needs
+    pgd::Vector m_CylinderOriginPosition;
+    pgd::Vector m_CylinderInsertionPosition;
+    pgd::Vector m_CylinderCylinder1Position;
+    pgd::Vector m_CylinderCylinder2Position;
+    pgd::Quaternion m_Cylinder1BodyQuaternion;
+
     pgd::Vector *m_PathCoordinates;
     int m_NumPathCoordinates;
+    bool m_PathCoordinatesValid;
 
 #ifdef USE_QT
     Colour m_CylinderColour;
@@ -23,17 +23,16 @@
 #include "DataFile.h"
 #include "Simulation.h"
 #include "DebugControl.h"
+#include "Trace.h"
 
 #ifdef USE_QT
-#include "FacetedPolyline.h"
+#include "FacetedBatch.h"
+#include "SimulationWindow.h"
 #endif
 
 TwoPointStrap::TwoPointStrap()
 {
-    PointForce *origin = new PointForce();
-    PointForce *insertion = new PointForce();
-    m_PointForceList.push_back(origin);
-    m_PointForceList.push_back(insertion);
+    m_PointForceList.resize(2); // origin, insertion
 }
 
 TwoPointStrap::~TwoPointStrap()
@@ -43,7 +42,7 @@ TwoPointStrap::~TwoPointStrap()
 void TwoPointStrap::SetOrigin(Body *body, dVector3 point)
 {
     m_OriginBody = body;
-    m_PointForceList[0]->body = m_OriginBody;
+    m_PointForceList[0].body = m_OriginBody;
     memcpy(m_Origin, point, sizeof(m_Origin));
 }
 
@@ -106,7 +105,7 @@ TwoPointStrap::SetOrigin(Body *body, const char *buf)
 void TwoPointStrap::SetInsertion(Body *body, dVector3 point)
 {
     m_InsertionBody = body;
-    m_PointForceList[1]->body = m_InsertionBody;
+    m_PointForceList[1].body = m_InsertionBody;
     memcpy(m_Insertion, point, sizeof(m_Insertion));
 }
 
@@ -167,8 +166,8 @@ TwoPointStrap::SetInsertion(Body *body, const char *buf)
 
 void TwoPointStrap::Calculate(double deltaT)
 {
-    PointForce *theOrigin = m_PointForceList[0];
-    PointForce *theInsertion = m_PointForceList[1];
+    PointForce *theOrigin = &m_PointForceList[0];
+    PointForce *theInsertion = &m_PointForceList[1];
 
     // calculate the world positions
     dBodyGetRelPointPos(m_OriginBody->GetBodyID(), m_Origin[0], m_Origin[1], m_Origin[2],
@@ -182,11 +181,9 @@ void TwoPointStrap::Calculate(double deltaT)
     line[1] = theInsertion->point[1] - theOrigin->point[1];
     line[2] = theInsertion->point[2] - theOrigin->point[2];
 
-    // calculate the length and velocity
+    // calculate the length
     m_LastLength = m_Length;
     m_Length = sqrt(line[0]*line[0] + line[1]*line[1] + line[2]*line[2]);
-    if (deltaT != 0.0) m_Velocity = (m_Length - m_LastLength) / deltaT;
-    else m_Velocity = 0;
 
     // normalise the direction vector
     line[0] /= m_Length;
@@ -202,18 +199,19 @@ void TwoPointStrap::Calculate(double deltaT)
 
     memcpy(theInsertion->vector, line, sizeof(theInsertion->vector));
 
-    if (gDebug == StrapDebug)
+    CalculateVelocity(deltaT);
+
+    if (TRACE_ON(StrapDebug))
     {
         pgd::Vector totalF(0, 0, 0);
         for (unsigned int i = 0; i < m_PointForceList.size(); i++)
         {
-            *gDebugStream << "TwoPointStrap::Calculate " <<
-            *m_PointForceList[i]->body->GetName() << " " <<
-            m_PointForceList[i]->point[0] << " " << m_PointForceList[i]->point[1] << " " << m_PointForceList[i]->point[2] << " " <<
-            m_PointForceList[i]->vector[0] << " " << m_PointForceList[i]->vector[1] << " " << m_PointForceList[i]->vector[2] << "\n";
-            totalF.x += m_PointForceList[i]->vector[0]; totalF.y += m_PointForceList[i]->vector[1]; totalF.z += m_PointForceList[i]->vector[2];
+            Trace::Record(StrapPointForceEvent, *m_PointForceList[i].body->GetName(),
+                          {m_PointForceList[i].point[0], m_PointForceList[i].point[1], m_PointForceList[i].point[2],
+                           m_PointForceList[i].vector[0], m_PointForceList[i].vector[1], m_PointForceList[i].vector[2]});
+            totalF.x += m_PointForceList[i].vector[0]; totalF.y += m_PointForceList[i].vector[1]; totalF.z += m_PointForceList[i].vector[2];
         }
-        *gDebugStream << "Total F " << totalF.x << " " << totalF.y << " " << totalF.z << "\n";
+        Trace::Record(StrapTotalForceEvent, m_Name, {totalF.x, totalF.y, totalF.z});
     }
 }
 
@@ -274,46 +272,17 @@ int TwoPointStrap::SanityCheck(Strap *otherStrap, AxisType axis, const std::stri
 void
 TwoPointStrap::Draw(SimulationWindow *window)
 {
-    const int kSides = 128;
-    FacetedPolyline *facetedPolyline;
-    unsigned int i;
+    FacetedBatch *batch = window->strapBatch();
 
-    if (m_simulation->GetTime() != m_LastDrawTime)
+    if (m_Visible)
     {
-        m_LastDrawTime = m_simulation->GetTime();
-        std::vector<FacetedObject *>::const_iterator iterFO;
-        for (iterFO = m_DrawList.begin(); iterFO != m_DrawList.end(); iterFO++)
-            delete *iterFO;
-        m_DrawList.clear();
-
-        std::vector<pgd::Vector> polyline;
-        polyline.push_back(pgd::Vector(m_PointForceList[0]->point[0], m_PointForceList[0]->point[1], m_PointForceList[0]->point[2]));
-        polyline.push_back(pgd::Vector(m_PointForceList[1]->point[0], m_PointForceList[1]->point[1], m_PointForceList[1]->point[2]));
-        facetedPolyline = new FacetedPolyline(&polyline, m_Radius, kSides);
-        facetedPolyline->SetColour(m_Colour);
-        facetedPolyline->setSimulationWindow(window);
-        facetedPolyline->SetVisible(m_Visible);
-        m_DrawList.push_back(facetedPolyline);
-
-        if (m_drawMuscleForces)
-        {
-            for (i = 0; i < m_PointForceList.size(); i++)
-            {
-                polyline.clear();
-                pgd::Vector f = pgd::Vector(m_PointForceList[i]->vector[0], m_PointForceList[i]->vector[1], m_PointForceList[i]->vector[2]) * m_Tension * m_ForceScale;
-                polyline.push_back(pgd::Vector(m_PointForceList[i]->point[0], m_PointForceList[i]->point[1], m_PointForceList[i]->point[2]));
-                polyline.push_back(pgd::Vector(m_PointForceList[i]->point[0], m_PointForceList[i]->point[1], m_PointForceList[i]->point[2]) + f);
-                facetedPolyline = new FacetedPolyline(&polyline, m_ForceRadius, kSides);
-                facetedPolyline->SetColour(m_Colour);
-                facetedPolyline->setSimulationWindow(window);
-                facetedPolyline->SetVisible(m_drawMuscleForces);
-                m_DrawList.push_back(facetedPolyline);
-            }
-        }
+        m_DrawPolyline.clear();
+        m_DrawPolyline.push_back(pgd::Vector(m_PointForceList[0].point[0], m_PointForceList[0].point[1], m_PointForceList[0].point[2]));
+        m_DrawPolyline.push_back(pgd::Vector(m_PointForceList[1].point[0], m_PointForceList[1].point[1], m_PointForceList[1].point[2]));
+        batch->AddPolyline(m_DrawPolyline, m_Radius, m_Colour);
     }
 
-    for (i = 0; i < m_DrawList.size(); i++)
-        m_DrawList[i]->Draw();
+    DrawPointForces(batch);
 }
 #endif
 
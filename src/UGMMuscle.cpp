@@ -17,6 +17,7 @@
 #include "Strap.h"
 #include "Util.h"
 #include "DebugControl.h"
+#include "Trace.h"
 #include "UGMMuscle.h"
 #include "Simulation.h"
 
@@ -160,6 +161,18 @@ void UGMMuscle::SetModellingConstants(double specificTension, double relativeCon
     m_density = muscleDensity;
 }
 
+// do any intialisation that relies on the strap being set up properly
+void UGMMuscle::LateInitialisation()
+{
+    Muscle::LateInitialisation();
+
+    // the lower limits match the minimum values for m_act and m_stim in SetStim
+    BuildCurveTable(&m_activationFactorTable, "ActivationFactor", [](double act) { return pow(act, -0.3); },
+                    0.0001, 1.0, CurveTable::OctaveGrid);
+    BuildCurveTable(&m_maintenanceHeatScaleTable, "MaintenanceHeatScale", [](double ea) { return pow(ea, 0.6); },
+                    0.00001, 1.0, CurveTable::OctaveGrid);
+}
+
 // set the activation level
 // this code directly modified from the fortran
 // but missing the pennation angle sections
@@ -264,7 +277,7 @@ void UGMMuscle::SetStim(double stim, double timeIncrement)
 
     // Contracile element velocity
     // this is the modified version after email 3
-    double Afact = pow(m_act, -0.3);
+    double Afact = m_activationFactorTable.IsValid() ? m_activationFactorTable.Evaluate(m_act) : pow(m_act, -0.3);
     double arel = Afact * m_arel;
     if (m_lce >= m_lceopt)
         arel = arel * m_fiso;
@@ -290,7 +303,7 @@ void UGMMuscle::SetStim(double stim, double timeIncrement)
         else if (den <= 0)
         {
             m_vce = -m_vmaxft * m_lceopt;
-            if (gDebug == UGMMuscleDebug) *gDebugStream << "Applying concentric m_vce = -m_vmaxft * m_lceopt fixup to " << m_Name << "\n";
+            if (TRACE_ON(UGMMuscleDebug)) Trace::Record(UGMMuscleConcentricFixupEvent, m_Name, {m_vce});
         }
         else
         {
@@ -328,7 +341,7 @@ void UGMMuscle::SetStim(double stim, double timeIncrement)
         else if (den >= 0)
         {
             m_vce = m_vmaxft * m_lceopt;
-            if (gDebug == UGMMuscleDebug) *gDebugStream << "Applying eccentric m_vce = m_vmaxft * m_lceopt fixup to " << m_Name << "\n";
+            if (TRACE_ON(UGMMuscleDebug)) Trace::Record(UGMMuscleEccentricFixupEvent, m_Name, {m_vce});
         }
         else
         {
@@ -340,36 +353,26 @@ void UGMMuscle::SetStim(double stim, double timeIncrement)
     double speedLimit = m_vmaxft * m_lceopt;
     if (m_vce < -speedLimit)
     {
-        if (gDebug == UGMMuscleDebug) *gDebugStream << "Negative speed limit fix applied\n";
+        if (TRACE_ON(UGMMuscleDebug)) Trace::Record(UGMMuscleNegativeSpeedLimitEvent, m_Name, {m_vce});
         m_vce = -speedLimit;
     }
     else if (m_vce > speedLimit)
     {
-        if (gDebug == UGMMuscleDebug) *gDebugStream << "Positive speed limit fix applied\n";
+        if (TRACE_ON(UGMMuscleDebug)) Trace::Record(UGMMusclePositiveSpeedLimitEvent, m_Name, {m_vce});
         m_vce = speedLimit;
     }
     m_lce += m_vce * timeIncrement;
     if (m_lce < 0)
     {
-        if (gDebug == UGMMuscleDebug) *gDebugStream << "m_vce < 0 fix applied\n";
+        if (TRACE_ON(UGMMuscleDebug)) Trace::Record(UGMMuscleLengthFixupEvent, m_Name, {m_lce});
         m_lce = 0;
     }
 
-    if (gDebug == UGMMuscleDebug)
+    if (TRACE_ON(UGMMuscleDebug))
     {
-        *gDebugStream << "MAMuscle::SetStim " << m_Name << " "
-        << "m_act " << m_act << " "
-        << "m_stim " << m_stim << " "
-        << "m_fiso " << m_fiso << " "
-        << "m_lce " << m_lce << " "
-        << "m_vce " << m_vce << " "
-        << "concentricFlag " << concentricFlag << " "
-        << "m_fce " << m_fce << " "
-        << "fse " << fse << " "
-        << "fpe " << fpe << " "
-        << "m_Tension " << m_Strap->GetTension() << " "
-        << "m_Length " << m_Strap->GetLength() << " "
-        << "m_Velocity " << m_Strap->GetVelocity() << "\n";
+        Trace::Record(UGMMuscleStimEvent, m_Name,
+                      {m_act, m_stim, m_fiso, m_lce, m_vce, double(concentricFlag), m_fce, fse, fpe,
+                       m_Strap->GetTension(), m_Strap->GetLength(), m_Strap->GetVelocity()});
     }
 }
 
@@ -390,7 +393,7 @@ double UGMMuscle::GetMetabolicPower()
         ea = (m_stim + m_act) * 0.5;
 
     //c--- Nonlinear scaling of amhdot & slhdot
-    double eamh = pow(ea, 0.6);
+    double eamh = m_maintenanceHeatScaleTable.IsValid() ? m_maintenanceHeatScaleTable.Evaluate(ea) : pow(ea, 0.6);
     double eash = pow(ea, 2.0);
 
     // What follows is eq 18, although the nesting of the if's has
@@ -456,15 +459,8 @@ double UGMMuscle::GetMetabolicPower()
         else metabolicPower = cehdot * m_mass;
     }
 
-    if (gDebug == UGMMuscleDebug)
-    {
-        *gDebugStream << "MAMuscle::GetMetabolicPower " << m_Name << " "
-        << "amhdot " << amhdot << " "
-        << "slhdot " << slhdot << " "
-        << "cewdot " << cewdot << " "
-        << "cehdot " << cehdot << " "
-        << "metabolicPower " << metabolicPower << "\n";
-    }
+    if (TRACE_ON(UGMMuscleDebug))
+        Trace::Record(UGMMuscleMetabolicPowerEvent, m_Name, {amhdot, slhdot, cewdot, cehdot, metabolicPower});
 
     return metabolicPower;
 }
@@ -679,6 +675,13 @@ c--- CE mechanical power output, normalized to muscle mass
       end
 */
 
+void UGMMuscle::AccumulateEnergy(EnergyAccounts *accounts, int muscleIndex, double timeIncrement)
+{
+    Muscle::AccumulateEnergy(accounts, muscleIndex, timeIncrement);
+    accounts->AddElementWork(muscleIndex, GetVCE(), GetFCE(), GetVSE(), GetFSE(), GetVPE(), GetFPE(), timeIncrement);
+    if (accounts->GetRecordElasticEnergy()) accounts->SetElementEnergies(muscleIndex, GetESE(), GetEPE());
+}
+
 void UGMMuscle::Dump()
 {
     if (m_Dump == false) return;
@@ -67,6 +67,8 @@ public:
     double GetStimulation() { return m_stim; }
 
     virtual void Dump();
+    virtual void LateInitialisation();
+    virtual void AccumulateEnergy(EnergyAccounts *accounts, int muscleIndex, double timeIncrement);
 
 protected:
 
@@ -106,6 +108,10 @@ protected:
     double m_serialStrainAtFmax;
     bool m_allowReverseWork;
     bool m_newObject;
+
+    // optional tables for the power law scalings
+    CurveTable m_activationFactorTable; // pow(act, -0.3)
+    CurveTable m_maintenanceHeatScaleTable; // pow(ea, 0.6)
 };
 
 #endif